@@ -21,6 +21,8 @@
 #include <assert.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 
 #include "esp_err.h"
 #include "esp_partition.h"
@@ -44,6 +46,37 @@
 
 #define SUB_TYPE_ID(i) (i & 0x0F) 
 
+/* With OTA_WITH_SEQUENTIAL_WRITES, the partition is erased in blocks of this size
+   where possible, as erasing a block takes much less time than erasing its sectors */
+#define OTA_ERASE_BLOCK_SIZE        0x10000
+/* A block is only erased if the image uses at least this much of it, as erasing
+   a block takes about as long as erasing 3-4 sectors */
+#define OTA_ERASE_BLOCK_MIN_USED    (4 * SPI_FLASH_SEC_SIZE)
+
+#define OTA_WRITE_BUF_SIZE          SPI_FLASH_SEC_SIZE
+#define OTA_WRITE_BUF_COUNT         2
+#define OTA_WRITE_TASK_STACK_SIZE   3072
+
+/* Data to be written by the writer task. A request with NULL data stops the task. */
+typedef struct {
+    uint8_t *data;
+    uint32_t offset;
+    size_t size;
+    uint32_t image_len;
+} ota_write_req_t;
+
+typedef struct {
+    uint8_t *buf;                   /* Buffer being filled by esp_ota_write() */
+    uint32_t buf_offset;            /* Partition offset where the buffer is written */
+    size_t buf_len;
+    uint32_t image_len;             /* Image length known when the buffer was filled */
+    QueueHandle_t write_reqs;       /* Buffers to be written by the writer task */
+    QueueHandle_t free_bufs;        /* Buffers written by the writer task */
+    SemaphoreHandle_t done;         /* Given when the writer task stops */
+    volatile esp_err_t err;         /* First flash error in the writer task */
+    uint8_t *bufs[OTA_WRITE_BUF_COUNT];
+} ota_writer_t;
+
 typedef struct ota_ops_entry_ {
     uint32_t handle;
     const esp_partition_t *part;
@@ -51,6 +84,10 @@ typedef struct ota_ops_entry_ {
     uint32_t wrote_size;
     uint8_t partial_bytes;
     uint8_t partial_data[16];
+    bool need_erase;                /* Partition is erased as it is written */
+    uint32_t image_len;             /* Image length known so far, when erased as it is written */
+    esp_image_stream_t *stream;     /* Image verified as it is written, or NULL */
+    ota_writer_t *writer;           /* Background writer, or NULL */
     LIST_ENTRY(ota_ops_entry_) entries;
 } ota_ops_entry_t;
 
@@ -120,6 +157,173 @@ static esp_ota_img_states_t set_new_state_otadata(void)
 #endif
 }
 
+/* Write to the partition, first erasing the sectors written to if the
+   partition is erased as it is written. image_len is the length the image
+   is known to have, so that blocks past its end are not erased. */
+static esp_err_t ota_write_flash(ota_ops_entry_t *it, uint32_t offset, const void *data, size_t size, uint32_t image_len)
+{
+    image_len = MAX(image_len, offset + size);
+    while (it->need_erase && it->erased_size < offset + size) {
+        size_t erase_size = SPI_FLASH_SEC_SIZE;
+        if (it->erased_size % OTA_ERASE_BLOCK_SIZE == 0 && it->erased_size + OTA_ERASE_BLOCK_SIZE <= it->part->size
+                && image_len >= it->erased_size + OTA_ERASE_BLOCK_MIN_USED) {
+            erase_size = OTA_ERASE_BLOCK_SIZE;
+        }
+        esp_err_t ret = esp_partition_erase_range(it->part, it->erased_size, erase_size);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        it->erased_size += erase_size;
+    }
+    return esp_partition_write(it->part, offset, data, size);
+}
+
+#ifdef CONFIG_APP_OTA_WRITE_TASK
+static void ota_writer_task(void *arg)
+{
+    ota_ops_entry_t *it = (ota_ops_entry_t *) arg;
+    ota_writer_t *writer = it->writer;
+    ota_write_req_t req;
+
+    while (xQueueReceive(writer->write_reqs, &req, portMAX_DELAY) == pdTRUE && req.data != NULL) {
+        // After an error, buffers are only returned until the update ends
+        if (writer->err == ESP_OK) {
+            esp_err_t ret = ota_write_flash(it, req.offset, req.data, req.size, req.image_len);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "writing 0x%x bytes at offset 0x%x failed (0x%x)", req.size, req.offset, ret);
+                writer->err = ret;
+            }
+        }
+        xQueueSend(writer->free_bufs, &req.data, portMAX_DELAY);
+    }
+
+    xSemaphoreGive(writer->done);
+    vTaskDelete(NULL);
+}
+
+static void ota_writer_free(ota_writer_t *writer)
+{
+    if (writer->write_reqs) {
+        vQueueDelete(writer->write_reqs);
+    }
+    if (writer->free_bufs) {
+        vQueueDelete(writer->free_bufs);
+    }
+    if (writer->done) {
+        vSemaphoreDelete(writer->done);
+    }
+    for (int i = 0; i < OTA_WRITE_BUF_COUNT; i++) {
+        free(writer->bufs[i]);
+    }
+    free(writer);
+}
+
+static esp_err_t ota_writer_start(ota_ops_entry_t *it)
+{
+    ota_writer_t *writer = (ota_writer_t *) calloc(1, sizeof(ota_writer_t));
+    if (writer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    writer->write_reqs = xQueueCreate(OTA_WRITE_BUF_COUNT + 1, sizeof(ota_write_req_t));
+    writer->free_bufs = xQueueCreate(OTA_WRITE_BUF_COUNT, sizeof(uint8_t *));
+    writer->done = xSemaphoreCreateBinary();
+    bool ok = writer->write_reqs && writer->free_bufs && writer->done;
+    for (int i = 0; i < OTA_WRITE_BUF_COUNT; i++) {
+        writer->bufs[i] = (uint8_t *) malloc(OTA_WRITE_BUF_SIZE);
+        ok = ok && writer->bufs[i];
+    }
+
+    if (ok) {
+        writer->buf = writer->bufs[0];
+        for (int i = 1; i < OTA_WRITE_BUF_COUNT; i++) {
+            xQueueSend(writer->free_bufs, &writer->bufs[i], 0);
+        }
+        it->writer = writer;
+        // The writer task runs at the priority of the task receiving the update
+        ok = xTaskCreate(ota_writer_task, "ota_write", OTA_WRITE_TASK_STACK_SIZE, it,
+                         uxTaskPriorityGet(NULL), NULL) == pdPASS;
+    }
+    if (!ok) {
+        it->writer = NULL;
+        ota_writer_free(writer);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/* Pass the buffer being filled to the writer task, and wait for a free one */
+static void ota_writer_flush(ota_writer_t *writer)
+{
+    ota_write_req_t req = {
+        .data = writer->buf,
+        .offset = writer->buf_offset,
+        .size = writer->buf_len,
+        .image_len = writer->image_len,
+    };
+    xQueueSend(writer->write_reqs, &req, portMAX_DELAY);
+    xQueueReceive(writer->free_bufs, &writer->buf, portMAX_DELAY);
+    writer->buf_offset += writer->buf_len;
+    writer->buf_len = 0;
+}
+
+static esp_err_t ota_writer_write(ota_writer_t *writer, const uint8_t *data, size_t size)
+{
+    while (size > 0 && writer->err == ESP_OK) {
+        size_t copy_len = MIN(size, OTA_WRITE_BUF_SIZE - writer->buf_len);
+        memcpy(writer->buf + writer->buf_len, data, copy_len);
+        writer->buf_len += copy_len;
+        data += copy_len;
+        size -= copy_len;
+        if (writer->buf_len == OTA_WRITE_BUF_SIZE) {
+            ota_writer_flush(writer);
+        }
+    }
+    return writer->err;
+}
+
+/* Write the last buffer, stop the writer task and free the writer */
+static esp_err_t ota_writer_stop(ota_ops_entry_t *it)
+{
+    ota_writer_t *writer = it->writer;
+
+    if (writer->buf_len > 0 && writer->err == ESP_OK) {
+        if (esp_flash_encryption_enabled()) {
+            /* Can only write 16 byte blocks to flash, pad the last one */
+            size_t padded_len = (writer->buf_len + 15) & ~15;
+            memset(writer->buf + writer->buf_len, 0xFF, padded_len - writer->buf_len);
+            writer->buf_len = padded_len;
+        }
+        ota_writer_flush(writer);
+    }
+
+    const ota_write_req_t stop = { 0 };
+    xQueueSend(writer->write_reqs, &stop, portMAX_DELAY);
+    xSemaphoreTake(writer->done, portMAX_DELAY);
+
+    esp_err_t ret = writer->err;
+    it->writer = NULL;
+    ota_writer_free(writer);
+    return ret;
+}
+#endif // CONFIG_APP_OTA_WRITE_TASK
+
+static void free_ota_entry(ota_ops_entry_t *entry)
+{
+#ifdef CONFIG_APP_OTA_WRITE_TASK
+    if (entry->writer != NULL) {
+        /* Drop the data not passed to the writer task yet, and wait for the writes in progress */
+        entry->writer->buf_len = 0;
+        ota_writer_stop(entry);
+    }
+#endif
+    if (entry->stream != NULL) {
+        esp_image_stream_abort(entry->stream);
+        free(entry->stream);
+    }
+    free(entry);
+}
+
 esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp_ota_handle_t *out_handle)
 {
     ota_ops_entry_t *new_entry;
@@ -153,15 +357,17 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
     }
 #endif
 
-    // If input image size is 0 or OTA_SIZE_UNKNOWN, erase entire partition
-    if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
-        ret = esp_partition_erase_range(partition, 0, partition->size);
-    } else {
-        ret = esp_partition_erase_range(partition, 0, (image_size / SPI_FLASH_SEC_SIZE + 1) * SPI_FLASH_SEC_SIZE);
-    }
+    if (image_size != OTA_WITH_SEQUENTIAL_WRITES) {
+        // If input image size is 0 or OTA_SIZE_UNKNOWN, erase entire partition
+        if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
+            ret = esp_partition_erase_range(partition, 0, partition->size);
+        } else {
+            ret = esp_partition_erase_range(partition, 0, (image_size / SPI_FLASH_SEC_SIZE + 1) * SPI_FLASH_SEC_SIZE);
+        }
 
-    if (ret != ESP_OK) {
-        return ret;
+        if (ret != ESP_OK) {
+            return ret;
+        }
     }
 
     new_entry = (ota_ops_entry_t *) calloc(sizeof(ota_ops_entry_t), 1);
@@ -169,15 +375,40 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
         return ESP_ERR_NO_MEM;
     }
 
-    LIST_INSERT_HEAD(&s_ota_ops_entries_head, new_entry, entries);
-
-    if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
+    new_entry->part = partition;
+    if (image_size == OTA_WITH_SEQUENTIAL_WRITES) {
+        // Erased by esp_ota_write(), and verified as it is written if possible
+        new_entry->need_erase = true;
+        new_entry->image_len = partition->size;
+        new_entry->stream = (esp_image_stream_t *) malloc(sizeof(esp_image_stream_t));
+        if (new_entry->stream == NULL) {
+            free_ota_entry(new_entry);
+            return ESP_ERR_NO_MEM;
+        }
+        const esp_partition_pos_t part_pos = {
+            .offset = partition->address,
+            .size = partition->size,
+        };
+        if (esp_image_stream_start(new_entry->stream, &part_pos) != ESP_OK) {
+            // Verified by esp_ota_end() instead
+            free(new_entry->stream);
+            new_entry->stream = NULL;
+        }
+#ifdef CONFIG_APP_OTA_WRITE_TASK
+        ret = ota_writer_start(new_entry);
+        if (ret != ESP_OK) {
+            free_ota_entry(new_entry);
+            return ret;
+        }
+#endif
+    } else if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
         new_entry->erased_size = partition->size;
     } else {
         new_entry->erased_size = image_size;
     }
 
-    new_entry->part = partition;
+    LIST_INSERT_HEAD(&s_ota_ops_entries_head, new_entry, entries);
+
     new_entry->handle = ++s_ota_ops_last_handle;
     *out_handle = new_entry->handle;
     return ESP_OK;
@@ -198,12 +429,31 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
     for (it = LIST_FIRST(&s_ota_ops_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
         if (it->handle == handle) {
             // must erase the partition before writing to it
-            assert(it->erased_size > 0 && "must erase the partition before writing to it");
+            assert((it->erased_size > 0 || it->need_erase) && "must erase the partition before writing to it");
             if (it->wrote_size == 0 && it->partial_bytes == 0 && size > 0 && data_bytes[0] != ESP_IMAGE_HEADER_MAGIC) {
                 ESP_LOGE(TAG, "OTA image has invalid magic byte (expected 0xE9, saw 0x%02x", data_bytes[0]);
                 return ESP_ERR_OTA_VALIDATE_FAILED;
             }
 
+            if (it->stream != NULL) {
+                ret = esp_image_stream_data(it->stream, data_bytes, size);
+                if (ret != ESP_OK) {
+                    return (ret == ESP_ERR_IMAGE_INVALID) ? ESP_ERR_OTA_VALIDATE_FAILED : ret;
+                }
+                it->image_len = esp_image_stream_min_length(it->stream);
+            }
+
+#ifdef CONFIG_APP_OTA_WRITE_TASK
+            if (it->writer != NULL) {
+                it->writer->image_len = it->image_len;
+                ret = ota_writer_write(it->writer, data_bytes, size);
+                if (ret == ESP_OK) {
+                    it->wrote_size += size;
+                }
+                return ret;
+            }
+#endif
+
             if (esp_flash_encryption_enabled()) {
                 /* Can only write 16 byte blocks to flash, so need to cache anything else */
                 size_t copy_len;
@@ -217,7 +467,7 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
                         return ESP_OK; /* nothing to write yet, just filling buffer */
                     }
                     /* write 16 byte to partition */
-                    ret = esp_partition_write(it->part, it->wrote_size, it->partial_data, 16);
+                    ret = ota_write_flash(it, it->wrote_size, it->partial_data, 16, it->image_len);
                     if (ret != ESP_OK) {
                         return ret;
                     }
@@ -236,7 +486,7 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
                 }
             }
 
-            ret = esp_partition_write(it->part, it->wrote_size, data_bytes, size);
+            ret = ota_write_flash(it, it->wrote_size, data_bytes, size, it->image_len);
             if(ret == ESP_OK){
                 it->wrote_size += size;
             }
@@ -266,15 +516,25 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
 
     /* 'it' holds the ota_ops_entry_t for 'handle' */
 
+#ifdef CONFIG_APP_OTA_WRITE_TASK
+    if (it->writer != NULL) {
+        /* Wait for the data written in the background */
+        ret = ota_writer_stop(it);
+        if (ret != ESP_OK) {
+            goto cleanup;
+        }
+    }
+#endif
+
     // esp_ota_end() is only valid if some data was written to this handle
-    if ((it->erased_size == 0) || (it->wrote_size == 0)) {
+    if ((it->erased_size == 0 && !it->need_erase) || (it->wrote_size == 0)) {
         ret = ESP_ERR_INVALID_ARG;
         goto cleanup;
     }
 
     if (it->partial_bytes > 0) {
         /* Write out last 16 bytes, if necessary */
-        ret = esp_partition_write(it->part, it->wrote_size, it->partial_data, 16);
+        ret = ota_write_flash(it, it->wrote_size, it->partial_data, 16, it->image_len);
         if (ret != ESP_OK) {
             ret = ESP_ERR_INVALID_STATE;
             goto cleanup;
@@ -289,17 +549,42 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
       .size = it->part->size,
     };
 
-    if (esp_image_verify(ESP_IMAGE_VERIFY, &part_pos, &data) != ESP_OK) {
+    if (it->stream != NULL) {
+        /* Image was verified as it was written */
+        if (esp_image_stream_finish(it->stream, &data) != ESP_OK) {
+            ret = ESP_ERR_OTA_VALIDATE_FAILED;
+            goto cleanup;
+        }
+    } else if (esp_image_verify(ESP_IMAGE_VERIFY, &part_pos, &data) != ESP_OK) {
         ret = ESP_ERR_OTA_VALIDATE_FAILED;
         goto cleanup;
     }
 
  cleanup:
     LIST_REMOVE(it, entries);
-    free(it);
+    free_ota_entry(it);
     return ret;
 }
 
+esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+    ota_ops_entry_t *it;
+
+    for (it = LIST_FIRST(&s_ota_ops_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
+        if (it->handle == handle) {
+            break;
+        }
+    }
+
+    if (it == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    LIST_REMOVE(it, entries);
+    free_ota_entry(it);
+    return ESP_OK;
+}
+
 static esp_err_t rewrite_ota_seq(esp_ota_select_entry_t *two_otadata, uint32_t seq, uint8_t sec_id, const esp_partition_t *ota_data_partition)
 {
     if (two_otadata == NULL || sec_id > 1) {
@@ -29,6 +29,7 @@ extern "C"
 #endif
 
 #define OTA_SIZE_UNKNOWN 0xffffffff /*!< Used for esp_ota_begin() if new image size is unknown */
+#define OTA_WITH_SEQUENTIAL_WRITES 0xfffffffe /*!< Used for esp_ota_begin() to erase the partition as it is written, if new image size is unknown */
 
 #define ESP_ERR_OTA_BASE                         0x1500                     /*!< Base error code for ota_ops api */
 #define ESP_ERR_OTA_PARTITION_CONFLICT           (ESP_ERR_OTA_BASE + 0x01)  /*!< Error if request was to write or erase the current running partition */
@@ -73,8 +74,18 @@ int esp_ota_get_app_elf_sha256(char* dst, size_t size);
  * If image size is not yet known, pass OTA_SIZE_UNKNOWN which will
  * cause the entire partition to be erased.
  *
+ * If OTA_WITH_SEQUENTIAL_WRITES is passed, nothing is erased here. Instead each
+ * esp_ota_write() erases the sectors it is about to write to, and the image is
+ * verified while it is written, so that esp_ota_end() doesn't read it back from flash.
+ * If CONFIG_APP_OTA_WRITE_TASK is enabled, erasing and writing is done by a
+ * background task, while the caller receives the next part of the image.
+ *
  * On success, this function allocates memory that remains in use
- * until esp_ota_end() is called with the returned handle.
+ * until esp_ota_end() or esp_ota_abort() is called with the returned handle.
+ * Every successful call must be followed by one of them, including when esp_ota_write()
+ * fails. With OTA_WITH_SEQUENTIAL_WRITES and CONFIG_APP_OTA_WRITE_TASK, this memory
+ * includes two 4 KB buffers and the stack of the writer task, which keeps running
+ * until the handle is ended or aborted.
  *
  * Note: If the rollback option is enabled and the running application has the ESP_OTA_IMG_PENDING_VERIFY state then
  * it will lead to the ESP_ERR_OTA_ROLLBACK_INVALID_STATE error. Confirm the running app before to run download a new app,
@@ -82,6 +93,7 @@ int esp_ota_get_app_elf_sha256(char* dst, size_t size);
  *
  * @param partition Pointer to info for partition which will receive the OTA update. Required.
  * @param image_size Size of new OTA app image. Partition will be erased in order to receive this size of image. If 0 or OTA_SIZE_UNKNOWN, the entire partition is erased.
+ *                   If OTA_WITH_SEQUENTIAL_WRITES, the partition is erased as it is written.
  * @param out_handle On success, returns a handle which should be used for subsequent esp_ota_write() and esp_ota_end() calls.
 
  * @return
@@ -104,6 +116,10 @@ esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp
  * data is received during the OTA operation. Data is written
  * sequentially to the partition.
  *
+ * If the update was started with OTA_WITH_SEQUENTIAL_WRITES and CONFIG_APP_OTA_WRITE_TASK
+ * is enabled, the data is copied and written to flash in the background. A flash error is
+ * then returned by a later call to esp_ota_write() or by esp_ota_end().
+ *
  * @param handle  Handle obtained from esp_ota_begin
  * @param data    Data buffer to write
  * @param size    Size of data buffer in bytes.
@@ -111,7 +127,8 @@ esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp
  * @return
  *    - ESP_OK: Data was written to flash successfully.
  *    - ESP_ERR_INVALID_ARG: handle is invalid.
- *    - ESP_ERR_OTA_VALIDATE_FAILED: First byte of image contains invalid app image magic byte.
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: First byte of image contains invalid app image magic byte,
+ *      or the update was started with OTA_WITH_SEQUENTIAL_WRITES and the image is invalid.
  *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash write failed.
  *    - ESP_ERR_OTA_SELECT_INFO_INVALID: OTA data partition has invalid contents
  */
@@ -120,6 +137,10 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
 /**
  * @brief Finish OTA update and validate newly written app image.
  *
+ * If the update was started with OTA_WITH_SEQUENTIAL_WRITES, the image checked is the data
+ * passed to esp_ota_write(), rather than the image read back from flash. Secure boot signatures
+ * are always checked on the image read back from flash.
+ *
  * @param handle  Handle obtained from esp_ota_begin().
  *
  * @note After calling esp_ota_end(), the handle is no longer valid and any memory associated with it is freed (regardless of result).
@@ -130,9 +151,25 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
  *    - ESP_ERR_INVALID_ARG: Handle was never written to.
  *    - ESP_ERR_OTA_VALIDATE_FAILED: OTA image is invalid (either not a valid app image, or - if secure boot is enabled - signature failed to verify.)
  *    - ESP_ERR_INVALID_STATE: If flash encryption is enabled, this result indicates an internal error writing the final encrypted bytes to flash.
+ *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Data written in the background by the OTA writer task failed to write.
  */
 esp_err_t esp_ota_end(esp_ota_handle_t handle);
 
+/**
+ * @brief Abort OTA update, free the handle and memory associated with it.
+ *
+ * The data already written to the partition is left as it is. If the update was
+ * started with OTA_WITH_SEQUENTIAL_WRITES, this function waits until the writer
+ * task has finished the flash write in progress, and stops the task.
+ *
+ * @param handle  Handle obtained from esp_ota_begin().
+ *
+ * @return
+ *    - ESP_OK: Handle and its resources were freed.
+ *    - ESP_ERR_NOT_FOUND: OTA handle was not found.
+ */
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+
 /**
  * @brief Configure OTA data for a new boot partition
  *
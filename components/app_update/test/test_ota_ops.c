@@ -1,13 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/param.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
+#include <esp_heap_caps.h>
 
 #include <unity.h>
 #include <test_utils.h>
 #include <esp_ota_ops.h>
+#include "esp_image_format.h"
 #include "bootloader_common.h"
 
 /* These OTA tests currently don't assume an OTA partition exists
@@ -107,3 +110,91 @@ TEST_CASE("esp_ota_get_partition_description ", "[ota]")
     };
     TEST_ESP_ERR(ESP_ERR_NOT_FOUND, bootloader_common_get_partition_description(&not_app_pos, &app_desc1));
 }
+
+/* Writes the running app to the next OTA partition in chunks of chunk_size bytes,
+   with the byte at corrupt_offset inverted if it is not negative */
+static esp_err_t write_running_app_sequentially(size_t image_len, size_t chunk_size, int32_t corrupt_offset)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *next = esp_ota_get_next_update_partition(NULL);
+    TEST_ASSERT_NOT_NULL(running);
+    TEST_ASSERT_NOT_NULL(next);
+
+    const uint8_t *app_bin = NULL;
+    spi_flash_mmap_handle_t data_map;
+    TEST_ESP_OK(esp_partition_mmap(running, 0, running->size, SPI_FLASH_MMAP_DATA, (const void **)&app_bin, &data_map));
+    uint8_t *chunk = malloc(chunk_size);
+    TEST_ASSERT_NOT_NULL(chunk);
+
+    esp_ota_handle_t handle;
+    TEST_ESP_OK(esp_ota_begin(next, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    esp_err_t err = ESP_OK;
+    for (size_t offset = 0; offset < image_len && err == ESP_OK; offset += chunk_size) {
+        size_t len = MIN(chunk_size, image_len - offset);
+        memcpy(chunk, app_bin + offset, len);
+        if (corrupt_offset >= 0 && (size_t)corrupt_offset >= offset && (size_t)corrupt_offset < offset + len) {
+            chunk[corrupt_offset - offset] ^= 0xFF;
+        }
+        err = esp_ota_write(handle, chunk, len);
+    }
+    esp_err_t end_err = esp_ota_end(handle);
+
+    if (err == ESP_OK && end_err == ESP_OK) {
+        const uint8_t *written = NULL;
+        spi_flash_mmap_handle_t written_map;
+        TEST_ESP_OK(esp_partition_mmap(next, 0, image_len, SPI_FLASH_MMAP_DATA, (const void **)&written, &written_map));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(app_bin, written, image_len);
+        spi_flash_munmap(written_map);
+    }
+    free(chunk);
+    spi_flash_munmap(data_map);
+    return (err != ESP_OK) ? err : end_err;
+}
+
+TEST_CASE("esp_ota_begin(OTA_WITH_SEQUENTIAL_WRITES) verifies the image as it is written", "[ota]")
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    TEST_ASSERT_NOT_NULL(running);
+    esp_image_metadata_t data;
+    const esp_partition_pos_t running_pos = {
+        .offset = running->address,
+        .size = running->size,
+    };
+    TEST_ESP_OK(esp_image_verify(ESP_IMAGE_VERIFY_SILENT, &running_pos, &data));
+
+    /* whole image in chunks which don't match sectors, or the fields of the image */
+    TEST_ESP_OK(write_running_app_sequentially(data.image_len, 1000, -1));
+    TEST_ESP_OK(write_running_app_sequentially(data.image_len, 8193, -1));
+
+    /* corrupted segment data, or checksum, or truncated image */
+    TEST_ESP_ERR(ESP_ERR_OTA_VALIDATE_FAILED, write_running_app_sequentially(data.image_len, 1000,
+                 data.segment_data[0] - running->address + 4));
+    TEST_ESP_ERR(ESP_ERR_OTA_VALIDATE_FAILED, write_running_app_sequentially(data.image_len, 1000,
+                 data.image_len - 1 - (data.image.hash_appended ? ESP_IMAGE_HASH_LEN : 0)));
+    TEST_ESP_ERR(ESP_ERR_OTA_VALIDATE_FAILED, write_running_app_sequentially(data.image_len - 16, 1000, -1));
+}
+
+TEST_CASE("esp_ota_abort() stops the OTA writer and frees the handle", "[ota]")
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *next = esp_ota_get_next_update_partition(NULL);
+    TEST_ASSERT_NOT_NULL(running);
+    TEST_ASSERT_NOT_NULL(next);
+
+    const size_t image_part_len = 10000;
+    uint8_t *chunk = malloc(image_part_len);
+    TEST_ASSERT_NOT_NULL(chunk);
+    TEST_ESP_OK(esp_partition_read(running, 0, chunk, image_part_len));
+
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    esp_ota_handle_t handle;
+    TEST_ESP_OK(esp_ota_begin(next, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ESP_OK(esp_ota_write(handle, chunk, image_part_len));
+    TEST_ESP_OK(esp_ota_abort(handle));
+    vTaskDelay(10 / portTICK_PERIOD_MS); /* let the idle task free the stack of the writer task */
+    TEST_ASSERT_INT_WITHIN(128, free_before, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+
+    TEST_ESP_ERR(ESP_ERR_NOT_FOUND, esp_ota_abort(handle));
+    TEST_ESP_ERR(ESP_ERR_NOT_FOUND, esp_ota_end(handle));
+    free(chunk);
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_err.h"
+#include "esp_spi_flash.h"
+#include "esp_partition.h"
+#include "esp_efuse.h"
+#include "esp_system.h"
+#include "bootloader_flash.h"
+#include "bootloader_common.h"
+#include "bootloader_utility.h"
+#include "esp_secure_boot.h"
+#include "esp32/rom/rtc.h"
+#include "soc/cpu.h"
+
+/* Mapped flash is read once through the cache when the image is checked, so
+   bootloader_mmap() reads the data with spi_flash_read(), which the flash
+   simulator counts and times. */
+uint32_t bootloader_mmap_get_free_pages(void)
+{
+    return 50;
+}
+
+const void *bootloader_mmap(uint32_t src_addr, uint32_t size)
+{
+    void *data = malloc(size);
+    if (data == NULL) {
+        return NULL;
+    }
+    if (spi_flash_read(src_addr, data, size) != ESP_OK) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+void bootloader_munmap(const void *mapping)
+{
+    free((void *) mapping);
+}
+
+esp_err_t bootloader_flash_read(size_t src_addr, void *dest, size_t size, bool allow_decrypt)
+{
+    return spi_flash_read(src_addr, dest, size);
+}
+
+/* The test runs from the factory partition */
+size_t spi_flash_cache2phys(const void *cached)
+{
+    const esp_partition_t *factory = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_FACTORY, NULL);
+    return factory->address;
+}
+
+bool esp_cpu_in_ocd_debug_mode(void)
+{
+    return false;
+}
+
+RESET_REASON rtc_get_reset_reason(int cpu_no)
+{
+    return POWERON_RESET;
+}
+
+esp_err_t bootloader_sha256_hex_to_str(char *out_str, const uint8_t *in_array_hex, size_t len)
+{
+    for (int i = 0; i < len; i++) {
+        sprintf(&out_str[i * 2], "%02x", in_array_hex[i]);
+    }
+    return ESP_OK;
+}
+
+/* Signed images are not used by the tests */
+esp_err_t esp_secure_boot_verify_signature_block(const esp_secure_boot_sig_block_t *sig_block, const uint8_t *image_digest)
+{
+    abort();
+}
+
+/* Used to select the boot partition, which the tests don't do */
+uint32_t bootloader_common_ota_select_crc(const esp_ota_select_entry_t *s)
+{
+    abort();
+}
+
+bool bootloader_common_ota_select_invalid(const esp_ota_select_entry_t *s)
+{
+    abort();
+}
+
+bool bootloader_common_ota_select_valid(const esp_ota_select_entry_t *s)
+{
+    abort();
+}
+
+int bootloader_common_get_active_otadata(esp_ota_select_entry_t *two_otadata)
+{
+    abort();
+}
+
+int bootloader_common_select_otadata(const esp_ota_select_entry_t *two_otadata, bool *valid_two_otadata, bool max)
+{
+    abort();
+}
+
+bool esp_efuse_check_secure_version(uint32_t secure_version)
+{
+    abort();
+}
+
+esp_err_t esp_efuse_update_secure_version(uint32_t secure_version)
+{
+    abort();
+}
+
+void esp_restart(void)
+{
+    abort();
+}
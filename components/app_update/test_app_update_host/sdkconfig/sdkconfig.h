@@ -0,0 +1,7 @@
+#pragma once
+
+#define CONFIG_LOG_DEFAULT_LEVEL 1
+#define CONFIG_PARTITION_TABLE_OFFSET 0x8000
+#define CONFIG_ESPTOOLPY_FLASHSIZE "4MB"
+//currently use the legacy implementation, since the stubs for new HAL are not done yet
+#define CONFIG_SPI_FLASH_USE_LEGACY_IMPL 1
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "esp_log.h" // defines away the _Static_assert in esp_app_format.h, which C++ doesn't have
+#include "esp_spi_flash.h"
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include "esp_app_format.h"
+#include "esp_image_format.h"
+#include "mbedtls/sha256.h"
+#include "SpiFlash.h"
+
+#include "catch.hpp"
+
+#include "sdkconfig.h"
+
+extern "C" void _spi_flash_init(const char* chip_size, size_t block_size, size_t sector_size, size_t page_size, const char* partition_bin);
+extern SpiFlash spiflash;
+
+#define OTA_IMAGE_DATA_SIZE     (768 * 1024)
+#define OTA_WRITE_CHUNK_SIZE    1024
+
+static void init_flash()
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, 0x10000, SPI_FLASH_SEC_SIZE, 256, "partition_table.bin");
+}
+
+// App image with one DRAM segment, its checksum and an appended SHA-256 digest
+static std::vector<uint8_t> make_app_image(size_t data_len)
+{
+    esp_image_header_t header = {};
+    header.magic = ESP_IMAGE_HEADER_MAGIC;
+    header.segment_count = 1;
+    header.spi_mode = ESP_IMAGE_SPI_MODE_DIO;
+    header.spi_speed = ESP_IMAGE_SPI_SPEED_40M;
+    header.spi_size = ESP_IMAGE_FLASH_SIZE_4MB;
+    header.entry_addr = 0x40080000;
+    header.hash_appended = 1;
+
+    esp_image_segment_header_t segment = {};
+    segment.load_addr = 0x3FFB0000;
+    segment.data_len = data_len;
+
+    std::vector<uint8_t> image(sizeof(header) + sizeof(segment) + data_len);
+    memcpy(&image[0], &header, sizeof(header));
+    memcpy(&image[sizeof(header)], &segment, sizeof(segment));
+
+    uint8_t checksum = 0xEF;
+    srand(1);
+    for (size_t i = sizeof(header) + sizeof(segment); i < image.size(); i++) {
+        image[i] = rand();
+        checksum ^= image[i];
+    }
+
+    // Checksum byte at the end of the next full 16 byte block
+    image.resize((image.size() + 1 + 15) & ~15, 0);
+    image.back() = checksum;
+
+    uint8_t digest[ESP_IMAGE_HASH_LEN];
+    mbedtls_sha256_ret(&image[0], image.size(), digest, 0);
+    image.insert(image.end(), digest, digest + sizeof(digest));
+    return image;
+}
+
+static esp_err_t ota_update(const std::vector<uint8_t>& image, size_t image_size, esp_ota_handle_t* out_handle = NULL)
+{
+    const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+    REQUIRE(partition != NULL);
+
+    esp_ota_handle_t handle;
+    esp_err_t err = esp_ota_begin(partition, image_size, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    for (size_t offset = 0; offset < image.size() && err == ESP_OK; offset += OTA_WRITE_CHUNK_SIZE) {
+        size_t len = std::min((size_t) OTA_WRITE_CHUNK_SIZE, image.size() - offset);
+        err = esp_ota_write(handle, &image[offset], len);
+    }
+    if (err != ESP_OK && out_handle != NULL) {
+        *out_handle = handle;
+        return err;
+    }
+    if (err != ESP_OK) {
+        esp_ota_abort(handle);
+        return err;
+    }
+    return esp_ota_end(handle);
+}
+
+TEST_CASE("OTA update with sequential writes takes less flash time", "[app_update]")
+{
+    init_flash();
+    spiflash_timing_t timing = SPIFLASH_TIMING_DEFAULT();
+    spiflash.set_timing(&timing);
+    const spiflash_stats_t& stats = spiflash.get_stats();
+    std::vector<uint8_t> image = make_app_image(OTA_IMAGE_DATA_SIZE);
+
+    // Partition erased up front, image read back by esp_ota_end()
+    spiflash.reset_stats();
+    REQUIRE(ota_update(image, image.size()) == ESP_OK);
+    printf("OTA update of %d bytes, erased before writing:\n", (int) image.size());
+    spiflash.print_stats(stdout);
+    uint64_t erase_first_ns = stats.elapsed_ns;
+    uint64_t erase_first_read_bytes = stats.read.bytes;
+    uint64_t erase_first_erase_bytes = stats.erase.bytes;
+
+    // Partition erased as it is written, image checked as it is written
+    spiflash.reset_stats();
+    REQUIRE(ota_update(image, OTA_WITH_SEQUENTIAL_WRITES) == ESP_OK);
+    printf("OTA update of %d bytes, sequential writes:\n", (int) image.size());
+    spiflash.print_stats(stdout);
+    uint64_t sequential_ns = stats.elapsed_ns;
+
+    printf("OTA update flash time: erased before writing %d ms, sequential writes %d ms\n",
+           (int) (erase_first_ns / 1000000), (int) (sequential_ns / 1000000));
+    CHECK(erase_first_read_bytes >= image.size());
+    CHECK(stats.read.bytes == 0);
+    // no block is erased past the end of the image
+    CHECK(stats.erase.bytes <= erase_first_erase_bytes);
+    CHECK(sequential_ns < erase_first_ns);
+
+    spiflash.set_timing(NULL);
+}
+
+TEST_CASE("OTA update rejects a corrupt image", "[app_update]")
+{
+    init_flash();
+    std::vector<uint8_t> image = make_app_image(64 * 1024);
+    image[image.size() / 2] ^= 1;
+
+    CHECK(ota_update(image, image.size()) == ESP_ERR_OTA_VALIDATE_FAILED);
+    CHECK(ota_update(image, OTA_SIZE_UNKNOWN) == ESP_ERR_OTA_VALIDATE_FAILED);
+
+    // With sequential writes the image is checked as it is written
+    esp_ota_handle_t handle;
+    CHECK(ota_update(image, OTA_WITH_SEQUENTIAL_WRITES, &handle) == ESP_ERR_OTA_VALIDATE_FAILED);
+    CHECK(esp_ota_abort(handle) == ESP_OK);
+    CHECK(esp_ota_abort(handle) == ESP_ERR_NOT_FOUND);
+    CHECK(esp_ota_end(handle) == ESP_ERR_NOT_FOUND);
+}
@@ -199,6 +199,86 @@ esp_err_t esp_image_verify_bootloader(uint32_t *length);
  */
 esp_err_t esp_image_verify_bootloader_data(esp_image_metadata_t *data);
 
+/* State of an image verified while it is received, see esp_image_stream_start().
+   Fields are private to esp_image_format.c */
+typedef struct {
+    esp_image_metadata_t data;  /* Image metadata, filled in as the headers are received */
+    uint32_t part_size;         /* Size of the partition receiving the image */
+    uint32_t pos;               /* Number of image bytes received */
+    uint32_t field_end;         /* Image offset where the field being received ends */
+    uint8_t *field;             /* Where to store the rest of the field being received, or NULL */
+    uint32_t checksum_word;     /* XOR of the segment data received */
+    void *sha_handle;           /* SHA-256 of the image, if a hash is appended */
+    int state;                  /* Type of the field being received */
+    int segment;                /* Index of the segment being received */
+    esp_err_t err;              /* First verification error */
+    uint8_t checksum_block[16]; /* Padding at the end of the segments, holding the checksum */
+} esp_image_stream_t;
+
+/**
+ * @brief Start verifying an app image while it is received.
+ *
+ * Performs the same checks as esp_image_verify(), but on the image data passed to
+ * esp_image_stream_data() as it is written, rather than on the image read back from flash.
+ *
+ * @param[out] stream Verification state, valid until esp_image_stream_finish() or esp_image_stream_abort() is called.
+ * @param part Partition which receives the image.
+ *
+ * @return
+ * - ESP_OK if verification was started
+ * - ESP_ERR_INVALID_ARG if the partition is larger than 16MB
+ * - ESP_ERR_NOT_SUPPORTED if the image signature must be checked, which can only be done by esp_image_verify()
+ */
+esp_err_t esp_image_stream_start(esp_image_stream_t *stream, const esp_partition_pos_t *part);
+
+/**
+ * @brief Pass the next part of the image being verified.
+ *
+ * Data following the image (for example the padding of a partition dump) is ignored.
+ *
+ * @param stream Verification state from esp_image_stream_start().
+ * @param data Image data.
+ * @param len Length of the data in bytes.
+ *
+ * @return
+ * - ESP_OK if the image received so far is valid
+ * - ESP_ERR_IMAGE_INVALID if the image is invalid. Later calls return the same error.
+ * - ESP_ERR_NO_MEM if there is not enough memory to calculate the image hash.
+ */
+esp_err_t esp_image_stream_data(esp_image_stream_t *stream, const void *data, size_t len);
+
+/**
+ * @brief Get the length the image being verified has at least.
+ *
+ * The length is known from the headers and data received so far, and is the full
+ * image length once the image has been received.
+ *
+ * @param stream Verification state from esp_image_stream_start().
+ *
+ * @return Length of the image in bytes, at least the number of bytes received.
+ */
+uint32_t esp_image_stream_min_length(const esp_image_stream_t *stream);
+
+/**
+ * @brief Finish verifying an image, and release the resources used by the verification.
+ *
+ * @param stream Verification state from esp_image_stream_start().
+ * @param[out] data Metadata of the image, as filled in by esp_image_verify(). Only valid if result is ESP_OK. May be NULL.
+ *
+ * @return
+ * - ESP_OK if a complete and valid image was received
+ * - ESP_ERR_IMAGE_INVALID if the image is invalid or truncated
+ * - ESP_ERR_NO_MEM if there was not enough memory to calculate the image hash.
+ */
+esp_err_t esp_image_stream_finish(esp_image_stream_t *stream, esp_image_metadata_t *data);
+
+/**
+ * @brief Release the resources used by an image verification, without finishing it.
+ *
+ * @param stream Verification state from esp_image_stream_start().
+ */
+void esp_image_stream_abort(esp_image_stream_t *stream);
+
 
 typedef struct {
     uint32_t drom_addr;
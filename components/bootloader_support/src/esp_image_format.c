@@ -678,3 +678,233 @@ static void debug_log_hash(const uint8_t *image_hash, const char *label)
     ESP_LOGD(TAG, "%s: %s", label, hash_print);
 #endif
 }
+
+/* Fields of an image, in the order they are received by esp_image_stream_data() */
+enum {
+    STREAM_IMAGE_HEADER,
+    STREAM_SEGMENT_HEADER,
+    STREAM_SEGMENT_DATA,
+    STREAM_CHECKSUM,
+    STREAM_HASH,
+    STREAM_DONE,
+};
+
+esp_err_t esp_image_stream_start(esp_image_stream_t *stream, const esp_partition_pos_t *part)
+{
+#ifdef SECURE_BOOT_CHECK_SIGNATURE
+    // The signature block follows the image, and is checked by esp_image_verify() only
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    if (stream == NULL || part == NULL || part->size > SIXTEEN_MB) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bzero(stream, sizeof(esp_image_stream_t));
+    stream->data.start_addr = part->offset;
+    stream->part_size = part->size;
+    stream->checksum_word = ESP_ROM_CHECKSUM_INITIAL;
+    stream->state = STREAM_IMAGE_HEADER;
+    stream->field = (uint8_t *)&stream->data.image;
+    stream->field_end = sizeof(esp_image_header_t);
+    return ESP_OK;
+#endif
+}
+
+/* XOR data into the checksum a word at a time. The checksum byte is the XOR of
+   all the bytes of the checksum word, so the alignment of the words doesn't matter. */
+static void stream_checksum(esp_image_stream_t *stream, const uint8_t *src, size_t len)
+{
+    uint32_t checksum_word = stream->checksum_word;
+
+    while (len > 0 && ((intptr_t)src & 3) != 0) {
+        checksum_word ^= *src++;
+        len--;
+    }
+    for (; len >= 4; len -= 4, src += 4) {
+        checksum_word ^= *(const uint32_t *)src;
+    }
+    while (len > 0) {
+        checksum_word ^= *src++;
+        len--;
+    }
+    stream->checksum_word = checksum_word;
+}
+
+/* Check the field which has just been received, and set up the next one */
+static esp_err_t stream_next_field(esp_image_stream_t *stream)
+{
+    esp_image_metadata_t *data = &stream->data;
+    esp_err_t err;
+
+    switch (stream->state) {
+    case STREAM_IMAGE_HEADER:
+        err = verify_image_header(data->start_addr, &data->image, false);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (data->image.segment_count > ESP_IMAGE_MAX_SEGMENTS) {
+            ESP_LOGE(TAG, "image at 0x%x segment count %d exceeds max %d",
+                     data->start_addr, data->image.segment_count, ESP_IMAGE_MAX_SEGMENTS);
+            return ESP_ERR_IMAGE_INVALID;
+        }
+        if (data->image.hash_appended) {
+            stream->sha_handle = bootloader_sha256_start();
+            if (stream->sha_handle == NULL) {
+                return ESP_ERR_NO_MEM;
+            }
+            bootloader_sha256_data(stream->sha_handle, &data->image, sizeof(esp_image_header_t));
+        }
+        break;
+
+    case STREAM_SEGMENT_HEADER: {
+        const esp_image_segment_header_t *header = &data->segments[stream->segment];
+        uint32_t data_addr = data->start_addr + stream->pos;
+
+        err = verify_segment_header(stream->segment, header, data_addr, false);
+        if (err != ESP_OK) {
+            return err;
+        }
+        ESP_LOGI(TAG, "segment %d: paddr=0x%08x vaddr=0x%08x size=0x%05x (%6d) %s",
+                 stream->segment, data_addr, header->load_addr,
+                 header->data_len, header->data_len,
+                 should_map(header->load_addr) ? "map" : "");
+        data->segment_data[stream->segment] = data_addr;
+        stream->state = STREAM_SEGMENT_DATA;
+        stream->field = NULL;
+        stream->field_end = stream->pos + header->data_len;
+        goto check_length;
+    }
+
+    case STREAM_SEGMENT_DATA:
+        stream->segment++;
+        break;
+
+    case STREAM_CHECKSUM: {
+        uint8_t calc = stream->checksum_block[stream->field_end - data->image_len - 1];
+        uint8_t checksum = (stream->checksum_word >> 24)
+            ^ (stream->checksum_word >> 16)
+            ^ (stream->checksum_word >> 8)
+            ^ (stream->checksum_word >> 0);
+        if (checksum != calc && !esp_cpu_in_ocd_debug_mode()) {
+            ESP_LOGE(TAG, "Checksum failed. Calculated 0x%x read 0x%x", checksum, calc);
+            return ESP_ERR_IMAGE_INVALID;
+        }
+        data->image_len = stream->pos;
+        if (!data->image.hash_appended) {
+            stream->state = STREAM_DONE;
+            return ESP_OK;
+        }
+        stream->state = STREAM_HASH;
+        stream->field = data->image_digest;
+        stream->field_end = stream->pos + HASH_LEN;
+        goto check_length;
+    }
+
+    case STREAM_HASH: {
+        uint8_t image_hash[HASH_LEN] = { 0 };
+        bootloader_sha256_finish(stream->sha_handle, image_hash);
+        stream->sha_handle = NULL;
+        debug_log_hash(image_hash, "Calculated hash");
+        if (memcmp(data->image_digest, image_hash, HASH_LEN) != 0 && !esp_cpu_in_ocd_debug_mode()) {
+            ESP_LOGE(TAG, "Image hash failed - image is corrupt");
+            debug_log_hash(data->image_digest, "Expected hash");
+            return ESP_ERR_IMAGE_INVALID;
+        }
+        data->image_len = stream->pos;
+        stream->state = STREAM_DONE;
+        return ESP_OK;
+    }
+
+    default:
+        return ESP_ERR_IMAGE_INVALID;
+    }
+
+    if (stream->segment < data->image.segment_count) {
+        stream->state = STREAM_SEGMENT_HEADER;
+        stream->field = (uint8_t *)&data->segments[stream->segment];
+        stream->field_end = stream->pos + sizeof(esp_image_segment_header_t);
+    } else {
+        // Checksum byte at the end of the next full 16 byte block
+        data->image_len = stream->pos;
+        stream->state = STREAM_CHECKSUM;
+        stream->field = stream->checksum_block;
+        stream->field_end = (stream->pos + 1 + 15) & ~15;
+    }
+
+ check_length:
+    if (stream->field_end > stream->part_size) {
+        ESP_LOGE(TAG, "Image length %d doesn't fit in partition length %d", stream->field_end, stream->part_size);
+        return ESP_ERR_IMAGE_INVALID;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_image_stream_data(esp_image_stream_t *stream, const void *data, size_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+
+    while (stream->err == ESP_OK && stream->state != STREAM_DONE) {
+        if (stream->pos == stream->field_end) {
+            stream->err = stream_next_field(stream);
+            continue;
+        }
+        if (len == 0) {
+            break;
+        }
+
+        size_t copy_len = MIN(len, stream->field_end - stream->pos);
+        if (stream->state == STREAM_SEGMENT_DATA) {
+            stream_checksum(stream, src, copy_len);
+        } else if (stream->field != NULL) {
+            memcpy(stream->field, src, copy_len);
+            stream->field += copy_len;
+        }
+        // The appended hash covers everything before it
+        if (stream->sha_handle != NULL && stream->state != STREAM_HASH) {
+            bootloader_sha256_data(stream->sha_handle, src, copy_len);
+        }
+        stream->pos += copy_len;
+        src += copy_len;
+        len -= copy_len;
+    }
+
+    if (stream->err != ESP_OK) {
+        esp_image_stream_abort(stream);
+    }
+    return stream->err;
+}
+
+uint32_t esp_image_stream_min_length(const esp_image_stream_t *stream)
+{
+    // The field being received is part of the image
+    return stream->field_end;
+}
+
+esp_err_t esp_image_stream_finish(esp_image_stream_t *stream, esp_image_metadata_t *data)
+{
+    esp_err_t err = esp_image_stream_data(stream, NULL, 0);
+    if (err == ESP_OK && stream->state != STREAM_DONE) {
+        ESP_LOGE(TAG, "image at 0x%x is truncated after %d bytes", stream->data.start_addr, stream->pos);
+        err = ESP_ERR_IMAGE_INVALID;
+    }
+
+    if (data != NULL) {
+        if (err == ESP_OK) {
+            memcpy(data, &stream->data, sizeof(esp_image_metadata_t));
+        } else {
+            // Prevent invalid/incomplete data leaking out
+            bzero(data, sizeof(esp_image_metadata_t));
+        }
+    }
+    esp_image_stream_abort(stream);
+    return err;
+}
+
+void esp_image_stream_abort(esp_image_stream_t *stream)
+{
+    if (stream->sha_handle != NULL) {
+        // Need to finish the hash process to free the handle
+        bootloader_sha256_finish(stream->sha_handle, NULL);
+        stream->sha_handle = NULL;
+    }
+}
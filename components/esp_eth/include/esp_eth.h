@@ -141,6 +141,25 @@ esp_err_t esp_eth_driver_uninstall(esp_eth_handle_t hdl);
 */
 esp_err_t esp_eth_transmit(esp_eth_handle_t hdl, uint8_t *buf, uint32_t length);
 
+/**
+* @brief Transmit a packet gathered from several buffers
+*
+* @note The buffers are copied to the MAC in turn, so a packet split over several buffers
+*       does not need to be copied into a single one first
+*
+* @param[in] hdl: handle of Ethernet driver
+* @param[in] bufs: buffers holding the consecutive parts of the packet
+* @param[in] lengths: length of each buffer
+* @param[in] count: number of buffers
+*
+* @return
+*       - ESP_OK: transmit frame buffers successfully
+*       - ESP_ERR_INVALID_ARG: transmit frame buffers failed because of some invalid argument
+*       - ESP_ERR_NOT_SUPPORTED: the MAC can only transmit a frame from a single buffer
+*       - ESP_FAIL: transmit frame buffers failed because some other error occurred
+*/
+esp_err_t esp_eth_transmit_multiple_buf(esp_eth_handle_t hdl, uint8_t **bufs, uint32_t *lengths, uint32_t count);
+
 /**
 * @brief General Receive
 *
@@ -91,6 +91,25 @@ struct esp_eth_mac_s {
     */
     esp_err_t (*transmit)(esp_eth_mac_t *mac, uint8_t *buf, uint32_t length);
 
+    /**
+    * @brief Transmit packet from Ethernet MAC, gathering it from several buffers
+    *
+    * @param[in] mac: Ethernet MAC instance
+    * @param[in] bufs: buffers holding the consecutive parts of the packet
+    * @param[in] lengths: length of each buffer
+    * @param[in] count: number of buffers
+    *
+    * @note This is optional, it is NULL if the MAC can only transmit packets from a single buffer
+    *
+    * @return
+    *      - ESP_OK: transmit packet successfully
+    *      - ESP_ERR_INVALID_ARG: transmit packet failed because of invalid argument
+    *      - ESP_ERR_INVALID_STATE: transmit packet failed because of wrong state of MAC
+    *      - ESP_FAIL: transmit packet failed because some other error occurred
+    *
+    */
+    esp_err_t (*transmit_multiple_buf)(esp_eth_mac_t *mac, uint8_t **bufs, uint32_t *lengths, uint32_t count);
+
     /**
     * @brief Receive packet from Ethernet MAC
     *
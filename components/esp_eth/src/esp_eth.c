@@ -232,6 +232,20 @@ err:
     return ret;
 }
 
+esp_err_t esp_eth_transmit_multiple_buf(esp_eth_handle_t hdl, uint8_t **bufs, uint32_t *lengths, uint32_t count)
+{
+    esp_err_t ret = ESP_OK;
+    esp_eth_driver_t *eth_driver = (esp_eth_driver_t *)hdl;
+    ETH_CHECK(eth_driver, "ethernet driver handle can't be null", err, ESP_ERR_INVALID_ARG);
+    esp_eth_mac_t *mac = eth_driver->mac;
+    if (!mac->transmit_multiple_buf) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return mac->transmit_multiple_buf(mac, bufs, lengths, count);
+err:
+    return ret;
+}
+
 esp_err_t esp_eth_receive(esp_eth_handle_t hdl, uint8_t *buf, uint32_t *length)
 {
     esp_err_t ret = ESP_OK;
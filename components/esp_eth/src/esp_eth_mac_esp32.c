@@ -220,6 +220,26 @@ err:
     return ret;
 }
 
+static esp_err_t emac_esp32_transmit_multiple_buf(esp_eth_mac_t *mac, uint8_t **bufs, uint32_t *lengths, uint32_t count)
+{
+    esp_err_t ret = ESP_OK;
+    emac_esp32_t *emac = __containerof(mac, emac_esp32_t, parent);
+    MAC_CHECK(bufs && lengths, "can't set bufs and lengths to null", err, ESP_ERR_INVALID_ARG);
+    uint32_t length = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        MAC_CHECK(bufs[i] || !lengths[i], "can't set buf to null", err, ESP_ERR_INVALID_ARG);
+        length += lengths[i];
+    }
+    MAC_CHECK(length, "buf length can't be zero", err, ESP_ERR_INVALID_ARG);
+    /* Check if the descriptor is owned by the Ethernet DMA (when 1) or CPU (when 0) */
+    MAC_CHECK(emac_hal_get_tx_desc_owner(&emac->hal) == EMAC_DMADESC_OWNER_CPU,
+              "CPU doesn't own the Tx Descriptor", err, ESP_ERR_INVALID_STATE);
+    emac_hal_transmit_multiple_buf_frame(&emac->hal, bufs, lengths, count);
+    return ESP_OK;
+err:
+    return ret;
+}
+
 static esp_err_t emac_esp32_receive(esp_eth_mac_t *mac, uint8_t *buf, uint32_t *length)
 {
     esp_err_t ret = ESP_OK;
@@ -411,6 +431,7 @@ esp_eth_mac_t *esp_eth_mac_new_esp32(const eth_mac_config_t *config)
     emac->parent.set_link = emac_esp32_set_link;
     emac->parent.set_promiscuous = emac_esp32_set_promiscuous;
     emac->parent.transmit = emac_esp32_transmit;
+    emac->parent.transmit_multiple_buf = emac_esp32_transmit_multiple_buf;
     emac->parent.receive = emac_esp32_receive;
     /* Interrupt configuration */
     MAC_CHECK(esp_intr_alloc(ETS_ETH_MAC_INTR_SOURCE, ESP_INTR_FLAG_IRAM, emac_esp32_isr_handler,
@@ -122,30 +122,26 @@ static void esp_event_loop_run_task(void* args)
     vTaskSuspend(NULL);
 }
 
-static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_instance_t *handler, esp_event_post_instance_t post)
+static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_instance_t *handler, esp_event_post_instance_t* post)
 {
-    ESP_LOGD(TAG, "running post %s:%d with handler %p on loop %p", post.base, post.id, handler->handler, loop);
+    ESP_LOGD(TAG, "running post %s:%d with handler %p on loop %p", post->base, post->id, handler->handler, loop);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     int64_t start, diff;
     start = esp_timer_get_time();
 #endif
     // Execute the handler
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
     void* data_ptr = NULL;
 
-    if (post.data_set) {
-        if (post.data_allocated) {
-            data_ptr = post.data.ptr;
+    if (post->data_set) {
+        if (post->data_allocated) {
+            data_ptr = post->data.ptr;
         } else {
-            data_ptr = &post.data.val;
+            data_ptr = post->data.buf;
         }
     }
 
-    (*(handler->handler))(handler->arg, post.base, post.id, data_ptr);
-#else
-    (*(handler->handler))(handler->arg, post.base, post.id, post.data);
-#endif
+    (*(handler->handler))(handler->arg, post->base, post->id, data_ptr);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     diff = esp_timer_get_time() - start;
@@ -177,7 +173,7 @@ static esp_err_t handler_instances_add(esp_event_handler_instances_t* handlers,
         esp_event_handler_instance_t *it = NULL, *last = NULL;
 
         SLIST_FOREACH(it, handlers, next) {
-            if (handler == it->handler) {
+            if (handler == it->handler && !it->unregistered) {
                 it->arg = handler_arg;
                 ESP_LOGW(TAG, "handler already registered, overwriting");
                 free(handler_instance);
@@ -293,14 +289,21 @@ static esp_err_t loop_node_add_handler(esp_event_loop_node_t* loop_node, esp_eve
     }
 }
 
-static esp_err_t handler_instances_remove(esp_event_handler_instances_t* handlers, esp_event_handler_t handler)
+static esp_err_t handler_instances_remove(esp_event_handler_instances_t* handlers, esp_event_handler_t handler,
+                                          bool dispatching)
 {
     esp_event_handler_instance_t *it, *temp;
 
     SLIST_FOREACH_SAFE(it, handlers, next, temp) {
-        if (it->handler == handler) {
-            SLIST_REMOVE(handlers, it, esp_event_handler_instance, next);
-            free(it);
+        if (it->handler == handler && !it->unregistered) {
+            if (dispatching) {
+                // The event being dispatched might still refer to the handler, or walk the list it is in.
+                // Since the list and its nodes are not changed, they are only freed after the dispatch.
+                it->unregistered = true;
+            } else {
+                SLIST_REMOVE(handlers, it, esp_event_handler_instance, next);
+                free(it);
+            }
             return ESP_OK;
         }
     }
@@ -309,16 +312,17 @@ static esp_err_t handler_instances_remove(esp_event_handler_instances_t* handler
 }
 
 
-static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int32_t id, esp_event_handler_t handler)
+static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int32_t id, esp_event_handler_t handler,
+                                          bool dispatching)
 {
     if (id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(base_node->handlers), handler);
+        return handler_instances_remove(&(base_node->handlers), handler, dispatching);
     }
     else {
         esp_event_id_node_t *it, *temp;
         SLIST_FOREACH_SAFE(it, &(base_node->id_nodes), next, temp) {
             if (it->id == id) {
-                esp_err_t res = handler_instances_remove(&(it->handlers), handler);
+                esp_err_t res = handler_instances_remove(&(it->handlers), handler, dispatching);
 
                 if (res == ESP_OK) {
                     if (SLIST_EMPTY(&(it->handlers))) {
@@ -334,16 +338,17 @@ static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int3
     return ESP_ERR_NOT_FOUND;
 }
 
-static esp_err_t loop_node_remove_handler(esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_t handler)
+static esp_err_t loop_node_remove_handler(esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_t handler,
+                                          bool dispatching)
 {
     if (base == esp_event_any_base && id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(loop_node->handlers), handler);
+        return handler_instances_remove(&(loop_node->handlers), handler, dispatching);
     }
     else {
         esp_event_base_node_t *it, *temp;
         SLIST_FOREACH_SAFE(it, &(loop_node->base_nodes), next, temp) {
             if (it->base == base) {
-                esp_err_t res = base_node_remove_handler(it, id, handler);
+                esp_err_t res = base_node_remove_handler(it, id, handler, dispatching);
 
                 if (res == ESP_OK) {
                     if (SLIST_EMPTY(&(it->handlers)) && SLIST_EMPTY(&(it->id_nodes))) {
@@ -392,17 +397,311 @@ static void loop_node_remove_all_handler(esp_event_loop_node_t* loop_node)
     }
 }
 
+static void handler_instances_remove_unregistered(esp_event_handler_instances_t* handlers)
+{
+    esp_event_handler_instance_t *it, *temp;
+    SLIST_FOREACH_SAFE(it, handlers, next, temp) {
+        if (it->unregistered) {
+            SLIST_REMOVE(handlers, it, esp_event_handler_instance, next);
+            free(it);
+        }
+    }
+}
+
+// Frees the handlers which were unregistered while an event was being dispatched, and the nodes they leave empty
+static void loop_remove_unregistered_handlers(esp_event_loop_instance_t* loop)
+{
+    esp_event_loop_node_t *loop_node, *loop_temp;
+    esp_event_base_node_t *base_node, *base_temp;
+    esp_event_id_node_t *id_node, *id_temp;
+
+    SLIST_FOREACH_SAFE(loop_node, &(loop->loop_nodes), next, loop_temp) {
+        handler_instances_remove_unregistered(&(loop_node->handlers));
+
+        SLIST_FOREACH_SAFE(base_node, &(loop_node->base_nodes), next, base_temp) {
+            handler_instances_remove_unregistered(&(base_node->handlers));
+
+            SLIST_FOREACH_SAFE(id_node, &(base_node->id_nodes), next, id_temp) {
+                handler_instances_remove_unregistered(&(id_node->handlers));
+                if (SLIST_EMPTY(&(id_node->handlers))) {
+                    SLIST_REMOVE(&(base_node->id_nodes), id_node, esp_event_id_node, next);
+                    free(id_node);
+                }
+            }
+
+            if (SLIST_EMPTY(&(base_node->handlers)) && SLIST_EMPTY(&(base_node->id_nodes))) {
+                SLIST_REMOVE(&(loop_node->base_nodes), base_node, esp_event_base_node, next);
+                free(base_node);
+            }
+        }
+
+        if (SLIST_EMPTY(&(loop_node->handlers)) && SLIST_EMPTY(&(loop_node->base_nodes))) {
+            SLIST_REMOVE(&(loop->loop_nodes), loop_node, esp_event_loop_node, next);
+            free(loop_node);
+        }
+    }
+
+    loop->handlers_unregistered = false;
+}
+
+// Collects the handlers to execute for an event, in the order they are executed. Only counts them if handlers is NULL.
+static size_t loop_collect_handlers(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id,
+                                    esp_event_handler_instance_t** handlers)
+{
+    size_t count = 0;
+
+    esp_event_handler_instance_t *handler;
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(handler, &(loop_node->handlers), next) {
+            if (handlers) {
+                handlers[count] = handler;
+            }
+            count++;
+        }
+
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base == base) {
+                SLIST_FOREACH(handler, &(base_node->handlers), next) {
+                    if (handlers) {
+                        handlers[count] = handler;
+                    }
+                    count++;
+                }
+
+                SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                    if (id_node->id == id) {
+                        SLIST_FOREACH(handler, &(id_node->handlers), next) {
+                            if (handlers) {
+                                handlers[count] = handler;
+                            }
+                            count++;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+static inline uint32_t dispatch_table_hash(esp_event_base_t base, int32_t id)
+{
+    uint32_t hash = ((uint32_t) (uintptr_t) base ^ ((uint32_t) id * 0x9E3779B1)) * 0x9E3779B1;
+    return hash ^ (hash >> 16);
+}
+
+static esp_event_dispatch_entry_t* dispatch_table_find(esp_event_dispatch_table_t* table, esp_event_base_t base, int32_t id)
+{
+    esp_event_dispatch_entry_t* entry = table->buckets[dispatch_table_hash(base, id) & table->mask];
+
+    while (entry && (entry->base != base || entry->id != id)) {
+        entry = entry->next;
+    }
+
+    return entry;
+}
+
+static esp_event_dispatch_entry_t* dispatch_entry_create(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id)
+{
+    size_t count = loop_collect_handlers(loop, base, id, NULL);
+    esp_event_dispatch_entry_t* entry = calloc(1, sizeof(*entry) + count * sizeof(entry->handlers[0]));
+
+    if (entry) {
+        entry->base = base;
+        entry->id = id;
+        entry->count = loop_collect_handlers(loop, base, id, entry->handlers);
+    }
+
+    return entry;
+}
+
+static esp_err_t dispatch_table_add(esp_event_loop_instance_t* loop, esp_event_dispatch_table_t* table, esp_event_base_t base, int32_t id)
+{
+    if (dispatch_table_find(table, base, id)) {
+        return ESP_OK;
+    }
+
+    esp_event_dispatch_entry_t* entry = dispatch_entry_create(loop, base, id);
+
+    if (!entry) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint32_t bucket = dispatch_table_hash(base, id) & table->mask;
+    entry->next = table->buckets[bucket];
+    table->buckets[bucket] = entry;
+
+    return ESP_OK;
+}
+
+static void dispatch_table_delete(esp_event_dispatch_table_t* table)
+{
+    if (!table) {
+        return;
+    }
+
+    for (uint32_t i = 0; i <= table->mask; i++) {
+        esp_event_dispatch_entry_t *it = table->buckets[i], *temp;
+        while (it) {
+            temp = it->next;
+            free(it);
+            it = temp;
+        }
+    }
+
+    free(table->any);
+    free(table);
+}
+
+// Builds the dispatch table of the loop from its loop nodes. If there's not enough memory,
+// the dispatch table is left empty and events are dispatched by walking the loop nodes.
+static void dispatch_table_rebuild(esp_event_loop_instance_t* loop)
+{
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+
+    dispatch_table_delete(loop->dispatch_table);
+    loop->dispatch_table = NULL;
+    loop->dispatch_table_valid = true;
+
+    // One entry for each base, and one for each id with id level handlers
+    uint32_t entries = 0;
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            entries++;
+            SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                entries++;
+            }
+        }
+    }
+
+    uint32_t buckets = 1;
+    while (buckets < entries) {
+        buckets <<= 1;
+    }
+
+    esp_event_dispatch_table_t* table = calloc(1, sizeof(*table) + buckets * sizeof(table->buckets[0]));
+    if (!table) {
+        goto on_err;
+    }
+    table->mask = buckets - 1;
+
+    table->any = dispatch_entry_create(loop, esp_event_any_base, ESP_EVENT_ANY_ID);
+    if (!table->any) {
+        goto on_err;
+    }
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (dispatch_table_add(loop, table, base_node->base, ESP_EVENT_ANY_ID) != ESP_OK) {
+                goto on_err;
+            }
+            SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                if (dispatch_table_add(loop, table, base_node->base, id_node->id) != ESP_OK) {
+                    goto on_err;
+                }
+            }
+        }
+    }
+
+    loop->dispatch_table = table;
+    return;
+
+on_err:
+    ESP_LOGW(TAG, "alloc for dispatch table of loop %p failed", loop);
+    dispatch_table_delete(table);
+}
+
+static bool loop_dispatch(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
+{
+    if (!loop->dispatch_table_valid) {
+        dispatch_table_rebuild(loop);
+    }
+
+    esp_event_dispatch_table_t* table = loop->dispatch_table;
+
+    if (table) {
+        esp_event_dispatch_entry_t* entry = dispatch_table_find(table, post->base, post->id);
+
+        if (!entry) {
+            entry = dispatch_table_find(table, post->base, ESP_EVENT_ANY_ID);
+        }
+        if (!entry) {
+            entry = table->any;
+        }
+
+        // Handlers can register and unregister handlers, which only invalidates the table. Unregistered
+        // handlers are kept until the event has been dispatched.
+        for (size_t i = 0; i < entry->count; i++) {
+            if (!entry->handlers[i]->unregistered) {
+                handler_execute(loop, entry->handlers[i], post);
+            }
+        }
+
+        return entry->count > 0;
+    }
+
+    // No dispatch table, walk the loop nodes
+    bool exec = false;
+
+    esp_event_handler_instance_t *handler, *temp;
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+
+    // As with the table, handlers unregistered by a handler are skipped. Unregistering leaves them and their nodes
+    // in the lists until the event has been dispatched, so the walk can go on from any of them.
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        // Execute loop level handlers
+        SLIST_FOREACH_SAFE(handler, &(loop_node->handlers), next, temp) {
+            if (!handler->unregistered) {
+                handler_execute(loop, handler, post);
+                exec |= true;
+            }
+        }
+
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base == post->base) {
+                // Execute base level handlers
+                SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp) {
+                    if (!handler->unregistered) {
+                        handler_execute(loop, handler, post);
+                        exec |= true;
+                    }
+                }
+
+                SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                    if (id_node->id == post->id) {
+                        // Execute id level handlers
+                        SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp) {
+                            if (!handler->unregistered) {
+                                handler_execute(loop, handler, post);
+                                exec |= true;
+                            }
+                        }
+                        // Skip to next base node
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return exec;
+}
+
 static void inline __attribute__((always_inline)) post_instance_delete(esp_event_post_instance_t* post)
 {
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
     if (post->data_allocated && post->data.ptr) {
         free(post->data.ptr);
     }
-#else
-    if (post->data) {
-        free(post->data);
-    }
-#endif
     memset(post, 0, sizeof(*post));
 }
 
@@ -442,6 +741,8 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
 #endif
 
     SLIST_INIT(&(loop->loop_nodes));
+    loop->dispatch_table = NULL;
+    loop->dispatch_table_valid = false;
 
     // Create the loop task if requested
     if (event_loop_args->task_name != NULL) {
@@ -497,12 +798,10 @@ on_err:
     return err;
 }
 
-// On event lookup performance: The library implements the event list as a linked list, which results to O(n)
-// lookup time. The test comparing this implementation to the O(lg n) performance of rbtrees
-// (https://github.com/freebsd/freebsd/blob/master/sys/sys/tree.h)
-// indicate that the difference is not that substantial, especially considering the additional
-// pointers per node of rbtrees. Code for the rbtree implementation of the event loop library is archived
-// in feature/esp_event_loop_library_rbtrees if needed.
+// On event lookup performance: The handlers are registered in linked lists, which are flattened into a hash table
+// keyed by (event base, event id) the first time an event is dispatched after handlers have been registered or
+// unregistered. Each entry of the table holds the handlers to execute for the event, in execution order, so a dispatch
+// only takes a hash lookup. If the table cannot be allocated, the linked lists are walked instead.
 esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run)
 {
     assert(event_loop);
@@ -524,41 +823,11 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
 
         loop->running_task = xTaskGetCurrentTaskHandle();
 
-        bool exec = false;
-
-        esp_event_handler_instance_t *handler;
-        esp_event_loop_node_t *loop_node;
-        esp_event_base_node_t *base_node;
-        esp_event_id_node_t *id_node;
-
-        SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
-            // Execute loop level handlers
-            SLIST_FOREACH(handler, &(loop_node->handlers), next) {
-                handler_execute(loop, handler, post);
-                exec |= true;
-            }
-
-            SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
-                if (base_node->base == post.base) {
-                    // Execute base level handlers
-                    SLIST_FOREACH(handler, &(base_node->handlers), next) {
-                        handler_execute(loop, handler, post);
-                        exec |= true;
-                    }
+        bool exec = loop_dispatch(loop, &post);
 
-                    SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
-                        if (id_node->id == post.id) {
-                            // Execute id level handlers
-                            SLIST_FOREACH(handler, &(id_node->handlers), next) {
-                                handler_execute(loop, handler, post);
-                                exec |= true;
-                            }
-                            // Skip to next base node
-                            break;
-                        }
-                    }
-                }
-            }
+        // Free handlers which were unregistered by the handlers of this event
+        if (loop->handlers_unregistered) {
+            loop_remove_unregistered_handlers(loop);
         }
 
         esp_event_base_t base = post.base;
@@ -571,6 +840,7 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
             remaining_ticks -= end - marker;
             // If the ticks to run expired, return to the caller
             if (remaining_ticks <= 0) {
+                loop->running_task = NULL;
                 xSemaphoreGiveRecursive(loop->mutex);
                 break;
             } else {
@@ -622,6 +892,7 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
         SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
         free(it);
     }
+    dispatch_table_delete(loop->dispatch_table);
 
     // Drop existing posts on the queue
     esp_event_post_instance_t post;
@@ -704,6 +975,10 @@ esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t event_loop, es
         err = loop_node_add_handler(last_loop_node, event_base, event_id, event_handler, event_handler_arg);
     }
 
+    if (err == ESP_OK) {
+        loop->dispatch_table_valid = false;
+    }
+
 on_err:
     xSemaphoreGiveRecursive(loop->mutex);
     return err;
@@ -728,10 +1003,18 @@ esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t event_loop,
 
     xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
+    // Handlers unregistered by a handler of the loop are freed after the event has been dispatched
+    bool dispatching = (loop->running_task == xTaskGetCurrentTaskHandle());
+    if (dispatching) {
+        loop->handlers_unregistered = true;
+    }
+
+    loop->dispatch_table_valid = false;
+
     esp_event_loop_node_t *it, *temp;
 
     SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
-        esp_err_t res = loop_node_remove_handler(it, event_base, event_id, event_handler);
+        esp_err_t res = loop_node_remove_handler(it, event_base, event_id, event_handler, dispatching);
 
         if (res == ESP_OK && SLIST_EMPTY(&(it->base_nodes)) && SLIST_EMPTY(&(it->handlers))) {
             SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
@@ -760,21 +1043,23 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     memset((void*)(&post), 0, sizeof(post));
 
     if (event_data != NULL && event_data_size != 0) {
-        // Make persistent copy of event data on heap.
-        void* event_data_copy = calloc(1, event_data_size);
+        if (event_data_size <= sizeof(post.data.buf)) {
+            // Small event data is stored in the post itself
+            memcpy(post.data.buf, event_data, event_data_size);
+            post.data_allocated = false;
+        } else {
+            // Make persistent copy of event data on heap.
+            void* event_data_copy = calloc(1, event_data_size);
 
-        if (event_data_copy == NULL) {
-            return ESP_ERR_NO_MEM;
-        }
+            if (event_data_copy == NULL) {
+                return ESP_ERR_NO_MEM;
+            }
 
-        memcpy(event_data_copy, event_data, event_data_size);
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
-        post.data.ptr = event_data_copy;
-        post.data_allocated = true;
+            memcpy(event_data_copy, event_data, event_data_size);
+            post.data.ptr = event_data_copy;
+            post.data_allocated = true;
+        }
         post.data_set = true;
-#else
-        post.data = event_data_copy;
-#endif
     }
     post.base = event_base;
     post.id = event_id;
@@ -836,12 +1121,12 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
     esp_event_post_instance_t post;
     memset((void*)(&post), 0, sizeof(post));
 
-    if (event_data_size > sizeof(post.data.val)) {
+    if (event_data_size > sizeof(post.data.buf)) {
         return ESP_ERR_INVALID_ARG;
     }
 
     if (event_data != NULL && event_data_size != 0) {
-        memcpy((void*)(&(post.data.val)), event_data, event_data_size);
+        memcpy(post.data.buf, event_data, event_data_size);
         post.data_allocated = false;
         post.data_set = true;
     }
@@ -277,7 +277,7 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
  * @param[in] event_base the event base that identifies the event
  * @param[in] event_id the event id that identifies the event
  * @param[in] event_data the data, specific to the event occurence, that gets passed to the handler
- * @param[in] event_data_size the size of the event data; max is 4 bytes
+ * @param[in] event_data_size the size of the event data; max is CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE bytes
  * @param[out] task_unblocked an optional parameter (can be NULL) which indicates that an event task with 
  *                            higher priority than currently running task has been unblocked by the posted event;
  *                            a context switch should be requested before the interrupt is existed.
@@ -290,7 +290,7 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
  *  - ESP_OK: Success
  *  - ESP_FAIL: Event queue for the default event loop full
  *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event id,
- *                          data size of more than 4 bytes 
+ *                          data size of more than CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE bytes
  *  - Others: Fail
  */
 esp_err_t esp_event_isr_post(esp_event_base_t event_base,
@@ -305,7 +305,7 @@ esp_err_t esp_event_isr_post(esp_event_base_t event_base,
  * @param[in] event_base the event base that identifies the event
  * @param[in] event_id the event id that identifies the event
  * @param[in] event_data the data, specific to the event occurence, that gets passed to the handler
- * @param[in] event_data_size the size of the event data
+ * @param[in] event_data_size the size of the event data; max is CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE bytes
  * @param[out] task_unblocked an optional parameter (can be NULL) which indicates that an event task with 
  *                            higher priority than currently running task has been unblocked by the posted event;
  *                            a context switch should be requested before the interrupt is existed.
@@ -318,7 +318,7 @@ esp_err_t esp_event_isr_post(esp_event_base_t event_base,
  *  - ESP_OK: Success
  *  - ESP_FAIL: Event queue for the loop full
  *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event id,
- *                          data size of more than 4 bytes 
+ *                          data size of more than CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE bytes
  *  - Others: Fail
  */
 esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
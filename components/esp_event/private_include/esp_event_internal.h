@@ -32,6 +32,10 @@ typedef struct esp_event_handler_instance {
     uint32_t invoked;                                               /**< number of times this handler has been invoked */
     int64_t time;                                                   /**< total runtime of this handler across all calls */
 #endif
+    bool unregistered;                                              /**< handler has been unregistered while an event
+                                                                            was being dispatched, and must not be executed.
+                                                                            It stays in its list until the event has been
+                                                                            dispatched */
     SLIST_ENTRY(esp_event_handler_instance) next;                   /**< next event handler in the list */
 } esp_event_handler_instance_t;
 
@@ -67,6 +71,24 @@ typedef struct esp_event_loop_node {
 
 typedef SLIST_HEAD(esp_event_loop_nodes, esp_event_loop_node) esp_event_loop_nodes_t;
 
+/// Handlers to execute for an event, in execution order
+typedef struct esp_event_dispatch_entry {
+    esp_event_base_t base;                                          /**< base of the event */
+    int32_t id;                                                     /**< id of the event, ESP_EVENT_ANY_ID for events of the
+                                                                            base which have no id level handlers */
+    struct esp_event_dispatch_entry* next;                          /**< next entry in the same bucket */
+    size_t count;                                                   /**< number of handlers */
+    esp_event_handler_instance_t* handlers[];                       /**< handlers to execute */
+} esp_event_dispatch_entry_t;
+
+/// Hash table from event base and id to the handlers to execute, built from the loop nodes
+typedef struct esp_event_dispatch_table {
+    uint32_t mask;                                                  /**< number of buckets - 1 */
+    esp_event_dispatch_entry_t* any;                                /**< handlers for events of bases without any handlers,
+                                                                            i.e. the loop level handlers */
+    esp_event_dispatch_entry_t* buckets[];                          /**< hash buckets */
+} esp_event_dispatch_table_t;
+
 /// Event loop
 typedef struct esp_event_loop_instance {
     const char* name;                                               /**< name of this event loop */
@@ -77,6 +99,12 @@ typedef struct esp_event_loop_instance {
     SemaphoreHandle_t mutex;                                        /**< mutex for updating the events linked list */
     esp_event_loop_nodes_t loop_nodes;                              /**< set of linked lists containing the
                                                                             registered handlers for the loop */
+    esp_event_dispatch_table_t* dispatch_table;                     /**< handlers for each event, rebuilt after handlers
+                                                                            are registered or unregistered */
+    bool dispatch_table_valid;                                      /**< dispatch table matches the loop nodes */
+    bool handlers_unregistered;                                     /**< handlers have been unregistered while an event
+                                                                            was being dispatched, and are freed once it has
+                                                                            been dispatched */
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     atomic_uint_least32_t events_recieved;                          /**< number of events successfully posted to the loop */
     atomic_uint_least32_t events_dropped;                           /**< number of events dropped due to queue being full */
@@ -85,21 +113,16 @@ typedef struct esp_event_loop_instance {
 #endif
 } esp_event_loop_instance_t;
 
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
 typedef union esp_event_post_data {
-    uint32_t val;
-    void *ptr;
+    uint32_t val;                                                    /**< first word of data stored in the post */
+    void *ptr;                                                       /**< data allocated from heap */
+    uint8_t buf[CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE];             /**< data stored in the post */
 } esp_event_post_data_t;
-#else
-typedef void* esp_event_post_data_t;
-#endif
 
 /// Event posted to the event queue
 typedef struct esp_event_post_instance {
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
     bool data_allocated;                                             /**< indicates whether data is allocated from heap */
     bool data_set;                                                   /**< indicates if data is null */
-#endif
     esp_event_base_t base;                                           /**< the event base */
     int32_t id;                                                      /**< the event id */
     esp_event_post_data_t data;                                      /**< data associated with the event */
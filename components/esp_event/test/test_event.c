@@ -744,7 +744,7 @@ static void loop_run_task(void* args)
     }
 }
 
-static void performance_test(bool dedicated_task)
+static void performance_test(bool dedicated_task, size_t event_data_size)
 {
     // rand() seems to do a one-time allocation. Call it here so that the memory it allocates
     // is not counted as a leak.
@@ -768,6 +768,8 @@ static void performance_test(bool dedicated_task)
     TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_create(&loop_args, &loop));
 
     performance_data_t data;
+    uint8_t event_data[CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE] = { 0 };
+    TEST_ASSERT(event_data_size <= sizeof(event_data));
 
     // Register the handlers
     for (int base = 0; base < TEST_CONFIG_BASES; base++) {
@@ -827,7 +829,8 @@ static void performance_test(bool dedicated_task)
             int64_t start = esp_timer_get_time();
             for (int base = 0; base < bases; base++) {
                 for (int id = 0; id < ids; id++) {
-                    TEST_ASSERT_EQUAL(ESP_OK, esp_event_post_to(loop, test_base + post_bases[base], post_ids[id], NULL, 0, portMAX_DELAY));
+                    TEST_ASSERT_EQUAL(ESP_OK, esp_event_post_to(loop, test_base + post_bases[base], post_ids[id],
+                                                                event_data_size ? event_data : NULL, event_data_size, portMAX_DELAY));
                 }
             }
 
@@ -869,12 +872,18 @@ static void performance_test(bool dedicated_task)
 
 TEST_CASE("performance test - dedicated task", "[event]")
 {
-    performance_test(true);
+    performance_test(true, 0);
 }
 
 TEST_CASE("performance test - no dedicated task", "[event]")
 {
-    performance_test(false);
+    performance_test(false, 0);
+}
+
+TEST_CASE("performance test - event data stored in post", "[event]")
+{
+    // Event data which fits in the post is not allocated on the heap
+    performance_test(true, CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE);
 }
 
 TEST_CASE("can post to loop from handler - dedicated task", "[event]")
@@ -1072,6 +1081,127 @@ static void test_create_loop_handler(void* handler_args, esp_event_base_t base,
     }
 }
 
+static void test_unregister_next_handler(void* handler_arg, esp_event_base_t base, int32_t id, void* event_arg)
+{
+    esp_event_loop_handle_t* loop = (esp_event_loop_handle_t*) handler_arg;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_unregister_with(*loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_unregister_next_handler));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_unregister_with(*loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_event_simple_handler_1));
+}
+
+TEST_CASE("can unregister handlers of the event being dispatched from handler", "[event]")
+{
+    TEST_SETUP();
+
+    esp_event_loop_handle_t loop;
+
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+
+    loop_args.task_name = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_create(&loop_args, &loop));
+
+    int count = 0;
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_unregister_next_handler, &loop));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_event_simple_handler_1, &count));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_event_simple_handler_2, &count));
+
+    // The next handler is unregistered before its turn and is skipped, the handler after it still executes
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+
+    TEST_ASSERT_EQUAL(1, count);
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+
+    TEST_ASSERT_EQUAL(2, count);
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_delete(loop));
+
+    TEST_TEARDOWN();
+}
+
+static void test_unregister_self_handler(void* handler_arg, esp_event_base_t base, int32_t id, void* event_arg)
+{
+    esp_event_loop_handle_t* loop = (esp_event_loop_handle_t*) handler_arg;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_unregister_with(*loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_unregister_self_handler));
+}
+
+static void test_unregister_handler_2(void* handler_arg, esp_event_base_t base, int32_t id, void* event_arg)
+{
+    esp_event_loop_handle_t* loop = (esp_event_loop_handle_t*) handler_arg;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_unregister_with(*loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_event_simple_handler_2));
+}
+
+// Allocates the free memory in blocks chained through their first word, so that further allocations fail
+static void* test_alloc_free_memory(void)
+{
+    void* blocks = NULL;
+    size_t size = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
+
+    while (size >= sizeof(void*)) {
+        void** block = heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+        if (block) {
+            *block = blocks;
+            blocks = block;
+            size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
+            size = largest < size ? largest : size;
+        } else {
+            size /= 2;
+        }
+    }
+
+    return blocks;
+}
+
+static void test_free_memory(void* blocks)
+{
+    while (blocks) {
+        void* next = *((void**) blocks);
+        free(blocks);
+        blocks = next;
+    }
+}
+
+TEST_CASE("can unregister handlers from handler when the dispatch table cannot be allocated", "[event]")
+{
+    TEST_SETUP();
+
+    esp_event_loop_handle_t loop;
+
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+
+    loop_args.task_name = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_create(&loop_args, &loop));
+
+    int count = 0;
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_unregister_self_handler, &loop));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_event_simple_handler_1, &count));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_unregister_handler_2, &loop));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_event_simple_handler_2, &count));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_event_simple_handler_3, &count));
+
+    // The dispatch table is built when the event is dispatched, so the handlers are run by walking the loop nodes.
+    // A handler unregistering itself or the next one does not stop the walk.
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    void* blocks = test_alloc_free_memory();
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_run(loop, 0));
+    TEST_ASSERT_NULL(((esp_event_loop_instance_t*) loop)->dispatch_table);
+    test_free_memory(blocks);
+
+    TEST_ASSERT_EQUAL(2, count);
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+
+    TEST_ASSERT_EQUAL(4, count);
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_delete(loop));
+
+    TEST_TEARDOWN();
+}
+
 TEST_CASE("can create and delete loop from handler", "[event]")
 {
     TEST_SETUP();
@@ -1172,6 +1302,23 @@ TEST_CASE("can properly prepare event data posted to loop", "[event]")
     TEST_ASSERT_EQUAL(false, post.data_allocated);
     TEST_ASSERT_EQUAL(NULL, post.data.ptr);
 
+    uint8_t small[CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE] = { 1 };
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, small, sizeof(small), portMAX_DELAY));
+    TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->queue, &post, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(true, post.data_set);
+    TEST_ASSERT_EQUAL(false, post.data_allocated);
+    TEST_ASSERT_EQUAL_MEMORY(small, post.data.buf, sizeof(small));
+
+    uint8_t large[CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE + 1] = { 1 };
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, large, sizeof(large), portMAX_DELAY));
+    TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->queue, &post, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(true, post.data_set);
+    TEST_ASSERT_EQUAL(true, post.data_allocated);
+    TEST_ASSERT_EQUAL_MEMORY(large, post.data.ptr, sizeof(large));
+    free(post.data.ptr);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_event_isr_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, large, sizeof(large), NULL));
+
     int sample = 0;
     TEST_ASSERT_EQUAL(ESP_OK, esp_event_isr_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &sample, sizeof(sample), NULL));
     TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->queue, &post, portMAX_DELAY));
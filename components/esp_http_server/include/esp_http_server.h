@@ -44,6 +44,9 @@ initializer that should be kept in sync
         .lru_purge_enable   = false,                    \
         .recv_wait_timeout  = 5,                        \
         .send_wait_timeout  = 5,                        \
+        .worker_count       = 0,                        \
+        .worker_core_id     = tskNO_AFFINITY,           \
+        .worker_spread_cores = false,                   \
         .global_user_ctx = NULL,                        \
         .global_user_ctx_free_fn = NULL,                \
         .global_transport_ctx = NULL,                   \
@@ -163,6 +166,20 @@ typedef struct httpd_config {
     uint16_t    recv_wait_timeout;  /*!< Timeout for recv function (in seconds)*/
     uint16_t    send_wait_timeout;  /*!< Timeout for send function (in seconds)*/
 
+    /**
+     * Number of worker tasks which process requests.
+     *
+     * When 0, the server task receives and processes all requests itself, so a slow
+     * URI handler delays the requests of all other sessions. Otherwise the server task
+     * only accepts connections and waits for data on the open sessions, and each
+     * session with an incoming request is handed to a free worker task, which runs
+     * the URI handler. A session is handled by one worker at a time. The worker tasks
+     * are created with the same priority and stack size as the server task.
+     */
+    uint8_t     worker_count;
+    BaseType_t  worker_core_id;     /*!< The core the worker tasks will run on */
+    bool        worker_spread_cores; /*!< Pin worker i to core (i % portNUM_PROCESSORS) instead of worker_core_id */
+
     /**
      * Global user context.
      *
@@ -237,6 +254,11 @@ typedef struct httpd_config {
      *
      * Users can implement their own matching functions (See description
      * of the `httpd_uri_match_func_t` function prototype)
+     *
+     * With either of the above options, the registered URIs are compiled
+     * into a prefix tree, so finding the handler of a request takes about
+     * the same time whatever the number of handlers. With a custom function,
+     * the request URI is matched against each registered URI in turn.
      */
     httpd_uri_match_func_t uri_match_fn;
 } httpd_config_t;
@@ -676,6 +698,39 @@ typedef int (*httpd_recv_func_t)(httpd_handle_t hd, int sockfd, char *buf, size_
  */
 typedef int (*httpd_pending_func_t)(httpd_handle_t hd, int sockfd);
 
+/**
+ * @brief  A buffer to be sent by the HTTPDs low-level vectored send function
+ */
+typedef struct httpd_send_buf {
+    const char *buf;    /*!< Pointer to the data */
+    size_t      len;    /*!< Length of the data */
+} httpd_send_buf_t;
+
+/**
+ * @brief  Prototype for HTTPDs low-level vectored send function
+ *
+ * Sends the buffers one after another, like sendmsg() of the BSD socket API,
+ * so that the status line, headers and body of a response can leave in a
+ * single call.
+ *
+ * @note   User specified vectored send function must handle errors internally,
+ *         the same way as the send function. It may send less than the total
+ *         length of the buffers, in which case it is called again with the
+ *         remaining data.
+ *
+ * @param[in] hd        server instance
+ * @param[in] sockfd    session socket file descriptor
+ * @param[in] bufs      array of buffers to send
+ * @param[in] count     number of buffers in the array
+ * @param[in] flags     flags for the send() function
+ * @return
+ *  - Bytes : The number of bytes sent successfully
+ *  - HTTPD_SOCK_ERR_INVALID  : Invalid arguments
+ *  - HTTPD_SOCK_ERR_TIMEOUT  : Timeout/interrupted while calling socket send()
+ *  - HTTPD_SOCK_ERR_FAIL     : Unrecoverable error while calling socket send()
+ */
+typedef int (*httpd_sendv_func_t)(httpd_handle_t hd, int sockfd, const httpd_send_buf_t *bufs, size_t count, int flags);
+
 /** End of TX / RX
  * @}
  */
@@ -714,6 +769,11 @@ esp_err_t httpd_sess_set_recv_override(httpd_handle_t hd, int sockfd, httpd_recv
  * This function overrides the web server's send function. This same function is
  * used to send out any response to any HTTP request.
  *
+ * @note    This also removes the vectored send function of the session, so that
+ *          all the data goes through send_func. Responses are then gathered into
+ *          a buffer before calling send_func. Use httpd_sess_set_sendv_override()
+ *          afterwards to also provide a matching vectored send function.
+ *
  * @note    This API is supposed to be called either from the context of
  *          - an http session APIs where sockfd is a valid parameter
  *          - a URI handler where sockfd is obtained using httpd_req_to_sockfd()
@@ -728,6 +788,27 @@ esp_err_t httpd_sess_set_recv_override(httpd_handle_t hd, int sockfd, httpd_recv
  */
 esp_err_t httpd_sess_set_send_override(httpd_handle_t hd, int sockfd, httpd_send_func_t send_func);
 
+/**
+ * @brief   Override web server's vectored send function (by session FD)
+ *
+ * This function overrides the web server's vectored send function, which is
+ * used to send the headers and body of a response together. Passing NULL
+ * makes the server use only the send function of the session.
+ *
+ * @note    This API is supposed to be called either from the context of
+ *          - an http session APIs where sockfd is a valid parameter
+ *          - a URI handler where sockfd is obtained using httpd_req_to_sockfd()
+ *
+ * @param[in] hd         HTTPD instance handle
+ * @param[in] sockfd     Session socket FD
+ * @param[in] sendv_func The vectored send function to be set for this session
+ *
+ * @return
+ *  - ESP_OK : On successfully registering override
+ *  - ESP_ERR_INVALID_ARG : Null arguments
+ */
+esp_err_t httpd_sess_set_sendv_override(httpd_handle_t hd, int sockfd, httpd_sendv_func_t sendv_func);
+
 /**
  * @brief   Override web server's pending function (by session FD)
  *
@@ -1437,6 +1518,10 @@ typedef void (*httpd_work_fn_t)(void *arg);
  *          and send it to the persistently opened connection. This facility is for use
  *          by such protocols.
  *
+ * @note    The work function is always executed by the server task. When worker tasks
+ *          are enabled (see httpd_config_t::worker_count), it may run at the same time
+ *          as URI handlers of other sessions.
+ *
  * @param[in] handle    Handle to server returned by httpd_start
  * @param[in] work      Pointer to the function to be executed in the HTTPD's context
  * @param[in] arg       Pointer to the arguments that should be passed to this function
@@ -38,6 +38,9 @@ extern "C" {
 /* Calculate the maximum size needed for the scratch buffer */
 #define HTTPD_SCRATCH_BUF  MAX(HTTPD_MAX_REQ_HDR_LEN, HTTPD_MAX_URI_LEN)
 
+/* Maximum number of buffers passed to sendmsg() by the default vectored send function */
+#define HTTPD_SENDV_MAX_BUFS  4
+
 /* Formats a log string to prepend context function name */
 #define LOG_FMT(x)      "%s: " x, __func__
 
@@ -66,11 +69,14 @@ struct sock_db {
     httpd_free_ctx_fn_t free_ctx;      /*!< Function for freeing the context */
     httpd_free_ctx_fn_t free_transport_ctx; /*!< Function for freeing the 'transport' context */
     httpd_send_func_t send_fn;              /*!< Send function for this socket */
+    httpd_sendv_func_t sendv_fn;            /*!< Vectored send function for this socket, NULL if not available */
     httpd_recv_func_t recv_fn;              /*!< Receive function for this socket */
     httpd_pending_func_t pending_fn;        /*!< Pending function for this socket */
     uint64_t lru_counter;                   /*!< LRU Counter indicating when the socket was last used */
     char pending_data[PARSER_BLOCK_SIZE];   /*!< Buffer for pending data to be received */
     size_t pending_len;                     /*!< Length of pending data to be received */
+    bool busy;                              /*!< Session is being processed by a worker task */
+    bool close_pending;                     /*!< Session is to be closed once the worker task is done with it */
 };
 
 /**
@@ -93,6 +99,17 @@ struct httpd_req_aux {
     struct http_parser_url url_parse_res;           /*!< URL parsing result, used for retrieving URL elements */
 };
 
+/**
+ * @brief   Worker task which processes requests, when enabled by the
+ *          worker_count configuration option
+ */
+struct httpd_worker {
+    struct httpd_data *hd;                  /*!< Server instance the worker belongs to */
+    struct thread_data td;                  /*!< Information for the worker thread */
+    struct httpd_req req;                   /*!< The request being processed by the worker */
+    struct httpd_req_aux req_aux;           /*!< Additional data about the request kept unexposed */
+};
+
 /**
  * @brief   Server data for each instance. This is exposed publicly as
  *          httpd_handle_t but internal structure/members are kept private.
@@ -105,8 +122,13 @@ struct httpd_data {
     struct thread_data hd_td;               /*!< Information for the HTTPD thread */
     struct sock_db *hd_sd;                  /*!< The socket database */
     httpd_uri_t **hd_calls;                 /*!< Registered URI handlers */
+    struct uri_trie *hd_uri_trie;           /*!< Registered URI handlers, compiled for lookup. NULL if not available */
+    omutex_t hd_uri_lock;                   /*!< Guards hd_calls and hd_uri_trie, which are looked up by worker tasks */
     struct httpd_req hd_req;                /*!< The current HTTPD request */
     struct httpd_req_aux hd_req_aux;        /*!< Additional data about the HTTPD request kept unexposed */
+    struct httpd_worker *hd_workers;        /*!< Worker tasks, if enabled */
+    oqueue_t hd_work_queue;                 /*!< Sessions with a request waiting for a worker */
+    oqueue_t hd_done_queue;                 /*!< Sessions handed back to the server task by the workers */
 
     /* Array of registered error handler functions */
     httpd_err_handler_func_t *err_handler_fns;
@@ -159,13 +181,14 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd);
  * @brief   Processes incoming HTTP requests
  *
  * @param[in] hd    Server instance data
+ * @param[in] r     Request data of the calling task, used for processing the request
  * @param[in] clifd Descriptor of the client from which data is to be received
  *
  * @return
  *  - ESP_OK    : on successfully receiving, parsing and responding to a request
  *  - ESP_FAIL  : in case of failure in any of the stages of processing
  */
-esp_err_t httpd_sess_process(struct httpd_data *hd, int clifd);
+esp_err_t httpd_sess_process(struct httpd_data *hd, httpd_req_t *r, int clifd);
 
 /**
  * @brief   Remove client descriptor from the session / socket database
@@ -198,6 +221,7 @@ void httpd_sess_free_ctx(void *ctx, httpd_free_ctx_fn_t free_fn);
  * @brief   Add descriptors present in the socket database to an fdset and
  *          update the value of maxfd which are needed by the select function
  *          for looking through all available sockets for incoming data.
+ *          Sessions being processed by a worker task are left out.
  *
  * @param[in]  hd    Server instance data
  * @param[out] fdset File descriptor set to be updated.
@@ -230,6 +254,16 @@ int httpd_sess_iterate(struct httpd_data *hd, int fd);
  */
 bool httpd_is_sess_available(struct httpd_data *hd);
 
+/**
+ * @brief   Checks if there is any open session which is not being processed
+ *          by a worker task, and thus can be closed by httpd_sess_close_lru()
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return True if there is such a session
+ */
+bool httpd_is_sess_idle_available(struct httpd_data *hd);
+
 /**
  * @brief   Checks if session has any pending data/packets
  *          for processing
@@ -257,6 +291,7 @@ bool httpd_sess_pending(struct httpd_data *hd, int fd);
  * This may be useful if new clients are requesting for connection but
  * max number of connections is reached, in which case the client which
  * is inactive for the longest will be removed from the session.
+ * Sessions being processed by a worker task are not considered.
  *
  * @param[in] hd  Server instance data
  *
@@ -281,12 +316,13 @@ esp_err_t httpd_sess_close_lru(struct httpd_data *hd);
  *          and invokes the appropriate one if found
  *
  * @param[in] hd  Server instance data for which handler needs to be invoked
+ * @param[in] r   The parsed request
  *
  * @return
  *  - ESP_OK    : if handler found and executed successfully
  *  - ESP_FAIL  : otherwise
  */
-esp_err_t httpd_uri(struct httpd_data *hd);
+esp_err_t httpd_uri(struct httpd_data *hd, httpd_req_t *r);
 
 /**
  * @brief   Unregister all URI handlers
@@ -335,25 +371,39 @@ bool httpd_validate_req_ptr(httpd_req_t *r);
  * http_recv() after this reads the body of the request.
  *
  * @param[in] hd  Server instance data
+ * @param[in] r   Request data to fill, its aux member must point to the
+ *                auxiliary data of the calling task
  * @param[in] sd  Pointer to socket which is needed for receiving TCP packets.
  *
  * @return
  *  - ESP_OK    : if request packet is valid
  *  - ESP_FAIL  : otherwise
  */
-esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd);
+esp_err_t httpd_req_new(struct httpd_data *hd, httpd_req_t *r, struct sock_db *sd);
 
 /**
  * @brief   For an HTTP request, resets the resources allocated for it and
  *          purges any data left to be received
  *
  * @param[in] hd  Server instance data
+ * @param[in] r   The request to reset
  *
  * @return
  *  - ESP_OK    : if request packet deleted and resources cleaned.
  *  - ESP_FAIL  : otherwise.
  */
-esp_err_t httpd_req_delete(struct httpd_data *hd);
+esp_err_t httpd_req_delete(struct httpd_data *hd, httpd_req_t *r);
+
+/**
+ * @brief   Get the request data of the calling task
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return
+ *  - Request data of the server task or of a worker task, if called by one of them
+ *  - NULL if called by any other task
+ */
+httpd_req_t *httpd_req_get_current(struct httpd_data *hd);
 
 /**
  * @brief   For handling HTTP errors by invoking registered
@@ -450,6 +500,23 @@ size_t httpd_unrecv(struct httpd_req *r, const char *buf, size_t buf_len);
  */
 int httpd_default_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags);
 
+/**
+ * @brief   This is the low level default vectored send function of the HTTPD.
+ *          This should NEVER be called directly. The semantics of this is
+ *          similar to sendmsg() of the BSD socket API.
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] sockfd  Socket descriptor for sending data
+ * @param[in] bufs    Array of buffers to send
+ * @param[in] count   Number of buffers in the array
+ * @param[in] flags   Flags for mode selection
+ *
+ * @return
+ *  - Length of data : if successful
+ *  - -1             : if failed (appropriate errno is set)
+ */
+int httpd_default_sendv(httpd_handle_t hd, int sockfd, const httpd_send_buf_t *bufs, size_t count, int flags);
+
 /**
  * @brief   This is the low level default recv function of the HTTPD. This should
  *          NEVER be called directly. The semantics of this is exactly similar to
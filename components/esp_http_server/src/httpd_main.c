@@ -75,6 +75,7 @@ struct httpd_ctrl_data {
     enum httpd_ctrl_msg {
         HTTPD_CTRL_SHUTDOWN,
         HTTPD_CTRL_WORK,
+        HTTPD_CTRL_SESS_DONE,
     } hc_msg;
     httpd_work_fn_t hc_work;
     void *hc_work_arg;
@@ -112,6 +113,103 @@ void *httpd_get_global_transport_ctx(httpd_handle_t handle)
     return ((struct httpd_data *)handle)->config.global_transport_ctx;
 }
 
+httpd_req_t *httpd_req_get_current(struct httpd_data *hd)
+{
+    othread_t self = httpd_os_thread_handle();
+    if (self == hd->hd_td.handle) {
+        return &hd->hd_req;
+    }
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        if (self == hd->hd_workers[i].td.handle) {
+            return &hd->hd_workers[i].req;
+        }
+    }
+    return NULL;
+}
+
+/* Runs in the server task to take back the sessions which
+ * the workers are done with */
+static void httpd_sess_release_done(struct httpd_data *hd)
+{
+    struct sock_db *sd;
+    while (httpd_os_queue_try_recv(hd->hd_done_queue, &sd) == OS_SUCCESS) {
+        sd->busy = false;
+        if (sd->close_pending) {
+            int fd = sd->fd;
+            ESP_LOGD(TAG, LOG_FMT("closing socket %d"), fd);
+            httpd_sess_delete(hd, fd);
+            close(fd);
+        }
+    }
+}
+
+/* A worker thread */
+static void httpd_worker_thread(void *arg)
+{
+    struct httpd_worker *w = (struct httpd_worker *) arg;
+    struct httpd_data *hd = w->hd;
+    struct sock_db *sd;
+    w->td.status = THREAD_RUNNING;
+
+    /* A NULL session asks the worker to exit */
+    while (httpd_os_queue_recv(hd->hd_work_queue, &sd) == OS_SUCCESS && sd != NULL) {
+        ESP_LOGD(TAG, LOG_FMT("processing socket %d"), sd->fd);
+        if (httpd_sess_process(hd, &w->req, sd->fd) != ESP_OK) {
+            sd->close_pending = true;
+        }
+        /* Hand the session back to the server task, which waits for the
+         * next request on it, or closes it. The queue has room for all
+         * sessions. The control message only wakes up the server task,
+         * so it doesn't matter if it is dropped because the control
+         * socket is full: the server task then wakes up for the others */
+        httpd_os_queue_send(hd->hd_done_queue, &sd);
+        struct httpd_ctrl_data msg = {
+            .hc_msg = HTTPD_CTRL_SESS_DONE,
+        };
+        while (cs_send_to_ctrl_sock(hd->msg_fd, hd->config.ctrl_port, &msg, sizeof(msg)) < 0) {
+            httpd_os_thread_sleep(10);
+        }
+    }
+
+    w->td.status = THREAD_STOPPED;
+    httpd_os_thread_delete();
+}
+
+static esp_err_t httpd_workers_start(struct httpd_data *hd)
+{
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        struct httpd_worker *w = &hd->hd_workers[i];
+        BaseType_t core_id = hd->config.worker_spread_cores ? (i % portNUM_PROCESSORS) : hd->config.worker_core_id;
+        if (httpd_os_thread_create(&w->td.handle, "httpd_worker",
+                                   hd->config.stack_size,
+                                   hd->config.task_priority,
+                                   httpd_worker_thread, w,
+                                   core_id) != ESP_OK) {
+            w->td.handle = NULL;
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+static void httpd_workers_stop(struct httpd_data *hd)
+{
+    struct sock_db *stop = NULL;
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        if (hd->hd_workers[i].td.handle) {
+            httpd_os_queue_send(hd->hd_work_queue, &stop);
+        }
+    }
+    /* Workers finish the request they are processing first */
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        if (hd->hd_workers[i].td.handle) {
+            while (hd->hd_workers[i].td.status != THREAD_STOPPED) {
+                httpd_os_thread_sleep(10);
+            }
+        }
+    }
+}
+
 static void httpd_close_all_sessions(struct httpd_data *hd)
 {
     int fd = -1;
@@ -142,6 +240,9 @@ static void httpd_process_ctrl_msg(struct httpd_data *hd)
             (*msg.hc_work)(msg.hc_work_arg);
         }
         break;
+    case HTTPD_CTRL_SESS_DONE:
+        /* Sessions are taken back before each select() */
+        break;
     case HTTPD_CTRL_SHUTDOWN:
         ESP_LOGD(TAG, LOG_FMT("shutdown"));
         hd->hd_td.status = THREAD_STOPPING;
@@ -154,9 +255,14 @@ static void httpd_process_ctrl_msg(struct httpd_data *hd)
 /* Manage in-coming connection or data requests */
 static esp_err_t httpd_server(struct httpd_data *hd)
 {
+    if (hd->config.worker_count) {
+        httpd_sess_release_done(hd);
+    }
+
     fd_set read_set;
     FD_ZERO(&read_set);
-    if (hd->config.lru_purge_enable || httpd_is_sess_available(hd)) {
+    if (httpd_is_sess_available(hd) ||
+        (hd->config.lru_purge_enable && httpd_is_sess_idle_available(hd))) {
         /* Only listen for new connections if server has capacity to
          * handle more (or when LRU purge is enabled, in which case
          * older connections will be closed) */
@@ -192,9 +298,22 @@ static esp_err_t httpd_server(struct httpd_data *hd)
      * sessions? */
     int fd = -1;
     while ((fd = httpd_sess_iterate(hd, fd)) != -1) {
+        struct sock_db *sd = httpd_sess_get(hd, fd);
+        if (sd->busy) {
+            /* Already being processed by a worker */
+            continue;
+        }
         if (FD_ISSET(fd, &read_set) || (httpd_sess_pending(hd, fd))) {
+            if (hd->config.worker_count) {
+                /* The session is handed back by the worker when done,
+                 * until then it is left out of select() */
+                ESP_LOGD(TAG, LOG_FMT("queueing socket %d"), fd);
+                sd->busy = true;
+                httpd_os_queue_send(hd->hd_work_queue, &sd);
+                continue;
+            }
             ESP_LOGD(TAG, LOG_FMT("processing socket %d"), fd);
-            if (httpd_sess_process(hd, fd) != ESP_OK) {
+            if (httpd_sess_process(hd, &hd->hd_req, fd) != ESP_OK) {
                 ESP_LOGD(TAG, LOG_FMT("closing socket %d"), fd);
                 close(fd);
                 /* Delete session and update fd to that
@@ -231,6 +350,7 @@ static void httpd_thread(void *arg)
     }
 
     ESP_LOGD(TAG, LOG_FMT("web server exiting"));
+    httpd_workers_stop(hd);
     close(hd->msg_fd);
     cs_free_ctrl_sock(hd->ctrl_fd);
     httpd_close_all_sessions(hd);
@@ -298,6 +418,8 @@ static esp_err_t httpd_server_init(struct httpd_data *hd)
     return ESP_OK;
 }
 
+static void httpd_delete(struct httpd_data *hd);
+
 static struct httpd_data *httpd_create(const httpd_config_t *config)
 {
     /* Allocate memory for httpd instance data */
@@ -339,12 +461,58 @@ static struct httpd_data *httpd_create(const httpd_config_t *config)
     }
     /* Save the configuration for this instance */
     hd->config = *config;
+    hd->hd_req.aux = ra;
+
+    hd->hd_uri_lock = httpd_os_mutex_create();
+    if (!hd->hd_uri_lock) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to create lock for HTTP URI handlers"));
+        httpd_delete(hd);
+        return NULL;
+    }
+
+    if (config->worker_count) {
+        hd->hd_workers = calloc(config->worker_count, sizeof(struct httpd_worker));
+        /* Each session is queued at most once, and each worker is sent one stop request */
+        hd->hd_work_queue = httpd_os_queue_create(config->max_open_sockets + config->worker_count,
+                                                  sizeof(struct sock_db *));
+        hd->hd_done_queue = httpd_os_queue_create(config->max_open_sockets, sizeof(struct sock_db *));
+        if (!hd->hd_workers || !hd->hd_work_queue || !hd->hd_done_queue) {
+            ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for HTTP worker tasks"));
+            httpd_delete(hd);
+            return NULL;
+        }
+        for (int i = 0; i < config->worker_count; i++) {
+            struct httpd_worker *w = &hd->hd_workers[i];
+            w->hd = hd;
+            w->req.aux = &w->req_aux;
+            w->req_aux.resp_hdrs = calloc(config->max_resp_headers, sizeof(struct resp_hdr));
+            if (!w->req_aux.resp_hdrs) {
+                ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for HTTP response headers"));
+                httpd_delete(hd);
+                return NULL;
+            }
+        }
+    }
     return hd;
 }
 
 static void httpd_delete(struct httpd_data *hd)
 {
     struct httpd_req_aux *ra = &hd->hd_req_aux;
+    /* Free memory of worker tasks data */
+    if (hd->hd_workers) {
+        for (int i = 0; i < hd->config.worker_count; i++) {
+            free(hd->hd_workers[i].req_aux.resp_hdrs);
+        }
+        free(hd->hd_workers);
+    }
+    if (hd->hd_work_queue) {
+        httpd_os_queue_delete(hd->hd_work_queue);
+    }
+    if (hd->hd_done_queue) {
+        httpd_os_queue_delete(hd->hd_done_queue);
+    }
+
     /* Free memory of httpd instance data */
     free(hd->err_handler_fns);
     free(ra->resp_hdrs);
@@ -353,6 +521,9 @@ static void httpd_delete(struct httpd_data *hd)
     /* Free registered URI handlers */
     httpd_unregister_all_uri_handlers(hd);
     free(hd->hd_calls);
+    if (hd->hd_uri_lock) {
+        httpd_os_mutex_delete(hd->hd_uri_lock);
+    }
     free(hd);
 }
 
@@ -391,12 +562,23 @@ esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
     }
 
     httpd_sess_init(hd);
+    if (httpd_workers_start(hd) != ESP_OK) {
+        /* Failed to launch worker tasks */
+        httpd_workers_stop(hd);
+        close(hd->msg_fd);
+        cs_free_ctrl_sock(hd->ctrl_fd);
+        close(hd->listen_fd);
+        httpd_delete(hd);
+        return ESP_ERR_HTTPD_TASK;
+    }
+
     if (httpd_os_thread_create(&hd->hd_td.handle, "httpd",
                                hd->config.stack_size,
                                hd->config.task_priority,
                                httpd_thread, hd,
                                hd->config.core_id) != ESP_OK) {
         /* Failed to launch task */
+        httpd_workers_stop(hd);
         httpd_delete(hd);
         return ESP_ERR_HTTPD_TASK;
     }
@@ -582,9 +582,8 @@ static void parse_init(httpd_req_t *r, http_parser *parser, parser_data_t *data)
 
 /* Function that receives TCP data and runs parser on it
  */
-static esp_err_t httpd_parse_req(struct httpd_data *hd)
+static esp_err_t httpd_parse_req(struct httpd_data *hd, httpd_req_t *r)
 {
-    httpd_req_t *r = &hd->hd_req;
     int blk_len,  offset;
     http_parser   parser;
     parser_data_t parser_data;
@@ -624,7 +623,7 @@ static esp_err_t httpd_parse_req(struct httpd_data *hd)
     } while (parser_data.status != PARSING_COMPLETE);
 
     ESP_LOGD(TAG, LOG_FMT("parsing complete"));
-    return httpd_uri(hd);
+    return httpd_uri(hd, r);
 }
 
 static void init_req(httpd_req_t *r, httpd_config_t *config)
@@ -633,7 +632,6 @@ static void init_req(httpd_req_t *r, httpd_config_t *config)
     r->method = 0;
     memset((char*)r->uri, 0, sizeof(r->uri));
     r->content_len = 0;
-    r->aux = 0;
     r->user_ctx = 0;
     r->sess_ctx = 0;
     r->free_ctx = 0;
@@ -666,22 +664,20 @@ static void httpd_req_cleanup(httpd_req_t *r)
     ra->sd->free_ctx = r->free_ctx;
     ra->sd->ignore_sess_ctx_changes = r->ignore_sess_ctx_changes;
 
-    /* Clear out the request and request_aux structures */
+    /* Clear out the request and request_aux structures. The aux member is
+     * kept, as it always points to the auxiliary data of the request */
     ra->sd = NULL;
     r->handle = NULL;
-    r->aux = NULL;
 }
 
 /* Function that processes incoming TCP data and
  * updates the http request data httpd_req_t
  */
-esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
+esp_err_t httpd_req_new(struct httpd_data *hd, httpd_req_t *r, struct sock_db *sd)
 {
-    httpd_req_t *r = &hd->hd_req;
     init_req(r, &hd->config);
-    init_req_aux(&hd->hd_req_aux, &hd->config);
+    init_req_aux(r->aux, &hd->config);
     r->handle = hd;
-    r->aux = &hd->hd_req_aux;
     /* Associate the request to the socket */
     struct httpd_req_aux *ra = r->aux;
     ra->sd = sd;
@@ -694,7 +690,7 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
     r->free_ctx = sd->free_ctx;
     r->ignore_sess_ctx_changes = sd->ignore_sess_ctx_changes;
     /* Parse request */
-    esp_err_t err = httpd_parse_req(hd);
+    esp_err_t err = httpd_parse_req(hd, r);
     if (err != ESP_OK) {
         httpd_req_cleanup(r);
     }
@@ -703,9 +699,8 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
 
 /* Function that resets the http request data
  */
-esp_err_t httpd_req_delete(struct httpd_data *hd)
+esp_err_t httpd_req_delete(struct httpd_data *hd, httpd_req_t *r)
 {
-    httpd_req_t *r = &hd->hd_req;
     struct httpd_req_aux *ra = r->aux;
 
     /* Finish off reading any pending/leftover data */
@@ -745,8 +740,8 @@ bool httpd_validate_req_ptr(httpd_req_t *r)
         struct httpd_data *hd = (struct httpd_data *) r->handle;
         if (hd) {
             /* Check if this function is running in the context of
-             * the correct httpd server thread */
-            if (httpd_os_thread_handle() == hd->hd_td.handle) {
+             * the httpd server or worker thread processing the request */
+            if (httpd_req_get_current(hd) == r) {
                 return true;
             }
         }
@@ -33,6 +33,27 @@ bool httpd_is_sess_available(struct httpd_data *hd)
     return false;
 }
 
+bool httpd_is_sess_idle_available(struct httpd_data *hd)
+{
+    int i;
+    for (i = 0; i < hd->config.max_open_sockets; i++) {
+        if (hd->hd_sd[i].fd != -1 && !hd->hd_sd[i].busy) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Returns the session of the request being processed by the calling task, if any */
+static struct sock_db *httpd_sess_get_current(struct httpd_data *hd)
+{
+    httpd_req_t *r = httpd_req_get_current(hd);
+    if (r == NULL) {
+        return NULL;
+    }
+    return ((struct httpd_req_aux *) r->aux)->sd;
+}
+
 struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
 {
     if (hd == NULL) {
@@ -41,10 +62,11 @@ struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
 
     /* Check if called inside a request handler, and the
      * session sockfd in use is same as the parameter */
-    if ((hd->hd_req_aux.sd) && (hd->hd_req_aux.sd->fd == sockfd)) {
+    struct sock_db *cur = httpd_sess_get_current(hd);
+    if (cur && (cur->fd == sockfd)) {
         /* Just return the pointer to the sock_db
          * corresponding to the request */
-        return hd->hd_req_aux.sd;
+        return cur;
     }
 
     int i;
@@ -72,6 +94,7 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd)
             hd->hd_sd[i].fd = newfd;
             hd->hd_sd[i].handle = (httpd_handle_t) hd;
             hd->hd_sd[i].send_fn = httpd_default_send;
+            hd->hd_sd[i].sendv_fn = httpd_default_sendv;
             hd->hd_sd[i].recv_fn = httpd_default_recv;
 
             /* Call user-defined session opening function */
@@ -112,8 +135,8 @@ void *httpd_sess_get_ctx(httpd_handle_t handle, int sockfd)
      * request handler, in which case fetch the context from
      * the httpd_req_t structure */
     struct httpd_data *hd = (struct httpd_data *) handle;
-    if (hd->hd_req_aux.sd == sd) {
-        return hd->hd_req.sess_ctx;
+    if (httpd_sess_get_current(hd) == sd) {
+        return httpd_req_get_current(hd)->sess_ctx;
     }
 
     return sd->ctx;
@@ -130,17 +153,18 @@ void httpd_sess_set_ctx(httpd_handle_t handle, int sockfd, void *ctx, httpd_free
      * request handler, in which case set the context inside
      * the httpd_req_t structure */
     struct httpd_data *hd = (struct httpd_data *) handle;
-    if (hd->hd_req_aux.sd == sd) {
-        if (hd->hd_req.sess_ctx != ctx) {
+    if (httpd_sess_get_current(hd) == sd) {
+        httpd_req_t *r = httpd_req_get_current(hd);
+        if (r->sess_ctx != ctx) {
             /* Don't free previous context if it is in sockdb
              * as it will be freed inside httpd_req_cleanup() */
-            if (sd->ctx != hd->hd_req.sess_ctx) {
+            if (sd->ctx != r->sess_ctx) {
                 /* Free previous context */
-                httpd_sess_free_ctx(hd->hd_req.sess_ctx, hd->hd_req.free_ctx);
+                httpd_sess_free_ctx(r->sess_ctx, r->free_ctx);
             }
-            hd->hd_req.sess_ctx = ctx;
+            r->sess_ctx = ctx;
         }
-        hd->hd_req.free_ctx = free_fn;
+        r->free_ctx = free_fn;
         return;
     }
 
@@ -184,7 +208,7 @@ void httpd_sess_set_descriptors(struct httpd_data *hd,
     int i;
     *maxfd = -1;
     for (i = 0; i < hd->config.max_open_sockets; i++) {
-        if (hd->hd_sd[i].fd != -1) {
+        if (hd->hd_sd[i].fd != -1 && !hd->hd_sd[i].busy) {
             FD_SET(hd->hd_sd[i].fd, fdset);
             if (hd->hd_sd[i].fd > *maxfd) {
                 *maxfd = hd->hd_sd[i].fd;
@@ -208,7 +232,8 @@ static inline uint64_t httpd_sess_get_lru_counter(void)
 void httpd_sess_delete_invalid(struct httpd_data *hd)
 {
     for (int i = 0; i < hd->config.max_open_sockets; i++) {
-        if (hd->hd_sd[i].fd != -1 && !fd_is_valid(hd->hd_sd[i].fd)) {
+        /* Sessions being processed by a worker are checked after the worker is done */
+        if (hd->hd_sd[i].fd != -1 && !hd->hd_sd[i].busy && !fd_is_valid(hd->hd_sd[i].fd)) {
             ESP_LOGW(TAG, LOG_FMT("Closing invalid socket %d"), hd->hd_sd[i].fd);
             httpd_sess_delete(hd, hd->hd_sd[i].fd);
         }
@@ -291,7 +316,7 @@ bool httpd_sess_pending(struct httpd_data *hd, int fd)
  * value is returned, everything related to this socket will be
  * cleaned up and the socket will be closed.
  */
-esp_err_t httpd_sess_process(struct httpd_data *hd, int newfd)
+esp_err_t httpd_sess_process(struct httpd_data *hd, httpd_req_t *r, int newfd)
 {
     struct sock_db *sd = httpd_sess_get(hd, newfd);
     if (! sd) {
@@ -299,11 +324,11 @@ esp_err_t httpd_sess_process(struct httpd_data *hd, int newfd)
     }
 
     ESP_LOGD(TAG, LOG_FMT("httpd_req_new"));
-    if (httpd_req_new(hd, sd) != ESP_OK) {
+    if (httpd_req_new(hd, r, sd) != ESP_OK) {
         return ESP_FAIL;
     }
     ESP_LOGD(TAG, LOG_FMT("httpd_req_delete"));
-    if (httpd_req_delete(hd) != ESP_OK) {
+    if (httpd_req_delete(hd, r) != ESP_OK) {
         return ESP_FAIL;
     }
     ESP_LOGD(TAG, LOG_FMT("success"));
@@ -342,6 +367,10 @@ esp_err_t httpd_sess_close_lru(struct httpd_data *hd)
         if (hd->hd_sd[i].fd == -1) {
             return ESP_OK;
         }
+        /* Sessions being processed by a worker can't be closed now */
+        if (hd->hd_sd[i].busy) {
+            continue;
+        }
         if (hd->hd_sd[i].lru_counter < lru_counter) {
             lru_counter = hd->hd_sd[i].lru_counter;
             lru_fd = hd->hd_sd[i].fd;
@@ -382,6 +411,12 @@ static void httpd_sess_close(void *arg)
             ESP_LOGD(TAG, "Skipping session close for %d as it seems to be a race condition", sock_db->fd);
             return;
         }
+        if (sock_db->busy) {
+            /* The server task closes the session once the worker is done with it */
+            ESP_LOGD(TAG, "Deferring session close for %d as it is being processed", sock_db->fd);
+            sock_db->close_pending = true;
+            return;
+        }
         int fd = sock_db->fd;
         struct httpd_data *hd = (struct httpd_data *) sock_db->handle;
         httpd_sess_delete(hd, fd);
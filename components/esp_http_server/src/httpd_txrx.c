@@ -29,6 +29,18 @@ esp_err_t httpd_sess_set_send_override(httpd_handle_t hd, int sockfd, httpd_send
         return ESP_ERR_INVALID_ARG;
     }
     sess->send_fn = send_func;
+    /* The default vectored send function would bypass send_func */
+    sess->sendv_fn = NULL;
+    return ESP_OK;
+}
+
+esp_err_t httpd_sess_set_sendv_override(httpd_handle_t hd, int sockfd, httpd_sendv_func_t sendv_func)
+{
+    struct sock_db *sess = httpd_sess_get(hd, sockfd);
+    if (!sess) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sess->sendv_fn = sendv_func;
     return ESP_OK;
 }
 
@@ -89,6 +101,111 @@ static esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len)
     return ESP_OK;
 }
 
+static esp_err_t httpd_sendv_all(httpd_req_t *r, httpd_send_buf_t *bufs, size_t count)
+{
+    struct httpd_req_aux *ra = r->aux;
+    int ret;
+
+    while (count > 0) {
+        ret = ra->sd->sendv_fn(ra->sd->handle, ra->sd->fd, bufs, count, 0);
+        if (ret < 0) {
+            ESP_LOGD(TAG, LOG_FMT("error in sendv_fn"));
+            return ESP_FAIL;
+        }
+        ESP_LOGD(TAG, LOG_FMT("sent = %d"), ret);
+        /* Skip the buffers sent completely, and the sent part of the next one */
+        while (count > 0 && (size_t) ret >= bufs->len) {
+            ret -= bufs->len;
+            bufs++;
+            count--;
+        }
+        if (count > 0) {
+            bufs->buf += ret;
+            bufs->len -= ret;
+        }
+    }
+    return ESP_OK;
+}
+
+/* The response headers are gathered in the scratch buffer, as the request
+ * headers kept there are no longer needed, and only sent when the buffer
+ * is full or together with the response data */
+static esp_err_t httpd_resp_buf_append(httpd_req_t *r, size_t *len, const char *buf, size_t buf_len)
+{
+    struct httpd_req_aux *ra = r->aux;
+
+    while (buf_len > 0) {
+        if (*len == sizeof(ra->scratch)) {
+            if (httpd_send_all(r, ra->scratch, *len) != ESP_OK) {
+                return ESP_FAIL;
+            }
+            *len = 0;
+        }
+        size_t copy_len = MIN(buf_len, sizeof(ra->scratch) - *len);
+        memcpy(ra->scratch + *len, buf, copy_len);
+        *len    += copy_len;
+        buf     += copy_len;
+        buf_len -= copy_len;
+    }
+    return ESP_OK;
+}
+
+/* Gathers the additional headers based on set_header and ends the header section */
+static esp_err_t httpd_resp_buf_append_hdrs(httpd_req_t *r, size_t *len)
+{
+    struct httpd_req_aux *ra = r->aux;
+
+    for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
+        const char *field = ra->resp_hdrs[i].field;
+        const char *value = ra->resp_hdrs[i].value;
+        if (httpd_resp_buf_append(r, len, field, strlen(field)) != ESP_OK ||
+            httpd_resp_buf_append(r, len, ": ", strlen(": ")) != ESP_OK ||
+            httpd_resp_buf_append(r, len, value, strlen(value)) != ESP_OK ||
+            httpd_resp_buf_append(r, len, "\r\n", strlen("\r\n")) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    return httpd_resp_buf_append(r, len, "\r\n", strlen("\r\n"));
+}
+
+/* Sends the gathered data followed by buf and trailer. These are copied
+ * behind the gathered data when they fit in the scratch buffer, otherwise
+ * everything is passed to the vectored send function of the session, so
+ * that a response normally takes a single call to send */
+static esp_err_t httpd_resp_buf_send(httpd_req_t *r, size_t len,
+                                     const char *buf, size_t buf_len,
+                                     const char *trailer)
+{
+    struct httpd_req_aux *ra = r->aux;
+    size_t trailer_len = trailer ? strlen(trailer) : 0;
+
+    if (len + buf_len + trailer_len <= sizeof(ra->scratch)) {
+        if (buf_len) {
+            memcpy(ra->scratch + len, buf, buf_len);
+        }
+        if (trailer_len) {
+            memcpy(ra->scratch + len + buf_len, trailer, trailer_len);
+        }
+        return httpd_send_all(r, ra->scratch, len + buf_len + trailer_len);
+    }
+
+    if (ra->sd->sendv_fn) {
+        httpd_send_buf_t bufs[] = {
+            { .buf = ra->scratch, .len = len },
+            { .buf = buf,         .len = buf_len },
+            { .buf = trailer,     .len = trailer_len },
+        };
+        return httpd_sendv_all(r, bufs, sizeof(bufs) / sizeof(bufs[0]));
+    }
+
+    if (httpd_send_all(r, ra->scratch, len) != ESP_OK ||
+        httpd_send_all(r, buf, buf_len) != ESP_OK ||
+        httpd_send_all(r, trailer, trailer_len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 static size_t httpd_recv_pending(httpd_req_t *r, char *buf, size_t buf_len)
 {
     struct httpd_req_aux *ra = r->aux;
@@ -244,8 +361,7 @@ esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
 
     struct httpd_req_aux *ra = r->aux;
     const char *httpd_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n";
-    const char *colon_separator = ": ";
-    const char *cr_lf_seperator = "\r\n";
+    size_t len;
 
     if (buf_len == HTTPD_RESP_USE_STRLEN) {
         buf_len = strlen(buf);
@@ -255,47 +371,21 @@ esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
     ra->req_hdrs_count = 0;
 
     /* Size of essential headers is limited by scratch buffer size */
-    if (snprintf(ra->scratch, sizeof(ra->scratch), httpd_hdr_str,
-                 ra->status, ra->content_type, buf_len) >= sizeof(ra->scratch)) {
+    len = snprintf(ra->scratch, sizeof(ra->scratch), httpd_hdr_str,
+                   ra->status, ra->content_type, buf_len);
+    if (len >= sizeof(ra->scratch)) {
         return ESP_ERR_HTTPD_RESP_HDR;
     }
 
-    /* Sending essential headers */
-    if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
+    /* Gathering additional headers based on set_header */
+    if (httpd_resp_buf_append_hdrs(r, &len) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
 
-    /* Sending additional headers based on set_header */
-    for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-        /* Send header field */
-        if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send ': ' */
-        if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send header value */
-        if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send CR + LF */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-    }
-
-    /* End header section */
-    if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
+    /* Sending headers and content */
+    if (httpd_resp_buf_send(r, len, buf, buf ? buf_len : 0, NULL) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
-
-    /* Sending content */
-    if (buf && buf_len) {
-        if (httpd_send_all(r, buf, buf_len) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-    }
     return ESP_OK;
 }
 
@@ -315,68 +405,37 @@ esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len
 
     struct httpd_req_aux *ra = r->aux;
     const char *httpd_chunked_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nTransfer-Encoding: chunked\r\n";
-    const char *colon_separator = ": ";
-    const char *cr_lf_seperator = "\r\n";
+    size_t len = 0;
 
     /* Request headers are no longer available */
     ra->req_hdrs_count = 0;
 
     if (!ra->first_chunk_sent) {
         /* Size of essential headers is limited by scratch buffer size */
-        if (snprintf(ra->scratch, sizeof(ra->scratch), httpd_chunked_hdr_str,
-                     ra->status, ra->content_type) >= sizeof(ra->scratch)) {
+        len = snprintf(ra->scratch, sizeof(ra->scratch), httpd_chunked_hdr_str,
+                       ra->status, ra->content_type);
+        if (len >= sizeof(ra->scratch)) {
             return ESP_ERR_HTTPD_RESP_HDR;
         }
 
-        /* Sending essential headers */
-        if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-
-        /* Sending additional headers based on set_header */
-        for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-            /* Send header field */
-            if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send ': ' */
-            if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send header value */
-            if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send CR + LF */
-            if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-        }
-
-        /* End header section */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
+        /* Gathering additional headers based on set_header */
+        if (httpd_resp_buf_append_hdrs(r, &len) != ESP_OK) {
             return ESP_ERR_HTTPD_RESP_SEND;
         }
-        ra->first_chunk_sent = true;
     }
 
-    /* Sending chunked content */
+    /* Sending chunk size, chunked content and end of chunk, along
+     * with the headers in case of the first chunk */
     char len_str[10];
     snprintf(len_str, sizeof(len_str), "%x\r\n", buf_len);
-    if (httpd_send_all(r, len_str, strlen(len_str)) != ESP_OK) {
+    if (httpd_resp_buf_append(r, &len, len_str, strlen(len_str)) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
 
-    if (buf) {
-        if (httpd_send_all(r, buf, (size_t) buf_len) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-    }
-
-    /* Indicate end of chunk */
-    if (httpd_send_all(r, "\r\n", strlen("\r\n")) != ESP_OK) {
+    if (httpd_resp_buf_send(r, len, buf, buf ? buf_len : 0, "\r\n") != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
+    ra->first_chunk_sent = true;
     return ESP_OK;
 }
 
@@ -586,6 +645,35 @@ int httpd_default_send(httpd_handle_t hd, int sockfd, const char *buf, size_t bu
     return ret;
 }
 
+int httpd_default_sendv(httpd_handle_t hd, int sockfd, const httpd_send_buf_t *bufs, size_t count, int flags)
+{
+    (void)hd;
+    if (bufs == NULL) {
+        return HTTPD_SOCK_ERR_INVALID;
+    }
+
+    /* Anything beyond HTTPD_SENDV_MAX_BUFS is left for the next call */
+    struct iovec iov[HTTPD_SENDV_MAX_BUFS];
+    struct msghdr msg = { .msg_iov = iov };
+    for (size_t i = 0; i < count && msg.msg_iovlen < HTTPD_SENDV_MAX_BUFS; i++) {
+        if (bufs[i].len == 0) {
+            continue;
+        }
+        iov[msg.msg_iovlen].iov_base = (void *) bufs[i].buf;
+        iov[msg.msg_iovlen].iov_len  = bufs[i].len;
+        msg.msg_iovlen++;
+    }
+    if (msg.msg_iovlen == 0) {
+        return 0;
+    }
+
+    int ret = sendmsg(sockfd, &msg, flags);
+    if (ret < 0) {
+        return httpd_sock_err("sendmsg", sockfd);
+    }
+    return ret;
+}
+
 int httpd_default_recv(httpd_handle_t hd, int sockfd, char *buf, size_t buf_len, int flags)
 {
     (void)hd;
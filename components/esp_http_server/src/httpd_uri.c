@@ -20,6 +20,7 @@
 
 #include <esp_http_server.h>
 #include "esp_httpd_priv.h"
+#include "uri_trie.h"
 
 static const char *TAG = "httpd_uri";
 
@@ -31,65 +32,47 @@ static bool httpd_uri_match_simple(const char *uri1, const char *uri2, size_t le
 
 bool httpd_uri_match_wildcard(const char *template, const char *uri, size_t len)
 {
-    const size_t tpl_len = strlen(template);
-    size_t exact_match_chars = tpl_len;
-
-    /* Check for trailing question mark and asterisk */
-    const char last = (const char) (tpl_len > 0 ? template[tpl_len - 1] : 0);
-    const char prevlast = (const char) (tpl_len > 1 ? template[tpl_len - 2] : 0);
-    const bool asterisk = last == '*' || (prevlast == '*' && last == '?');
-    const bool quest = last == '?' || (prevlast == '?' && last == '*');
-
-    /* Minimum template string length must be:
-     *      0 : if neither of '*' and '?' are present
-     *      1 : if only '*' is present
-     *      2 : if only '?' is present
-     *      3 : if both are present
-     *
-     * The expression (asterisk + quest*2) serves as a
-     * case wise generator of these length values
-     */
-
-    /* abort in cases such as "?" with no preceding character (invalid template) */
-    if (exact_match_chars < asterisk + quest*2) {
-        return false;
-    }
+    ut_template_t parsed;
+    ut_parse_template(template, true, &parsed);
+    return ut_match_template(template, &parsed, uri, len);
+}
 
-    /* account for special characters and the optional character if "?" is used */
-    exact_match_chars -= asterisk + quest*2;
+/* Compile the registered URI handlers into a trie, which is used for
+ * lookup instead of matching the URI against each handler in turn.
+ * This is only possible with the built-in URI matching functions. If
+ * the trie can't be allocated, the handlers are matched in turn.
+ * The trie is only changed when handlers are registered or unregistered,
+ * with hd_uri_lock taken, so that lookups by worker tasks only read it */
+static void httpd_uri_trie_rebuild(struct httpd_data *hd)
+{
+    ut_delete(hd->hd_uri_trie);
+    hd->hd_uri_trie = NULL;
 
-    if (len < exact_match_chars) {
-        return false;
+    if (hd->config.uri_match_fn && hd->config.uri_match_fn != httpd_uri_match_wildcard) {
+        return;
     }
 
-    if (!quest) {
-        if (!asterisk && len != exact_match_chars) {
-            /* no special characters and different length - strncmp would return false */
-            return false;
-        }
-        /* asterisk allows arbitrary trailing characters, we ignore these using
-         * exact_match_chars as the length limit */
-        return (strncmp(template, uri, exact_match_chars) == 0);
-    } else {
-        /* question mark present */
-        if (len > exact_match_chars && template[exact_match_chars] != uri[exact_match_chars]) {
-            /* the optional character is present, but different */
-            return false;
+    uri_trie_t *trie = ut_create(hd->config.uri_match_fn == httpd_uri_match_wildcard);
+    if (!trie) {
+        ESP_LOGW(TAG, LOG_FMT("no memory for URI trie"));
+        return;
+    }
+    for (int i = 0; i < hd->config.max_uri_handlers; i++) {
+        if (!hd->hd_calls[i]) {
+            break;
         }
-        if (strncmp(template, uri, exact_match_chars) != 0) {
-            /* the mandatory part differs */
-            return false;
+        if (!ut_add(trie, hd->hd_calls[i]->uri, hd->hd_calls[i]->method, hd->hd_calls[i])) {
+            ESP_LOGW(TAG, LOG_FMT("no memory for URI trie"));
+            ut_delete(trie);
+            return;
         }
-        /* Now we know the URI is longer than the required part of template,
-         * the mandatory part matches, and if the optional character is present, it is correct.
-         * Match is OK if we have asterisk, i.e. any trailing characters are OK, or if
-         * there are no characters beyond the optional character. */
-        return asterisk || len <= exact_match_chars + 1;
     }
+    hd->hd_uri_trie = trie;
 }
 
 /* Find handler with matching URI and method, and set
- * appropriate error code if URI or method not found */
+ * appropriate error code if URI or method not found.
+ * Call this function with hd_uri_lock taken */
 static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
                                            const char *uri, size_t uri_len,
                                            httpd_method_t method,
@@ -99,6 +82,15 @@ static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
         *err = HTTPD_404_NOT_FOUND;
     }
 
+    if (hd->hd_uri_trie) {
+        bool uri_found;
+        httpd_uri_t *call = ut_find(hd->hd_uri_trie, uri, uri_len, method, &uri_found);
+        if (err) {
+            *err = call ? 0 : (uri_found ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND);
+        }
+        return call;
+    }
+
     for (int i = 0; i < hd->config.max_uri_handlers; i++) {
         if (!hd->hd_calls[i]) {
             break;
@@ -131,20 +123,14 @@ static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
     return NULL;
 }
 
-esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
-                                     const httpd_uri_t *uri_handler)
+static esp_err_t httpd_add_uri_handler(struct httpd_data *hd,
+                                       const httpd_uri_t *uri_handler)
 {
-    if (handle == NULL || uri_handler == NULL) {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    struct httpd_data *hd = (struct httpd_data *) handle;
-
     /* Make sure another handler with matching URI and method
      * is not already registered. This will also catch cases
      * when a registered URI wildcard pattern already accounts
      * for the new URI being registered */
-    if (httpd_find_uri_handler(handle, uri_handler->uri,
+    if (httpd_find_uri_handler(hd, uri_handler->uri,
                                strlen(uri_handler->uri),
                                uri_handler->method, NULL) != NULL) {
         ESP_LOGW(TAG, LOG_FMT("handler %s with method %d already registered"),
@@ -173,6 +159,13 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
             hd->hd_calls[i]->handler  = uri_handler->handler;
             hd->hd_calls[i]->user_ctx = uri_handler->user_ctx;
             ESP_LOGD(TAG, LOG_FMT("[%d] installed %s"), i, uri_handler->uri);
+
+            /* Handlers are added last, so they can be added to the trie
+             * without changing the order in which handlers are matched */
+            if (!hd->hd_uri_trie ||
+                !ut_add(hd->hd_uri_trie, hd->hd_calls[i]->uri, hd->hd_calls[i]->method, hd->hd_calls[i])) {
+                httpd_uri_trie_rebuild(hd);
+            }
             return ESP_OK;
         }
         ESP_LOGD(TAG, LOG_FMT("[%d] exists %s"), i, hd->hd_calls[i]->uri);
@@ -181,14 +174,23 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
     return ESP_ERR_HTTPD_HANDLERS_FULL;
 }
 
-esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
-                                       const char *uri, httpd_method_t method)
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
+                                     const httpd_uri_t *uri_handler)
 {
-    if (handle == NULL || uri == NULL) {
+    if (handle == NULL || uri_handler == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
     struct httpd_data *hd = (struct httpd_data *) handle;
+    httpd_os_mutex_lock(hd->hd_uri_lock);
+    esp_err_t ret = httpd_add_uri_handler(hd, uri_handler);
+    httpd_os_mutex_unlock(hd->hd_uri_lock);
+    return ret;
+}
+
+static esp_err_t httpd_remove_uri_handler(struct httpd_data *hd,
+                                          const char *uri, httpd_method_t method)
+{
     for (int i = 0; i < hd->config.max_uri_handlers; i++) {
         if (!hd->hd_calls[i]) {
             break;
@@ -211,6 +213,7 @@ esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
             }
             /* Nullify the following non null entry */
             hd->hd_calls[i-1] = NULL;
+            httpd_uri_trie_rebuild(hd);
             return ESP_OK;
         }
     }
@@ -218,6 +221,20 @@ esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
     return ESP_ERR_NOT_FOUND;
 }
 
+esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
+                                       const char *uri, httpd_method_t method)
+{
+    if (handle == NULL || uri == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_data *hd = (struct httpd_data *) handle;
+    httpd_os_mutex_lock(hd->hd_uri_lock);
+    esp_err_t ret = httpd_remove_uri_handler(hd, uri, method);
+    httpd_os_mutex_unlock(hd->hd_uri_lock);
+    return ret;
+}
+
 esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
 {
     if (handle == NULL || uri == NULL) {
@@ -227,6 +244,7 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
     struct httpd_data *hd = (struct httpd_data *) handle;
     bool found = false;
 
+    httpd_os_mutex_lock(hd->hd_uri_lock);
     int i = 0, j = 0; // For keeping count of removed entries
     for (; i < hd->config.max_uri_handlers; i++) {
         if (!hd->hd_calls[i]) {
@@ -252,6 +270,11 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
         hd->hd_calls[k] = NULL;
     }
 
+    if (found) {
+        httpd_uri_trie_rebuild(hd);
+    }
+    httpd_os_mutex_unlock(hd->hd_uri_lock);
+
     if (!found) {
         ESP_LOGW(TAG, LOG_FMT("no handler found for URI %s"), uri);
     }
@@ -260,6 +283,9 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
 
 void httpd_unregister_all_uri_handlers(struct httpd_data *hd)
 {
+    ut_delete(hd->hd_uri_trie);
+    hd->hd_uri_trie = NULL;
+
     for (unsigned i = 0; i < hd->config.max_uri_handlers; i++) {
         if (!hd->hd_calls[i]) {
             break;
@@ -272,11 +298,11 @@ void httpd_unregister_all_uri_handlers(struct httpd_data *hd)
     }
 }
 
-esp_err_t httpd_uri(struct httpd_data *hd)
+esp_err_t httpd_uri(struct httpd_data *hd, httpd_req_t *req)
 {
     httpd_uri_t            *uri = NULL;
-    httpd_req_t            *req = &hd->hd_req;
-    struct http_parser_url *res = &hd->hd_req_aux.url_parse_res;
+    httpd_uri_t             uri_copy;
+    struct http_parser_url *res = &((struct httpd_req_aux *) req->aux)->url_parse_res;
 
     /* For conveying URI not found/method not allowed */
     httpd_err_code_t err = 0;
@@ -285,8 +311,16 @@ esp_err_t httpd_uri(struct httpd_data *hd)
 
     /* URL parser result contains offset and length of path string */
     if (res->field_set & (1 << UF_PATH)) {
+        /* The handler is copied, as it may be unregistered by another
+         * task once the lock is released */
+        httpd_os_mutex_lock(hd->hd_uri_lock);
         uri = httpd_find_uri_handler(hd, req->uri + res->field_data[UF_PATH].off,
                                      res->field_data[UF_PATH].len, req->method, &err);
+        if (uri) {
+            uri_copy = *uri;
+            uri = &uri_copy;
+        }
+        httpd_os_mutex_unlock(hd->hd_uri_lock);
     }
 
     /* If URI with method not found, respond with error code */
@@ -17,6 +17,8 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include <unistd.h>
 #include <stdint.h>
 #include <esp_timer.h>
@@ -29,6 +31,8 @@ extern "C" {
 #define OS_FAIL    ESP_FAIL
 
 typedef TaskHandle_t othread_t;
+typedef QueueHandle_t oqueue_t;
+typedef SemaphoreHandle_t omutex_t;
 
 static inline int httpd_os_thread_create(othread_t *thread,
                                  const char *name, uint16_t stacksize, int prio,
@@ -58,6 +62,64 @@ static inline othread_t httpd_os_thread_handle(void)
     return xTaskGetCurrentTaskHandle();
 }
 
+static inline oqueue_t httpd_os_queue_create(unsigned len, size_t item_size)
+{
+    return xQueueCreate(len, item_size);
+}
+
+static inline void httpd_os_queue_delete(oqueue_t queue)
+{
+    vQueueDelete(queue);
+}
+
+/* Blocks until there is space in the queue */
+static inline int httpd_os_queue_send(oqueue_t queue, const void *item)
+{
+    if (xQueueSend(queue, item, portMAX_DELAY) == pdTRUE) {
+        return OS_SUCCESS;
+    }
+    return OS_FAIL;
+}
+
+/* Blocks until an item is available */
+static inline int httpd_os_queue_recv(oqueue_t queue, void *item)
+{
+    if (xQueueReceive(queue, item, portMAX_DELAY) == pdTRUE) {
+        return OS_SUCCESS;
+    }
+    return OS_FAIL;
+}
+
+/* Fails at once if the queue is empty */
+static inline int httpd_os_queue_try_recv(oqueue_t queue, void *item)
+{
+    if (xQueueReceive(queue, item, 0) == pdTRUE) {
+        return OS_SUCCESS;
+    }
+    return OS_FAIL;
+}
+
+static inline omutex_t httpd_os_mutex_create(void)
+{
+    return xSemaphoreCreateMutex();
+}
+
+static inline void httpd_os_mutex_delete(omutex_t mutex)
+{
+    vSemaphoreDelete(mutex);
+}
+
+/* Blocks until the mutex is taken */
+static inline void httpd_os_mutex_lock(omutex_t mutex)
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+}
+
+static inline void httpd_os_mutex_unlock(omutex_t mutex)
+{
+    xSemaphoreGive(mutex);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,330 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "uri_trie.h"
+
+/* A template is stored as one or two routes, on the nodes reached by the
+ * strings the URI must be equal to (exact routes) or start with (prefix
+ * routes). E.g. "/a?*" has an exact route on "/" and a prefix route on "/a".
+ */
+typedef struct ut_route {
+    struct ut_route *next;
+    void *ctx;
+    unsigned seq;           /* Order in which the template was added */
+    unsigned method;
+    bool prefix;
+} ut_route_t;
+
+/* Radix tree node. The label is the part of the key between the parent
+ * node and this one, and points into one of the template strings. The
+ * method bitmaps tell which methods the routes of this node handle, so
+ * nodes without a matching route are passed without walking the routes.
+ */
+typedef struct ut_node {
+    const char *label;
+    size_t label_len;
+    struct ut_node *child;
+    struct ut_node *next;
+    ut_route_t *routes;
+    uint64_t exact_methods;
+    uint64_t prefix_methods;
+} ut_node_t;
+
+struct uri_trie {
+    ut_node_t root;
+    unsigned count;
+    bool wildcard;
+};
+
+/* Methods beyond the bitmap width share the last bit */
+static inline uint64_t ut_method_bit(unsigned method)
+{
+    return 1ULL << (method < 63 ? method : 63);
+}
+
+void ut_parse_template(const char *tpl, bool wildcard, ut_template_t *parsed)
+{
+    const size_t tpl_len = strlen(tpl);
+
+    memset(parsed, 0, sizeof(*parsed));
+    parsed->exact_len = tpl_len;
+    parsed->valid = true;
+    if (!wildcard) {
+        return;
+    }
+
+    /* Check for trailing question mark and asterisk */
+    const char last = (const char) (tpl_len > 0 ? tpl[tpl_len - 1] : 0);
+    const char prevlast = (const char) (tpl_len > 1 ? tpl[tpl_len - 2] : 0);
+    const bool asterisk = last == '*' || (prevlast == '*' && last == '?');
+    const bool quest = last == '?' || (prevlast == '?' && last == '*');
+
+    /* Minimum template string length must be:
+     *      0 : if neither of '*' and '?' are present
+     *      1 : if only '*' is present
+     *      2 : if only '?' is present
+     *      3 : if both are present
+     *
+     * The expression (asterisk + quest*2) serves as a
+     * case wise generator of these length values
+     */
+
+    /* abort in cases such as "?" with no preceding character (invalid template) */
+    if (tpl_len < asterisk + quest*2) {
+        parsed->valid = false;
+        return;
+    }
+
+    /* account for special characters and the optional character if "?" is used */
+    parsed->exact_len = tpl_len - (asterisk + quest*2);
+    parsed->has_optional = quest;
+    parsed->any_tail = asterisk;
+}
+
+bool ut_match_template(const char *tpl, const ut_template_t *parsed, const char *uri, size_t len)
+{
+    const size_t exact_match_chars = parsed->exact_len;
+
+    if (!parsed->valid || len < exact_match_chars) {
+        return false;
+    }
+
+    if (!parsed->has_optional) {
+        if (!parsed->any_tail && len != exact_match_chars) {
+            /* no special characters and different length - strncmp would return false */
+            return false;
+        }
+        /* asterisk allows arbitrary trailing characters, we ignore these using
+         * exact_match_chars as the length limit */
+        return (strncmp(tpl, uri, exact_match_chars) == 0);
+    } else {
+        /* question mark present */
+        if (len > exact_match_chars && tpl[exact_match_chars] != uri[exact_match_chars]) {
+            /* the optional character is present, but different */
+            return false;
+        }
+        if (strncmp(tpl, uri, exact_match_chars) != 0) {
+            /* the mandatory part differs */
+            return false;
+        }
+        /* Now we know the URI is longer than the required part of template,
+         * the mandatory part matches, and if the optional character is present, it is correct.
+         * Match is OK if we have asterisk, i.e. any trailing characters are OK, or if
+         * there are no characters beyond the optional character. */
+        return parsed->any_tail || len <= exact_match_chars + 1;
+    }
+}
+
+uri_trie_t *ut_create(bool wildcard)
+{
+    uri_trie_t *trie = calloc(1, sizeof(uri_trie_t));
+    if (trie) {
+        trie->wildcard = wildcard;
+    }
+    return trie;
+}
+
+static void ut_free_node(ut_node_t *node)
+{
+    while (node->routes) {
+        ut_route_t *route = node->routes;
+        node->routes = route->next;
+        free(route);
+    }
+    while (node->child) {
+        ut_node_t *child = node->child;
+        node->child = child->next;
+        ut_free_node(child);
+        free(child);
+    }
+}
+
+void ut_delete(uri_trie_t *trie)
+{
+    if (trie) {
+        ut_free_node(&trie->root);
+        free(trie);
+    }
+}
+
+/* Find or create the node reached by key, splitting the label
+ * of an existing node if the key ends in the middle of it */
+static ut_node_t *ut_get_node(uri_trie_t *trie, const char *key, size_t key_len)
+{
+    ut_node_t *node = &trie->root;
+    size_t pos = 0;
+
+    while (pos < key_len) {
+        ut_node_t **link = &node->child;
+        while (*link && (*link)->label[0] != key[pos]) {
+            link = &(*link)->next;
+        }
+
+        ut_node_t *child = *link;
+        if (!child) {
+            child = calloc(1, sizeof(ut_node_t));
+            if (!child) {
+                return NULL;
+            }
+            child->label = key + pos;
+            child->label_len = key_len - pos;
+            *link = child;
+            return child;
+        }
+
+        size_t common = 1;
+        while (common < child->label_len && pos + common < key_len &&
+               child->label[common] == key[pos + common]) {
+            common++;
+        }
+
+        if (common < child->label_len) {
+            ut_node_t *mid = calloc(1, sizeof(ut_node_t));
+            if (!mid) {
+                return NULL;
+            }
+            mid->label = child->label;
+            mid->label_len = common;
+            mid->child = child;
+            mid->next = child->next;
+            child->label += common;
+            child->label_len -= common;
+            child->next = NULL;
+            *link = mid;
+            child = mid;
+        }
+        node = child;
+        pos += common;
+    }
+    return node;
+}
+
+static bool ut_add_route(uri_trie_t *trie, const char *key, size_t key_len,
+                         bool prefix, unsigned method, void *ctx)
+{
+    ut_node_t *node = ut_get_node(trie, key, key_len);
+    if (!node) {
+        return false;
+    }
+
+    ut_route_t *route = calloc(1, sizeof(ut_route_t));
+    if (!route) {
+        return false;
+    }
+    route->ctx = ctx;
+    route->seq = trie->count;
+    route->method = method;
+    route->prefix = prefix;
+
+    /* Keep the routes in the order they were added */
+    ut_route_t **link = &node->routes;
+    while (*link) {
+        link = &(*link)->next;
+    }
+    *link = route;
+
+    if (prefix) {
+        node->prefix_methods |= ut_method_bit(method);
+    } else {
+        node->exact_methods |= ut_method_bit(method);
+    }
+    return true;
+}
+
+bool ut_add(uri_trie_t *trie, const char *tpl, unsigned method, void *ctx)
+{
+    ut_template_t parsed;
+    ut_parse_template(tpl, trie->wildcard, &parsed);
+    if (!parsed.valid) {
+        /* Never matches, nothing to store */
+        trie->count++;
+        return true;
+    }
+
+    const size_t len = parsed.exact_len;
+    bool ret;
+    if (!parsed.has_optional) {
+        ret = ut_add_route(trie, tpl, len, parsed.any_tail, method, ctx);
+    } else {
+        /* The optional character is the one following the exact part */
+        ret = ut_add_route(trie, tpl, len, false, method, ctx) &&
+              ut_add_route(trie, tpl, len + 1, parsed.any_tail, method, ctx);
+    }
+    trie->count++;
+    return ret;
+}
+
+/* Update best with the first route of node of the given type handling method */
+static void ut_check_routes(const ut_node_t *node, bool prefix, unsigned method,
+                            const ut_route_t **best)
+{
+    for (const ut_route_t *route = node->routes; route; route = route->next) {
+        if (*best && route->seq > (*best)->seq) {
+            return;
+        }
+        if (route->prefix == prefix && route->method == method) {
+            *best = route;
+            return;
+        }
+    }
+}
+
+void *ut_find(const uri_trie_t *trie, const char *uri, size_t len, unsigned method, bool *uri_found)
+{
+    const uint64_t bit = ut_method_bit(method);
+    const ut_route_t *best = NULL;
+    const ut_node_t *node = &trie->root;
+    bool found = false;
+    size_t pos = 0;
+
+    while (true) {
+        /* Prefix routes match anything following the node */
+        if (node->prefix_methods) {
+            found = true;
+            if (node->prefix_methods & bit) {
+                ut_check_routes(node, true, method, &best);
+            }
+        }
+
+        if (pos == len) {
+            if (node->exact_methods) {
+                found = true;
+                if (node->exact_methods & bit) {
+                    ut_check_routes(node, false, method, &best);
+                }
+            }
+            break;
+        }
+
+        const ut_node_t *child = node->child;
+        while (child && child->label[0] != uri[pos]) {
+            child = child->next;
+        }
+        if (!child || child->label_len > len - pos ||
+            memcmp(child->label, uri + pos, child->label_len) != 0) {
+            break;
+        }
+        node = child;
+        pos += child->label_len;
+    }
+
+    if (uri_found) {
+        *uri_found = found;
+    }
+    return best ? best->ctx : NULL;
+}
@@ -0,0 +1,127 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file uri_trie.h
+ * \brief Prefix trie for URI handler lookup
+ *
+ * Comparing a request URI against every registered URI template takes
+ * time proportional to the number of templates. This trie stores the
+ * templates in a radix tree instead, so that a lookup only walks the
+ * characters of the request URI once, whatever the number of templates.
+ *
+ * Templates are interpreted either as plain strings, or in the same way
+ * as by httpd_uri_match_wildcard(), with a trailing '?' and / or '*'.
+ */
+#ifndef _URI_TRIE_H_
+#define _URI_TRIE_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Parsed URI template
+ */
+typedef struct {
+    size_t exact_len;       /*!< Length of the part of the URI which must match exactly */
+    bool   has_optional;    /*!< The character following that part may be present in the URI */
+    bool   any_tail;        /*!< Any characters may follow in the URI */
+    bool   valid;           /*!< False if the template can never match */
+} ut_template_t;
+
+/**
+ * @brief Opaque URI trie type
+ */
+typedef struct uri_trie uri_trie_t;
+
+/**
+ * @brief Parse a URI template
+ *
+ * @param[in]  tpl       the template string
+ * @param[in]  wildcard  interpret a trailing '?' and '*' like httpd_uri_match_wildcard(),
+ *                       otherwise the template is a plain string
+ * @param[out] parsed    the parsed template
+ */
+void ut_parse_template(const char *tpl, bool wildcard, ut_template_t *parsed);
+
+/**
+ * @brief Match a URI against a parsed template
+ *
+ * @param[in] tpl     the template string
+ * @param[in] parsed  the template parsed by ut_parse_template()
+ * @param[in] uri     the URI to match
+ * @param[in] len     length of the URI
+ *
+ * @return true if the URI matches the template
+ */
+bool ut_match_template(const char *tpl, const ut_template_t *parsed, const char *uri, size_t len);
+
+/**
+ * @brief Create an empty URI trie
+ *
+ * @param[in] wildcard  how templates are interpreted, see ut_parse_template()
+ *
+ * @return the trie, or NULL if out of memory
+ */
+uri_trie_t *ut_create(bool wildcard);
+
+/**
+ * @brief Free a URI trie
+ *
+ * @param[in] trie  the trie to free, may be NULL
+ */
+void ut_delete(uri_trie_t *trie);
+
+/**
+ * @brief Add a URI template to the trie
+ *
+ * When several templates match a URI, ut_find() returns the one
+ * added first, which supports the requested method.
+ *
+ * @note The trie keeps pointers into tpl, so the string must stay
+ *       valid and unchanged until the trie is freed.
+ *
+ * @param[in] trie    the trie
+ * @param[in] tpl     the template string
+ * @param[in] method  the method handled
+ * @param[in] ctx     value returned by ut_find() for this template and method
+ *
+ * @return false if out of memory. The template may then be partially
+ *         added, so the trie should be freed.
+ */
+bool ut_add(uri_trie_t *trie, const char *tpl, unsigned method, void *ctx);
+
+/**
+ * @brief Find the template matching a URI and method
+ *
+ * @param[in]  trie       the trie
+ * @param[in]  uri        the URI to match
+ * @param[in]  len        length of the URI
+ * @param[in]  method     the requested method
+ * @param[out] uri_found  set to true if any template matches the URI,
+ *                        whatever its method. May be NULL.
+ *
+ * @return the ctx passed to ut_add() for the matching template, or NULL
+ */
+void *ut_find(const uri_trie_t *trie, const char *uri, size_t len, unsigned method, bool *uri_found);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ! _URI_TRIE_H_ */
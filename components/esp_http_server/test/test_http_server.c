@@ -14,8 +14,14 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include <esp_system.h>
 #include <esp_http_server.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <lwip/sockets.h>
 
 #include "unity.h"
 #include "test_utils.h"
@@ -156,6 +162,322 @@ TEST_CASE("Leak Test", "[HTTP SERVER]")
     TEST_ASSERT(res == true);
 }
 
+#define TEST_WORKER_COUNT 3
+
+TEST_CASE("Worker Tasks Test", "[HTTP SERVER]")
+{
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.worker_count = TEST_WORKER_COUNT;
+    config.worker_spread_cores = true;
+
+    test_case_uses_tcpip();
+
+    unsigned task_count = uxTaskGetNumberOfTasks();
+
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    vTaskDelay(10);
+    /* Server task and the workers */
+    TEST_ASSERT_EQUAL(task_count + 1 + TEST_WORKER_COUNT, uxTaskGetNumberOfTasks());
+    test_handler_limit(hd);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+    vTaskDelay(10);
+    TEST_ASSERT_EQUAL(task_count, uxTaskGetNumberOfTasks());
+}
+
+#define TEST_CLIENT_COUNT       4
+#define TEST_CLIENT_CONNECTIONS 5
+#define TEST_CLIENT_REQUESTS    4
+
+/* Sessions are opened and closed by the server task only */
+static int s_sess_opened, s_sess_closed;
+
+static esp_err_t count_sess_open(httpd_handle_t hd, int sockfd)
+{
+    s_sess_opened++;
+    return ESP_OK;
+}
+
+static void count_sess_close(httpd_handle_t hd, int sockfd)
+{
+    s_sess_closed++;
+}
+
+static esp_err_t slow_hello_handler(httpd_req_t *req)
+{
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+    return httpd_resp_sendstr(req, "hello");
+}
+
+typedef struct {
+    uint16_t port;
+    int responses;
+    SemaphoreHandle_t done;
+} test_client_t;
+
+static bool test_client_request(int sock)
+{
+    static const char request[] = "GET /hello HTTP/1.1\r\nHost: test\r\n\r\n";
+    char resp[256];
+    int len = 0;
+
+    if (send(sock, request, sizeof(request) - 1, 0) != sizeof(request) - 1) {
+        return false;
+    }
+    while (len < sizeof(resp) - 1) {
+        int ret = recv(sock, resp + len, sizeof(resp) - 1 - len, 0);
+        if (ret <= 0) {
+            return false;
+        }
+        len += ret;
+        resp[len] = '\0';
+        /* The body is the end of the response */
+        if (strstr(resp, "\r\n\r\nhello")) {
+            return strncmp(resp, "HTTP/1.1 200", 12) == 0;
+        }
+    }
+    return false;
+}
+
+static void test_client_task(void *arg)
+{
+    test_client_t *client = (test_client_t *) arg;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(client->port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    /* Requests on keep-alive connections, which the client closes */
+    for (int c = 0; c < TEST_CLIENT_CONNECTIONS; c++) {
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0) {
+            continue;
+        }
+        if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+            for (int r = 0; r < TEST_CLIENT_REQUESTS && test_client_request(sock); r++) {
+                client->responses++;
+            }
+        }
+        close(sock);
+    }
+    xSemaphoreGive(client->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("Worker Tasks Session Release Test", "[HTTP SERVER]")
+{
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.worker_count = TEST_WORKER_COUNT;
+    config.open_fn = count_sess_open;
+    config.close_fn = count_sess_close;
+    httpd_uri_t hello = {
+        .uri      = "/hello",
+        .method   = HTTP_GET,
+        .handler  = slow_hello_handler,
+        .user_ctx = NULL,
+    };
+    test_client_t clients[TEST_CLIENT_COUNT];
+
+    test_case_uses_tcpip();
+
+    s_sess_opened = 0;
+    s_sess_closed = 0;
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &hello) == ESP_OK);
+
+    for (int i = 0; i < TEST_CLIENT_COUNT; i++) {
+        clients[i].port = config.server_port;
+        clients[i].responses = 0;
+        clients[i].done = xSemaphoreCreateBinary();
+        TEST_ASSERT_NOT_NULL(clients[i].done);
+        TEST_ASSERT(xTaskCreate(test_client_task, "test_client", 4096, &clients[i], 5, NULL) == pdPASS);
+    }
+    for (int i = 0; i < TEST_CLIENT_COUNT; i++) {
+        xSemaphoreTake(clients[i].done, portMAX_DELAY);
+        vSemaphoreDelete(clients[i].done);
+        TEST_ASSERT_EQUAL(TEST_CLIENT_CONNECTIONS * TEST_CLIENT_REQUESTS, clients[i].responses);
+    }
+
+    /* The server task only notices that a connection was closed by the
+     * client once the worker has handed the session back */
+    for (int i = 0; i < 100 && s_sess_closed != TEST_CLIENT_COUNT * TEST_CLIENT_CONNECTIONS; i++) {
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+    TEST_ASSERT_EQUAL(TEST_CLIENT_COUNT * TEST_CLIENT_CONNECTIONS, s_sess_opened);
+    TEST_ASSERT_EQUAL(TEST_CLIENT_COUNT * TEST_CLIENT_CONNECTIONS, s_sess_closed);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
+#define TEST_LARGE_BODY_LEN     2000
+#define TEST_SEND_UNLIMITED     SIZE_MAX
+
+/* The send functions of the session behave like a socket which
+ * only accepts that many bytes per call. A vectored send cap of
+ * 0 leaves the session with the send function only */
+static size_t s_send_cap, s_sendv_cap;
+static volatile int s_send_calls, s_sendv_calls;
+static volatile size_t s_send_bytes;
+static char s_large_body[TEST_LARGE_BODY_LEN];
+
+static int short_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    s_send_calls++;
+    int ret = send(sockfd, buf, buf_len < s_send_cap ? buf_len : s_send_cap, flags);
+    if (ret < 0) {
+        return HTTPD_SOCK_ERR_FAIL;
+    }
+    s_send_bytes += ret;
+    return ret;
+}
+
+static int short_sendv(httpd_handle_t hd, int sockfd, const httpd_send_buf_t *bufs, size_t count, int flags)
+{
+    size_t sent = 0;
+
+    s_sendv_calls++;
+    for (size_t i = 0; i < count && sent < s_sendv_cap; i++) {
+        size_t len = bufs[i].len < s_sendv_cap - sent ? bufs[i].len : s_sendv_cap - sent;
+        if (len && send(sockfd, bufs[i].buf, len, flags) != len) {
+            return HTTPD_SOCK_ERR_FAIL;
+        }
+        sent += len;
+    }
+    return sent;
+}
+
+static esp_err_t send_test_handler(httpd_req_t *req)
+{
+    int sockfd = httpd_req_to_sockfd(req);
+
+    httpd_sess_set_send_override(req->handle, sockfd, short_send);
+    if (s_sendv_cap) {
+        httpd_sess_set_sendv_override(req->handle, sockfd, short_sendv);
+    }
+    s_send_calls = 0;
+    s_sendv_calls = 0;
+    s_send_bytes = 0;
+
+    httpd_resp_set_hdr(req, "X-Test", "value");
+    if (strcmp(req->uri, "/small") == 0) {
+        return httpd_resp_sendstr(req, "hello");
+    }
+    if (strcmp(req->uri, "/large") == 0) {
+        return httpd_resp_send(req, s_large_body, sizeof(s_large_body));
+    }
+    if (httpd_resp_send_chunk(req, "abc", 3) != ESP_OK ||
+        httpd_resp_send_chunk(req, s_large_body, sizeof(s_large_body)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/* Sends a request and checks that exactly the expected response is received */
+static void test_send_request(int sock, const char *uri, const char *expect, size_t expect_len)
+{
+    static char resp[TEST_LARGE_BODY_LEN + 256];
+    char request[64];
+    size_t len = 0;
+
+    int request_len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: test\r\n\r\n", uri);
+    TEST_ASSERT_EQUAL(request_len, send(sock, request, request_len, 0));
+    while (len < expect_len) {
+        int ret = recv(sock, resp + len, expect_len - len, 0);
+        TEST_ASSERT_TRUE(ret > 0);
+        len += ret;
+    }
+    TEST_ASSERT_EQUAL(0, memcmp(resp, expect, expect_len));
+}
+
+TEST_CASE("Response Send Coalescing Test", "[HTTP SERVER]")
+{
+    static char small[256], large[TEST_LARGE_BODY_LEN + 256], chunked[TEST_LARGE_BODY_LEN + 256];
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.uri_match_fn = httpd_uri_match_wildcard;
+    httpd_uri_t send_test = {
+        .uri      = "/*",
+        .method   = HTTP_GET,
+        .handler  = send_test_handler,
+        .user_ctx = NULL,
+    };
+
+    test_case_uses_tcpip();
+
+    /* The body is larger than the scratch buffer, so it can't be
+     * gathered with the headers */
+    for (int i = 0; i < sizeof(s_large_body); i++) {
+        s_large_body[i] = 'a' + i % 26;
+    }
+    size_t small_len = snprintf(small, sizeof(small),
+                                "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 5\r\n"
+                                "X-Test: value\r\n\r\nhello");
+    size_t large_len = snprintf(large, sizeof(large),
+                                "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: %d\r\n"
+                                "X-Test: value\r\n\r\n", TEST_LARGE_BODY_LEN);
+    memcpy(large + large_len, s_large_body, sizeof(s_large_body));
+    large_len += sizeof(s_large_body);
+    size_t chunked_len = snprintf(chunked, sizeof(chunked),
+                                  "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nTransfer-Encoding: chunked\r\n"
+                                  "X-Test: value\r\n\r\n3\r\nabc\r\n%x\r\n", TEST_LARGE_BODY_LEN);
+    memcpy(chunked + chunked_len, s_large_body, sizeof(s_large_body));
+    chunked_len += sizeof(s_large_body);
+    chunked_len += snprintf(chunked + chunked_len, sizeof(chunked) - chunked_len, "\r\n0\r\n\r\n");
+
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &send_test) == ESP_OK);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config.server_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT_TRUE(sock >= 0);
+    TEST_ASSERT_EQUAL(0, connect(sock, (struct sockaddr *) &addr, sizeof(addr)));
+
+    /* Headers and small bodies leave in a single send, large
+     * bodies together with the headers in a single vectored send */
+    s_send_cap = TEST_SEND_UNLIMITED;
+    s_sendv_cap = TEST_SEND_UNLIMITED;
+    test_send_request(sock, "/small", small, small_len);
+    TEST_ASSERT_EQUAL(1, s_send_calls);
+    TEST_ASSERT_EQUAL(0, s_sendv_calls);
+    test_send_request(sock, "/large", large, large_len);
+    TEST_ASSERT_EQUAL(0, s_send_calls);
+    TEST_ASSERT_EQUAL(1, s_sendv_calls);
+    test_send_request(sock, "/chunked", chunked, chunked_len);
+    TEST_ASSERT_EQUAL(2, s_send_calls);
+    TEST_ASSERT_EQUAL(1, s_sendv_calls);
+
+    /* Partial writes are resumed where they stopped, also in the
+     * middle of a buffer of the vectored send */
+    s_send_cap = 7;
+    s_sendv_cap = 100;
+    test_send_request(sock, "/small", small, small_len);
+    TEST_ASSERT_EQUAL((small_len + 6) / 7, s_send_calls);
+    test_send_request(sock, "/large", large, large_len);
+    TEST_ASSERT_EQUAL(0, s_send_calls);
+    TEST_ASSERT_EQUAL((large_len + 99) / 100, s_sendv_calls);
+    test_send_request(sock, "/chunked", chunked, chunked_len);
+
+    /* A session with only a send override never has its data sent
+     * by the default vectored send function */
+    s_sendv_cap = 0;
+    test_send_request(sock, "/large", large, large_len);
+    TEST_ASSERT_EQUAL(0, s_sendv_calls);
+    TEST_ASSERT_EQUAL(large_len, s_send_bytes);
+    test_send_request(sock, "/chunked", chunked, chunked_len);
+    TEST_ASSERT_EQUAL(0, s_sendv_calls);
+    TEST_ASSERT_EQUAL(chunked_len, s_send_bytes);
+
+    close(sock);
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
 TEST_CASE("Basic Functionality Tests", "[HTTP SERVER]")
 {
     httpd_handle_t hd;
@@ -0,0 +1,212 @@
+#include "catch.hpp"
+#include "uri_trie.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+struct Handler {
+    std::string uri;
+    unsigned method;
+    ut_template_t parsed;
+};
+
+/* Reference lookup: match the URI against each handler in turn, the same
+ * way as httpd_find_uri_handler() does without the trie */
+static const Handler *linear_find(const std::vector<Handler> &handlers, const char *uri, size_t len,
+                                  unsigned method, bool *uri_found)
+{
+    *uri_found = false;
+    for (const Handler &h : handlers) {
+        if (ut_match_template(h.uri.c_str(), &h.parsed, uri, len)) {
+            *uri_found = true;
+            if (h.method == method) {
+                return &h;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void add_handlers(uri_trie_t *trie, std::vector<Handler> &handlers, bool wildcard)
+{
+    for (Handler &h : handlers) {
+        ut_parse_template(h.uri.c_str(), wildcard, &h.parsed);
+        REQUIRE(ut_add(trie, h.uri.c_str(), h.method, &h));
+    }
+}
+
+static void check_lookup(const uri_trie_t *trie, const std::vector<Handler> &handlers,
+                         const std::string &uri, unsigned method)
+{
+    bool linear_found, trie_found;
+    const Handler *expected = linear_find(handlers, uri.c_str(), uri.size(), method, &linear_found);
+    const Handler *found = (const Handler *) ut_find(trie, uri.c_str(), uri.size(), method, &trie_found);
+    INFO("uri " << uri << " method " << method);
+    CHECK(found == expected);
+    CHECK(trie_found == linear_found);
+}
+
+TEST_CASE("plain templates match exactly", "[uri_trie]")
+{
+    std::vector<Handler> handlers = {
+        { "/", 1 }, { "/hello", 1 }, { "/hello", 3 }, { "/hello/world", 1 },
+        { "/hel", 3 }, { "/hello*", 1 }, { "/echo?", 1 },
+    };
+    uri_trie_t *trie = ut_create(false);
+    REQUIRE(trie != NULL);
+    add_handlers(trie, handlers, false);
+
+    bool found;
+    CHECK(ut_find(trie, "/hello", 6, 1, &found) == &handlers[1]);
+    CHECK(ut_find(trie, "/hello", 6, 3, &found) == &handlers[2]);
+    CHECK(ut_find(trie, "/hello", 6, 2, &found) == NULL);
+    CHECK(found);
+    CHECK(ut_find(trie, "/hellox", 7, 1, &found) == NULL);
+    CHECK(!found);
+    CHECK(ut_find(trie, "/hello*", 7, 1, &found) == &handlers[5]);
+    CHECK(ut_find(trie, "/echo", 5, 1, &found) == NULL);
+    CHECK(ut_find(trie, "/hello/world?a=b", 12, 1, &found) == &handlers[3]);
+    CHECK(ut_find(trie, "/he", 3, 3, &found) == NULL);
+    CHECK(!found);
+
+    for (const char *uri : { "", "/", "/h", "/hel", "/hello/", "/hello/world", "/echo?" }) {
+        for (unsigned method = 0; method < 4; method++) {
+            check_lookup(trie, handlers, uri, method);
+        }
+    }
+    ut_delete(trie);
+}
+
+TEST_CASE("wildcard templates match like httpd_uri_match_wildcard", "[uri_trie]")
+{
+    std::vector<Handler> handlers = {
+        { "/api/v1/*", 2 }, { "/api/v1/status", 1 }, { "/api/v1/status", 2 }, { "/api/*", 1 },
+        { "/file?", 1 }, { "/dir/?*", 1 }, { "/dir/*?", 3 }, { "?", 1 }, { "*", 4 },
+    };
+    uri_trie_t *trie = ut_create(true);
+    REQUIRE(trie != NULL);
+    add_handlers(trie, handlers, true);
+
+    bool found;
+    /* the first registered handler wins */
+    CHECK(ut_find(trie, "/api/v1/status", 14, 2, &found) == &handlers[0]);
+    CHECK(ut_find(trie, "/api/v1/status", 14, 1, &found) == &handlers[1]);
+    CHECK(ut_find(trie, "/api/v2", 7, 1, &found) == &handlers[3]);
+    CHECK(ut_find(trie, "/file", 5, 1, &found) == &handlers[4]);
+    CHECK(ut_find(trie, "/fil", 4, 1, &found) == &handlers[4]);
+    CHECK(ut_find(trie, "/files", 6, 1, &found) == NULL);
+    CHECK(ut_find(trie, "/dir", 4, 1, &found) == &handlers[5]);
+    CHECK(ut_find(trie, "/dir/x/y", 8, 3, &found) == &handlers[6]);
+    CHECK(ut_find(trie, "/dirx", 5, 1, &found) == NULL);
+    CHECK(ut_find(trie, "/anything", 9, 4, &found) == &handlers[8]);
+    CHECK(ut_find(trie, "/anything", 9, 1, &found) == NULL);
+    CHECK(found);
+
+    for (const char *uri : { "", "/", "/api", "/api/", "/api/v1", "/api/v1/", "/file", "/fil", "/dir/", "?" }) {
+        for (unsigned method = 0; method < 5; method++) {
+            check_lookup(trie, handlers, uri, method);
+        }
+    }
+    ut_delete(trie);
+}
+
+TEST_CASE("random templates give the same result as linear matching", "[uri_trie]")
+{
+    const char alphabet[] = "/ab?*";
+    const char *suffixes[] = { "", "", "*", "?", "?*", "*?" };
+    srand(0x5EED);
+
+    for (int wildcard = 0; wildcard < 2; wildcard++) {
+        for (int round = 0; round < 200; round++) {
+            std::vector<Handler> handlers(1 + rand() % 12);
+            for (Handler &h : handlers) {
+                for (int n = rand() % 5; n > 0; n--) {
+                    h.uri += alphabet[rand() % 3];
+                }
+                h.uri += suffixes[rand() % 6];
+                h.method = rand() % 3;
+            }
+            uri_trie_t *trie = ut_create(wildcard);
+            REQUIRE(trie != NULL);
+            add_handlers(trie, handlers, wildcard);
+
+            for (int i = 0; i < 50; i++) {
+                std::string uri;
+                for (int n = rand() % 7; n > 0; n--) {
+                    uri += alphabet[rand() % 5];
+                }
+                check_lookup(trie, handlers, uri, rand() % 3);
+            }
+            for (const Handler &h : handlers) {
+                check_lookup(trie, handlers, h.uri, h.method);
+            }
+            ut_delete(trie);
+        }
+    }
+}
+
+/* Compares lookup times for a REST API with 96 endpoints */
+TEST_CASE("benchmark trie lookup versus linear matching", "[uri_trie][benchmark]")
+{
+    typedef std::chrono::steady_clock clock;
+    const char *resources[] = { "users", "devices", "sensors", "groups", "schedules", "scenes",
+                                "firmware", "logs", "config", "events", "alarms", "zones" };
+    const int LOOKUPS = 200000;
+
+    std::vector<Handler> handlers;
+    for (const char *res : resources) {
+        std::string base = std::string("/api/v1/") + res;
+        handlers.push_back({ base, 1 });
+        handlers.push_back({ base, 3 });
+        handlers.push_back({ base + "/*", 1 });
+        handlers.push_back({ base + "/*", 4 });
+        handlers.push_back({ base + "/*", 0 });
+        handlers.push_back({ base + "/stats", 1 });
+        handlers.push_back({ base + "/export?", 1 });
+        handlers.push_back({ base + "/import", 3 });
+    }
+    uri_trie_t *trie = ut_create(true);
+    REQUIRE(trie != NULL);
+    add_handlers(trie, handlers, true);
+
+    std::vector<std::string> uris;
+    for (const char *res : resources) {
+        uris.push_back(std::string("/api/v1/") + res);
+        uris.push_back(std::string("/api/v1/") + res + "/42");
+        uris.push_back(std::string("/api/v1/") + res + "/stats");
+        uris.push_back(std::string("/api/v2/") + res);
+    }
+    for (const std::string &uri : uris) {
+        for (unsigned method = 0; method < 5; method++) {
+            check_lookup(trie, handlers, uri, method);
+        }
+    }
+
+    size_t hits = 0;
+    auto start = clock::now();
+    for (int i = 0; i < LOOKUPS; i++) {
+        const std::string &uri = uris[i % uris.size()];
+        bool found;
+        hits += linear_find(handlers, uri.c_str(), uri.size(), 1, &found) != NULL;
+    }
+    auto linear_time = clock::now() - start;
+
+    start = clock::now();
+    for (int i = 0; i < LOOKUPS; i++) {
+        const std::string &uri = uris[i % uris.size()];
+        bool found;
+        hits -= ut_find(trie, uri.c_str(), uri.size(), 1, &found) != NULL;
+    }
+    auto trie_time = clock::now() - start;
+    CHECK(hits == 0);
+
+    printf("%d lookups with %d handlers: linear %d ns per lookup, trie %d ns per lookup\n",
+           LOOKUPS, (int) handlers.size(),
+           (int) (std::chrono::duration_cast<std::chrono::nanoseconds>(linear_time).count() / LOOKUPS),
+           (int) (std::chrono::duration_cast<std::chrono::nanoseconds>(trie_time).count() / LOOKUPS));
+    ut_delete(trie);
+}
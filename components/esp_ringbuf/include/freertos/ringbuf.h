@@ -53,6 +53,16 @@ typedef enum {
      * time.
      */
     RINGBUF_TYPE_BYTEBUF,
+    /**
+     * Single producer, single consumer byte buffers behave like byte buffers,
+     * but sending and receiving never take the ring buffer's spinlock. Only
+     * one task (or ISR) may send to and only one task (or ISR) may receive
+     * from the buffer. Blocked senders and receivers are woken using task
+     * notifications, so a task must not use its notification value for other
+     * purposes while it is blocked on such a buffer. One byte of the storage
+     * area is never used, and these buffers cannot be added to a queue set.
+     */
+    RINGBUF_TYPE_BYTEBUF_SPSC,
     RINGBUF_TYPE_MAX,
 } RingbufferType_t;
 
@@ -73,7 +83,7 @@ typedef struct xSTATIC_RINGBUFFER {
     size_t xDummy1[2];
     UBaseType_t uxDummy2;
     BaseType_t xDummy3;
-    void *pvDummy4[11];
+    void *pvDummy4[14];
     StaticSemaphore_t xDummy5[2];
     portMUX_TYPE muxDummy;
     /** @endcond */
@@ -88,6 +98,7 @@ typedef struct xSTATIC_RINGBUFFER {
  * @param[in]   xBufferType Type of ring buffer, see documentation.
  *
  * @note    xBufferSize of no-split/allow-split buffers will be rounded up to the nearest 32-bit aligned size.
+ *          For RINGBUF_TYPE_BYTEBUF_SPSC buffers, one extra byte is allocated so that xBufferSize bytes can be stored.
  *
  * @return  A handle to the created ring buffer, or NULL in case of error.
  */
@@ -121,6 +132,7 @@ RingbufHandle_t xRingbufferCreateNoSplit(size_t xItemSize, size_t xItemNum);
  *          for this to be available
  *
  * @note    xBufferSize of no-split/allow-split buffers MUST be 32-bit aligned.
+ * @note    RINGBUF_TYPE_BYTEBUF_SPSC buffers can store at most xBufferSize - 1 bytes.
  *
  * @return  A handle to the created ring buffer
  */
@@ -198,10 +210,12 @@ BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer,
  * @param[in]   xItemSize       Size of item to acquire.
  * @param[in]   xTicksToWait    Ticks to wait for room in the ring buffer.
  *
- * @note Only applicable for no-split ring buffers now, the actual size of
- *       memory that the item will occupy will be rounded up to the nearest 32-bit
- *       aligned size. This is done to ensure all items are always stored in 32-bit
- *       aligned fashion.
+ * @note Only applicable for no-split ring buffers and RINGBUF_TYPE_BYTEBUF_SPSC
+ *       byte buffers now. For no-split buffers, the actual size of memory that the
+ *       item will occupy will be rounded up to the nearest 32-bit aligned size. This
+ *       is done to ensure all items are always stored in 32-bit aligned fashion.
+ *       For RINGBUF_TYPE_BYTEBUF_SPSC buffers, xItemSize must not be larger than
+ *       half of the buffer size, as the acquired memory is always contiguous.
  *
  * @return
  *      - pdTRUE if succeeded
@@ -367,6 +381,34 @@ void *xRingbufferReceiveUpTo(RingbufHandle_t xRingbuffer,
  */
 void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize, size_t xMaxSize);
 
+/**
+ * @brief   Retrieve multiple items from a no-split ring buffer
+ *
+ * Attempt to retrieve all items that are currently available in a no-split ring
+ * buffer, up to xMaxItems, in a single critical section. This function will
+ * block until at least one item is available or until it times out.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  ppvItems        Array of at least xMaxItems elements to which pointers to the retrieved items will be written
+ * @param[out]  pxItemSizes     Array of at least xMaxItems elements to which the sizes of the retrieved items will be written
+ * @param[in]   xMaxItems       Maximum number of items to retrieve
+ * @param[out]  pxItemsReceived Pointer to a variable to which the number of retrieved items will be written
+ * @param[in]   xTicksToWait    Ticks to wait for items in the ring buffer.
+ *
+ * @note    A call to vRingbufferReturnMany() or calls to vRingbufferReturnItem() are required after this to free the items retrieved.
+ * @note    This function should only be called on no-split buffers
+ *
+ * @return
+ *      - pdTRUE if at least one item was retrieved, the items are in the order they were sent
+ *      - pdFALSE when no item was retrieved before the timeout, *pxItemsReceived is set to 0
+ */
+BaseType_t xRingbufferReceiveMany(RingbufHandle_t xRingbuffer,
+                                  void **ppvItems,
+                                  size_t *pxItemSizes,
+                                  size_t xMaxItems,
+                                  size_t *pxItemsReceived,
+                                  TickType_t xTicksToWait);
+
 /**
  * @brief   Return a previously-retrieved item to the ring buffer
  *
@@ -389,6 +431,20 @@ void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem);
  */
 void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, BaseType_t *pxHigherPriorityTaskWoken);
 
+/**
+ * @brief   Return multiple previously-retrieved items to a no-split ring buffer
+ *
+ * All items are returned in a single critical section, and blocked senders are
+ * only woken once.
+ *
+ * @param[in]   xRingbuffer Ring buffer the items were retrieved from
+ * @param[in]   ppvItems    Array of items that were received earlier, e.g. by xRingbufferReceiveMany()
+ * @param[in]   xItemCount  Number of items in ppvItems
+ *
+ * @note    This function should only be called on no-split buffers
+ */
+void vRingbufferReturnMany(RingbufHandle_t xRingbuffer, void **ppvItems, size_t xItemCount);
+
 /**
  * @brief   Delete a ring buffer
  *
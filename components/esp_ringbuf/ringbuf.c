@@ -18,6 +18,7 @@
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "freertos/ringbuf.h"
+#include "soc/soc_memory_layout.h"
 
 //32-bit alignment macros
 #define rbALIGN_SIZE( xSize )       ( ( xSize + portBYTE_ALIGNMENT_MASK ) & ~portBYTE_ALIGNMENT_MASK )
@@ -28,6 +29,7 @@
 #define rbBYTE_BUFFER_FLAG          ( ( UBaseType_t ) 2 )   //The ring buffer is a byte buffer
 #define rbBUFFER_FULL_FLAG          ( ( UBaseType_t ) 4 )   //The ring buffer is currently full (write pointer == free pointer)
 #define rbBUFFER_STATIC_FLAG        ( ( UBaseType_t ) 8 )   //The ring buffer is statically allocated
+#define rbSPSC_FLAG                 ( ( UBaseType_t ) 16 )  //The ring buffer is a single producer single consumer byte buffer
 
 //Item flags
 #define rbITEM_FREE_FLAG            ( ( UBaseType_t ) 1 )   //Item has been retrieved and returned by application, free to overwrite
@@ -44,6 +46,10 @@
 #define rbGET_RX_SEM_HANDLE( pxRingbuffer ) ( pxRingbuffer->xRecvSemHandle )
 #endif
 
+//Access to the pointers of SPSC byte buffers which are shared between the producer and the consumer
+#define rbSPSC_PTR( xField )        ( *( uint8_t * volatile * ) &( xField ) )
+#define rbSPSC_TASK( xField )       ( *( TaskHandle_t volatile * ) &( xField ) )
+
 typedef struct {
     //This size of this structure must be 32-bit aligned
     size_t xItemLen;
@@ -76,6 +82,9 @@ typedef struct RingbufferDefinition {
     uint8_t *pucFree;                           //Free Pointer. Points to the last item that has yet to be returned to the ring buffer
     uint8_t *pucHead;                           //Pointer to the start of the ring buffer storage area
     uint8_t *pucTail;                           //Pointer to the end of the ring buffer storage area
+    uint8_t *pucWrapEnd;                        //SPSC byte buffers only. End of the data before the write pointer last wrapped around
+    TaskHandle_t xTxWaitTask;                   //SPSC byte buffers only. Task waiting for free space
+    TaskHandle_t xRxWaitTask;                   //SPSC byte buffers only. Task waiting for data
 
     BaseType_t xItemsWaiting;                   //Number of items/bytes(for byte buffers) currently in ring buffer that have not yet been read
     /*
@@ -166,6 +175,12 @@ static void *prvGetItemByteBuf(Ringbuffer_t *pxRingbuffer,
 //Return an item to a split/no-split ring buffer
 static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
 
+//Mark an item of a split/no-split ring buffer as free without moving the free pointer
+static void prvMarkItemFreeDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
+//Move the free pointer of a split/no-split ring buffer past all items that have been marked as free
+static void prvAdvanceFreeDefault(Ringbuffer_t *pxRingbuffer);
+
 //Return data to a byte buffer
 static void prvReturnItemByteBuf(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
 
@@ -178,6 +193,47 @@ static size_t prvGetCurMaxSizeAllowSplit(Ringbuffer_t *pxRingbuffer);
 //Get the maximum size an item that can currently have if sent to a byte buffer
 static size_t prvGetCurMaxSizeByteBuf(Ringbuffer_t *pxRingbuffer);
 
+/*
+ * SPSC byte buffers (RINGBUF_TYPE_BYTEBUF_SPSC) are written by a single producer
+ * and read by a single consumer, so the following functions do not take the
+ * spinlock. The producer only modifies pucWrite, pucAcquire and pucWrapEnd, the
+ * consumer only modifies pucRead and pucFree. One byte of the storage area is
+ * never used, so pucWrite == pucFree means the buffer is empty.
+ */
+
+//Get the free space of an SPSC byte buffer
+static size_t prvGetCurMaxSizeSpsc(Ringbuffer_t *pxRingbuffer);
+
+//Copy data into an SPSC byte buffer, or acquire contiguous space if ppvItem is not NULL. Returns pdFALSE if there is not enough space
+static BaseType_t prvSpscTrySend(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize, void **ppvItem);
+
+//Make data up to pucWrite available to the consumer
+static void prvSpscPublishWrite(Ringbuffer_t *pxRingbuffer, uint8_t *pucWrite);
+
+//Retrieve contiguous data from an SPSC byte buffer. If xMaxSize is 0, all continuous data is retrieved. Returns NULL if empty
+static void *prvSpscTryReceive(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize);
+
+//Free the data retrieved from an SPSC byte buffer
+static void prvSpscReturnItem(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
+//Atomically clear *pxWaitTask if it is xTask. Returns pdTRUE if it was cleared
+static BaseType_t prvSpscCompareClearTask(TaskHandle_t *pxWaitTask, TaskHandle_t xTask);
+
+//Register the calling task to be notified by the other side of an SPSC byte buffer
+static void prvSpscSetWaitTask(TaskHandle_t *pxWaitTask);
+
+//Unregister the calling task if the other side hasn't notified it yet
+static void prvSpscClearWaitTask(TaskHandle_t *pxWaitTask);
+
+//Notify the task waiting on the other side of an SPSC byte buffer, if any
+static void prvSpscNotifyWaitTask(TaskHandle_t *pxWaitTask, BaseType_t xFromISR, BaseType_t *pxHigherPriorityTaskWoken);
+
+//Blocking send or acquire for SPSC byte buffers
+static BaseType_t prvSpscSendGeneric(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize, void **ppvItem, TickType_t xTicksToWait);
+
+//Blocking receive for SPSC byte buffers
+static void *prvSpscReceiveGeneric(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize, TickType_t xTicksToWait);
+
 /**
  * Generic function used to retrieve an item/data from ring buffers. If called on
  * an allow-split buffer, and pvItem2 and xItemSize2 are not NULL, both parts of
@@ -215,6 +271,9 @@ static void prvInitializeNewRingbuffer(size_t xBufferSize,
     pxNewRingbuffer->pucRead = pucRingbufferStorage;
     pxNewRingbuffer->pucWrite = pucRingbufferStorage;
     pxNewRingbuffer->pucAcquire = pucRingbufferStorage;
+    pxNewRingbuffer->pucWrapEnd = pxNewRingbuffer->pucTail;
+    pxNewRingbuffer->xTxWaitTask = NULL;
+    pxNewRingbuffer->xRxWaitTask = NULL;
     pxNewRingbuffer->xItemsWaiting = 0;
     pxNewRingbuffer->uxRingbufferFlags = 0;
 
@@ -239,6 +298,16 @@ static void prvInitializeNewRingbuffer(size_t xBufferSize,
         //Worst case an item is split into two, incurring two headers of overhead
         pxNewRingbuffer->xMaxItemSize = pxNewRingbuffer->xSize - (sizeof(ItemHeader_t) * 2);
         pxNewRingbuffer->xGetCurMaxSize = prvGetCurMaxSizeAllowSplit;
+    } else if (xBufferType == RINGBUF_TYPE_BYTEBUF_SPSC) {
+        pxNewRingbuffer->uxRingbufferFlags |= rbBYTE_BUFFER_FLAG | rbSPSC_FLAG;
+        //Items are copied and retrieved by the prvSpsc functions without taking the spinlock
+        pxNewRingbuffer->xCheckItemFits = NULL;
+        pxNewRingbuffer->vCopyItem = NULL;
+        pxNewRingbuffer->pvGetItem = NULL;
+        pxNewRingbuffer->vReturnItem = NULL;
+        //One byte is always left unused to tell a full buffer from an empty one
+        pxNewRingbuffer->xMaxItemSize = pxNewRingbuffer->xSize - 1;
+        pxNewRingbuffer->xGetCurMaxSize = prvGetCurMaxSizeSpsc;
     } else { //Byte Buffer
         pxNewRingbuffer->uxRingbufferFlags |= rbBYTE_BUFFER_FLAG;
         pxNewRingbuffer->xCheckItemFits = prvCheckItemFitsByteBuffer;
@@ -256,7 +325,9 @@ static void prvInitializeNewRingbuffer(size_t xBufferSize,
 static size_t prvGetFreeSize(Ringbuffer_t *pxRingbuffer)
 {
     size_t xReturn;
-    if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        xReturn = prvGetCurMaxSizeSpsc(pxRingbuffer);
+    } else if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
         xReturn =  0;
     } else {
         BaseType_t xFreeSize = pxRingbuffer->pucFree - pxRingbuffer->pucAcquire;
@@ -589,6 +660,12 @@ static void *prvGetItemByteBuf(Ringbuffer_t *pxRingbuffer,
 }
 
 static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    prvMarkItemFreeDefault(pxRingbuffer, pucItem);
+    prvAdvanceFreeDefault(pxRingbuffer);
+}
+
+static void prvMarkItemFreeDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
 {
     //Check arguments and buffer state
     configASSERT(rbCHECK_ALIGNED(pucItem));
@@ -602,14 +679,17 @@ static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
     configASSERT((pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) == 0);       //Indicates item has already been returned before
     pxCurHeader->uxItemFlags &= ~rbITEM_SPLIT_FLAG;                         //Clear wrap flag if set (not strictly necessary)
     pxCurHeader->uxItemFlags |= rbITEM_FREE_FLAG;                           //Mark as free
+}
 
+static void prvAdvanceFreeDefault(Ringbuffer_t *pxRingbuffer)
+{
     /*
      * Items might not be returned in the order they were retrieved. Move the free pointer
      * up to the next item that has not been marked as free (by free flag) or up
      * till the read pointer. When advancing the free pointer, items that have already been
      * freed or items with dummy data should be skipped over
      */
-    pxCurHeader = (ItemHeader_t *)pxRingbuffer->pucFree;
+    ItemHeader_t *pxCurHeader = (ItemHeader_t *)pxRingbuffer->pucFree;
     //Skip over Items that have already been freed or are dummy items
     while (((pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) || (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG)) && pxRingbuffer->pucFree != pxRingbuffer->pucRead) {
         if (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
@@ -731,6 +811,202 @@ static size_t prvGetCurMaxSizeByteBuf(Ringbuffer_t *pxRingbuffer)
     return xFreeSize;
 }
 
+static size_t prvGetCurMaxSizeSpsc(Ringbuffer_t *pxRingbuffer)
+{
+    uint8_t *pucFree = rbSPSC_PTR(pxRingbuffer->pucFree);
+    uint8_t *pucWrite = rbSPSC_PTR(pxRingbuffer->pucWrite);
+    if (pucFree > pucWrite) {
+        return pucFree - pucWrite - 1;
+    }
+    return pxRingbuffer->xSize - (pucWrite - pucFree) - 1;
+}
+
+static BaseType_t prvSpscTrySend(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize, void **ppvItem)
+{
+    uint8_t *pucFree = rbSPSC_PTR(pxRingbuffer->pucFree);
+    __sync_synchronize();   //Consumer must be done with the freed space before it is overwritten
+    uint8_t *pucWrite = pxRingbuffer->pucWrite;
+    size_t xFreeSize = (pucFree > pucWrite) ? pucFree - pucWrite - 1 : pxRingbuffer->xSize - (pucWrite - pucFree) - 1;
+    size_t xRemLen = pxRingbuffer->pucTail - pucWrite;  //Length from pucWrite until end of buffer
+    if (xItemSize > xFreeSize) {
+        return pdFALSE;
+    }
+
+    if (ppvItem != NULL) {
+        //Acquired space must be contiguous
+        if (xItemSize <= xRemLen) {
+            *ppvItem = pucWrite;
+            pxRingbuffer->pucAcquire = pucWrite + xItemSize;
+        } else if (pucFree <= pucWrite && xItemSize < pucFree - pxRingbuffer->pucHead) {
+            //Skip the space at the end of the buffer, the consumer wraps around at pucWrapEnd
+            *ppvItem = pxRingbuffer->pucHead;
+            pxRingbuffer->pucWrapEnd = pucWrite;
+            pxRingbuffer->pucAcquire = pxRingbuffer->pucHead + xItemSize;
+        } else {
+            return pdFALSE;
+        }
+        if (pxRingbuffer->pucAcquire == pxRingbuffer->pucTail) {
+            pxRingbuffer->pucWrapEnd = pxRingbuffer->pucTail;
+            pxRingbuffer->pucAcquire = pxRingbuffer->pucHead;
+        }
+        return pdTRUE;
+    }
+
+    if (xItemSize < xRemLen) {
+        memcpy(pucWrite, pucItem, xItemSize);
+        pucWrite += xItemSize;
+    } else {
+        //Data wraps around
+        memcpy(pucWrite, pucItem, xRemLen);
+        memcpy(pxRingbuffer->pucHead, pucItem + xRemLen, xItemSize - xRemLen);
+        pucWrite = pxRingbuffer->pucHead + (xItemSize - xRemLen);
+        pxRingbuffer->pucWrapEnd = pxRingbuffer->pucTail;
+    }
+    prvSpscPublishWrite(pxRingbuffer, pucWrite);
+    return pdTRUE;
+}
+
+static void prvSpscPublishWrite(Ringbuffer_t *pxRingbuffer, uint8_t *pucWrite)
+{
+    __sync_synchronize();   //Data must be visible to the consumer before the write pointer
+    pxRingbuffer->pucAcquire = pucWrite;
+    rbSPSC_PTR(pxRingbuffer->pucWrite) = pucWrite;
+    __sync_synchronize();   //Write pointer must be visible before checking for a waiting consumer
+}
+
+static void *prvSpscTryReceive(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize)
+{
+    uint8_t *pucWrite = rbSPSC_PTR(pxRingbuffer->pucWrite);
+    __sync_synchronize();   //Data must not be read before the write pointer
+    uint8_t *pucRead = pxRingbuffer->pucRead;
+    uint8_t *pucEnd = pucWrite;
+    if (pucWrite < pucRead) {
+        //Producer has wrapped around, data ends where it wrapped around
+        pucEnd = pxRingbuffer->pucWrapEnd;
+        if (pucRead == pucEnd) {
+            pucRead = pxRingbuffer->pucHead;
+            pucEnd = pucWrite;
+        }
+    }
+    if (pucRead == pucEnd) {
+        return NULL;
+    }
+
+    size_t xSize = pucEnd - pucRead;
+    if (xMaxSize != 0 && xSize > xMaxSize) {
+        xSize = xMaxSize;
+    }
+    *pxItemSize = xSize;
+    pxRingbuffer->pucRead = pucRead + xSize;
+    return pucRead;
+}
+
+static void prvSpscReturnItem(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    //Check pointer points to address inside buffer
+    configASSERT(pucItem >= pxRingbuffer->pucHead);
+    configASSERT(pucItem < pxRingbuffer->pucTail);
+    __sync_synchronize();   //Data must be read before the space is given back to the producer
+    rbSPSC_PTR(pxRingbuffer->pucFree) = pxRingbuffer->pucRead;
+    __sync_synchronize();   //Free pointer must be visible before checking for a waiting producer
+}
+
+static BaseType_t prvSpscCompareClearTask(TaskHandle_t *pxWaitTask, TaskHandle_t xTask)
+{
+    uint32_t uxSet = 0;
+#if defined(CONFIG_ESP32_SPIRAM_SUPPORT)
+    if (esp_ptr_external_ram(pxWaitTask)) {
+        uxPortCompareSetExtram((volatile uint32_t *)pxWaitTask, (uint32_t)xTask, &uxSet);
+    } else {
+#endif
+        uxPortCompareSet((volatile uint32_t *)pxWaitTask, (uint32_t)xTask, &uxSet);
+#if defined(CONFIG_ESP32_SPIRAM_SUPPORT)
+    }
+#endif
+    return (uxSet == (uint32_t)xTask) ? pdTRUE : pdFALSE;
+}
+
+static void prvSpscSetWaitTask(TaskHandle_t *pxWaitTask)
+{
+    rbSPSC_TASK(*pxWaitTask) = xTaskGetCurrentTaskHandle();
+    __sync_synchronize();   //Other side must see the task before the buffer is checked again
+}
+
+static void prvSpscClearWaitTask(TaskHandle_t *pxWaitTask)
+{
+    //If the other side cleared the task first, its notification wakes up a later wait early, which is harmless
+    prvSpscCompareClearTask(pxWaitTask, xTaskGetCurrentTaskHandle());
+}
+
+static void prvSpscNotifyWaitTask(TaskHandle_t *pxWaitTask, BaseType_t xFromISR, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    TaskHandle_t xTask = rbSPSC_TASK(*pxWaitTask);
+    if (xTask == NULL) {
+        return;
+    }
+    //Only notify the task if it hasn't stopped waiting in the meantime
+    if (prvSpscCompareClearTask(pxWaitTask, xTask) != pdTRUE) {
+        return;
+    }
+    if (xFromISR == pdTRUE) {
+        vTaskNotifyGiveFromISR(xTask, pxHigherPriorityTaskWoken);
+    } else {
+        xTaskNotifyGive(xTask);
+    }
+}
+
+static BaseType_t prvSpscSendGeneric(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize, void **ppvItem, TickType_t xTicksToWait)
+{
+    BaseType_t xReturn = pdTRUE;
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while (prvSpscTrySend(pxRingbuffer, pucItem, xItemSize, ppvItem) != pdTRUE) {
+        if (xTicksRemaining == 0 || xTicksRemaining > xTicksToWait) {   //xTicksRemaining will underflow once xTaskGetTickCount() > ticks_end
+            xReturn = pdFALSE;
+            break;
+        }
+        //Buffer is full, wait for the consumer to free some space
+        prvSpscSetWaitTask(&pxRingbuffer->xTxWaitTask);
+        if (prvSpscTrySend(pxRingbuffer, pucItem, xItemSize, ppvItem) == pdTRUE) {
+            prvSpscClearWaitTask(&pxRingbuffer->xTxWaitTask);
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, xTicksRemaining);
+        prvSpscClearWaitTask(&pxRingbuffer->xTxWaitTask);
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+    }
+    if (xReturn == pdTRUE && ppvItem == NULL) {
+        prvSpscNotifyWaitTask(&pxRingbuffer->xRxWaitTask, pdFALSE, NULL);
+    }
+    return xReturn;
+}
+
+static void *prvSpscReceiveGeneric(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize, TickType_t xTicksToWait)
+{
+    void *pvItem;
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while ((pvItem = prvSpscTryReceive(pxRingbuffer, xMaxSize, pxItemSize)) == NULL) {
+        if (xTicksRemaining == 0 || xTicksRemaining > xTicksToWait) {   //xTicksRemaining will underflow once xTaskGetTickCount() > ticks_end
+            break;
+        }
+        //Buffer is empty, wait for the producer to send some data
+        prvSpscSetWaitTask(&pxRingbuffer->xRxWaitTask);
+        if ((pvItem = prvSpscTryReceive(pxRingbuffer, xMaxSize, pxItemSize)) != NULL) {
+            prvSpscClearWaitTask(&pxRingbuffer->xRxWaitTask);
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, xTicksRemaining);
+        prvSpscClearWaitTask(&pxRingbuffer->xRxWaitTask);
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+    }
+    return pvItem;
+}
+
 static BaseType_t prvReceiveGeneric(Ringbuffer_t *pxRingbuffer,
                                     void **pvItem1,
                                     void **pvItem2,
@@ -739,6 +1015,11 @@ static BaseType_t prvReceiveGeneric(Ringbuffer_t *pxRingbuffer,
                                     size_t xMaxSize,
                                     TickType_t xTicksToWait)
 {
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        *pvItem1 = prvSpscReceiveGeneric(pxRingbuffer, xMaxSize, xItemSize1, xTicksToWait);
+        return (*pvItem1 != NULL) ? pdTRUE : pdFALSE;
+    }
+
     BaseType_t xReturn = pdFALSE;
     BaseType_t xReturnSemaphore = pdFALSE;
     TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
@@ -803,6 +1084,11 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
                                            size_t *xItemSize2,
                                            size_t xMaxSize)
 {
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        *pvItem1 = prvSpscTryReceive(pxRingbuffer, xMaxSize, xItemSize1);
+        return (*pvItem1 != NULL) ? pdTRUE : pdFALSE;
+    }
+
     BaseType_t xReturn = pdFALSE;
     BaseType_t xReturnSemaphore = pdFALSE;
 
@@ -847,7 +1133,9 @@ RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferTy
     configASSERT(xBufferType < RINGBUF_TYPE_MAX);
 
     //Allocate memory
-    if (xBufferType != RINGBUF_TYPE_BYTEBUF) {
+    if (xBufferType == RINGBUF_TYPE_BYTEBUF_SPSC) {
+        xBufferSize += 1;                           //SPSC byte buffers never use one byte of the storage area
+    } else if (xBufferType != RINGBUF_TYPE_BYTEBUF) {
         xBufferSize = rbALIGN_SIZE(xBufferSize);    //xBufferSize is rounded up for no-split/allow-split buffers
     }
     Ringbuffer_t *pxNewRingbuffer = calloc(1, sizeof(Ringbuffer_t));
@@ -900,7 +1188,7 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
     configASSERT(xBufferSize > 0);
     configASSERT(xBufferType < RINGBUF_TYPE_MAX);
     configASSERT(pucRingbufferStorage != NULL && pxStaticRingbuffer != NULL);
-    if (xBufferType != RINGBUF_TYPE_BYTEBUF) {
+    if (xBufferType != RINGBUF_TYPE_BYTEBUF && xBufferType != RINGBUF_TYPE_BYTEBUF_SPSC) {
         //No-split/allow-split buffer sizes must be 32-bit aligned
         configASSERT(rbCHECK_ALIGNED(xBufferSize));
     }
@@ -920,8 +1208,8 @@ BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, s
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
     configASSERT(ppvItem != NULL || xItemSize == 0);
-    //currently only supported in NoSplit buffers
-    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
+    //currently only supported in NoSplit buffers and SPSC byte buffers
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) || (pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
 
     *ppvItem = NULL;
     if (xItemSize > pxRingbuffer->xMaxItemSize) {
@@ -930,6 +1218,12 @@ BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, s
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && xItemSize == 0) {
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        if (xItemSize > pxRingbuffer->xMaxItemSize / 2) {
+            return pdFALSE;     //Acquired space must be contiguous, which is only guaranteed for up to half of the buffer
+        }
+        return prvSpscSendGeneric(pxRingbuffer, NULL, xItemSize, ppvItem, xTicksToWait);
+    }
 
     //Attempt to send an item
     BaseType_t xReturn = pdFALSE;
@@ -979,6 +1273,12 @@ BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem)
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        configASSERT((uint8_t *)pvItem >= pxRingbuffer->pucHead && (uint8_t *)pvItem < pxRingbuffer->pucTail);
+        prvSpscPublishWrite(pxRingbuffer, pxRingbuffer->pucAcquire);
+        prvSpscNotifyWaitTask(&pxRingbuffer->xRxWaitTask, pdFALSE, NULL);
+        return pdTRUE;
+    }
     configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
 
     portENTER_CRITICAL(&pxRingbuffer->mux);
@@ -1004,6 +1304,9 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer,
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && xItemSize == 0) {
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscSendGeneric(pxRingbuffer, pvItem, xItemSize, NULL, xTicksToWait);
+    }
 
     //Attempt to send an item
     BaseType_t xReturn = pdFALSE;
@@ -1065,6 +1368,13 @@ BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer,
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && xItemSize == 0) {
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        if (prvSpscTrySend(pxRingbuffer, pvItem, xItemSize, NULL) != pdTRUE) {
+            return pdFALSE;
+        }
+        prvSpscNotifyWaitTask(&pxRingbuffer->xRxWaitTask, pdTRUE, pxHigherPriorityTaskWoken);
+        return pdTRUE;
+    }
 
     //Attempt to send an item
     BaseType_t xReturn;
@@ -1257,12 +1567,77 @@ void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemS
     }
 }
 
+BaseType_t xRingbufferReceiveMany(RingbufHandle_t xRingbuffer,
+                                  void **ppvItems,
+                                  size_t *pxItemSizes,
+                                  size_t xMaxItems,
+                                  size_t *pxItemsReceived,
+                                  TickType_t xTicksToWait)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);  //This function should only be called for no-split buffers
+    configASSERT(ppvItems != NULL && pxItemSizes != NULL && pxItemsReceived != NULL);
+    *pxItemsReceived = 0;
+    if (xMaxItems == 0) {
+        return pdFALSE;
+    }
+
+    //Attempt to retrieve up to xMaxItems items
+    BaseType_t xReturn = pdFALSE;
+    BaseType_t xReturnSemaphore = pdFALSE;
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while (xTicksRemaining <= xTicksToWait) {   //xTicksToWait will underflow once xTaskGetTickCount() > ticks_end
+        //Block until more items become available or timeout
+        if (xSemaphoreTake(rbGET_RX_SEM_HANDLE(pxRingbuffer), xTicksRemaining) != pdTRUE) {
+            xReturn = pdFALSE;     //Timed out attempting to get semaphore
+            break;
+        }
+
+        //Semaphore obtained, retrieve all available items in one critical section
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        size_t xCount = 0;
+        while (xCount < xMaxItems && prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+            BaseType_t xIsSplit;
+            ppvItems[xCount] = pxRingbuffer->pvGetItem(pxRingbuffer, &xIsSplit, 0, &pxItemSizes[xCount]);
+            xCount++;
+        }
+        if (xCount > 0) {
+            *pxItemsReceived = xCount;
+            xReturn = pdTRUE;
+            if (pxRingbuffer->xItemsWaiting > 0) {
+                xReturnSemaphore = pdTRUE;
+            }
+            portEXIT_CRITICAL(&pxRingbuffer->mux);
+            break;
+        }
+        //No item available for retrieval, adjust ticks and take the semaphore again
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGive(rbGET_RX_SEM_HANDLE(pxRingbuffer));  //Give semaphore back so other tasks can retrieve
+    }
+    return xReturn;
+}
+
 void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscReturnItem(pxRingbuffer, (uint8_t *)pvItem);
+        prvSpscNotifyWaitTask(&pxRingbuffer->xTxWaitTask, pdFALSE, NULL);
+        return;
+    }
+
     portENTER_CRITICAL(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     portEXIT_CRITICAL(&pxRingbuffer->mux);
@@ -1275,12 +1650,39 @@ void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, Bas
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscReturnItem(pxRingbuffer, (uint8_t *)pvItem);
+        prvSpscNotifyWaitTask(&pxRingbuffer->xTxWaitTask, pdTRUE, pxHigherPriorityTaskWoken);
+        return;
+    }
+
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
     xSemaphoreGiveFromISR(rbGET_TX_SEM_HANDLE(pxRingbuffer), pxHigherPriorityTaskWoken);
 }
 
+void vRingbufferReturnMany(RingbufHandle_t xRingbuffer, void **ppvItems, size_t xItemCount)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);  //This function should only be called for no-split buffers
+    configASSERT(ppvItems != NULL || xItemCount == 0);
+    if (xItemCount == 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    for (size_t i = 0; i < xItemCount; i++) {
+        configASSERT(ppvItems[i] != NULL);
+        prvMarkItemFreeDefault(pxRingbuffer, (uint8_t *)ppvItems[i]);
+    }
+    //Free pointer only needs to be moved once all items have been marked as free
+    prvAdvanceFreeDefault(pxRingbuffer);
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+    xSemaphoreGive(rbGET_TX_SEM_HANDLE(pxRingbuffer));
+}
+
 void vRingbufferDelete(RingbufHandle_t xRingbuffer)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
@@ -1322,6 +1724,7 @@ BaseType_t xRingbufferAddToQueueSetRead(RingbufHandle_t xRingbuffer, QueueSetHan
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) == 0);    //SPSC byte buffers don't use the semaphores
 
     BaseType_t xReturn;
     portENTER_CRITICAL(&pxRingbuffer->mux);
@@ -1386,7 +1789,11 @@ void vRingbufferGetInfo(RingbufHandle_t xRingbuffer,
         *uxAcquire = (UBaseType_t)(pxRingbuffer->pucAcquire - pxRingbuffer->pucHead);
     }
     if (uxItemsWaiting != NULL) {
-        *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+            *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xMaxItemSize - prvGetCurMaxSizeSpsc(pxRingbuffer));
+        } else {
+            *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        }
     }
     portEXIT_CRITICAL(&pxRingbuffer->mux);
 }
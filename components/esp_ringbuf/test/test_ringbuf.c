@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -8,6 +9,7 @@
 #include "driver/timer.h"
 #include "esp_heap_caps.h"
 #include "esp_spi_flash.h"
+#include "esp_timer.h"
 #include "unity.h"
 #include "test_utils.h"
 
@@ -197,6 +199,68 @@ TEST_CASE("Test ring buffer No-Split", "[esp_ringbuf]")
     vRingbufferDelete(buffer_handle);
 }
 
+static void receive_many_check_and_return(RingbufHandle_t handle, const uint8_t *const *expected_data, const size_t *expected_sizes, size_t expected_count, size_t max_items)
+{
+    void *items[max_items];
+    size_t item_sizes[max_items];
+    size_t items_received;
+    TEST_ASSERT_MESSAGE(xRingbufferReceiveMany(handle, items, item_sizes, max_items, &items_received, TIMEOUT_TICKS) == pdTRUE, "Failed to receive items");
+    TEST_ASSERT_EQUAL_MESSAGE(expected_count, items_received, "Incorrect number of items");
+    for (int i = 0; i < items_received; i++) {
+        TEST_ASSERT_MESSAGE(item_sizes[i] == expected_sizes[i], "Item size is incorrect");
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_data[i], items[i], item_sizes[i]);
+    }
+    vRingbufferReturnMany(handle, items, items_received);
+}
+
+TEST_CASE("Test ring buffer No-Split receive many", "[esp_ringbuf]")
+{
+    //Create buffer
+    RingbufHandle_t buffer_handle = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_MESSAGE(buffer_handle != NULL, "Failed to create ring buffer");
+    //Calculate number of items to send. Aim to almost fill buffer to setup for wrap around
+    int no_of_items = (BUFFER_SIZE - (ITEM_HDR_SIZE + SMALL_ITEM_SIZE)) / (ITEM_HDR_SIZE + SMALL_ITEM_SIZE);
+    const uint8_t *data[no_of_items];
+    size_t sizes[no_of_items];
+    for (int i = 0; i < no_of_items; i++) {
+        data[i] = small_item;
+        sizes[i] = SMALL_ITEM_SIZE;
+    }
+
+    //Test sending items
+    for (int i = 0; i < no_of_items; i++) {
+        send_item_and_check(buffer_handle, small_item, SMALL_ITEM_SIZE, TIMEOUT_TICKS, false);
+    }
+    //Receive items in two batches, the second batch is limited by the number of available items
+    receive_many_check_and_return(buffer_handle, data, sizes, no_of_items / 2, no_of_items / 2);
+    receive_many_check_and_return(buffer_handle, data, sizes, no_of_items - no_of_items / 2, no_of_items);
+
+    //All items have been returned, the free pointer must have caught up with the read pointer
+    uint32_t free_pos, read_pos, write_pos;
+    vRingbufferGetInfo(buffer_handle, &free_pos, &read_pos, &write_pos, NULL, NULL);
+    TEST_ASSERT_EQUAL(read_pos, free_pos);
+    TEST_ASSERT_EQUAL(write_pos, read_pos);
+
+    //Send items so that the second one wraps around, and receive both in one batch
+    const uint8_t *wrap_data[] = {small_item, large_item};
+    const size_t wrap_sizes[] = {SMALL_ITEM_SIZE, LARGE_ITEM_SIZE};
+    send_item_and_check(buffer_handle, small_item, SMALL_ITEM_SIZE, TIMEOUT_TICKS, false);
+    send_item_and_check(buffer_handle, large_item, LARGE_ITEM_SIZE, TIMEOUT_TICKS, false);
+    receive_many_check_and_return(buffer_handle, wrap_data, wrap_sizes, 2, no_of_items);
+    vRingbufferGetInfo(buffer_handle, &free_pos, &read_pos, NULL, NULL, NULL);
+    TEST_ASSERT_EQUAL(read_pos, free_pos);
+    TEST_ASSERT_MESSAGE(read_pos < write_pos, "Failed to wrap around");
+
+    //Empty buffer
+    void *item;
+    size_t item_size, items_received;
+    TEST_ASSERT(xRingbufferReceiveMany(buffer_handle, &item, &item_size, 1, &items_received, 0) == pdFALSE);
+    TEST_ASSERT_EQUAL(0, items_received);
+
+    //Cleanup
+    vRingbufferDelete(buffer_handle);
+}
+
 TEST_CASE("Test ring buffer Allow-Split", "[esp_ringbuf]")
 {
     //Create buffer
@@ -259,6 +323,115 @@ TEST_CASE("Test ring buffer Byte Buffer", "[esp_ringbuf]")
     vRingbufferDelete(buffer_handle);
 }
 
+TEST_CASE("Test ring buffer SPSC Byte Buffer", "[esp_ringbuf]")
+{
+    //Create buffer
+    RingbufHandle_t buffer_handle = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_BYTEBUF_SPSC);
+    TEST_ASSERT_MESSAGE(buffer_handle != NULL, "Failed to create ring buffer");
+    TEST_ASSERT_MESSAGE(xRingbufferGetMaxItemSize(buffer_handle) == BUFFER_SIZE, "Incorrect max item size");
+    //Calculate number of items to send. Aim to almost fill buffer to setup for wrap around
+    int no_of_items = (BUFFER_SIZE - SMALL_ITEM_SIZE) / SMALL_ITEM_SIZE;
+
+    //Test sending items
+    for (int i = 0; i < no_of_items; i++) {
+        send_item_and_check(buffer_handle, small_item, SMALL_ITEM_SIZE, TIMEOUT_TICKS, false);
+    }
+    //Test receiving items
+    for (int i = 0; i < no_of_items; i++) {
+        receive_check_and_return_item_byte_buffer(buffer_handle, small_item, SMALL_ITEM_SIZE, TIMEOUT_TICKS, false);
+    }
+
+    //Write pointer should be near the end, acquired memory must not wrap around
+    uint32_t write_pos_before, write_pos_after;
+    vRingbufferGetInfo(buffer_handle, NULL, NULL, &write_pos_before, NULL, NULL);
+    uint8_t *acquired;
+    TEST_ASSERT_MESSAGE(xRingbufferSendAcquire(buffer_handle, (void **)&acquired, LARGE_ITEM_SIZE, TIMEOUT_TICKS) == pdTRUE, "Failed to acquire memory");
+    memcpy(acquired, large_item, LARGE_ITEM_SIZE);
+    TEST_ASSERT_MESSAGE(xRingbufferSendComplete(buffer_handle, acquired) == pdTRUE, "Failed to send acquired memory");
+    //Acquired memory is contiguous, so it must be received as a single item
+    size_t item_size;
+    uint8_t *item = (uint8_t *)xRingbufferReceive(buffer_handle, &item_size, TIMEOUT_TICKS);
+    TEST_ASSERT_MESSAGE(item == acquired, "Failed to receive acquired memory");
+    TEST_ASSERT_MESSAGE(item_size == LARGE_ITEM_SIZE, "Item size is incorrect");
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(large_item, item, LARGE_ITEM_SIZE);
+    vRingbufferReturnItem(buffer_handle, item);
+    vRingbufferGetInfo(buffer_handle, NULL, NULL, &write_pos_after, NULL, NULL);
+    TEST_ASSERT_MESSAGE(write_pos_after < write_pos_before, "Failed to wrap around");
+
+    //Buffer can be filled completely, but no more than that
+    for (int i = 0; i < BUFFER_SIZE / SMALL_ITEM_SIZE; i++) {
+        send_item_and_check(buffer_handle, small_item, SMALL_ITEM_SIZE, TIMEOUT_TICKS, false);
+    }
+    TEST_ASSERT_EQUAL(0, xRingbufferGetCurFreeSize(buffer_handle));
+    TEST_ASSERT_MESSAGE(xRingbufferSend(buffer_handle, small_item, 1, 0) == pdFALSE, "Sent item to a full buffer");
+    //Acquiring more than half of the buffer is not supported
+    TEST_ASSERT_MESSAGE(xRingbufferSendAcquire(buffer_handle, (void **)&acquired, BUFFER_SIZE / 2 + 1, 0) == pdFALSE, "Acquired more than half of the buffer");
+
+    //Cleanup
+    vRingbufferDelete(buffer_handle);
+}
+
+/* ------------------------ Ring buffer throughput test ------------------------
+ * The following test case streams data from a task on one core to a task on
+ * the other core, through a regular byte buffer and then through an SPSC byte
+ * buffer, and prints the throughput of both.
+ */
+
+#define THROUGHPUT_BUFF_LEN             1024
+#define THROUGHPUT_CHUNK_LEN            64
+#define THROUGHPUT_DATA_LEN             (1024 * 1024)
+
+static void throughput_send_task(void *args)
+{
+    RingbufHandle_t buffer = (RingbufHandle_t)args;
+    uint8_t chunk[THROUGHPUT_CHUNK_LEN];
+    for (int i = 0; i < THROUGHPUT_CHUNK_LEN; i++) {
+        chunk[i] = i;
+    }
+    for (int sent = 0; sent < THROUGHPUT_DATA_LEN; sent += THROUGHPUT_CHUNK_LEN) {
+        TEST_ASSERT(xRingbufferSend(buffer, chunk, THROUGHPUT_CHUNK_LEN, portMAX_DELAY) == pdTRUE);
+    }
+    vTaskDelete(NULL);
+}
+
+static void throughput_rec_task(void *args)
+{
+    RingbufHandle_t buffer = (RingbufHandle_t)args;
+    size_t received = 0;
+    while (received < THROUGHPUT_DATA_LEN) {
+        size_t item_size;
+        uint8_t *item = (uint8_t *)xRingbufferReceiveUpTo(buffer, &item_size, portMAX_DELAY, THROUGHPUT_CHUNK_LEN);
+        TEST_ASSERT(item != NULL);
+        TEST_ASSERT(item[0] == (uint8_t)(received % THROUGHPUT_CHUNK_LEN));
+        received += item_size;
+        vRingbufferReturnItem(buffer, item);
+    }
+    xSemaphoreGive(done_sem);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("Test ring buffer SPSC throughput", "[esp_ringbuf][timeout=60]")
+{
+    const RingbufferType_t types[] = {RINGBUF_TYPE_BYTEBUF, RINGBUF_TYPE_BYTEBUF_SPSC};
+    done_sem = xSemaphoreCreateBinary();
+    for (int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        RingbufHandle_t buffer = xRingbufferCreate(THROUGHPUT_BUFF_LEN, types[i]);
+        TEST_ASSERT_MESSAGE(buffer != NULL, "Failed to create ring buffer");
+
+        int64_t start = esp_timer_get_time();
+        xTaskCreatePinnedToCore(throughput_rec_task, "rec tsk", 2048, buffer, UNITY_FREERTOS_PRIORITY + 1, NULL, 0);
+        xTaskCreatePinnedToCore(throughput_send_task, "send tsk", 2048, buffer, UNITY_FREERTOS_PRIORITY + 1, NULL, portNUM_PROCESSORS - 1);
+        xSemaphoreTake(done_sem, portMAX_DELAY);
+        int64_t elapsed = esp_timer_get_time() - start;
+        printf("Type: %d, %d bytes in %d us, %d KB/s\n", types[i], THROUGHPUT_DATA_LEN, (int)elapsed,
+               (int)((int64_t)THROUGHPUT_DATA_LEN * 1000000 / 1024 / elapsed));
+
+        vTaskDelay(5);  //Allow idle to clean up
+        vRingbufferDelete(buffer);
+    }
+    vSemaphoreDelete(done_sem);
+}
+
 /* ----------------------- Ring buffer queue sets test ------------------------
  * The following test case will test receiving from ring buffers that have been
  * added to a queue set. The test case will do the following...
@@ -516,7 +689,7 @@ static void read_from_buffer(RingbufHandle_t buffer, RingbufferType_t buf_type,
 
             //Check received item and return it
             TEST_ASSERT_MESSAGE(item_data != NULL, "Failed to receive an item");
-            if (buf_type == RINGBUF_TYPE_BYTEBUF) {
+            if (buf_type == RINGBUF_TYPE_BYTEBUF || buf_type == RINGBUF_TYPE_BYTEBUF_SPSC) {
                 TEST_ASSERT_MESSAGE(item_size <= max_rec_size, "Received data exceeds max size");
             }
             for (int i = 0; i < item_size; i++) {
@@ -6,9 +6,11 @@
 
 #include "ff.h"
 #include <stdlib.h>
+#include <pthread.h>
 
 /* This is the implementation for host-side testing on Linux.
- * Host-side tests are single threaded, so lock functionality isn't needed.
+ * The sync object is a pthread mutex, so that the tests can access
+ * a volume from several threads.
  */
 
 void* ff_memalloc(UINT msize)
@@ -24,23 +26,31 @@ void ff_memfree(void* mblock)
 /* 1:Function succeeded, 0:Could not create the sync object */
 int ff_cre_syncobj(BYTE vol, FF_SYNC_t* sobj)
 {
-    *sobj = NULL;
+    pthread_mutex_t* mutex = (pthread_mutex_t*) malloc(sizeof(pthread_mutex_t));
+    if (mutex == NULL || pthread_mutex_init(mutex, NULL) != 0) {
+        free(mutex);
+        *sobj = NULL;
+        return 0;
+    }
+    *sobj = mutex;
     return 1;
 }
 
 /* 1:Function succeeded, 0:Could not delete due to an error */
 int ff_del_syncobj(FF_SYNC_t sobj)
 {
+    pthread_mutex_destroy((pthread_mutex_t*) sobj);
+    free(sobj);
     return 1;
 }
 
 /* 1:Function succeeded, 0:Could not acquire lock */
 int ff_req_grant (FF_SYNC_t sobj)
 {
-    return 1;
+    return pthread_mutex_lock((pthread_mutex_t*) sobj) == 0 ? 1 : 0;
 }
 
 void ff_rel_grant (FF_SYNC_t sobj)
 {
+    pthread_mutex_unlock((pthread_mutex_t*) sobj);
 }
-
@@ -1636,6 +1636,65 @@ static DWORD clmt_clust (	/* <2:Error, >=2:Cluster number */
 
 
 
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Convert offset into cluster for positional access      */
+/*-----------------------------------------------------------------------*/
+
+static DWORD pos_clust (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk error, >=2:Cluster number */
+	FIL* fp,		/* Pointer to the file object */
+	FSIZE_t ofs,	/* File offset to be converted to cluster# */
+	int stretch		/* 0:Follow the chain, 1:Stretch the chain if needed */
+)
+{
+	DWORD clst;
+	FSIZE_t bcs, cofs, fofs;
+	FATFS *fs = fp->obj.fs;
+
+
+#if FF_USE_FASTSEEK
+	if (fp->cltbl) return clmt_clust(fp, ofs);	/* Get cluster# from the CLMT */
+#endif
+	bcs = (DWORD)fs->csize * SS(fs);	/* Cluster size in byte */
+	cofs = 0; clst = fp->obj.sclust;	/* Follow the chain from the origin, */
+	if (fp->pclust != 0 && fp->pptr <= ofs) {	/* from the cluster of the last positional access, */
+		cofs = fp->pptr; clst = fp->pclust;
+	}
+	if (fp->fptr > 0) {					/* or from the current cluster of the file, whichever is the closest */
+		fofs = (fp->fptr - 1) / bcs * bcs;
+		if (fofs > cofs && fofs <= ofs) {
+			cofs = fofs; clst = fp->clust;
+		}
+	}
+	if (clst == 0) {					/* If no cluster is allocated, */
+#if !FF_FS_READONLY
+		if (!stretch) return 1;
+		clst = create_chain(&fp->obj, 0);	/* create a new cluster chain */
+		if (clst < 2 || clst == 0xFFFFFFFF) return clst;
+		fp->obj.sclust = clst;
+#else
+		return 1;
+#endif
+	}
+	while (ofs - cofs >= bcs) {			/* Follow the chain up to the cluster containing ofs */
+#if !FF_FS_READONLY
+		if (stretch) {
+			clst = create_chain(&fp->obj, clst);	/* Follow or stretch cluster chain on the FAT */
+		} else
+#endif
+		{
+			clst = get_fat(&fp->obj, clst);	/* Follow cluster chain on the FAT */
+			if (clst == 0) return 1;		/* Free cluster in the chain */
+		}
+		if (clst < 2 || clst == 0xFFFFFFFF) return clst;
+		cofs += bcs;
+	}
+	fp->pptr = cofs; fp->pclust = clst;	/* Start the next positional access from here */
+	return clst;
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Directory handling - Fill a cluster with zeros                        */
 /*-----------------------------------------------------------------------*/
@@ -3691,6 +3750,7 @@ FRESULT f_open (
 			fp->err = 0;			/* Clear error flag */
 			fp->sect = 0;			/* Invalidate current data sector */
 			fp->fptr = 0;			/* Set file pointer top of the file */
+			fp->pclust = 0;			/* Invalidate cluster of positional access */
 #if !FF_FS_READONLY
 #if !FF_FS_TINY
 			mem_set(fp->buf, 0, sizeof fp->buf);	/* Clear sector buffer */
@@ -3829,6 +3889,87 @@ FRESULT f_read (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Read File at an Offset                                                */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_pread (
+	FIL* fp, 	/* Pointer to the file object */
+	void* buff,	/* Pointer to data buffer */
+	UINT btr,	/* Number of bytes to read */
+	FSIZE_t ofs,	/* File offset to read from */
+	UINT* br	/* Pointer to number of bytes read */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	DWORD clst = 0, sect;
+	FSIZE_t remain;
+	UINT rcnt, cc, csect;
+	BYTE *rbuff = (BYTE*)buff;
+
+
+	*br = 0;	/* Clear read byte counter */
+	res = validate(&fp->obj, &fs);				/* Check validity of the file object */
+	if (res != FR_OK || (res = (FRESULT)fp->err) != FR_OK) LEAVE_FF(fs, res);	/* Check validity */
+	if (!(fp->flag & FA_READ)) LEAVE_FF(fs, FR_DENIED); /* Check access mode */
+	if (ofs >= fp->obj.objsize) LEAVE_FF(fs, FR_OK);	/* Nothing to read at or beyond the end of the file */
+	remain = fp->obj.objsize - ofs;
+	if (btr > remain) btr = (UINT)remain;		/* Truncate btr by remaining bytes */
+
+	/* The file pointer, current cluster and sector cache of the file are left as they are */
+	for ( ;  btr;								/* Repeat until btr bytes read */
+		btr -= rcnt, *br += rcnt, rbuff += rcnt, ofs += rcnt) {
+		csect = (UINT)(ofs / SS(fs) & (fs->csize - 1));	/* Sector offset in the cluster */
+		if (clst == 0 || (csect == 0 && ofs % SS(fs) == 0)) {	/* At the start or on the cluster boundary? */
+			clst = pos_clust(fp, ofs, 0);		/* Get cluster# containing ofs */
+			if (clst < 2) ABORT(fs, FR_INT_ERR);
+			if (clst == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+		}
+		sect = clst2sect(fs, clst);				/* Get current sector */
+		if (sect == 0) ABORT(fs, FR_INT_ERR);
+		sect += csect;
+		cc = btr / SS(fs);						/* When remaining bytes >= sector size, */
+		if (ofs % SS(fs) == 0 && cc > 0) {		/* Read maximum contiguous sectors directly */
+			if (csect + cc > fs->csize) {		/* Clip at cluster boundary */
+				cc = fs->csize - csect;
+			}
+			if (disk_read(fs->pdrv, rbuff, sect, cc) != RES_OK) ABORT(fs, FR_DISK_ERR);
+#if !FF_FS_READONLY && FF_FS_MINIMIZE <= 2		/* Replace one of the read sectors with cached data if it contains a dirty sector */
+#if FF_FS_TINY
+			if (fs->wflag && fs->winsect - sect < cc) {
+				mem_cpy(rbuff + ((fs->winsect - sect) * SS(fs)), fs->win, SS(fs));
+			}
+#else
+			if ((fp->flag & FA_DIRTY) && fp->sect - sect < cc) {
+				mem_cpy(rbuff + ((fp->sect - sect) * SS(fs)), fp->buf, SS(fs));
+			}
+#endif
+#endif
+			rcnt = SS(fs) * cc;					/* Number of bytes transferred */
+			continue;
+		}
+		rcnt = SS(fs) - (UINT)ofs % SS(fs);		/* Number of bytes left in the sector */
+		if (rcnt > btr) rcnt = btr;				/* Clip it by btr if needed */
+#if !FF_FS_TINY
+		if (sect == fp->sect) {					/* Sector in the file cache (may be newer than on the disk)? */
+			mem_cpy(rbuff, fp->buf + ofs % SS(fs), rcnt);	/* Extract partial sector */
+			continue;
+		}
+#endif
+		if (move_window(fs, sect) != FR_OK) ABORT(fs, FR_DISK_ERR);	/* Move sector window */
+		mem_cpy(rbuff, fs->win + ofs % SS(fs), rcnt);	/* Extract partial sector */
+#if !FF_FS_TINY
+		fs->winsect = 0xFFFFFFFF;				/* Invalidate window, as f_write does not update file data in it */
+#endif
+	}
+
+	LEAVE_FF(fs, FR_OK);
+}
+
+
+
+
 #if !FF_FS_READONLY
 /*-----------------------------------------------------------------------*/
 /* Write File                                                            */
@@ -3951,6 +4092,96 @@ FRESULT f_write (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Write File at an Offset                                               */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_pwrite (
+	FIL* fp,			/* Pointer to the file object */
+	const void* buff,	/* Pointer to the data to be written */
+	UINT btw,			/* Number of bytes to write */
+	FSIZE_t ofs,		/* File offset to write at */
+	UINT* bw			/* Pointer to number of bytes written */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	DWORD clst = 0, sect;
+	UINT wcnt, cc, csect;
+	const BYTE *wbuff = (const BYTE*)buff;
+
+
+	*bw = 0;	/* Clear write byte counter */
+	res = validate(&fp->obj, &fs);			/* Check validity of the file object */
+	if (res != FR_OK || (res = (FRESULT)fp->err) != FR_OK) LEAVE_FF(fs, res);	/* Check validity */
+	if (!(fp->flag & FA_WRITE)) LEAVE_FF(fs, FR_DENIED);	/* Check access mode */
+
+	/* Check ofs wrap-around (file size cannot reach 4 GiB at FAT volume) */
+	if ((!FF_FS_EXFAT || fs->fs_type != FS_EXFAT) && (DWORD)(ofs + btw) < (DWORD)ofs) {
+		btw = (UINT)(0xFFFFFFFF - (DWORD)ofs);
+	}
+
+	/* The file pointer, current cluster and sector cache of the file are left as they are.
+	   The file is expanded if ofs is beyond its end, as f_lseek does. */
+	for ( ;  btw;							/* Repeat until all data written */
+		btw -= wcnt, *bw += wcnt, wbuff += wcnt, ofs += wcnt, fp->obj.objsize = (ofs > fp->obj.objsize) ? ofs : fp->obj.objsize) {
+		csect = (UINT)(ofs / SS(fs)) & (fs->csize - 1);	/* Sector offset in the cluster */
+		if (clst == 0 || (csect == 0 && ofs % SS(fs) == 0)) {	/* At the start or on the cluster boundary? */
+			clst = pos_clust(fp, ofs, 1);	/* Get cluster# containing ofs, stretch the chain if needed */
+			if (clst == 0) break;			/* Could not allocate a new cluster (disk full) */
+			if (clst == 1) ABORT(fs, FR_INT_ERR);
+			if (clst == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+		}
+		sect = clst2sect(fs, clst);			/* Get current sector */
+		if (sect == 0) ABORT(fs, FR_INT_ERR);
+		sect += csect;
+		cc = btw / SS(fs);					/* When remaining bytes >= sector size, */
+		if (ofs % SS(fs) == 0 && cc > 0) {	/* Write maximum contiguous sectors directly */
+			if (csect + cc > fs->csize) {	/* Clip at cluster boundary */
+				cc = fs->csize - csect;
+			}
+			if (disk_write(fs->pdrv, wbuff, sect, cc) != RES_OK) ABORT(fs, FR_DISK_ERR);
+#if FF_FS_TINY
+			if (fs->winsect - sect < cc) {	/* Refill sector cache if it gets invalidated by the direct write */
+				mem_cpy(fs->win, wbuff + ((fs->winsect - sect) * SS(fs)), SS(fs));
+				fs->wflag = 0;
+			}
+#else
+			if (fp->sect - sect < cc) {		/* Refill sector cache if it gets invalidated by the direct write */
+				mem_cpy(fp->buf, wbuff + ((fp->sect - sect) * SS(fs)), SS(fs));
+				fp->flag &= (BYTE)~FA_DIRTY;
+			}
+#endif
+			wcnt = SS(fs) * cc;			/* Number of bytes transferred */
+			continue;
+		}
+		wcnt = SS(fs) - (UINT)ofs % SS(fs);	/* Number of bytes left in the sector */
+		if (wcnt > btw) wcnt = btw;			/* Clip it by btw if needed */
+#if !FF_FS_TINY
+		if (sect == fp->sect) {				/* Sector in the file cache? */
+			mem_cpy(fp->buf + ofs % SS(fs), wbuff, wcnt);	/* Fit data to the sector */
+			fp->flag |= FA_DIRTY;
+			continue;
+		}
+#endif
+		if (move_window(fs, sect) != FR_OK) ABORT(fs, FR_DISK_ERR);	/* Move sector window */
+		mem_cpy(fs->win + ofs % SS(fs), wbuff, wcnt);	/* Fit data to the sector */
+		fs->wflag = 1;
+#if !FF_FS_TINY
+		res = sync_window(fs);				/* Write the sector back and invalidate window, */
+		fs->winsect = 0xFFFFFFFF;			/* as f_read does not look for file data in it */
+		if (res != FR_OK) ABORT(fs, res);
+#endif
+	}
+
+	fp->flag |= FA_MODIFIED;				/* Set file change flag */
+
+	LEAVE_FF(fs, FR_OK);
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Synchronize the File                                                  */
 /*-----------------------------------------------------------------------*/
@@ -4748,6 +4979,7 @@ FRESULT f_truncate (
 		}
 		fp->obj.objsize = fp->fptr;	/* Set file size to current read/write point */
 		fp->flag |= FA_MODIFIED;
+		fp->pclust = 0;				/* The cluster of positional access may be removed */
 #if !FF_FS_TINY
 		if (res == FR_OK && (fp->flag & FA_DIRTY)) {
 			if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) {
@@ -200,6 +200,8 @@ typedef struct {
 	FSIZE_t	fptr;			/* File read/write pointer (Zeroed on file open) */
 	DWORD	clust;			/* Current cluster of fpter (invalid when fptr is 0) */
 	DWORD	sect;			/* Sector number appearing in buf[] (0:invalid) */
+	FSIZE_t	pptr;			/* File offset of pclust (cluster aligned) */
+	DWORD	pclust;			/* Cluster last accessed by f_pread/f_pwrite (0:invalid) */
 #if !FF_FS_READONLY
 	DWORD	dir_sect;		/* Sector number containing the directory entry (not used at exFAT) */
 	BYTE*	dir_ptr;		/* Pointer to the directory entry in the win[] (not used at exFAT) */
@@ -284,6 +286,8 @@ FRESULT f_open (FIL* fp, const TCHAR* path, BYTE mode);				/* Open or create a f
 FRESULT f_close (FIL* fp);											/* Close an open file object */
 FRESULT f_read (FIL* fp, void* buff, UINT btr, UINT* br);			/* Read data from the file */
 FRESULT f_write (FIL* fp, const void* buff, UINT btw, UINT* bw);	/* Write data to the file */
+FRESULT f_pread (FIL* fp, void* buff, UINT btr, FSIZE_t ofs, UINT* br);		/* Read data from the file at an offset */
+FRESULT f_pwrite (FIL* fp, const void* buff, UINT btw, FSIZE_t ofs, UINT* bw);	/* Write data to the file at an offset */
 FRESULT f_lseek (FIL* fp, FSIZE_t ofs);								/* Move file pointer of the file object */
 FRESULT f_truncate (FIL* fp);										/* Truncate the file */
 FRESULT f_sync (FIL* fp);											/* Flush cached data of the writing file */
@@ -223,6 +223,90 @@ void test_fatfs_lseek(const char* filename)
     TEST_ASSERT_EQUAL(0, fclose(f));
 }
 
+#if CONFIG_FATFS_USE_FASTSEEK
+/* Opens a file for reading, and returns the heap used by its cluster link map table */
+static size_t open_fast_seek_file(const char* name, int* fd)
+{
+    size_t heap_size = esp_get_free_heap_size();
+    *fd = open(name, O_RDONLY);
+    TEST_ASSERT_NOT_EQUAL(-1, *fd);
+    return heap_size - esp_get_free_heap_size();
+}
+
+static void check_fast_seek_file(int fd, int file_index, size_t fragments, size_t cluster_size)
+{
+    /* Each byte of cluster c of the file holds 2 * c + file_index */
+    const size_t clusters[] = { fragments - 1, 0, fragments / 2, 1, fragments - 2 };
+    for (size_t i = 0; i < sizeof(clusters) / sizeof(clusters[0]); ++i) {
+        off_t offset = clusters[i] * cluster_size + cluster_size / 2;
+        uint8_t val;
+        TEST_ASSERT_EQUAL(offset, lseek(fd, offset, SEEK_SET));
+        TEST_ASSERT_EQUAL(1, read(fd, &val, 1));
+        TEST_ASSERT_EQUAL((uint8_t) (2 * clusters[i] + file_index), val);
+    }
+}
+
+void test_fatfs_fast_seek_budget(const char* filename_prefix, size_t cluster_size)
+{
+    /* Two files written in turns by clusters, so that each cluster is one fragment.
+     * The table of each file takes 40% of the budget of the volume. */
+    const size_t table_size = CONFIG_FATFS_FAST_SEEK_BUFFER_SIZE * 2 / 5;
+    const size_t fragments = table_size / (2 * sizeof(DWORD)) - 1;
+    TEST_ASSERT_TRUE(fragments * cluster_size >= CONFIG_FATFS_FAST_SEEK_MIN_FILE_SIZE * 1024);
+
+    char names[2][64];
+    int fd[3];
+    uint8_t* buf = malloc(cluster_size);
+    TEST_ASSERT_NOT_NULL(buf);
+    for (int i = 0; i < 2; ++i) {
+        snprintf(names[i], sizeof(names[i]), "%s%d", filename_prefix, i);
+        fd[i] = open(names[i], O_WRONLY | O_CREAT | O_TRUNC);
+        TEST_ASSERT_NOT_EQUAL(-1, fd[i]);
+    }
+    for (size_t c = 0; c < fragments; ++c) {
+        for (int i = 0; i < 2; ++i) {
+            memset(buf, 2 * c + i, cluster_size);
+            TEST_ASSERT_EQUAL(cluster_size, write(fd[i], buf, cluster_size));
+        }
+    }
+    for (int i = 0; i < 2; ++i) {
+        TEST_ASSERT_EQUAL(0, close(fd[i]));
+    }
+    free(buf);
+
+    /* Tables are created for the first two files opened, the third one is over the budget */
+    TEST_ASSERT_TRUE(open_fast_seek_file(names[0], &fd[0]) >= table_size);
+    TEST_ASSERT_TRUE(open_fast_seek_file(names[0], &fd[1]) >= table_size);
+    TEST_ASSERT_TRUE(open_fast_seek_file(names[1], &fd[2]) < table_size / 2);
+    check_fast_seek_file(fd[0], 0, fragments, cluster_size);
+    check_fast_seek_file(fd[1], 0, fragments, cluster_size);
+    check_fast_seek_file(fd[2], 1, fragments, cluster_size);
+
+    /* Closing a file gives its table back to the budget */
+    size_t heap_size = esp_get_free_heap_size();
+    TEST_ASSERT_EQUAL(0, close(fd[0]));
+    TEST_ASSERT_TRUE(esp_get_free_heap_size() - heap_size >= table_size);
+    TEST_ASSERT_EQUAL(0, close(fd[2]));
+    TEST_ASSERT_TRUE(open_fast_seek_file(names[1], &fd[2]) >= table_size);
+    check_fast_seek_file(fd[2], 1, fragments, cluster_size);
+    TEST_ASSERT_EQUAL(0, close(fd[1]));
+    TEST_ASSERT_EQUAL(0, close(fd[2]));
+
+    /* Files opened for writing don't use tables */
+    fd[0] = open(names[0], O_RDWR);
+    TEST_ASSERT_NOT_EQUAL(-1, fd[0]);
+    TEST_ASSERT_TRUE(open_fast_seek_file(names[0], &fd[1]) >= table_size);
+    TEST_ASSERT_TRUE(open_fast_seek_file(names[1], &fd[2]) >= table_size);
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL(0, close(fd[i]));
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        TEST_ASSERT_EQUAL(0, unlink(names[i]));
+    }
+}
+#endif // CONFIG_FATFS_USE_FASTSEEK
+
 void test_fatfs_truncate_file(const char* filename)
 {
     int read = 0;
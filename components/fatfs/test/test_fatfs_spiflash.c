@@ -111,6 +111,15 @@ TEST_CASE("(WL) can lseek", "[fatfs][wear_levelling]")
     test_teardown();
 }
 
+#if CONFIG_FATFS_USE_FASTSEEK
+TEST_CASE("(WL) fast seek tables are limited by the budget of the volume", "[fatfs][wear_levelling]")
+{
+    test_setup();
+    test_fatfs_fast_seek_budget("/spiflash/seek", CONFIG_WL_SECTOR_SIZE);
+    test_teardown();
+}
+#endif
+
 TEST_CASE("(WL) can truncate", "[fatfs][wear_levelling]")
 {
     test_setup();
@@ -1,15 +1,22 @@
 #include <stdio.h>
 #include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "ff.h"
 #include "esp_partition.h"
 #include "wear_levelling.h"
 #include "diskio_impl.h"
 #include "diskio_wl.h"
+#include "SpiFlash.h"
 
 #include "catch.hpp"
 
 extern "C" void _spi_flash_init(const char* chip_size, size_t block_size, size_t sector_size, size_t page_size, const char* partition_bin);
+extern SpiFlash spiflash;
 
 TEST_CASE("create volume, open file, write and read back data", "[fatfs]")
 {
@@ -90,4 +97,296 @@ TEST_CASE("create volume, open file, write and read back data", "[fatfs]")
 
     free(read);
     free(data);
+
+    ff_diskio_unregister(pdrv);
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+}
+
+typedef struct {
+    wl_handle_t wl_handle;
+    BYTE pdrv;
+    FATFS fs;
+} test_volume_t;
+
+/* Formats the FAT partition and mounts it as the default volume */
+static void test_volume_mount(test_volume_t* vol)
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, "storage");
+    REQUIRE(partition != NULL);
+    REQUIRE(wl_mount(partition, &vol->wl_handle) == ESP_OK);
+    REQUIRE(ff_diskio_get_drive(&vol->pdrv) == ESP_OK);
+    REQUIRE(ff_diskio_register_wl_partition(vol->pdrv, vol->wl_handle) == ESP_OK);
+
+    DWORD part_list[] = {100, 0, 0, 0};
+    BYTE work_area[FF_MAX_SS];
+    REQUIRE(f_fdisk(vol->pdrv, part_list, work_area) == FR_OK);
+    REQUIRE(f_mkfs("", FM_ANY, 0, work_area, sizeof(work_area)) == FR_OK);
+    REQUIRE(f_mount(&vol->fs, "", 0) == FR_OK);
+}
+
+static void test_volume_unmount(test_volume_t* vol)
+{
+    REQUIRE(f_mount(0, "", 0) == FR_OK);
+    ff_diskio_unregister(vol->pdrv);
+    REQUIRE(wl_unmount(vol->wl_handle) == ESP_OK);
+}
+
+static void fill_pattern(char* buf, uint32_t start, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; i++) {
+        buf[i] = (char) ((start + i) * 7 + (start + i) / 251);
+    }
+}
+
+TEST_CASE("pread and pwrite don't move the file pointer", "[fatfs]")
+{
+    test_volume_t vol;
+    test_volume_mount(&vol);
+
+    FIL file;
+    UINT bw;
+    const uint32_t data_size = 100000;
+    char *data = (char*) malloc(data_size + 10000);
+    char *read = (char*) malloc(data_size + 10000);
+    fill_pattern(data, 0, data_size);
+
+    REQUIRE(f_open(&file, "test.txt", FA_CREATE_ALWAYS | FA_READ | FA_WRITE) == FR_OK);
+    REQUIRE(f_write(&file, data, data_size, &bw) == FR_OK);
+    REQUIRE(bw == data_size);
+
+    // Leave the file pointer in the middle of a sector, with the sector cached
+    const FSIZE_t pos = 12345;
+    REQUIRE(f_lseek(&file, pos) == FR_OK);
+
+    // Read at various offsets and sizes, crossing sector and cluster boundaries
+    const struct { uint32_t ofs; uint32_t size; } reads[] = {
+        {0, 1}, {0, 512}, {511, 2}, {4095, 4098}, {pos - 10, 20}, {50000, 30000},
+        {1000, data_size - 1000}, {data_size - 5, 5}, {99000, 5000}, {data_size, 1},
+    };
+    for (size_t i = 0; i < sizeof(reads) / sizeof(reads[0]); i++) {
+        uint32_t expected = reads[i].size;
+        if (reads[i].ofs + expected > data_size) {
+            expected = data_size - reads[i].ofs;
+        }
+        REQUIRE(f_pread(&file, read, reads[i].size, reads[i].ofs, &bw) == FR_OK);
+        REQUIRE(bw == expected);
+        REQUIRE(memcmp(read, data + reads[i].ofs, expected) == 0);
+        REQUIRE(f_tell(&file) == pos);
+    }
+
+    // Writes through the file pointer are visible to pread before the file is synced
+    fill_pattern(data + pos, 0x10000, 100);
+    REQUIRE(f_write(&file, data + pos, 100, &bw) == FR_OK);
+    REQUIRE(f_pread(&file, read, 1000, pos - 500, &bw) == FR_OK);
+    REQUIRE(memcmp(read, data + pos - 500, 1000) == 0);
+
+    // Data written with pwrite is read back through the file pointer,
+    // including in the sector cached by the file
+    const FSIZE_t cur = f_tell(&file);
+    fill_pattern(data + cur - 10, 0x20000, 30);
+    REQUIRE(f_pwrite(&file, data + cur - 10, 30, cur - 10, &bw) == FR_OK);
+    REQUIRE(bw == 30);
+    fill_pattern(data + 40000, 0x30000, 20000);
+    REQUIRE(f_pwrite(&file, data + 40000, 20000, 40000, &bw) == FR_OK);
+    REQUIRE(bw == 20000);
+    REQUIRE(f_tell(&file) == cur);
+    REQUIRE(f_read(&file, read, 100, &bw) == FR_OK);
+    REQUIRE(memcmp(read, data + cur, 100) == 0);
+    REQUIRE(f_lseek(&file, 0) == FR_OK);
+    REQUIRE(f_read(&file, read, data_size, &bw) == FR_OK);
+    REQUIRE(bw == data_size);
+    REQUIRE(memcmp(read, data, data_size) == 0);
+
+    // pwrite beyond the end of the file expands it
+    fill_pattern(data + data_size + 5000, 0x40000, 5000);
+    REQUIRE(f_pwrite(&file, data + data_size + 5000, 5000, data_size + 5000, &bw) == FR_OK);
+    REQUIRE(bw == 5000);
+    REQUIRE(f_size(&file) == data_size + 10000);
+    REQUIRE(f_tell(&file) == data_size);
+    REQUIRE(f_close(&file) == FR_OK);
+
+    // and the data is there after reopening the file
+    REQUIRE(f_open(&file, "test.txt", FA_OPEN_EXISTING | FA_READ) == FR_OK);
+    REQUIRE(f_size(&file) == data_size + 10000);
+    REQUIRE(f_pread(&file, read, data_size, 0, &bw) == FR_OK);
+    REQUIRE(memcmp(read, data, data_size) == 0);
+    REQUIRE(f_pread(&file, read, 5000, data_size + 5000, &bw) == FR_OK);
+    REQUIRE(memcmp(read, data + data_size + 5000, 5000) == 0);
+    REQUIRE(f_pwrite(&file, data, 1, 0, &bw) == FR_DENIED);
+    REQUIRE(f_tell(&file) == 0);
+    REQUIRE(f_close(&file) == FR_OK);
+
+    test_volume_unmount(&vol);
+    free(read);
+    free(data);
+}
+
+/* Several threads read random blocks of one open file, as with pread()
+ * on a shared file descriptor. This compares f_pread with moving the file
+ * pointer to the block and back, which needs a lock around the three calls. */
+TEST_CASE("multiple threads read a file at random offsets", "[fatfs][benchmark]")
+{
+    typedef std::chrono::steady_clock clock;
+    const uint32_t file_size = 512 * 1024;
+    const uint32_t block_size = 1024;
+    const int thread_count = 4;
+    const int reads_per_thread = 2000;
+
+    test_volume_t vol;
+    test_volume_mount(&vol);
+
+    FIL file;
+    UINT bw;
+    char *data = (char*) malloc(file_size);
+    fill_pattern(data, 0, file_size);
+    REQUIRE(f_open(&file, "test.bin", FA_CREATE_ALWAYS | FA_READ | FA_WRITE) == FR_OK);
+    REQUIRE(f_write(&file, data, file_size, &bw) == FR_OK);
+    REQUIRE(bw == file_size);
+    REQUIRE(f_sync(&file) == FR_OK);
+
+    std::mutex file_lock;
+    std::atomic<int> errors(0);
+    auto reader = [&](int index, bool use_pread) {
+        char buf[block_size];
+        uint32_t seed = index + 1;
+        for (int i = 0; i < reads_per_thread; i++) {
+            seed = seed * 1103515245 + 12345;
+            const FSIZE_t ofs = (seed >> 8) % (file_size - block_size);
+            UINT br = 0;
+            FRESULT res;
+            if (use_pread) {
+                res = f_pread(&file, buf, block_size, ofs, &br);
+            } else {
+                std::lock_guard<std::mutex> guard(file_lock);
+                const FSIZE_t prev_pos = f_tell(&file);
+                res = f_lseek(&file, ofs);
+                if (res == FR_OK) {
+                    res = f_read(&file, buf, block_size, &br);
+                }
+                if (res == FR_OK) {
+                    res = f_lseek(&file, prev_pos);
+                }
+            }
+            if (res != FR_OK || br != block_size || memcmp(buf, data + ofs, block_size) != 0) {
+                errors++;
+            }
+        }
+    };
+
+    for (int use_pread = 0; use_pread < 2; use_pread++) {
+        auto start = clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < thread_count; i++) {
+            threads.emplace_back(reader, i, use_pread != 0);
+        }
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+        REQUIRE(errors == 0);
+        printf("%s: %d threads read %d KiB in %d us (%d KiB/s)\n",
+               use_pread ? "f_pread" : "f_lseek + f_read", thread_count,
+               (int) (thread_count * reads_per_thread * block_size / 1024), (int) us,
+               (int) (1000000LL * thread_count * reads_per_thread * block_size / 1024 / (us ? us : 1)));
+    }
+
+    REQUIRE(f_close(&file) == FR_OK);
+    test_volume_unmount(&vol);
+    free(data);
+}
+
+/* Two files are written in turns, one cluster at a time, so that each of them
+ * has a fragment in every other cluster. This compares random seeks in one of
+ * them following the cluster chain, and using a cluster link map table. */
+TEST_CASE("random seeks in a fragmented file", "[fatfs][benchmark]")
+{
+    typedef std::chrono::steady_clock clock;
+    const uint32_t file_size = 320 * 1024;
+    const int seek_count = 20000;
+
+    test_volume_t vol;
+    test_volume_mount(&vol);
+
+    FIL file, other;
+    UINT bw;
+    char *data = (char*) malloc(file_size);
+    fill_pattern(data, 0, file_size);
+    REQUIRE(f_open(&file, "test.bin", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+    REQUIRE(f_open(&other, "other.bin", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+    // The volume is mounted by the first access
+    const uint32_t cluster_size = vol.fs.csize * FF_MAX_SS;
+    REQUIRE(cluster_size > 0);
+    for (uint32_t ofs = 0; ofs < file_size; ofs += cluster_size) {
+        REQUIRE(f_write(&file, data + ofs, cluster_size, &bw) == FR_OK);
+        REQUIRE(bw == cluster_size);
+        REQUIRE(f_write(&other, data + ofs, cluster_size, &bw) == FR_OK);
+        REQUIRE(bw == cluster_size);
+        REQUIRE(f_sync(&file) == FR_OK);
+        REQUIRE(f_sync(&other) == FR_OK);
+    }
+    REQUIRE(f_close(&other) == FR_OK);
+    REQUIRE(f_close(&file) == FR_OK);
+
+    REQUIRE(f_open(&file, "test.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
+
+    // The first call only returns the number of items needed
+    DWORD size_only[2] = { 2, 0 };
+    file.cltbl = size_only;
+    REQUIRE(f_lseek(&file, CREATE_LINKMAP) == FR_NOT_ENOUGH_CORE);
+    const DWORD items = size_only[0];
+    REQUIRE(items == 2 * (file_size / cluster_size) + 2);
+    std::vector<DWORD> clmt(items);
+    clmt[0] = items;
+
+    uint32_t flash_reads[2];
+    for (int use_clmt = 0; use_clmt < 2; use_clmt++) {
+        if (use_clmt) {
+            file.cltbl = clmt.data();
+            REQUIRE(f_lseek(&file, CREATE_LINKMAP) == FR_OK);
+        } else {
+            file.cltbl = NULL;
+        }
+
+        uint32_t seed = 1;
+        int errors = 0;
+        char buf[512];
+        spiflash.reset_stats();
+        auto start = clock::now();
+        for (int i = 0; i < seek_count; i++) {
+            seed = seed * 1103515245 + 12345;
+            const FSIZE_t ofs = (seed >> 8) % (file_size - sizeof(buf));
+            UINT br = 0;
+            if (f_lseek(&file, ofs) != FR_OK || f_read(&file, buf, sizeof(buf), &br) != FR_OK ||
+                    br != sizeof(buf) || memcmp(buf, data + ofs, sizeof(buf)) != 0) {
+                errors++;
+            }
+        }
+        auto seek_us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+        flash_reads[use_clmt] = spiflash.get_stats().read.ops;
+
+        start = clock::now();
+        for (int i = 0; i < seek_count; i++) {
+            seed = seed * 1103515245 + 12345;
+            const FSIZE_t ofs = (seed >> 8) % (file_size - sizeof(buf));
+            UINT br = 0;
+            if (f_pread(&file, buf, sizeof(buf), ofs, &br) != FR_OK ||
+                    br != sizeof(buf) || memcmp(buf, data + ofs, sizeof(buf)) != 0) {
+                errors++;
+            }
+        }
+        auto pread_us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+        REQUIRE(errors == 0);
+
+        printf("%s: %d fragments, %d x f_lseek + f_read in %d us (%d flash reads), %d x f_pread in %d us\n",
+               use_clmt ? "link map table" : "cluster chain", (int) (file_size / cluster_size),
+               seek_count, (int) seek_us, (int) flash_reads[use_clmt], seek_count, (int) pread_us);
+    }
+    // Following the cluster chain reads FAT sectors, the link map table doesn't
+    CHECK(flash_reads[1] < flash_reads[0]);
+
+    REQUIRE(f_close(&file) == FR_OK);
+    test_volume_unmount(&vol);
+    free(data);
 }
@@ -33,6 +33,9 @@ typedef struct {
     char tmp_path_buf[FILENAME_MAX+3];  /* temporary buffer used to prepend drive name to the path */
     char tmp_path_buf2[FILENAME_MAX+3]; /* as above; used in functions which take two path arguments */
     bool *o_append;  /* O_APPEND is stored here for each max_files entries (because O_APPEND is not compatible with FA_OPEN_APPEND) */
+#if FF_USE_FASTSEEK
+    size_t clmt_size;   /* total size of the cluster link map tables of open files, in bytes */
+#endif
     FIL files[0];   /* array with max_files entries; must be the final member of the structure */
 } vfs_fat_ctx_t;
 
@@ -286,6 +289,63 @@ static void file_cleanup(vfs_fat_ctx_t* ctx, int fd)
     memset(&ctx->files[fd], 0, sizeof(FIL));
 }
 
+#if FF_USE_FASTSEEK
+/**
+ * @brief Create a cluster link map table for a large file opened for reading
+ * The table is sized for the fragments of the file, within the remaining
+ * budget of the volume. Without it, the file is accessed as usual.
+ * @note Call this function with ctx->lock acquired.
+ * @param ctx vfs_fat_ctx_t context
+ * @param file the file, opened without FA_WRITE
+ * @return FR_OK, also if no table was created, or the error which occurred
+ *         while reading the cluster chain. The file can't be used after an error.
+ */
+static FRESULT file_create_clmt(vfs_fat_ctx_t* ctx, FIL* file)
+{
+    if (f_size(file) < (FSIZE_t) CONFIG_FATFS_FAST_SEEK_MIN_FILE_SIZE * 1024 ||
+            ctx->clmt_size >= CONFIG_FATFS_FAST_SEEK_BUFFER_SIZE) {
+        return FR_OK;
+    }
+    size_t len = (CONFIG_FATFS_FAST_SEEK_BUFFER_SIZE - ctx->clmt_size) / sizeof(DWORD);
+    if (len < 4) { // table size, one fragment, terminator
+        return FR_OK;
+    }
+    DWORD* clmt = ff_memalloc(len * sizeof(DWORD));
+    if (clmt == NULL) {
+        return FR_OK;
+    }
+    clmt[0] = len;
+    file->cltbl = clmt;
+    FRESULT res = f_lseek(file, CREATE_LINKMAP);
+    if (res != FR_OK) {
+        ESP_LOGD(TAG, "%s: fresult=%d, %u items needed", __func__, res, (unsigned) clmt[0]);
+        file->cltbl = NULL;
+        free(clmt);
+        // FR_NOT_ENOUGH_CORE if the file has too many fragments for the budget
+        return (res == FR_NOT_ENOUGH_CORE) ? FR_OK : res;
+    }
+    // clmt[0] is now the number of items used, give back the rest
+    len = clmt[0];
+    DWORD* used = realloc(clmt, len * sizeof(DWORD));
+    file->cltbl = used ? used : clmt;
+    ctx->clmt_size += len * sizeof(DWORD);
+    return FR_OK;
+}
+
+/**
+ * @brief Free the cluster link map table of a file, if any
+ * @note Call this function with ctx->lock acquired.
+ */
+static void file_free_clmt(vfs_fat_ctx_t* ctx, FIL* file)
+{
+    if (file->cltbl) {
+        ctx->clmt_size -= file->cltbl[0] * sizeof(DWORD);
+        free(file->cltbl);
+        file->cltbl = NULL;
+    }
+}
+#endif // FF_USE_FASTSEEK
+
 /**
  * @brief Prepend drive letters to path names
  * This function returns new path path pointers, pointing to a temporary buffer
@@ -333,6 +393,20 @@ static int vfs_fat_open(void* ctx, const char * path, int flags, int mode)
     // therefore this flag is stored here (at this VFS level) in order to save
     // memory.
     fat_ctx->o_append[fd] = (flags & O_APPEND) == O_APPEND;
+#if FF_USE_FASTSEEK
+    // Fast seek mode doesn't allow the file to grow, so only use it for reading
+    if ((flags & O_ACCMODE) == O_RDONLY) {
+        res = file_create_clmt(fat_ctx, &fat_ctx->files[fd]);
+        if (res != FR_OK) {
+            f_close(&fat_ctx->files[fd]);
+            file_cleanup(fat_ctx, fd);
+            _lock_release(&fat_ctx->lock);
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            return -1;
+        }
+    }
+#endif
     _lock_release(&fat_ctx->lock);
     return fd;
 }
@@ -379,80 +453,43 @@ static ssize_t vfs_fat_read(void* ctx, int fd, void * dst, size_t size)
 
 static ssize_t vfs_fat_pread(void *ctx, int fd, void *dst, size_t size, off_t offset)
 {
-    ssize_t ret = -1;
     vfs_fat_ctx_t *fat_ctx = (vfs_fat_ctx_t *) ctx;
-    _lock_acquire(&fat_ctx->lock);
     FIL *file = &fat_ctx->files[fd];
-    const off_t prev_pos = f_tell(file);
-
-    FRESULT f_res = f_lseek(file, offset);
-    if (f_res != FR_OK) {
-        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
-        errno = fresult_to_errno(f_res);
-        goto pread_release;
+    if (offset < 0) {
+        errno = EINVAL;
+        return -1;
     }
-
+    // f_pread doesn't move the file pointer, so only the FatFs volume lock is needed
     unsigned read = 0;
-    f_res = f_read(file, dst, size, &read);
-    if (f_res == FR_OK) {
-        ret = read;
-    } else {
-        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
-        errno = fresult_to_errno(f_res);
-        // No return yet - need to restore previous position
-    }
-
-    f_res = f_lseek(file, prev_pos);
-    if (f_res != FR_OK) {
-        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
-        if (ret >= 0) {
-            errno = fresult_to_errno(f_res);
-        } // else f_read failed so errno shouldn't be overwritten
-        ret = -1; // in case the read was successful but the seek wasn't
+    FRESULT res = f_pread(file, dst, size, offset, &read);
+    if (res != FR_OK) {
+        ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+        errno = fresult_to_errno(res);
+        if (read == 0) {
+            return -1;
+        }
     }
-
-pread_release:
-    _lock_release(&fat_ctx->lock);
-    return ret;
+    return read;
 }
 
 static ssize_t vfs_fat_pwrite(void *ctx, int fd, const void *src, size_t size, off_t offset)
 {
-    ssize_t ret = -1;
     vfs_fat_ctx_t *fat_ctx = (vfs_fat_ctx_t *) ctx;
-    _lock_acquire(&fat_ctx->lock);
     FIL *file = &fat_ctx->files[fd];
-    const off_t prev_pos = f_tell(file);
-
-    FRESULT f_res = f_lseek(file, offset);
-    if (f_res != FR_OK) {
-        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
-        errno = fresult_to_errno(f_res);
-        goto pwrite_release;
-    }
-
-    unsigned wr = 0;
-    f_res = f_write(file, src, size, &wr);
-    if (f_res == FR_OK) {
-        ret = wr;
-    } else {
-        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
-        errno = fresult_to_errno(f_res);
-        // No return yet - need to restore previous position
+    if (offset < 0) {
+        errno = EINVAL;
+        return -1;
     }
-
-    f_res = f_lseek(file, prev_pos);
-    if (f_res != FR_OK) {
-        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
-        if (ret >= 0) {
-            errno = fresult_to_errno(f_res);
-        } // else f_write failed so errno shouldn't be overwritten
-        ret = -1; // in case the write was successful but the seek wasn't
+    unsigned written = 0;
+    FRESULT res = f_pwrite(file, src, size, offset, &written);
+    if (res != FR_OK) {
+        ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+        errno = fresult_to_errno(res);
+        if (written == 0) {
+            return -1;
+        }
     }
-
-pwrite_release:
-    _lock_release(&fat_ctx->lock);
-    return ret;
+    return written;
 }
 
 static int vfs_fat_fsync(void* ctx, int fd)
@@ -477,6 +514,9 @@ static int vfs_fat_close(void* ctx, int fd)
     _lock_acquire(&fat_ctx->lock);
     FIL* file = &fat_ctx->files[fd];
     FRESULT res = f_close(file);
+#if FF_USE_FASTSEEK
+    file_free_clmt(fat_ctx, file);
+#endif
     file_cleanup(fat_ctx, fd);
     _lock_release(&fat_ctx->lock);
     int rc = 0;
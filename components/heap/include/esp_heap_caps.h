@@ -46,6 +46,8 @@ extern "C" {
  *
  * In IDF, ``malloc(p)`` is equivalent to ``heap_caps_malloc(p, MALLOC_CAP_8BIT)``.
  *
+ * The smallest allocation holds 12 bytes of data, smaller requests use as much heap as a 12 byte one.
+ *
  * @param size Size, in bytes, of the amount of memory to allocate
  * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type
  *                    of memory to be returned
@@ -109,6 +111,9 @@ void *heap_caps_calloc(size_t n, size_t size, uint32_t caps);
  *
  * Note that because of heap fragmentation it is probably not possible to allocate a single block of memory
  * of this size. Use heap_caps_get_largest_free_block() for this purpose.
+ *
+ * Free fragments of less than 12 bytes, which cannot hold the smallest allocation, are not counted. They
+ * are merged into larger free blocks when the memory next to them is freed.
 
  * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type
  *                    of memory
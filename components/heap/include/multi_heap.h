@@ -33,6 +33,9 @@ typedef struct multi_heap_info *multi_heap_handle_t;
  *
  * Semantics are the same as standard malloc(), only the returned buffer will be allocated in the specified heap.
  *
+ * Every buffer has room for at least three pointers (12 bytes on ESP32), so that its block can be put on
+ * a free list once it is freed. Smaller requests use the same amount of heap as a 12 byte request.
+ *
  * @param heap Handle to a registered heap.
  * @param size Size of desired buffer.
  *
@@ -129,6 +132,10 @@ bool multi_heap_check(multi_heap_handle_t heap, bool print_errors);
  * Note that the heap may be fragmented, so the actual maximum size for a single malloc() may be lower. To know this
  * size, see the largest_free_block member returned by multi_heap_get_heap_info().
  *
+ * Free blocks with less than 12 bytes of data (three pointers) are left over when a larger free block is split. They
+ * cannot be allocated on their own, so they are not counted here, nor in multi_heap_minimum_free_size() or
+ * multi_heap_get_info(). They become usable again when a neighbouring block is freed and merged with them.
+ *
  * @param heap Handle to a registered heap.
  * @return Number of free bytes.
  */
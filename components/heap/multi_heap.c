@@ -71,37 +71,72 @@ struct heap_block;
 
 /* Block in the heap
 
-   Heap implementation uses two single linked lists, a block list (all blocks) and a free list (free blocks).
+   Heap implementation uses a single linked block list (all blocks, in address order) and a set of segregated
+   free lists, each holding the free blocks of one size class in a double linked list.
 
-   'header' holds a pointer to the next block (used or free) ORed with a free flag (the LSB of the pointer.) is_free() and get_next_block() utility functions allow typed access to these values.
+   'header' holds a pointer to the next block (used or free) ORed with a free flag (the LSB of the pointer) and a
+   "previous block is free" flag. is_free() and get_next_block() utility functions allow typed access to these values.
 
-   'next_free' is valid if the block is free and is a pointer to the next block in the free list.
+   'next_free' and 'prev_free' are valid if the block is free and link the block into the free list of its size
+   class. A free block also stores a pointer to itself in its last word (footer), so the block following it can
+   find it when it is freed and the two need to be merged. Free blocks with less than MIN_LISTED_DATA_SIZE bytes
+   of data only have the footer and are on no free list, they are used again once a neighbour is freed.
 */
 typedef struct heap_block {
-    intptr_t header;                  /* Encodes next block in heap (used or unused) and also free/used flag */
+    intptr_t header;                  /* Encodes next block in heap (used or unused) and also free/used flags */
     union {
         uint8_t data[1];              /* First byte of data, valid if block is used. Actual size of data is 'block_data_size(block)' */
-        struct heap_block *next_free; /* Pointer to next free block, valid if block is free */
+        struct {
+            struct heap_block *next_free; /* Pointer to next free block in the same free list, valid if block is free */
+            struct heap_block *prev_free; /* Pointer to previous free block in the same free list, valid if block is free */
+        };
     };
 } heap_block_t;
 
 /* These masks apply to the 'header' field of heap_block_t */
-#define BLOCK_FREE_FLAG 0x1  /* If set, this block is free & next_free pointer is valid */
+#define BLOCK_FREE_FLAG 0x1  /* If set, this block is free & next_free/prev_free pointers are valid */
+#define PREV_FREE_FLAG 0x2   /* If set, the previous block in the heap is free & its footer is valid */
 #define NEXT_BLOCK_MASK (~3) /* AND header with this mask to get pointer to next block (free or used) */
 
+/* Smallest data size of a block, a free block needs room for its footer */
+#define MIN_BLOCK_DATA_SIZE sizeof(heap_block_t *)
+
+/* Smallest data size of a free block which is put on a free list, it needs room for its free list pointers and footer */
+#define MIN_LISTED_DATA_SIZE (3 * sizeof(heap_block_t *))
+
+/* Free list 0 holds blocks below (1 << FREE_LIST_MIN_SHIFT) bytes. Each power of two size class
+   [1 << N, 1 << (N + 1)) above it has one free list while N < FREE_LIST_SPLIT_SHIFT, larger size classes
+   are split into (1 << FREE_LIST_SPLIT_BITS) free lists of equal size ranges. Small heaps only need a
+   few free list heads, and in large heaps a free list only holds blocks of similar size. */
+#define FREE_LIST_MIN_SHIFT 6
+#define FREE_LIST_SPLIT_SHIFT 8
+#define FREE_LIST_SPLIT_BITS 2
+#define FREE_LIST_MAX_COUNT 64 /* bits in free_lists_bitmap */
+
+/* Number of blocks examined for a best fit in the free list of the requested size, before
+   falling back to the first block of a larger free list. */
+#define FREE_LIST_SEARCH_LIMIT 8
+
 /* Metadata header for the heap, stored at the beginning of heap space.
 
-   'first_block' is a "fake" first block, minimum length, used to provide a pointer to the first used & free block in
-   the heap. This block is never allocated or merged into an adjacent block.
+   'first_block' is a "fake" first block, used to provide a pointer to the first used & free block in
+   the heap. This block is never allocated or merged into an adjacent block. Its data holds the heads
+   of the free lists, the number of free lists depends on the size of the heap (see get_free_list_count()).
 
-   'last_block' is a pointer to a final free block of length 0, which is added at the end of the heap when it is
-   registered. This block is also never allocated or merged into an adjacent block.
+   'last_block' is a pointer to a final free block of length 0 (header only), which is added at the end
+   of the heap when it is registered. This block is also never allocated or merged into an adjacent block.
+
+   'free_lists_bitmap' has bit N set if free list N is not empty.
+
+   'free_bytes' is the data size of the blocks on the free lists, free blocks too small to be on a free list
+   can't be allocated and are not counted.
  */
 typedef struct multi_heap_info {
     void *lock;
     size_t free_bytes;
     size_t minimum_free_bytes;
     heap_block_t *last_block;
+    uint64_t free_lists_bitmap;
     heap_block_t first_block; /* initial 'free block', never allocated */
 } heap_t;
 
@@ -131,6 +166,12 @@ static inline bool is_free(const heap_block_t *block)
     return block->header & BLOCK_FREE_FLAG;
 }
 
+/* Return true if the block before this one in the heap is free (and can be merged with it) */
+static inline bool is_prev_free(const heap_block_t *block)
+{
+    return block->header & PREV_FREE_FLAG;
+}
+
 /* Return true if this block is the first in the heap */
 static inline bool is_first_block(const heap_t *heap, const heap_block_t *block)
 {
@@ -155,6 +196,64 @@ static inline size_t block_data_size(const heap_block_t *block)
     return next - this - sizeof(block->header);
 }
 
+/* Set the pointer to the next block, keeping the flags of 'block' */
+static inline void set_next_block(heap_block_t *block, const heap_block_t *next)
+{
+    block->header = (intptr_t)next | (block->header & ~NEXT_BLOCK_MASK);
+}
+
+/* Set or clear the flag recording whether the block before 'block' is free */
+static inline void set_prev_free(heap_block_t *block, bool prev_free)
+{
+    if (prev_free) {
+        block->header |= PREV_FREE_FLAG;
+    } else {
+        block->header &= ~PREV_FREE_FLAG;
+    }
+}
+
+/* Return the footer of a free block, stored in the last word before the next block */
+static inline heap_block_t **get_footer(const heap_block_t *block)
+{
+    return (heap_block_t **)(block->header & NEXT_BLOCK_MASK) - 1;
+}
+
+/* Return the free block before 'block' in the heap, found via its footer.
+   Only valid if is_prev_free(block) is true.
+*/
+static inline heap_block_t *get_prev_free_block(const heap_block_t *block)
+{
+    assert(is_prev_free(block));
+    return *((heap_block_t **)block - 1);
+}
+
+/* Return the array of free list heads, stored in the data of heap->first_block */
+static inline heap_block_t **get_free_lists(heap_t *heap)
+{
+    return (heap_block_t **)heap->first_block.data;
+}
+
+/* Return the index of the free list holding free blocks of 'size' bytes */
+static inline unsigned get_free_list_index(size_t size)
+{
+    if (size < (1 << FREE_LIST_MIN_SHIFT)) {
+        return 0;
+    }
+    unsigned shift = (sizeof(unsigned long) * 8 - 1) - __builtin_clzl(size);
+    if (shift < FREE_LIST_SPLIT_SHIFT) {
+        return shift - FREE_LIST_MIN_SHIFT + 1;
+    }
+    unsigned split = (size >> (shift - FREE_LIST_SPLIT_BITS)) & ((1 << FREE_LIST_SPLIT_BITS) - 1);
+    unsigned index = (FREE_LIST_SPLIT_SHIFT - FREE_LIST_MIN_SHIFT + 1) + ((shift - FREE_LIST_SPLIT_SHIFT) << FREE_LIST_SPLIT_BITS) + split;
+    return (index < FREE_LIST_MAX_COUNT) ? index : FREE_LIST_MAX_COUNT - 1;
+}
+
+/* Return the number of free lists in the heap, enough to hold a block as big as the heap itself */
+static inline unsigned get_free_list_count(const heap_t *heap)
+{
+    return get_free_list_index((intptr_t)heap->last_block - (intptr_t)heap) + 1;
+}
+
 /* Check a block is valid for this heap. Used to verify parameters. */
 static void assert_valid_block(const heap_t *heap, const heap_block_t *block)
 {
@@ -163,106 +262,133 @@ static void assert_valid_block(const heap_t *heap, const heap_block_t *block)
     if (heap < (const heap_t *)heap->last_block) {
         const heap_block_t *next = get_next_block(block);
         MULTI_HEAP_ASSERT(next >= &heap->first_block && next <= heap->last_block, block); // Next block not in heap
-        if (is_free(block)) {
-            // Check block->next_free is valid
-            MULTI_HEAP_ASSERT(block->next_free >= &heap->first_block && block->next_free <= heap->last_block, &block->next_free);
+        if (is_free(block) && !is_first_block(heap, block) && block_data_size(block) >= MIN_LISTED_DATA_SIZE) {
+            // Check block->next_free & block->prev_free are valid
+            MULTI_HEAP_ASSERT(block->next_free == NULL ||
+                              (block->next_free > &heap->first_block && block->next_free < heap->last_block), &block->next_free);
+            MULTI_HEAP_ASSERT(block->prev_free == NULL ||
+                              (block->prev_free > &heap->first_block && block->prev_free < heap->last_block), &block->prev_free);
         }
     }
 }
 
-/* Get the first free block before 'block' in the heap. 'block' can be a free block or in use.
+/* Add a free block to the head of the free list for its size, and write its footer.
 
-   Result is always the closest free block to 'block' in the heap, that is located before 'block'. There may be multiple
-   allocated blocks between the result and 'block'.
-
-   If 'block' is free, the result's 'next_free' pointer will already point to 'block'.
-
-   Result will never be NULL, but it may be the header block heap->first_block.
+   'block' should already be marked free and have its final size. Blocks smaller than
+   MIN_LISTED_DATA_SIZE only get the footer.
 */
-static heap_block_t *get_prev_free_block(heap_t *heap, const heap_block_t *block)
+static void insert_free_block(heap_t *heap, heap_block_t *block)
 {
-    assert(!is_first_block(heap, block)); /* can't look for a block before first_block */
+    *get_footer(block) = block;
+    if (block_data_size(block) < MIN_LISTED_DATA_SIZE) {
+        return;
+    }
+    heap->free_bytes += block_data_size(block);
 
-    for (heap_block_t *b = &heap->first_block; b != NULL && b < block; b = b->next_free) {
-        MULTI_HEAP_ASSERT(is_free(b), b); // Block should be free
-        if (b->next_free == NULL || b->next_free >= block) {
-            if (is_free(block)) {
-                 /* if block is on freelist, 'b' should be the item before it. */
-                MULTI_HEAP_ASSERT(b->next_free == block, &b->next_free);
-            }
-            return b; /* b is the last free block before 'block' */
-        }
+    unsigned index = get_free_list_index(block_data_size(block));
+    heap_block_t **free_lists = get_free_lists(heap);
+
+    block->prev_free = NULL;
+    block->next_free = free_lists[index];
+    if (block->next_free != NULL) {
+        block->next_free->prev_free = block;
     }
-    abort(); /* There should always be a previous free block, even if it's heap->first_block */
+    free_lists[index] = block;
+    heap->free_lists_bitmap |= (uint64_t)1 << index;
 }
 
-/* Merge some block 'a' into the following block 'b'.
-
-   If both blocks are free, resulting block is marked free.
-   If only one block is free, resulting block is marked in use. No data is moved.
+/* Remove a free block from its free list.
 
-   This operation may fail if block 'a' is the first block or 'b' is the last block,
-   the caller should check block_data_size() to know if anything happened here or not.
+   Must be called before the size of 'block' is changed.
 */
-static heap_block_t *merge_adjacent(heap_t *heap, heap_block_t *a, heap_block_t *b)
+static void remove_free_block(heap_t *heap, heap_block_t *block)
 {
-    assert(a < b);
+    MULTI_HEAP_ASSERT(is_free(block), block); // block should be free
 
-    /* Can't merge header blocks, just return the non-header block as-is */
-    if (is_last_block(b)) {
-        return a;
+    if (block_data_size(block) < MIN_LISTED_DATA_SIZE) {
+        return; /* not on a free list */
     }
-    if (is_first_block(heap, a)) {
-        return b;
+    heap->free_bytes -= block_data_size(block);
+    if (block->prev_free != NULL) {
+        MULTI_HEAP_ASSERT(block->prev_free->next_free == block, &block->prev_free); // free list should be linked both ways
+        block->prev_free->next_free = block->next_free;
+    } else {
+        unsigned index = get_free_list_index(block_data_size(block));
+        heap_block_t **free_lists = get_free_lists(heap);
+        MULTI_HEAP_ASSERT(free_lists[index] == block, block); // block should be the head of its free list
+        free_lists[index] = block->next_free;
+        if (block->next_free == NULL) {
+            heap->free_lists_bitmap &= ~((uint64_t)1 << index);
+        }
     }
+    if (block->next_free != NULL) {
+        MULTI_HEAP_ASSERT(block->next_free->prev_free == block, &block->next_free); // free list should be linked both ways
+        block->next_free->prev_free = block->prev_free;
+    }
+}
 
-    MULTI_HEAP_ASSERT(get_next_block(a) == b, a); // Blocks should be in order
-
-    bool free = is_free(a) && is_free(b); /* merging two free blocks creates a free block */
-    if (!free && (is_free(a) || is_free(b))) {
-        /* only one of these blocks is free, so resulting block will be a used block.
-           means we need to take the free block out of the free list
-         */
-        heap_block_t *free_block = is_free(a) ? a : b;
-        heap_block_t *prev_free = get_prev_free_block(heap, free_block);
-        MULTI_HEAP_ASSERT(free_block->next_free > prev_free, &free_block->next_free); // Next free block should be after prev one
-        prev_free->next_free = free_block->next_free;
+/* Find a free block with at least 'size' bytes of data.
 
-        heap->free_bytes -= block_data_size(free_block);
-    }
+   The free list for 'size' is searched for a best fit, up to FREE_LIST_SEARCH_LIMIT blocks. Failing that, the
+   first block of the next non-empty larger free list is used, as any block there is big enough. The rest of
+   the free list for 'size' is never searched, so the time taken doesn't depend on the number of free blocks.
+   A block there which would fit is missed only if there is no larger free block at all, and it is less than a
+   quarter bigger than 'size' for all but the smallest size classes.
+*/
+static heap_block_t *find_free_block(heap_t *heap, size_t size)
+{
+    unsigned index = get_free_list_index(size);
+    heap_block_t **free_lists = get_free_lists(heap);
+    heap_block_t *best_block = NULL;
+    size_t best_size = SIZE_MAX;
+    heap_block_t *b = free_lists[index];
 
-    a->header = b->header & NEXT_BLOCK_MASK;
-    MULTI_HEAP_ASSERT(a->header != 0, a);
-    if (free) {
-        a->header |= BLOCK_FREE_FLAG;
-        if (b->next_free != NULL) {
-            MULTI_HEAP_ASSERT(b->next_free > a, &b->next_free);
-            MULTI_HEAP_ASSERT(b->next_free > b, &b->next_free);
+    for (int i = 0; b != NULL && i < FREE_LIST_SEARCH_LIMIT; b = b->next_free, i++) {
+        MULTI_HEAP_ASSERT(is_free(b), b); // block should be free
+        size_t bs = block_data_size(b);
+        if (bs >= size && bs < best_size) {
+            best_block = b;
+            best_size = bs;
+            if (bs == size) {
+                break; /* we've found a perfect sized block */
+            }
         }
-        a->next_free = b->next_free;
+    }
+    if (best_block != NULL) {
+        return best_block;
+    }
 
-        /* b's header can be put into the pool of free bytes */
-        heap->free_bytes += sizeof(a->header);
+    uint64_t larger = heap->free_lists_bitmap & ~(((uint64_t)2 << index) - 1);
+    if (larger != 0) {
+        return free_lists[__builtin_ctzll(larger)];
     }
+    return NULL;
+}
 
 #ifdef MULTI_HEAP_POISONING_SLOW
-    /* b's former block header needs to be replaced with a fill pattern */
-    multi_heap_internal_poison_fill_region(b, sizeof(heap_block_t), free);
-#endif
+/* Size of the start of a free block which holds its header and free list pointers. A free block
+   too small to be on a free list ends before that. */
+static inline size_t free_block_head_size(const heap_block_t *b)
+{
+    size_t size = (b->header & NEXT_BLOCK_MASK) - (intptr_t)b;
+    return (size < sizeof(heap_block_t)) ? size : sizeof(heap_block_t);
+}
 
-    return a;
+/* Replace the footer of a block and the header of the block following it with a fill pattern,
+   once the two blocks have been merged. */
+static void poison_merged_header(heap_block_t *b, bool is_free)
+{
+    multi_heap_internal_poison_fill_region((heap_block_t **)b - 1, sizeof(heap_block_t *) + free_block_head_size(b), is_free);
 }
+#endif
 
 /* Split a block so it can hold at least 'size' bytes of data, making any spare
    space into a new free block.
 
    'block' should be marked in-use when this function is called (implementation detail, this function
-   doesn't set the next_free pointer).
-
-   'prev_free_block' is the free block before 'block', if already known. Can be NULL if not yet known.
-   (This is a performance optimisation to avoid walking the freelist twice when possible.)
+   doesn't set the free list pointers).
 */
-static void split_if_necessary(heap_t *heap, heap_block_t *block, size_t size, heap_block_t *prev_free_block)
+static void split_if_necessary(heap_t *heap, heap_block_t *block, size_t size)
 {
     const size_t block_size = block_data_size(block);
     MULTI_HEAP_ASSERT(!is_free(block), block); // split block shouldn't be free
@@ -277,39 +403,28 @@ static void split_if_necessary(heap_t *heap, heap_block_t *block, size_t size, h
     heap_block_t *next_block = get_next_block(block);
 
     if (is_free(next_block) && !is_last_block(next_block)) {
-        /* The next block is free, just extend it upwards. */
-        new_block->header = next_block->header;
-        new_block->next_free = next_block->next_free;
-        if (prev_free_block == NULL) {
-            prev_free_block = get_prev_free_block(heap, block);
+        /* The next block is free, just extend it downwards. */
+        if (new_block == next_block) {
+            return;
         }
-        /* prev_free_block should point to the next block (which we found to be free). */
-        MULTI_HEAP_ASSERT(prev_free_block->next_free == next_block,
-                          &prev_free_block->next_free); // free blocks should be in order
-        /* Note: We have not introduced a new block header, hence the simple math. */
-        heap->free_bytes += block_size - size;
+        remove_free_block(heap, next_block);
+        intptr_t header = next_block->header;
 #ifdef MULTI_HEAP_POISONING_SLOW
-        /* next_block header needs to be replaced with a fill pattern */
-        multi_heap_internal_poison_fill_region(next_block, sizeof(heap_block_t), true /* free */);
+        /* the released space and next_block's header need to be replaced with a fill pattern */
+        multi_heap_internal_poison_fill_region(new_block, (intptr_t)next_block - (intptr_t)new_block + free_block_head_size(next_block), true /* free */);
 #endif
+        new_block->header = header;
     } else {
         /* Insert a free block between the current and the next one. */
-        if (block_data_size(block) < size + sizeof(heap_block_t)) {
+        if (block_size < size + sizeof(new_block->header) + MIN_BLOCK_DATA_SIZE) {
             /* Can't split 'block' if we're not going to get a usable free block afterwards */
             return;
         }
-        if (prev_free_block == NULL) {
-            prev_free_block = get_prev_free_block(heap, block);
-        }
-        new_block->header = block->header | BLOCK_FREE_FLAG;
-        new_block->next_free = prev_free_block->next_free;
-        /* prev_free_block should point to a free block after new_block */
-        MULTI_HEAP_ASSERT(prev_free_block->next_free > new_block,
-                          &prev_free_block->next_free); // free blocks should be in order
-        heap->free_bytes += block_data_size(new_block);
+        new_block->header = (intptr_t)next_block | BLOCK_FREE_FLAG;
+        set_prev_free(next_block, true);
     }
-    block->header = (intptr_t)new_block;
-    prev_free_block->next_free = new_block;
+    set_next_block(block, new_block);
+    insert_free_block(heap, new_block);
 }
 
 void *multi_heap_get_block_address_impl(multi_heap_block_handle_t block)
@@ -337,29 +452,36 @@ multi_heap_handle_t multi_heap_register_impl(void *start_ptr, size_t size)
         return NULL; /* 'size' is too small to fit a heap here */
     }
     heap->lock = NULL;
-    heap->last_block = (heap_block_t *)(end - sizeof(heap_block_t));
+    /* last block only has a header */
+    heap->last_block = (heap_block_t *)(end - sizeof(heap->last_block->header));
 
-    /* first 'real' (allocatable) free block goes after the heap structure */
-    heap_block_t *first_free_block = (heap_block_t *)(start + sizeof(heap_t));
-    first_free_block->header = (intptr_t)heap->last_block | BLOCK_FREE_FLAG;
-    first_free_block->next_free = heap->last_block;
+    /* first 'real' (allocatable) free block goes after the free list heads */
+    heap_block_t **free_lists = get_free_lists(heap);
+    const unsigned free_list_count = get_free_list_count(heap);
+    heap_block_t *first_free_block = (heap_block_t *)(free_lists + free_list_count);
+    if ((intptr_t)first_free_block->data + MIN_BLOCK_DATA_SIZE > (intptr_t)heap->last_block) {
+        return NULL; /* no room for the free list heads and a block */
+    }
+    memset(free_lists, 0, free_list_count * sizeof(heap_block_t *));
+    heap->free_lists_bitmap = 0;
 
     /* last block is 'free' but has a NULL next pointer */
-    heap->last_block->header = BLOCK_FREE_FLAG;
-    heap->last_block->next_free = NULL;
+    heap->last_block->header = BLOCK_FREE_FLAG | PREV_FREE_FLAG;
 
     /* first block also 'free' but has legitimate length,
        malloc will never allocate into this block. */
     heap->first_block.header = (intptr_t)first_free_block | BLOCK_FREE_FLAG;
-    heap->first_block.next_free = first_free_block;
+
+    first_free_block->header = (intptr_t)heap->last_block | BLOCK_FREE_FLAG;
+    heap->free_bytes = 0;
+    insert_free_block(heap, first_free_block);
 
     /* free bytes is:
        - total bytes in heap
-       - minus heap_t header at top (includes heap->first_block)
+       - minus heap_t header at top and the free list heads (heap->first_block)
        - minus header of first_free_block
-       - minus whole block at heap->last_block
+       - minus header at heap->last_block
     */
-    heap->free_bytes = size - sizeof(heap_t) - sizeof(first_free_block->header) - sizeof(heap_block_t);
     heap->minimum_free_bytes = heap->free_bytes;
 
     return heap;
@@ -403,15 +525,15 @@ bool multi_heap_is_free(multi_heap_block_handle_t block)
 
 void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
 {
-    heap_block_t *best_block = NULL;
-    heap_block_t *prev_free = NULL;
-    heap_block_t *prev = NULL;
-    size_t best_size = SIZE_MAX;
+    heap_block_t *best_block;
     size = ALIGN_UP(size);
 
     if (size == 0 || heap == NULL) {
         return NULL;
     }
+    if (size < MIN_LISTED_DATA_SIZE) {
+        size = MIN_LISTED_DATA_SIZE; /* so the block can go on a free list once it is freed */
+    }
 
     multi_heap_internal_lock(heap);
 
@@ -425,34 +547,22 @@ void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
         return NULL;
     }
 
-    /* Find best free block to perform the allocation in */
-    prev = &heap->first_block;
-    for (heap_block_t *b = heap->first_block.next_free; b != NULL; b = b->next_free) {
-        MULTI_HEAP_ASSERT(b > prev, &prev->next_free); // free blocks should be ascending in address
-        MULTI_HEAP_ASSERT(is_free(b), b); // block should be free
-        size_t bs = block_data_size(b);
-        if (bs >= size && bs < best_size) {
-            best_block = b;
-            best_size = bs;
-            prev_free = prev;
-            if (bs == size) {
-                break; /* we've found a perfect sized block */
-            }
-        }
-        prev = b;
-    }
+    best_block = find_free_block(heap, size);
 
     if (best_block == NULL) {
         multi_heap_internal_unlock(heap);
         return NULL; /* No room in heap */
     }
 
-    prev_free->next_free = best_block->next_free;
+    remove_free_block(heap, best_block);
+#ifdef MULTI_HEAP_POISONING_SLOW
+    /* best_block's footer is now part of the allocated data, and needs to be replaced with a fill pattern */
+    multi_heap_internal_poison_fill_region(get_footer(best_block), sizeof(heap_block_t *), true);
+#endif
     best_block->header &= ~BLOCK_FREE_FLAG;
+    set_prev_free(get_next_block(best_block), false);
 
-    heap->free_bytes -= block_data_size(best_block);
-
-    split_if_necessary(heap, best_block, size, prev_free);
+    split_if_necessary(heap, best_block, size);
 
     if (heap->free_bytes < heap->minimum_free_bytes) {
         heap->minimum_free_bytes = heap->free_bytes;
@@ -480,28 +590,34 @@ void multi_heap_free_impl(multi_heap_handle_t heap, void *p)
 
     heap_block_t *next = get_next_block(pb);
 
-    /* Update freelist pointers */
-    heap_block_t *prev_free = get_prev_free_block(heap, pb);
-    // freelist validity check
-    MULTI_HEAP_ASSERT(prev_free->next_free == NULL || prev_free->next_free > pb, &prev_free->next_free);
-    pb->next_free = prev_free->next_free;
-    prev_free->next_free = pb;
-
     /* Mark this block as free */
     pb->header |= BLOCK_FREE_FLAG;
 
-    heap->free_bytes += block_data_size(pb);
-
     /* Try and merge previous free block into this one */
-    if (get_next_block(prev_free) == pb) {
-        pb = merge_adjacent(heap, prev_free, pb);
+    if (is_prev_free(pb)) {
+        heap_block_t *prev = get_prev_free_block(pb);
+        MULTI_HEAP_ASSERT(prev > &heap->first_block && get_next_block(prev) == pb, (heap_block_t **)pb - 1); // footer should point to the previous block
+        remove_free_block(heap, prev);
+        set_next_block(prev, next);
+#ifdef MULTI_HEAP_POISONING_SLOW
+        poison_merged_header(pb, true);
+#endif
+        pb = prev;
     }
 
     /* If next block is free, try to merge the two */
-    if (is_free(next)) {
-        pb = merge_adjacent(heap, pb, next);
+    if (is_free(next) && !is_last_block(next)) {
+        remove_free_block(heap, next);
+        set_next_block(pb, get_next_block(next));
+#ifdef MULTI_HEAP_POISONING_SLOW
+        poison_merged_header(next, true);
+#endif
+        next = get_next_block(pb);
     }
 
+    insert_free_block(heap, pb);
+    set_prev_free(next, true);
+
     multi_heap_internal_unlock(heap);
 }
 
@@ -533,12 +649,16 @@ void *multi_heap_realloc_impl(multi_heap_handle_t heap, void *p, size_t size)
         return NULL;
     }
 
+    if (size < MIN_LISTED_DATA_SIZE) {
+        size = MIN_LISTED_DATA_SIZE;
+    }
+
     multi_heap_internal_lock(heap);
     result = NULL;
 
     if (size <= block_data_size(pb)) {
         // Shrinking....
-        split_if_necessary(heap, pb, size, NULL);
+        split_if_necessary(heap, pb, size);
         result = pb->data;
     }
     else if (heap->free_bytes < size - block_data_size(pb)) {
@@ -553,27 +673,34 @@ void *multi_heap_realloc_impl(multi_heap_handle_t heap, void *p, size_t size)
         heap_block_t *orig_pb = pb;
         size_t orig_size = block_data_size(orig_pb);
         heap_block_t *next = get_next_block(pb);
-        heap_block_t *prev = get_prev_free_block(heap, pb);
+        heap_block_t *prev = is_prev_free(pb) ? get_prev_free_block(pb) : NULL;
 
-        // Can only grow into the previous free block if it's adjacent
-        size_t prev_grow_size = (get_next_block(prev) == pb) ? block_data_size(prev) : 0;
+        // Growing into an adjacent block also gains its header
+        size_t next_grow_size = (is_free(next) && !is_last_block(next)) ? block_data_size(next) + sizeof(next->header) : 0;
+        size_t prev_grow_size = (prev != NULL) ? block_data_size(prev) + sizeof(pb->header) : 0;
 
-        // Can grow into next block? (we may also need to grow into 'prev' to get to our desired size)
-        if (is_free(next) && (block_data_size(pb) + block_data_size(next) + prev_grow_size >= size)) {
-            pb = merge_adjacent(heap, pb, next);
-        }
+        if (orig_size + next_grow_size + prev_grow_size >= size) {
+            if (next_grow_size > 0) {
+                remove_free_block(heap, next);
+                set_next_block(pb, get_next_block(next));
+                set_prev_free(get_next_block(pb), false);
+#ifdef MULTI_HEAP_POISONING_SLOW
+                /* next's former block header needs to be replaced with a fill pattern */
+                multi_heap_internal_poison_fill_region(next, free_block_head_size(next), false);
+#endif
+            }
 
-        // Can grow into previous block?
-        // (try this even if we're already big enough from growing into 'next', as it reduces fragmentation)
-        if (prev_grow_size > 0 && (block_data_size(pb) + prev_grow_size >= size)) {
-            pb = merge_adjacent(heap, prev, pb);
-            // this doesn't guarantee we'll be left with a big enough block, as it's
-            // possible for the merge to fail if prev == heap->first_block
-        }
+            // Grow into the previous block even if we're already big enough from growing into 'next',
+            // as it reduces fragmentation
+            if (prev_grow_size > 0) {
+                remove_free_block(heap, prev);
+                prev->header &= ~BLOCK_FREE_FLAG;
+                set_next_block(prev, get_next_block(pb));
+                pb = prev;
+            }
 
-        if (block_data_size(pb) >= size) {
             memmove(pb->data, orig_pb->data, orig_size);
-            split_if_necessary(heap, pb, size, NULL);
+            split_if_necessary(heap, pb, size);
             result = pb->data;
         }
     }
@@ -610,13 +737,12 @@ bool multi_heap_check(multi_heap_handle_t heap, bool print_errors)
 {
     bool valid = true;
     size_t total_free_bytes = 0;
+    size_t free_block_count = 0;
     assert(heap != NULL);
 
     multi_heap_internal_lock(heap);
 
     heap_block_t *prev = NULL;
-    heap_block_t *prev_free = NULL;
-    heap_block_t *expected_free = NULL;
 
     /* note: not using get_next_block() in loop, so that assertions aren't checked here */
     for(heap_block_t *b = &heap->first_block; b != NULL; b = (heap_block_t *)(b->header & NEXT_BLOCK_MASK)) {
@@ -632,29 +758,39 @@ bool multi_heap_check(multi_heap_handle_t heap, bool print_errors)
             FAIL_PRINT("CORRUPT HEAP: Block %p is outside heap (last valid block %p)\n", b, prev);
             goto done;
         }
+        if (prev != NULL && !is_first_block(heap, prev)) {
+            if (is_prev_free(b) != is_free(prev)) {
+                FAIL_PRINT("CORRUPT HEAP: Block %p previous free flag doesn't match prev block %p\n", b, prev);
+            }
+            if (is_free(prev) && *((heap_block_t **)b - 1) != prev) {
+                FAIL_PRINT("CORRUPT HEAP: Free block %p footer points to %p\n", prev, *((heap_block_t **)b - 1));
+            }
+        } else if (is_prev_free(b)) {
+            FAIL_PRINT("CORRUPT HEAP: Block %p after first block has previous free flag set\n", b);
+        }
         if (is_free(b)) {
             if (prev != NULL && is_free(prev) && !is_first_block(heap, prev) && !is_last_block(b)) {
                 FAIL_PRINT("CORRUPT HEAP: Two adjacent free blocks found, %p and %p\n", prev, b);
             }
-            if (expected_free != NULL && expected_free != b) {
-                FAIL_PRINT("CORRUPT HEAP: Prev free block %p pointed to next free %p but this free block is %p\n",
-                       prev_free, expected_free, b);
-            }
-            prev_free = b;
-            expected_free = b->next_free;
-            if (!is_first_block(heap, b)) {
+            if (!is_first_block(heap, b) && !is_last_block(b) && block_data_size(b) >= MIN_LISTED_DATA_SIZE) {
                 total_free_bytes += block_data_size(b);
+                free_block_count++;
             }
         }
         prev = b;
 
 #ifdef MULTI_HEAP_POISONING
-        if (!is_last_block(b)) {
+        heap_block_t *next = (heap_block_t *)(b->header & NEXT_BLOCK_MASK);
+        if (!is_last_block(b) && !is_first_block(heap, b) && next > b && next <= heap->last_block) {
             /* For slow heap poisoning, any block should contain correct poisoning patterns and/or fills */
             bool poison_ok;
-            if (is_free(b) && b != heap->last_block) {
-                uint32_t block_len = (intptr_t)get_next_block(b) - (intptr_t)b - sizeof(heap_block_t);
-                poison_ok = multi_heap_internal_check_block_poisoning(&b[1], block_len, true, print_errors);
+            if (is_free(b)) {
+                /* free block fill is between the free list pointers and the footer, small free blocks have none */
+                poison_ok = true;
+                if (block_data_size(b) >= MIN_LISTED_DATA_SIZE) {
+                    uint32_t block_len = (intptr_t)next - (intptr_t)b - sizeof(heap_block_t) - sizeof(heap_block_t *);
+                    poison_ok = multi_heap_internal_check_block_poisoning(&b[1], block_len, true, print_errors);
+                }
             }
             else {
                 poison_ok = multi_heap_internal_check_block_poisoning(b->data, block_data_size(b), false, print_errors);
@@ -676,6 +812,47 @@ bool multi_heap_check(multi_heap_handle_t heap, bool print_errors)
         FAIL_PRINT("CORRUPT HEAP: Expected %u free bytes counted %u\n", (unsigned)heap->free_bytes, (unsigned)total_free_bytes);
     }
 
+    /* every free block big enough should be on the free list for its size, exactly once */
+    heap_block_t **free_lists = get_free_lists(heap);
+    const unsigned free_list_count = get_free_list_count(heap);
+    size_t listed_count = 0;
+    if (free_list_count < FREE_LIST_MAX_COUNT && (heap->free_lists_bitmap >> free_list_count) != 0) {
+        FAIL_PRINT("CORRUPT HEAP: Free list bitmap 0x%08x%08x has bits above free list count %u\n",
+                   (unsigned)(heap->free_lists_bitmap >> 32), (unsigned)heap->free_lists_bitmap, free_list_count);
+    }
+    for (unsigned i = 0; i < free_list_count; i++) {
+        if (((heap->free_lists_bitmap >> i) & 1) != (free_lists[i] != NULL)) {
+            FAIL_PRINT("CORRUPT HEAP: Free list %u head %p doesn't match bitmap 0x%08x%08x\n",
+                       i, free_lists[i], (unsigned)(heap->free_lists_bitmap >> 32), (unsigned)heap->free_lists_bitmap);
+        }
+        prev = NULL;
+        for (heap_block_t *b = free_lists[i]; b != NULL; b = b->next_free) {
+            if (b <= &heap->first_block || b >= heap->last_block) {
+                FAIL_PRINT("CORRUPT HEAP: Free list %u block %p is outside heap\n", i, b);
+                goto done;
+            }
+            if (!is_free(b)) {
+                FAIL_PRINT("CORRUPT HEAP: Free list %u block %p is not free\n", i, b);
+                goto done;
+            }
+            if (b->prev_free != prev) {
+                FAIL_PRINT("CORRUPT HEAP: Free list %u block %p prev free %p expected %p\n", i, b, b->prev_free, prev);
+            }
+            if (block_data_size(b) < MIN_LISTED_DATA_SIZE || get_free_list_index(block_data_size(b)) != i) {
+                FAIL_PRINT("CORRUPT HEAP: Free block %p size 0x%08x is on wrong free list %u\n",
+                           b, (unsigned)block_data_size(b), i);
+            }
+            if (++listed_count > free_block_count) {
+                FAIL_PRINT("CORRUPT HEAP: Free lists hold more than %u free blocks\n", (unsigned)free_block_count);
+                goto done;
+            }
+            prev = b;
+        }
+    }
+    if (listed_count != free_block_count) {
+        FAIL_PRINT("CORRUPT HEAP: Expected %u blocks on free lists counted %u\n", (unsigned)free_block_count, (unsigned)listed_count);
+    }
+
  done:
     multi_heap_internal_unlock(heap);
 
@@ -687,11 +864,14 @@ void multi_heap_dump(multi_heap_handle_t heap)
     assert(heap != NULL);
 
     multi_heap_internal_lock(heap);
-    MULTI_HEAP_STDERR_PRINTF("Heap start %p end %p\nFirst free block %p\n", &heap->first_block, heap->last_block, heap->first_block.next_free);
+    MULTI_HEAP_STDERR_PRINTF("Heap start %p end %p\nFree list bitmap 0x%08x%08x\n", &heap->first_block, heap->last_block,
+                             (unsigned)(heap->free_lists_bitmap >> 32), (unsigned)heap->free_lists_bitmap);
     for(heap_block_t *b = &heap->first_block; b != NULL; b = get_next_block(b)) {
         MULTI_HEAP_STDERR_PRINTF("Block %p data size 0x%08x bytes next block %p", b, block_data_size(b), get_next_block(b));
-        if (is_free(b)) {
-            MULTI_HEAP_STDERR_PRINTF(" FREE. Next free %p\n", b->next_free);
+        if (is_free(b) && !is_first_block(heap, b) && !is_last_block(b) && block_data_size(b) >= MIN_LISTED_DATA_SIZE) {
+            MULTI_HEAP_STDERR_PRINTF(" FREE. Next free %p prev free %p\n", b->next_free, b->prev_free);
+        } else if (is_free(b) && !is_first_block(heap, b) && !is_last_block(b)) {
+            MULTI_HEAP_STDERR_PRINTF("%s", " FREE. Not listed\n");
         } else {
             MULTI_HEAP_STDERR_PRINTF("%s", "\n"); /* C macros & optional __VA_ARGS__ */
         }
@@ -726,6 +906,9 @@ void multi_heap_get_info_impl(multi_heap_handle_t heap, multi_heap_info_t *info)
     multi_heap_internal_lock(heap);
     for(heap_block_t *b = get_next_block(&heap->first_block); !is_last_block(b); b = get_next_block(b)) {
         info->total_blocks++;
+        if (is_free(b) && block_data_size(b) < MIN_LISTED_DATA_SIZE) {
+            continue; /* too small to be allocated, not counted as free space */
+        }
         if (is_free(b)) {
             size_t s = block_data_size(b);
             info->total_free_bytes += s;
@@ -5,6 +5,7 @@
 
 #include <string.h>
 #include <assert.h>
+#include <chrono>
 
 /* Insurance against accidentally using libc heap functions in tests */
 #undef free
@@ -443,6 +444,42 @@ TEST_CASE("multi_heap_realloc()", "[multi_heap]")
 #endif
 }
 
+/* The minimum allocation size and the free fragments which are not counted as free space,
+   as documented for multi_heap_malloc() & multi_heap_free_size() */
+TEST_CASE("small allocations and free fragments", "[multi_heap]")
+{
+#ifndef MULTI_HEAP_POISONING
+    uint8_t small_heap[512];
+    const size_t P = sizeof(void *);
+    multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
+
+    void *x = multi_heap_malloc(heap, 1);
+    REQUIRE( multi_heap_get_allocated_size(heap, x) == 3 * P );
+
+    void *a = multi_heap_malloc(heap, 8 * P);
+    void *b = multi_heap_malloc(heap, 8 * P);
+    REQUIRE( a != NULL );
+    REQUIRE( b != NULL );
+    multi_heap_free(heap, a);
+    size_t free_before = multi_heap_free_size(heap);
+
+    /* takes the free block of 'a', leaving a fragment with only room for the block header and one pointer */
+    void *c = multi_heap_malloc(heap, 6 * P);
+    REQUIRE( c == a );
+    REQUIRE( multi_heap_check(heap, true) );
+    REQUIRE( multi_heap_free_size(heap) == free_before - 8 * P );
+
+    multi_heap_info_t info;
+    multi_heap_get_info(heap, &info);
+    REQUIRE( info.total_free_bytes == multi_heap_free_size(heap) );
+
+    /* freeing 'c' merges the fragment back */
+    multi_heap_free(heap, c);
+    REQUIRE( multi_heap_check(heap, true) );
+    REQUIRE( multi_heap_free_size(heap) == free_before );
+#endif
+}
+
 TEST_CASE("corrupt heap block", "[multi_heap]")
 {
     uint8_t small_heap[256];
@@ -494,3 +531,68 @@ TEST_CASE("unaligned heaps", "[multi_heap]")
         }
     }
 }
+
+/* Measures multi_heap_malloc() & multi_heap_free() latency while a pool of random sized allocations
+   is freed & refilled in random order. A quarter of the pool is only allocated once and stays in place,
+   to keep the heap fragmented. */
+TEST_CASE("multi_heap allocation latency with fragmentation", "[multi_heap][benchmark]")
+{
+    static uint8_t bench_heap[128 * 1024];
+    const int NUM_POINTERS = 512;
+    const int LONG_LIVED = NUM_POINTERS / 4;
+    const int ITERATIONS = 100000;
+    typedef std::chrono::steady_clock clock;
+
+    void *p[NUM_POINTERS] = { 0 };
+    multi_heap_handle_t heap = multi_heap_register(bench_heap, sizeof(bench_heap));
+    srand(0x5EED);
+
+    uint64_t malloc_total_ns = 0, malloc_max_ns = 0, free_total_ns = 0, free_max_ns = 0;
+    unsigned malloc_count = 0, free_count = 0, malloc_failed = 0;
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        int n = rand() % NUM_POINTERS;
+        if (n < LONG_LIVED && p[n] != NULL) {
+            continue;
+        }
+        if (p[n] != NULL) {
+            auto start = clock::now();
+            multi_heap_free(heap, p[n]);
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+            free_total_ns += ns;
+            free_max_ns = (ns > free_max_ns) ? ns : free_max_ns;
+            free_count++;
+            p[n] = NULL;
+        }
+
+        /* mostly small allocations, 1 in 16 is up to 2KB */
+        size_t size = (rand() % 16 == 0) ? rand() % 2048 + 1 : rand() % 192 + 1;
+        auto start = clock::now();
+        p[n] = multi_heap_malloc(heap, size);
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        malloc_total_ns += ns;
+        malloc_max_ns = (ns > malloc_max_ns) ? ns : malloc_max_ns;
+        malloc_count++;
+        if (p[n] == NULL) {
+            malloc_failed++;
+        }
+    }
+
+    REQUIRE( multi_heap_check(heap, true) );
+
+    multi_heap_info_t info;
+    multi_heap_get_info(heap, &info);
+    printf("malloc: %u calls (%u failed), average %u ns, worst %u ns\n", malloc_count, malloc_failed,
+           (unsigned)(malloc_total_ns / malloc_count), (unsigned)malloc_max_ns);
+    printf("free: %u calls, average %u ns, worst %u ns\n", free_count,
+           (unsigned)(free_total_ns / free_count), (unsigned)free_max_ns);
+    printf("heap: %u free blocks, %u bytes free, largest free block %u bytes\n",
+           (unsigned)info.free_blocks, (unsigned)info.total_free_bytes, (unsigned)info.largest_free_block);
+
+    for (int i = 0; i < NUM_POINTERS; i++) {
+        multi_heap_free(heap, p[i]);
+    }
+    REQUIRE( multi_heap_check(heap, true) );
+    multi_heap_get_info(heap, &info);
+    REQUIRE( info.free_blocks == 1 );
+}
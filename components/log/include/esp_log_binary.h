@@ -0,0 +1,103 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __ESP_LOG_BINARY_H__
+#define __ESP_LOG_BINARY_H__
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary log records
+ *
+ * A record is a sequence of little endian 32-bit words:
+ *
+ *  - header: bits 0-7 number of argument words, bits 8-15 CPU core, bits 16-23 number of
+ *    records dropped on this core before this one (saturated at 255), bits 24-31 ESP_LOG_BINARY_SYNC
+ *  - address of the format string
+ *  - timestamp, as returned by esp_log_timestamp()
+ *  - argument words. Integer arguments take one word, 64-bit integer and floating point
+ *    arguments take two words. String arguments in flash (DROM) are stored as their address,
+ *    other strings as a word ESP_LOG_BINARY_INLINE_STRING | length followed by the characters
+ *    padded to a word boundary. NULL strings are stored as 0.
+ *
+ * tools/esp_app_trace/logbin_proc.py formats the records, using the format strings in the
+ * application ELF file.
+ */
+#define ESP_LOG_BINARY_SYNC           0xEB
+#define ESP_LOG_BINARY_INLINE_STRING  0x80000000
+#define ESP_LOG_BINARY_MAX_RECORD     64    /*!< Maximum size of a record in bytes, messages with more arguments are printed as text */
+
+/**
+ * @brief Allocate the binary log buffers
+ *
+ * One buffer of buffer_size bytes is allocated for each CPU core. After this call,
+ * install esp_log_binary_vprintf() using esp_log_set_vprintf() to start binary logging.
+ *
+ * @param buffer_size  Size of the buffer for each core, in bytes. Must be a power of two
+ *                     and at least ESP_LOG_BINARY_MAX_RECORD.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if buffer_size is invalid
+ *      - ESP_ERR_INVALID_STATE if the buffers are already allocated
+ *      - ESP_ERR_NO_MEM if out of memory
+ */
+esp_err_t esp_log_binary_init(size_t buffer_size);
+
+/**
+ * @brief vprintf-like function which stores a binary log record instead of formatting the message
+ *
+ * The record is added to the buffer of the current CPU core, without taking a lock.
+ * Pass this function to esp_log_set_vprintf() to enable binary logging.
+ *
+ * If the arguments don't fit into a record of ESP_LOG_BINARY_MAX_RECORD bytes, for example
+ * because of long strings in RAM, the message is formatted and written with vprintf() instead.
+ *
+ * @param fmt  Format string, should be a constant string which is present in the application ELF file
+ * @param ap   Format arguments
+ *
+ * @return size of the record in bytes, or -1 if the buffer of the current core is full
+ *         or the buffers are not allocated. For a message printed as text, the value
+ *         returned by vprintf().
+ */
+int esp_log_binary_vprintf(const char *fmt, va_list ap);
+
+/**
+ * @brief Read binary log records
+ *
+ * Copies as many complete records as fit into buf, and removes them from the buffers.
+ * Records are copied per CPU core, in the order they were added on that core. The data
+ * can then be sent to the host over any transport, and decoded by logbin_proc.py.
+ *
+ * @note Only one task may read the records at a time.
+ *
+ * @param buf   Destination buffer
+ * @param size  Size of buf in bytes
+ *
+ * @return number of bytes copied into buf
+ */
+size_t esp_log_binary_read(void *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ESP_LOG_BINARY_H__ */
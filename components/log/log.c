@@ -15,24 +15,31 @@
 /*
  * Log library implementation notes.
  *
- * Log library stores all tags provided to esp_log_level_set as a linked
- * list. See uncached_tag_entry_t structure.
+ * Log library stores all tags provided to esp_log_level_set in an
+ * immutable table, see log_tag_table_t structure. esp_log_level_set
+ * builds a new table with the updated level and publishes it by swapping
+ * the s_log_tag_table pointer. esp_log_write never takes a lock: it reads
+ * the current table, looks up the level and releases the table again.
  *
- * To avoid looking up log level for given tag each time message is
- * printed, this library caches pointers to tags. Because the suggested
- * way of creating tags uses one 'TAG' constant per file, this caching
- * should be effective. Cache is a binary min-heap of cached_tag_entry_t
- * items, ordering is done on 'generation' member. In this context,
- * generation is an integer which is incremented each time an operation
- * with cache is performed. When cache is full, new item is inserted in
- * place of an oldest item (that is, with smallest 'generation' value).
- * After that, bubble-down operation is performed to fix ordering in the
- * min-heap.
+ * Messages above the maximum level of the table (the highest level set for
+ * any tag, or the default level) are rejected before the table is read,
+ * so filtered-out messages cost one comparison.
  *
- * The potential problem with wrap-around of cache generation counter is
- * ignored for now. This will happen if someone happens to output more
- * than 4 billion log entries, at which point wrap-around will not be
- * the biggest problem.
+ * Readers register in one of two reader counters, selected by
+ * s_log_tag_epoch, before they read the table pointer. After publishing a
+ * new table, the writer flips the epoch and waits for the counter of the
+ * previous epoch to drain, twice, so that readers of both counters which
+ * may still hold the old table have finished before it is freed. Readers
+ * which start after a flip only count against the new epoch, so the
+ * writer can't be starved.
+ *
+ * To avoid comparing tag strings each time a message is printed, the
+ * table also caches tag pointers. Because the suggested way of creating
+ * tags uses one 'TAG' constant per file, this caching should be effective.
+ * Each table entry remembers the last tag pointer which matched it, and
+ * tags which use the default level are kept in a small cache indexed by
+ * the tag pointer. The cache slots are single words, so concurrent updates
+ * from several readers can only cost a cache miss.
  *
  */
 
@@ -50,13 +57,13 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <assert.h>
 #include <ctype.h>
 
 #include "esp_log.h"
 
-#include "sys/queue.h"
 #include "soc/soc_memory_layout.h"
 
 //print number of bytes per line for esp_log_buffer_char and esp_log_buffer_hex
@@ -64,47 +71,41 @@
 
 #ifndef BOOTLOADER_BUILD
 
-// Number of tags to be cached. Must be 2**n - 1, n >= 2.
+// Number of tag pointers using the default level to be cached.
 #define TAG_CACHE_SIZE 31
 
-// Maximum time to wait for the mutex in a logging statement.
-#define MAX_MUTEX_WAIT_MS 10
-#define MAX_MUTEX_WAIT_TICKS ((MAX_MUTEX_WAIT_MS + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS)
-
-// Uncomment this to enable consistency checks and cache statistics in this file.
-// #define LOG_BUILTIN_CHECKS
+typedef struct {
+    const char* volatile cached_tag;    // last tag pointer which matched this entry
+    const char* tag;                    // zero-terminated string, stored after the table entries
+    uint8_t level;                      // esp_log_level_t as uint8_t
+} log_tag_entry_t;
 
 typedef struct {
-    const char* tag;
-    uint32_t level : 3;
-    uint32_t generation : 29;
-} cached_tag_entry_t;
-
-typedef struct uncached_tag_entry_{
-    SLIST_ENTRY(uncached_tag_entry_) entries; 
-    uint8_t level;  // esp_log_level_t as uint8_t
-    char tag[0];    // beginning of a zero-terminated string
-} uncached_tag_entry_t;
-
-static esp_log_level_t s_log_default_level = ESP_LOG_VERBOSE;
-static SLIST_HEAD(log_tags_head , uncached_tag_entry_) s_log_tags = SLIST_HEAD_INITIALIZER(s_log_tags);
-static cached_tag_entry_t s_log_cache[TAG_CACHE_SIZE];
-static uint32_t s_log_cache_max_generation = 0;
-static uint32_t s_log_cache_entry_count = 0;
+    uint8_t default_level;              // esp_log_level_t as uint8_t
+    uint8_t max_level;                  // highest of default_level and all entry levels
+    uint16_t count;
+    const char* volatile default_cache[TAG_CACHE_SIZE]; // tag pointers known to use default_level
+    log_tag_entry_t entries[0];         // sorted by tag
+} log_tag_table_t;
+
+static log_tag_table_t s_log_default_table = {
+    .default_level = ESP_LOG_VERBOSE,
+    .max_level = ESP_LOG_VERBOSE,
+};
+static log_tag_table_t* volatile s_log_tag_table = &s_log_default_table;
+static volatile esp_log_level_t s_log_max_level = ESP_LOG_VERBOSE;
+static volatile uint32_t s_log_tag_epoch = 0;
+static volatile uint32_t s_log_tag_readers[2] = { 0, 0 };
 static vprintf_like_t s_log_print_func = &vprintf;
 static SemaphoreHandle_t s_log_mutex = NULL;
 
-#ifdef LOG_BUILTIN_CHECKS
-static uint32_t s_log_cache_misses = 0;
-#endif
-
-static inline bool get_cached_log_level(const char* tag, esp_log_level_t* level);
-static inline bool get_uncached_log_level(const char* tag, esp_log_level_t* level);
-static inline void add_to_cache(const char* tag, esp_log_level_t level);
-static void heap_bubble_down(int index);
-static inline void heap_swap(int i, int j);
+static inline void atomic_add(volatile uint32_t* addr, int32_t delta);
+static inline log_tag_table_t* acquire_tag_table(uint32_t* epoch);
+static inline void release_tag_table(uint32_t epoch);
+static inline esp_log_level_t get_log_level(log_tag_table_t* table, const char* tag);
+static log_tag_table_t* create_tag_table(const log_tag_table_t* old, const char* tag, esp_log_level_t level);
+static void publish_tag_table(log_tag_table_t* table);
 static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag);
-static inline void clear_log_level_list(void);
 
 vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
 {
@@ -127,87 +128,27 @@ void esp_log_level_set(const char* tag, esp_log_level_t level)
     }
     xSemaphoreTake(s_log_mutex, portMAX_DELAY);
 
-    // for wildcard tag, remove all linked list items and clear the cache
-    if (strcmp(tag, "*") == 0) {
-        s_log_default_level = level;
-        clear_log_level_list();
-        xSemaphoreGive(s_log_mutex);
-        return;
+    log_tag_table_t* table = create_tag_table(s_log_tag_table, tag, level);
+    if (table != NULL) {
+        publish_tag_table(table);
     }
 
-    //searching exist tag
-    uncached_tag_entry_t *it = NULL;
-    SLIST_FOREACH( it, &s_log_tags, entries ) {
-        if ( strcmp(it->tag, tag)==0 ) {
-            //one tag in the linked list match, update the level
-            it->level = level;
-            //quit with it != NULL
-            break;
-        }
-    }
-    //no exist tag, append new one
-    if ( it == NULL ) {
-        // allocate new linked list entry and append it to the head of the list
-        size_t entry_size = offsetof(uncached_tag_entry_t, tag) + strlen(tag) + 1;
-        uncached_tag_entry_t* new_entry = (uncached_tag_entry_t*) malloc(entry_size);
-        if (!new_entry) {
-            xSemaphoreGive(s_log_mutex);
-            return;
-        }
-        new_entry->level = (uint8_t) level;
-        strcpy(new_entry->tag, tag);
-        SLIST_INSERT_HEAD( &s_log_tags, new_entry, entries );
-    }
-
-    //search in the cache and update it if exist         
-    for (int i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (strcmp(s_log_cache[i].tag,tag) == 0) {
-            s_log_cache[i].level = level;
-            break;
-        }
-    }
     xSemaphoreGive(s_log_mutex);
 }
 
-void clear_log_level_list(void)
-{
-    uncached_tag_entry_t *it;
-    while((it = SLIST_FIRST(&s_log_tags)) != NULL) {
-        SLIST_REMOVE_HEAD(&s_log_tags, entries );
-        free(it);
-    }
-    s_log_cache_entry_count = 0;
-    s_log_cache_max_generation = 0;
-#ifdef LOG_BUILTIN_CHECKS
-    s_log_cache_misses = 0;
-#endif
-}
-
 void IRAM_ATTR esp_log_write(esp_log_level_t level,
         const char* tag,
         const char* format, ...)
 {
-    if (!s_log_mutex) {
-        s_log_mutex = xSemaphoreCreateMutex();
-    }
-    if (xSemaphoreTake(s_log_mutex, MAX_MUTEX_WAIT_TICKS) == pdFALSE) {
+    // Fast reject, no tag has a level which would output this message
+    if (!should_output(level, s_log_max_level)) {
         return;
     }
-    esp_log_level_t level_for_tag;
-    // Look for the tag in cache first, then in the linked list of all tags
-    if (!get_cached_log_level(tag, &level_for_tag)) {
-        if (!get_uncached_log_level(tag, &level_for_tag)) {
-            level_for_tag = s_log_default_level;
-        }
-        add_to_cache(tag, level_for_tag);
-#ifdef LOG_BUILTIN_CHECKS
-        ++s_log_cache_misses;
-#endif
-    }
-    xSemaphoreGive(s_log_mutex);
+
+    uint32_t epoch;
+    log_tag_table_t* table = acquire_tag_table(&epoch);
+    esp_log_level_t level_for_tag = get_log_level(table, tag);
+    release_tag_table(epoch);
     if (!should_output(level, level_for_tag)) {
         return;
     }
@@ -218,99 +159,153 @@ void IRAM_ATTR esp_log_write(esp_log_level_t level,
     va_end(list);
 }
 
-static inline bool get_cached_log_level(const char* tag, esp_log_level_t* level)
+static inline IRAM_ATTR void atomic_add(volatile uint32_t* addr, int32_t delta)
 {
-    // Look for `tag` in cache
-    int i;
-    for (i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (s_log_cache[i].tag == tag) {
-            break;
-        }
-    }
-    if (i == s_log_cache_entry_count) { // Not found in cache
-        return false;
-    }
-    // Return level from cache
-    *level = (esp_log_level_t) s_log_cache[i].level;
-    // If cache has been filled, start taking ordering into account
-    // (other options are: dynamically resize cache, add "dummy" entries
-    //  to the cache; this option was chosen because code is much simpler,
-    //  and the unfair behavior of cache will show it self at most once, when
-    //  it has just been filled)
-    if (s_log_cache_entry_count == TAG_CACHE_SIZE) {
-        // Update item generation
-        s_log_cache[i].generation = s_log_cache_max_generation++;
-        // Restore heap ordering
-        heap_bubble_down(i);
-    }
-    return true;
+    uint32_t old, set;
+    do {
+        old = *addr;
+        set = old + delta;
+        uxPortCompareSet(addr, old, &set);
+    } while (set != old);
 }
 
-static inline void add_to_cache(const char* tag, esp_log_level_t level)
+static inline IRAM_ATTR log_tag_table_t* acquire_tag_table(uint32_t* epoch)
 {
-    uint32_t generation = s_log_cache_max_generation++;
-    // First consider the case when cache is not filled yet.
-    // In this case, just add new entry at the end.
-    // This happens to satisfy binary min-heap ordering.
-    if (s_log_cache_entry_count < TAG_CACHE_SIZE) {
-        s_log_cache[s_log_cache_entry_count] = (cached_tag_entry_t) {
-            .generation = generation,
-            .level = level,
-            .tag = tag
-        };
-        ++s_log_cache_entry_count;
-        return;
-    }
+    *epoch = s_log_tag_epoch & 1;
+    atomic_add(&s_log_tag_readers[*epoch], 1);
+    // The table pointer must be read after the reader is counted
+    __sync_synchronize();
+    return s_log_tag_table;
+}
 
-    // Cache is full, so we replace the oldest entry (which is at index 0
-    // because this is a min-heap) with the new one, and do bubble-down
-    // operation to restore min-heap ordering.
-    s_log_cache[0] = (cached_tag_entry_t) {
-        .tag = tag,
-        .level = level,
-        .generation = generation
-    };
-    heap_bubble_down(0);
+static inline IRAM_ATTR void release_tag_table(uint32_t epoch)
+{
+    __sync_synchronize();
+    atomic_add(&s_log_tag_readers[epoch], -1);
 }
 
-static inline bool get_uncached_log_level(const char* tag, esp_log_level_t* level)
+static inline IRAM_ATTR esp_log_level_t get_log_level(log_tag_table_t* table, const char* tag)
 {
-    // Walk the linked list of all tags and see if given tag is present in the list.
-    // This is slow because tags are compared as strings.
-    uncached_tag_entry_t *it;
-    SLIST_FOREACH( it, &s_log_tags, entries ) {
-        if (strcmp(tag, it->tag) == 0) {
-            *level = it->level;
-            return true;
+    if (table->count == 0) {
+        return (esp_log_level_t) table->default_level;
+    }
+
+    // Look for `tag` pointer in the cache first
+    for (int i = 0; i < table->count; ++i) {
+        if (table->entries[i].cached_tag == tag) {
+            return (esp_log_level_t) table->entries[i].level;
+        }
+    }
+    int slot = (uintptr_t) tag % TAG_CACHE_SIZE;
+    if (table->default_cache[slot] == tag) {
+        return (esp_log_level_t) table->default_level;
+    }
+
+    // Binary search of the sorted entries. This is slower because tags are compared as strings.
+    int low = 0;
+    int high = table->count - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        int cmp = strcmp(tag, table->entries[mid].tag);
+        if (cmp == 0) {
+            table->entries[mid].cached_tag = tag;
+            return (esp_log_level_t) table->entries[mid].level;
+        } else if (cmp < 0) {
+            high = mid - 1;
+        } else {
+            low = mid + 1;
         }
     }
-    return false;
+    table->default_cache[slot] = tag;
+    return (esp_log_level_t) table->default_level;
 }
 
-static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag)
+// Create a copy of 'old' with the level of 'tag' set to 'level'. Returns NULL if out of memory.
+static log_tag_table_t* create_tag_table(const log_tag_table_t* old, const char* tag, esp_log_level_t level)
 {
-    return level_for_message <= level_for_tag;
+    // for wildcard tag, all tags use the new default level
+    bool wildcard = (strcmp(tag, "*") == 0);
+    int count = wildcard ? 0 : old->count;
+    int insert = count;
+    bool exists = false;
+    size_t strings_size = 0;
+
+    for (int i = 0; i < count; ++i) {
+        int cmp = strcmp(tag, old->entries[i].tag);
+        if (cmp == 0) {
+            exists = true;
+            insert = i;
+        } else if (cmp < 0 && insert == count) {
+            insert = i;
+        }
+        strings_size += strlen(old->entries[i].tag) + 1;
+    }
+    if (!wildcard && !exists) {
+        ++count;
+        strings_size += strlen(tag) + 1;
+    }
+
+    size_t entries_size = offsetof(log_tag_table_t, entries) + count * sizeof(log_tag_entry_t);
+    log_tag_table_t* table = (log_tag_table_t*) calloc(1, entries_size + strings_size);
+    if (!table) {
+        return NULL;
+    }
+    table->default_level = wildcard ? level : old->default_level;
+    table->max_level = table->default_level;
+    table->count = count;
+
+    char* strings = (char*) table + entries_size;
+    for (int i = 0, j = 0; i < count; ++i) {
+        const char* entry_tag;
+        uint8_t entry_level;
+        if (i == insert) {
+            entry_tag = tag;
+            entry_level = level;
+            if (exists) {
+                ++j;
+            }
+        } else {
+            entry_tag = old->entries[j].tag;
+            entry_level = old->entries[j].level;
+            ++j;
+        }
+        strcpy(strings, entry_tag);
+        table->entries[i].tag = strings;
+        table->entries[i].level = entry_level;
+        strings += strlen(entry_tag) + 1;
+        if (entry_level > table->max_level) {
+            table->max_level = entry_level;
+        }
+    }
+    return table;
 }
 
-static void heap_bubble_down(int index)
+// Replace the current table with 'table', and free the old table once no reader uses it.
+// Must be called with s_log_mutex held.
+static void publish_tag_table(log_tag_table_t* table)
 {
-    while (index < TAG_CACHE_SIZE / 2) {
-        int left_index = index * 2 + 1;
-        int right_index = left_index + 1;
-        int next = (s_log_cache[left_index].generation < s_log_cache[right_index].generation) ? left_index : right_index;
-        heap_swap(index, next);
-        index = next;
+    log_tag_table_t* old = s_log_tag_table;
+    s_log_tag_table = table;
+    s_log_max_level = (esp_log_level_t) table->max_level;
+
+    // A reader may have read the epoch before an earlier flip, so the old table
+    // can be in use by readers of either counter. New readers only see the new table.
+    for (int i = 0; i < 2; ++i) {
+        uint32_t epoch = s_log_tag_epoch & 1;
+        s_log_tag_epoch = epoch ^ 1;
+        __sync_synchronize();
+        while (s_log_tag_readers[epoch] != 0) {
+            vTaskDelay(1);
+        }
+    }
+    if (old != &s_log_default_table) {
+        free(old);
     }
 }
 
-static inline void heap_swap(int i, int j)
+static inline IRAM_ATTR bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag)
 {
-    cached_tag_entry_t tmp = s_log_cache[i];
-    s_log_cache[i] = s_log_cache[j];
-    s_log_cache[j] = tmp;
+    return level_for_message <= level_for_tag;
 }
 #endif //BOOTLOADER_BUILD
 
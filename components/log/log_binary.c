@@ -0,0 +1,279 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Binary log backend implementation notes.
+ *
+ * Each CPU core has its own ring buffer of records. Records are only added
+ * by the core which owns the buffer, with interrupts disabled on that core
+ * while the record is copied in, so tasks on the same core can't interleave
+ * and cores never wait for each other. The reader only moves the tail of a
+ * buffer, the writers only move the head.
+ *
+ * The record is encoded on the stack before interrupts are disabled, so
+ * only the copy into the ring buffer runs with interrupts disabled. Records
+ * are kept small (ESP_LOG_BINARY_MAX_RECORD) so that logging doesn't need
+ * much stack, and messages with arguments which don't fit are printed as
+ * text instead.
+ */
+
+#ifndef BOOTLOADER_BUILD
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_log_binary.h"
+#include "soc/soc_memory_layout.h"
+
+#define RECORD_HEADER_WORDS 3
+#define RECORD_MAX_WORDS (ESP_LOG_BINARY_MAX_RECORD / sizeof(uint32_t))
+
+typedef struct {
+    uint8_t *data;
+    uint32_t mask;              // buffer size - 1
+    volatile uint32_t head;     // free running byte offsets
+    volatile uint32_t tail;
+    uint32_t dropped;           // records dropped since the last stored record
+} log_binary_buffer_t;
+
+static log_binary_buffer_t s_log_binary_buffers[portNUM_PROCESSORS];
+
+// Store the argument of a %s conversion, returns the number of words used or 0 if it doesn't fit
+static size_t encode_string(uint32_t *out, size_t max_words, const char *str)
+{
+    if (max_words == 0) {
+        return 0;
+    }
+    if (str == NULL) {
+        out[0] = 0;
+        return 1;
+    }
+    if (esp_ptr_in_drom(str)) {
+        out[0] = (uint32_t) str;
+        return 1;
+    }
+    size_t len = strnlen(str, max_words * sizeof(uint32_t));
+    if (len > (max_words - 1) * sizeof(uint32_t)) {
+        return 0;
+    }
+    out[0] = ESP_LOG_BINARY_INLINE_STRING | len;
+    memcpy(&out[1], str, len);
+    memset((uint8_t *) &out[1] + len, 0, (-len) & (sizeof(uint32_t) - 1));
+    return 1 + (len + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+}
+
+// Store the arguments of fmt as words, returns the number of words used or SIZE_MAX if they don't fit
+static size_t encode_args(uint32_t *out, size_t max_words, const char *fmt, va_list ap)
+{
+    size_t n = 0;
+    const char *p = fmt;
+
+    while ((p = strchr(p, '%')) != NULL) {
+        p++;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        while (*p != 0 && strchr("-+ #0", *p) != NULL) {
+            p++;
+        }
+        // width and precision, '*' takes an int argument
+        for (int i = 0; i < 2; i++) {
+            if (*p == '*') {
+                if (n == max_words) {
+                    return SIZE_MAX;
+                }
+                out[n++] = va_arg(ap, uint32_t);
+                p++;
+            } else {
+                while (*p >= '0' && *p <= '9') {
+                    p++;
+                }
+            }
+            if (i == 0 && *p == '.') {
+                p++;
+            } else {
+                break;
+            }
+        }
+        int longs = 0;
+        while (*p != 0 && strchr("hlLqjzt", *p) != NULL) {
+            if (*p == 'l') {
+                longs++;
+            } else if (*p == 'q' || *p == 'j') {
+                longs = 2;
+            }
+            p++;
+        }
+        char conv = *p;
+        if (conv == 0) {
+            break;
+        }
+        p++;
+        if (conv == 's') {
+            size_t words = encode_string(&out[n], max_words - n, va_arg(ap, const char *));
+            if (words == 0) {
+                return SIZE_MAX;
+            }
+            n += words;
+        } else if (strchr("fFeEgGaA", conv) != NULL) {
+            if (n + 2 > max_words) {
+                return SIZE_MAX;
+            }
+            double d = va_arg(ap, double);
+            memcpy(&out[n], &d, sizeof(d));
+            n += 2;
+        } else if (longs >= 2 && strchr("diouxX", conv) != NULL) {
+            if (n + 2 > max_words) {
+                return SIZE_MAX;
+            }
+            uint64_t v = va_arg(ap, uint64_t);
+            memcpy(&out[n], &v, sizeof(v));
+            n += 2;
+        } else {
+            if (n == max_words) {
+                return SIZE_MAX;
+            }
+            out[n++] = va_arg(ap, uint32_t);
+        }
+    }
+    return n;
+}
+
+static void buffer_copy_in(log_binary_buffer_t *buffer, const void *src, size_t size)
+{
+    uint32_t offset = buffer->head & buffer->mask;
+    size_t first = buffer->mask + 1 - offset;
+    if (first > size) {
+        first = size;
+    }
+    memcpy(buffer->data + offset, src, first);
+    memcpy(buffer->data, (const uint8_t *) src + first, size - first);
+}
+
+static void buffer_copy_out(const log_binary_buffer_t *buffer, uint32_t tail, void *dst, size_t size)
+{
+    uint32_t offset = tail & buffer->mask;
+    size_t first = buffer->mask + 1 - offset;
+    if (first > size) {
+        first = size;
+    }
+    memcpy(dst, buffer->data + offset, first);
+    memcpy((uint8_t *) dst + first, buffer->data, size - first);
+}
+
+esp_err_t esp_log_binary_init(size_t buffer_size)
+{
+    if (buffer_size < ESP_LOG_BINARY_MAX_RECORD || (buffer_size & (buffer_size - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_log_binary_buffers[0].data != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t *data[portNUM_PROCESSORS];
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        data[i] = heap_caps_malloc(buffer_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (data[i] == NULL) {
+            while (i-- > 0) {
+                free(data[i]);
+            }
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        log_binary_buffer_t *buffer = &s_log_binary_buffers[i];
+        buffer->mask = buffer_size - 1;
+        buffer->head = 0;
+        buffer->tail = 0;
+        buffer->dropped = 0;
+        __sync_synchronize();
+        buffer->data = data[i];
+    }
+    return ESP_OK;
+}
+
+int esp_log_binary_vprintf(const char *fmt, va_list ap)
+{
+    uint32_t record[RECORD_MAX_WORDS];
+    va_list ap_text;
+    va_copy(ap_text, ap);
+    size_t arg_words = encode_args(&record[RECORD_HEADER_WORDS], RECORD_MAX_WORDS - RECORD_HEADER_WORDS, fmt, ap);
+    if (arg_words == SIZE_MAX) {
+        int ret = vprintf(fmt, ap_text);
+        va_end(ap_text);
+        return ret;
+    }
+    va_end(ap_text);
+    size_t words = RECORD_HEADER_WORDS + arg_words;
+    size_t size = words * sizeof(uint32_t);
+    record[1] = (uint32_t) fmt;
+    record[2] = esp_log_timestamp();
+
+    unsigned state = portENTER_CRITICAL_NESTED();
+    uint32_t core = xPortGetCoreID();
+    log_binary_buffer_t *buffer = &s_log_binary_buffers[core];
+    if (buffer->data == NULL || size > buffer->mask + 1 - (buffer->head - buffer->tail)) {
+        buffer->dropped++;
+        portEXIT_CRITICAL_NESTED(state);
+        return -1;
+    }
+    uint32_t dropped = (buffer->dropped < 0xFF) ? buffer->dropped : 0xFF;
+    record[0] = ((uint32_t) ESP_LOG_BINARY_SYNC << 24) | (dropped << 16) | (core << 8) | (words - RECORD_HEADER_WORDS);
+    buffer->dropped = 0;
+    buffer_copy_in(buffer, record, size);
+    // record data must be visible to the reader before the new head
+    __sync_synchronize();
+    buffer->head += size;
+    portEXIT_CRITICAL_NESTED(state);
+    return size;
+}
+
+size_t esp_log_binary_read(void *buf, size_t size)
+{
+    size_t total = 0;
+
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        log_binary_buffer_t *buffer = &s_log_binary_buffers[i];
+        if (buffer->data == NULL) {
+            continue;
+        }
+        uint32_t tail = buffer->tail;
+        uint32_t head = buffer->head;
+        __sync_synchronize();
+        while (tail != head) {
+            uint32_t header;
+            buffer_copy_out(buffer, tail, &header, sizeof(header));
+            size_t record_size = (RECORD_HEADER_WORDS + (header & 0xFF)) * sizeof(uint32_t);
+            if (total + record_size > size) {
+                break;
+            }
+            buffer_copy_out(buffer, tail, (uint8_t *) buf + total, record_size);
+            tail += record_size;
+            total += record_size;
+        }
+        // record data must be read before the space is released to the writers
+        __sync_synchronize();
+        buffer->tail = tail;
+    }
+    return total;
+}
+
+#endif // BOOTLOADER_BUILD
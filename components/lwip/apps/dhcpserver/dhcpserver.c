@@ -72,10 +72,26 @@
 #define DHCPS_STATE_IDLE 5
 #define DHCPS_STATE_RELEASE 6
 
-typedef struct _list_node {
-	void *pnode;
-	struct _list_node *pnext;
-} list_node;
+#define DHCPS_LEASE_SLOTS   (DHCPS_MAX_LEASE + 1)
+#define DHCPS_MAC_HASH_SIZE 32
+#define DHCPS_NO_SLOT       0xFF
+
+/* Leases are stored in the slot given by the offset of their address into
+ * the pool, so that the used addresses form a bitmap. Slots with the same
+ * MAC hash are chained for lookups by client, and a min-heap orders the
+ * slots by expiry. The lease_timer of a lease holds the coarse tick at
+ * which it expires. */
+typedef struct {
+    struct dhcps_pool pool[DHCPS_LEASE_SLOTS];
+    u32_t used[(DHCPS_LEASE_SLOTS + 31) / 32];
+    u8_t mac_head[DHCPS_MAC_HASH_SIZE];
+    u8_t mac_next[DHCPS_LEASE_SLOTS];
+    u8_t heap[DHCPS_LEASE_SLOTS];
+    u8_t heap_pos[DHCPS_LEASE_SLOTS];
+    u8_t count;
+    u32_t base;     /* host order address of slot 0 */
+    u32_t tick;
+} dhcps_lease_table_t;
 
 ////////////////////////////////////////////////////////////////////////////////////
 
@@ -88,7 +104,7 @@ static ip4_addr_t dns_server = {0};
 static ip4_addr_t client_address;        //added
 static ip4_addr_t client_address_plus;
 
-static list_node *plist = NULL;
+static dhcps_lease_table_t *leases = NULL;
 static bool renew = false;
 
 static dhcps_lease_t dhcps_poll;
@@ -192,80 +208,175 @@ void dhcps_set_option_info(u8_t op_id, void *opt_info, u32_t opt_len)
 }
 
 /******************************************************************************
- * FunctionName : node_insert_to_list
- * Description  : insert the node to the list
- * Parameters   : phead -- the head node of the list
- *                pinsert -- the insert node of the list
+ * FunctionName : dhcps_lease_table_reset
+ * Description  : remove all leases and index the slots from a pool start
+ * Parameters   : start_ip -- the first address of the pool
  * Returns      : none
 *******************************************************************************/
-static void node_insert_to_list(list_node **phead, list_node *pinsert)
+static void dhcps_lease_table_reset(ip4_addr_t start_ip)
 {
-    list_node *plist = NULL;
-    struct dhcps_pool *pdhcps_pool = NULL;
-    struct dhcps_pool *pdhcps_node = NULL;
+    memset(leases, 0x00, sizeof(dhcps_lease_table_t));
+    memset(leases->mac_head, DHCPS_NO_SLOT, sizeof(leases->mac_head));
+    leases->base = ntohl(start_ip.addr);
+}
 
-    if (*phead == NULL) {
-        *phead = pinsert;
-    } else {
-        plist = *phead;
-        pdhcps_node = pinsert->pnode;
-        pdhcps_pool = plist->pnode;
+static inline u32_t dhcps_lease_slot(u32_t addr)
+{
+    return ntohl(addr) - leases->base;
+}
 
-        if (pdhcps_node->ip.addr < pdhcps_pool->ip.addr) {
-            pinsert->pnext = plist;
-            *phead = pinsert;
-        } else {
-            while (plist->pnext != NULL) {
-                pdhcps_pool = plist->pnext->pnode;
+static inline u8_t dhcps_mac_hash(const u8_t *mac)
+{
+    u32_t hash = 0;
+    int i;
 
-                if (pdhcps_node->ip.addr < pdhcps_pool->ip.addr) {
-                    pinsert->pnext = plist->pnext;
-                    plist->pnext = pinsert;
-                    break;
-                }
+    for (i = 0; i < 6; i++) {
+        hash = hash * 31 + mac[i];
+    }
 
-                plist = plist->pnext;
-            }
+    return hash % DHCPS_MAC_HASH_SIZE;
+}
 
-            if (plist->pnext == NULL) {
-                plist->pnext = pinsert;
-            }
+static inline bool dhcps_lease_expires_before(u8_t a, u8_t b)
+{
+    s32_t diff = (s32_t)(leases->pool[a].lease_timer - leases->pool[b].lease_timer);
+
+    /* of the leases expiring together, the one with the lowest address goes first */
+    return diff < 0 || (diff == 0 && a < b);
+}
+
+/******************************************************************************
+ * FunctionName : dhcps_lease_heap_fix
+ * Description  : move a slot up or down the expiry heap to its place
+ * Parameters   : pos -- the position of the slot in the heap
+ * Returns      : none
+*******************************************************************************/
+static void dhcps_lease_heap_fix(int pos)
+{
+    u8_t slot = leases->heap[pos];
+    int child;
+
+    while (pos > 0 && dhcps_lease_expires_before(slot, leases->heap[(pos - 1) / 2])) {
+        leases->heap[pos] = leases->heap[(pos - 1) / 2];
+        leases->heap_pos[leases->heap[pos]] = pos;
+        pos = (pos - 1) / 2;
+    }
+
+    while ((child = 2 * pos + 1) < leases->count) {
+        if (child + 1 < leases->count && dhcps_lease_expires_before(leases->heap[child + 1], leases->heap[child])) {
+            child++;
+        }
+
+        if (!dhcps_lease_expires_before(leases->heap[child], slot)) {
+            break;
         }
+
+        leases->heap[pos] = leases->heap[child];
+        leases->heap_pos[leases->heap[pos]] = pos;
+        pos = child;
     }
 
-//	pinsert->pnext = NULL;
+    leases->heap[pos] = slot;
+    leases->heap_pos[slot] = pos;
 }
 
 /******************************************************************************
- * FunctionName : node_delete_from_list
- * Description  : remove the node from list
- * Parameters   : phead -- the head node of the list
- *                pdelete -- the remove node of the list
+ * FunctionName : dhcps_lease_add
+ * Description  : add a lease in the slot of its address
+ * Parameters   : slot -- the unused slot of the address
+ *                mac -- the MAC address of the client
+ *                lease_timer -- the number of coarse ticks the lease lasts
  * Returns      : none
 *******************************************************************************/
-void node_remove_from_list(list_node **phead, list_node *pdelete)
+static void dhcps_lease_add(u8_t slot, const u8_t *mac, u32_t lease_timer)
 {
-    list_node *plist = NULL;
+    struct dhcps_pool *pdhcps_pool = &leases->pool[slot];
+    u8_t hash = dhcps_mac_hash(mac);
+
+    pdhcps_pool->ip.addr = htonl(leases->base + slot);
+    memcpy(pdhcps_pool->mac, mac, sizeof(pdhcps_pool->mac));
+    pdhcps_pool->lease_timer = leases->tick + lease_timer;
+
+    leases->used[slot / 32] |= 1U << (slot % 32);
+    leases->mac_next[slot] = leases->mac_head[hash];
+    leases->mac_head[hash] = slot;
+    leases->heap[leases->count] = slot;
+    dhcps_lease_heap_fix(leases->count++);
+}
 
-    plist = *phead;
+/******************************************************************************
+ * FunctionName : dhcps_lease_remove
+ * Description  : remove the lease of a slot
+ * Parameters   : slot -- the used slot
+ * Returns      : none
+*******************************************************************************/
+static void dhcps_lease_remove(u8_t slot)
+{
+    u8_t *link = &leases->mac_head[dhcps_mac_hash(leases->pool[slot].mac)];
+    int pos = leases->heap_pos[slot];
 
-    if (plist == NULL) {
-        *phead = NULL;
-    } else {
-        if (plist == pdelete) {
-            *phead = plist->pnext;
-            pdelete->pnext = NULL;
-        } else {
-            while (plist != NULL) {
-                if (plist->pnext == pdelete) {
-                    plist->pnext = pdelete->pnext;
-                    pdelete->pnext = NULL;
-                }
+    while (*link != slot) {
+        link = &leases->mac_next[*link];
+    }
 
-                plist = plist->pnext;
-            }
+    *link = leases->mac_next[slot];
+    leases->used[slot / 32] &= ~(1U << (slot % 32));
+
+    if (pos != --leases->count) {
+        leases->heap[pos] = leases->heap[leases->count];
+        dhcps_lease_heap_fix(pos);
+    }
+}
+
+/******************************************************************************
+ * FunctionName : dhcps_lease_find
+ * Description  : search the lease of a client
+ * Parameters   : mac -- the MAC address of the client
+ * Returns      : the slot of the lease, DHCPS_NO_SLOT if there is none
+*******************************************************************************/
+static u8_t dhcps_lease_find(const u8_t *mac)
+{
+    u8_t slot;
+
+    for (slot = leases->mac_head[dhcps_mac_hash(mac)]; slot != DHCPS_NO_SLOT; slot = leases->mac_next[slot]) {
+        if (memcmp(leases->pool[slot].mac, mac, sizeof(leases->pool[slot].mac)) == 0) {
+            break;
+        }
+    }
+
+    return slot;
+}
+
+/******************************************************************************
+ * FunctionName : dhcps_lease_next_free
+ * Description  : search the first address without a lease
+ * Parameters   : addr -- the address to start from
+ *                limit -- the address to stop at
+ * Returns      : the first unused address from addr, limit if all addresses
+ *                from addr up to limit are used
+*******************************************************************************/
+static u32_t dhcps_lease_next_free(u32_t addr, u32_t limit)
+{
+    u32_t from = ntohl(addr);
+    u32_t to = ntohl(limit);
+    u32_t slot, unused;
+
+    if (from >= to) {
+        return addr;
+    }
+
+    while (from < to && (slot = from - leases->base) < DHCPS_LEASE_SLOTS) {
+        unused = ~leases->used[slot / 32] >> (slot % 32);
+
+        if (unused != 0) {
+            from += __builtin_ctz(unused);
+            break;
         }
+
+        from += 32 - slot % 32;
     }
+
+    return from < to ? htonl(from) : limit;
 }
 
 /******************************************************************************
@@ -814,95 +925,64 @@ static s16_t parse_msg(struct dhcps_msg *m, u16_t len)
 #if DHCPS_DEBUG
         DHCPS_LOG("dhcps: len = %d\n", len);
 #endif
-        ip4_addr_t addr_tmp;
-
-        struct dhcps_pool *pdhcps_pool = NULL;
-        list_node *pnode = NULL;
-        list_node *pback_node = NULL;
         ip4_addr_t first_address;
-        bool flag = false;
+        u8_t slot = DHCPS_NO_SLOT;
 
-        first_address.addr = dhcps_poll.start_ip.addr;
         client_address.addr = client_address_plus.addr;
         renew = false;
 
-        if (plist != NULL) {
-            for (pback_node = plist; pback_node != NULL; pback_node = pback_node->pnext) {
-                pdhcps_pool = pback_node->pnode;
-
-                if (memcmp(pdhcps_pool->mac, m->chaddr, sizeof(pdhcps_pool->mac)) == 0) {
-                    if (memcmp(&pdhcps_pool->ip.addr, m->ciaddr, sizeof(pdhcps_pool->ip.addr)) == 0) {
-                        renew = true;
-                    }
-
-                    client_address.addr = pdhcps_pool->ip.addr;
-                    pdhcps_pool->lease_timer = lease_timer;
-                    pnode = pback_node;
-                    goto POOL_CHECK;
-                } else if (pdhcps_pool->ip.addr == client_address_plus.addr) {
-                    addr_tmp.addr = htonl(client_address_plus.addr);
-                    addr_tmp.addr++;
-                    client_address_plus.addr = htonl(addr_tmp.addr);
-                    client_address.addr = client_address_plus.addr;
-                }
+        if (leases == NULL) {
+            return 4;
+        }
+
+        if (leases->count > 0) {
+            slot = dhcps_lease_find(m->chaddr);
+
+            if (slot != DHCPS_NO_SLOT) {
+                struct dhcps_pool *pdhcps_pool = &leases->pool[slot];
 
-                if (flag == false) { // search the fisrt unused ip
-                    if (first_address.addr < pdhcps_pool->ip.addr) {
-                        flag = true;
-                    } else {
-                        addr_tmp.addr = htonl(first_address.addr);
-                        addr_tmp.addr++;
-                        first_address.addr = htonl(addr_tmp.addr);
-                    }
+                if (memcmp(&pdhcps_pool->ip.addr, m->ciaddr, sizeof(pdhcps_pool->ip.addr)) == 0) {
+                    renew = true;
                 }
+
+                /* skip the used addresses below the lease, as a scan of the pool up to it would */
+                client_address_plus.addr = dhcps_lease_next_free(client_address_plus.addr, pdhcps_pool->ip.addr);
+                client_address.addr = pdhcps_pool->ip.addr;
+                pdhcps_pool->lease_timer = leases->tick + lease_timer;
+                dhcps_lease_heap_fix(leases->heap_pos[slot]);
+                goto POOL_CHECK;
             }
+
+            client_address_plus.addr = dhcps_lease_next_free(client_address_plus.addr, IPADDR_NONE);
+            client_address.addr = client_address_plus.addr;
         } else {
             client_address.addr = dhcps_poll.start_ip.addr;
         }
 
+        first_address.addr = dhcps_lease_next_free(dhcps_poll.start_ip.addr, IPADDR_NONE);
+
         if (client_address_plus.addr > dhcps_poll.end_ip.addr) {
             client_address.addr = first_address.addr;
         }
 
-        if (client_address.addr > dhcps_poll.end_ip.addr) {
+        if ((client_address.addr > dhcps_poll.end_ip.addr) || (dhcps_lease_slot(client_address.addr) >= DHCPS_LEASE_SLOTS)) {
             client_address_plus.addr = dhcps_poll.start_ip.addr;
-            pdhcps_pool = NULL;
-            pnode = NULL;
         } else {
-            pdhcps_pool = (struct dhcps_pool *)mem_malloc(sizeof(struct dhcps_pool));
-            memset(pdhcps_pool , 0x00 , sizeof(struct dhcps_pool));
-
-            pdhcps_pool->ip.addr = client_address.addr;
-            memcpy(pdhcps_pool->mac, m->chaddr, sizeof(pdhcps_pool->mac));
-            pdhcps_pool->lease_timer = lease_timer;
-            pnode = (list_node *)mem_malloc(sizeof(list_node));
-            memset(pnode , 0x00 , sizeof(list_node));
-
-            pnode->pnode = pdhcps_pool;
-            pnode->pnext = NULL;
-            node_insert_to_list(&plist, pnode);
+            slot = dhcps_lease_slot(client_address.addr);
+            dhcps_lease_add(slot, m->chaddr, lease_timer);
 
             if (client_address.addr == dhcps_poll.end_ip.addr) {
                 client_address_plus.addr = dhcps_poll.start_ip.addr;
             } else {
-                addr_tmp.addr = htonl(client_address.addr);
-                addr_tmp.addr++;
-                client_address_plus.addr = htonl(addr_tmp.addr);
+                client_address_plus.addr = htonl(ntohl(client_address.addr) + 1);
             }
         }
 
 POOL_CHECK:
 
         if ((client_address.addr > dhcps_poll.end_ip.addr) || (ip4_addr_isany(&client_address))) {
-            if (pnode != NULL) {
-                node_remove_from_list(&plist, pnode);
-                free(pnode);
-                pnode = NULL;
-            }
-
-            if (pdhcps_pool != NULL) {
-                free(pdhcps_pool);
-                pdhcps_pool = NULL;
+            if (slot != DHCPS_NO_SLOT) {
+                dhcps_lease_remove(slot);
             }
 
             return 4;
@@ -911,15 +991,8 @@ POOL_CHECK:
         s16_t ret = parse_options(&m->options[4], len);;
 
         if (ret == DHCPS_STATE_RELEASE) {
-            if (pnode != NULL) {
-                node_remove_from_list(&plist, pnode);
-                free(pnode);
-                pnode = NULL;
-            }
-
-            if (pdhcps_pool != NULL) {
-                free(pdhcps_pool);
-                pdhcps_pool = NULL;
+            if (slot != DHCPS_NO_SLOT) {
+                dhcps_lease_remove(slot);
             }
 
             memset(&client_address, 0x0, sizeof(client_address));
@@ -1156,6 +1229,18 @@ void dhcps_start(struct netif *netif, ip4_addr_t ip)
 
     client_address_plus.addr = dhcps_poll.start_ip.addr;
 
+    if (leases == NULL) {
+        leases = (dhcps_lease_table_t *)mem_malloc(sizeof(dhcps_lease_table_t));
+
+        if (leases != NULL) {
+            dhcps_lease_table_reset(dhcps_poll.start_ip);
+        } else {
+            DHCPS_LOG("dhcps_start(): could not allocate leases\n");
+        }
+    } else if (dhcps_lease_slot(dhcps_poll.start_ip.addr) != 0) {
+        dhcps_lease_table_reset(dhcps_poll.start_ip);
+    }
+
     udp_bind(pcb_dhcps, &netif->ip_addr, DHCPS_SERVER_PORT);
     udp_recv(pcb_dhcps, handle_dhcp, NULL);
 #if DHCPS_DEBUG
@@ -1185,57 +1270,12 @@ void dhcps_stop(struct netif *netif)
         apnetif->dhcps_pcb = NULL;
     }
 
-    list_node *pnode = NULL;
-    list_node *pback_node = NULL;
-    pnode = plist;
-
-    while (pnode != NULL) {
-        pback_node = pnode;
-        pnode = pback_node->pnext;
-        node_remove_from_list(&plist, pback_node);
-        free(pback_node->pnode);
-        pback_node->pnode = NULL;
-        free(pback_node);
-        pback_node = NULL;
+    if (leases != NULL) {
+        mem_free(leases);
+        leases = NULL;
     }
 }
 
-/******************************************************************************
- * FunctionName : kill_oldest_dhcps_pool
- * Description  : remove the oldest node from list
- * Parameters   : none
- * Returns      : none
-*******************************************************************************/
-static void kill_oldest_dhcps_pool(void)
-{
-    list_node *pre = NULL, *p = NULL;
-    list_node *minpre = NULL, *minp = NULL;
-    struct dhcps_pool *pdhcps_pool = NULL, *pmin_pool = NULL;
-    pre = plist;
-    p = pre->pnext;
-    minpre = pre;
-    minp = p;
-
-    while (p != NULL) {
-        pdhcps_pool = p->pnode;
-        pmin_pool = minp->pnode;
-
-        if (pdhcps_pool->lease_timer < pmin_pool->lease_timer) {
-            minp = p;
-            minpre = pre;
-        }
-
-        pre = p;
-        p = p->pnext;
-    }
-
-    minpre->pnext = minp->pnext;
-    free(minp->pnode);
-    minp->pnode = NULL;
-    free(minp);
-    minp = NULL;
-}
-
 /******************************************************************************
  * FunctionName : dhcps_coarse_tmr
  * Description  : the lease time count
@@ -1244,32 +1284,19 @@ static void kill_oldest_dhcps_pool(void)
 *******************************************************************************/
 void dhcps_coarse_tmr(void)
 {
-    u8_t num_dhcps_pool = 0;
-    list_node *pback_node = NULL;
-    list_node *pnode = NULL;
-    struct dhcps_pool *pdhcps_pool = NULL;
-    pnode = plist;
-
-    while (pnode != NULL) {
-        pdhcps_pool = pnode->pnode;
-        pdhcps_pool->lease_timer --;
-
-        if (pdhcps_pool->lease_timer == 0) {
-            pback_node = pnode;
-            pnode = pback_node->pnext;
-            node_remove_from_list(&plist, pback_node);
-            free(pback_node->pnode);
-            pback_node->pnode = NULL;
-            free(pback_node);
-            pback_node = NULL;
-        } else {
-            pnode = pnode ->pnext;
-            num_dhcps_pool ++;
-        }
+    if (leases == NULL) {
+        return;
     }
 
-    if (num_dhcps_pool > MAX_STATION_NUM) {
-        kill_oldest_dhcps_pool();
+    leases->tick++;
+
+    while (leases->count > 0 && (s32_t)(leases->pool[leases->heap[0]].lease_timer - leases->tick) <= 0) {
+        dhcps_lease_remove(leases->heap[0]);
+    }
+
+    /* remove the oldest lease */
+    if (leases->count > MAX_STATION_NUM) {
+        dhcps_lease_remove(leases->heap[0]);
     }
 }
 
@@ -1282,21 +1309,14 @@ void dhcps_coarse_tmr(void)
 *******************************************************************************/
 bool dhcp_search_ip_on_mac(u8_t *mac, ip4_addr_t *ip)
 {
-    struct dhcps_pool *pdhcps_pool = NULL;
-    list_node *pback_node = NULL;
-    bool ret = false;
+    u8_t slot;
 
-    for (pback_node = plist; pback_node != NULL; pback_node = pback_node->pnext) {
-        pdhcps_pool = pback_node->pnode;
-
-        if (memcmp(pdhcps_pool->mac, mac, sizeof(pdhcps_pool->mac)) == 0) {
-            memcpy(&ip->addr, &pdhcps_pool->ip.addr, sizeof(pdhcps_pool->ip.addr));
-            ret = true;
-            break;
-        }
+    if (leases == NULL || (slot = dhcps_lease_find(mac)) == DHCPS_NO_SLOT) {
+        return false;
     }
 
-    return ret;
+    memcpy(&ip->addr, &leases->pool[slot].ip.addr, sizeof(ip->addr));
+    return true;
 }
 
 /******************************************************************************
@@ -0,0 +1,61 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef _TX_CHAIN_LWIP_IF_H_
+#define _TX_CHAIN_LWIP_IF_H_
+
+#include "lwip/pbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest pbuf chain the netifs pass to a driver buffer by buffer, longer ones are copied */
+#define TX_CHAIN_MAX_SEGMENTS   8
+
+/**
+ * @brief Get the buffers of a pbuf chain to be transmitted
+ *
+ * @param p the chain
+ * @param bufs array of TX_CHAIN_MAX_SEGMENTS payload pointers to fill
+ * @param lengths array of TX_CHAIN_MAX_SEGMENTS payload lengths to fill
+ *
+ * @return number of buffers, or 0 if the chain is longer than TX_CHAIN_MAX_SEGMENTS
+ */
+u32_t tx_chain_segments(struct pbuf *p, uint8_t **bufs, uint32_t *lengths);
+
+/**
+ * @brief Copy a pbuf chain to be transmitted into a single pbuf
+ *
+ * Each call is counted by tx_chain_copy_count()
+ *
+ * @param p the chain
+ *
+ * @return new pbuf holding the whole frame, or NULL if out of memory
+ */
+struct pbuf *tx_chain_flatten(struct pbuf *p);
+
+/**
+ * @brief Get the number of frames which had to be copied into a single buffer to be transmitted
+ *
+ * @return number of tx_chain_flatten() calls since startup
+ */
+u32_t tx_chain_copy_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*  _TX_CHAIN_LWIP_IF_H_ */
@@ -45,6 +45,7 @@
 #include "lwip/snmp.h"
 #include "lwip/ethip6.h"
 #include "netif/etharp.h"
+#include "netif/tx_chain.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -117,21 +118,25 @@ static err_t ethernet_low_level_output(struct netif *netif, struct pbuf *p)
     if (q->next == NULL) {
         ret = esp_eth_transmit(eth_handle, q->payload, q->len);
     } else {
-        LWIP_DEBUGF(PBUF_DEBUG, ("low_level_output: pbuf is a list, application may has bug"));
-        q = pbuf_alloc(PBUF_RAW_TX, p->tot_len, PBUF_RAM);
-        if (q != NULL) {
-#if ESP_LWIP
-            /* This pbuf RAM was not allocated on layer2, no extra free operation needed in pbuf_free */
-            q->l2_owner = NULL;
-            q->l2_buf = NULL;
-#endif
-            pbuf_copy(q, p);
+        /* let the MAC gather the chain into its DMA buffers, if it can */
+        uint8_t *bufs[TX_CHAIN_MAX_SEGMENTS];
+        uint32_t lengths[TX_CHAIN_MAX_SEGMENTS];
+        uint32_t count = tx_chain_segments(p, bufs, lengths);
+        if (count) {
+            ret = esp_eth_transmit_multiple_buf(eth_handle, bufs, lengths, count);
         } else {
-            return ERR_MEM;
+            ret = ESP_ERR_NOT_SUPPORTED;
+        }
+        if (ret == ESP_ERR_NOT_SUPPORTED) {
+            LWIP_DEBUGF(PBUF_DEBUG, ("low_level_output: pbuf is a list, copying it"));
+            q = tx_chain_flatten(p);
+            if (q == NULL) {
+                return ERR_MEM;
+            }
+            ret = esp_eth_transmit(eth_handle, q->payload, q->len);
+            /* content in payload has been copied to DMA buffer, it's safe to free pbuf now */
+            pbuf_free(q);
         }
-        ret = esp_eth_transmit(eth_handle, q->payload, q->len);
-        /* content in payload has been copied to DMA buffer, it's safe to free pbuf now */
-        pbuf_free(q);
     }
     /* Check error */
     if (ret != ESP_OK) {
@@ -9,7 +9,9 @@
 #include "lwip/ethip6.h"
 #include "netif/etharp.h"
 #include "netif/wlanif.h"
+#include "netif/tx_chain.h"
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -17,19 +19,49 @@
 
 static struct netif *g_last_netif = NULL;
 
+/* chained frames alternate between the gathering and the copying path, so that tests cover both */
+static bool g_tx_chain_copy = false;
+
 
 err_t nettestif_output(struct netif *netif, struct pbuf *p)
 {
-  int i;
-  char *dat = p->payload;
+  uint8_t *bufs[TX_CHAIN_MAX_SEGMENTS];
+  uint32_t lengths[TX_CHAIN_MAX_SEGMENTS];
+  uint32_t count = 0;
+  uint32_t i, j;
+  struct pbuf *q = NULL;
+
+  if (p->next != NULL) {
+    if (!g_tx_chain_copy) {
+      count = tx_chain_segments(p, bufs, lengths);
+    }
+    g_tx_chain_copy = !g_tx_chain_copy;
+  }
+  if (count == 0) {
+    if (p->next != NULL) {
+      q = tx_chain_flatten(p);
+      if (q == NULL) {
+        return ERR_MEM;
+      }
+      p = q;
+    }
+    bufs[0] = p->payload;
+    lengths[0] = p->len;
+    count = 1;
+  }
 
   /* output the packet to stdout */
   printf("\nPacketOut:[");
-  for (i=0; i<p->len; i++) {
-    printf("%02x", *dat++);
+  for (i=0; i<count; i++) {
+    for (j=0; j<lengths[i]; j++) {
+      printf("%02x", bufs[i][j]);
+    }
   }
   printf("]\n");
 
+  if (q != NULL) {
+    pbuf_free(q);
+  }
   return ERR_OK;
 }
 
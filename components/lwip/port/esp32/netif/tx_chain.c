@@ -0,0 +1,62 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "netif/tx_chain.h"
+
+/* Frames are transmitted from the TCP/IP thread, so no locking is needed */
+static u32_t s_tx_copy_count = 0;
+
+u32_t tx_chain_segments(struct pbuf *p, uint8_t **bufs, uint32_t *lengths)
+{
+  u32_t count = 0;
+  struct pbuf *q;
+
+  for (q = p; q != NULL; q = q->next) {
+    if (count == TX_CHAIN_MAX_SEGMENTS) {
+      return 0;
+    }
+    bufs[count] = (uint8_t *)q->payload;
+    lengths[count] = q->len;
+    count++;
+    if (q->len == q->tot_len) {
+      /* last pbuf of this frame */
+      break;
+    }
+  }
+  return count;
+}
+
+struct pbuf *tx_chain_flatten(struct pbuf *p)
+{
+  struct pbuf *q = pbuf_alloc(PBUF_RAW_TX, p->tot_len, PBUF_RAM);
+
+  if (q == NULL) {
+    return NULL;
+  }
+#if ESP_LWIP
+  /* This pbuf RAM was not allocated on layer2, no extra free operation needed in pbuf_free */
+  q->l2_owner = NULL;
+  q->l2_buf = NULL;
+#endif
+  pbuf_copy(q, p);
+  s_tx_copy_count++;
+  return q;
+}
+
+u32_t tx_chain_copy_count(void)
+{
+  return s_tx_copy_count;
+}
@@ -46,6 +46,7 @@
 #include "lwip/ethip6.h"
 #include "netif/etharp.h"
 #include "netif/wlanif.h"
+#include "netif/tx_chain.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -115,12 +116,10 @@ low_level_output(struct netif *netif, struct pbuf *p)
   if(q->next == NULL) {
     ret = esp_wifi_internal_tx(wifi_if, q->payload, q->len);
   } else {
-    LWIP_DEBUGF(PBUF_DEBUG, ("low_level_output: pbuf is a list, application may has bug"));
-    q = pbuf_alloc(PBUF_RAW_TX, p->tot_len, PBUF_RAM);
-    if (q != NULL) {
-      q->l2_owner = NULL;
-      pbuf_copy(q, p);
-    } else {
+    /* the Wi-Fi driver takes a frame from a single buffer only */
+    LWIP_DEBUGF(PBUF_DEBUG, ("low_level_output: pbuf is a list, copying it"));
+    q = tx_chain_flatten(p);
+    if (q == NULL) {
       return ERR_MEM;
     }
     ret = esp_wifi_internal_tx(wifi_if, q->payload, q->len);
@@ -230,8 +230,14 @@ err_t udp_sendto_if_src(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *ds
     return ESP_OK;
 }
 
+// Set to make mem_malloc() fail, for testing out of memory handling
+bool mem_malloc_fails = false;
+
 void * mem_malloc(mem_size_t size)
 {
+    if (mem_malloc_fails) {
+        return NULL;
+    }
     return malloc(size);
 }
 
@@ -0,0 +1,201 @@
+//
+// Leases addresses of a whole pool to many clients, and measures the time
+// the server takes to handle their renewals, lookups and lease timer
+//
+#include "no_warn_host.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "tcpip_adapter.h"
+#include "dhcpserver/dhcpserver.h"
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#define CLIENTS_NUM     DHCPS_MAX_LEASE
+#define BENCH_ROUNDS    200
+
+#define DHCPDISCOVER    1
+#define DHCPREQUEST     3
+#define DHCPRELEASE     7
+
+#define CHECK(cond) do { if (!(cond)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+const ip_addr_t ip_addr_any;
+ip4_addr_t server_ip;
+struct netif mynetif;
+
+static int failures = 0;
+static u8_t acked_ip[4];
+static int acked;
+
+// Dependency injected static function to pass the packet into parser
+void dhcp_test_handle_dhcp(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
+void dhcp_test_init_di(void);
+void dhcps_coarse_tmr(void);
+
+// Network mock switch to fail memory allocations
+extern bool mem_malloc_fails;
+
+// dhcps callback
+void dhcp_test_dhcps_cb (u8_t client_ip[4])
+{
+    memcpy(acked_ip, client_ip, sizeof(acked_ip));
+    acked++;
+}
+
+static void client_mac(int client, u8_t mac[6])
+{
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = 0x5e;
+    mac[3] = client >> 16;
+    mac[4] = client >> 8;
+    mac[5] = client;
+}
+
+static void send_msg(int client, u8_t type, const u8_t ciaddr[4], const u8_t requested[4])
+{
+    static const u8_t magic_cookie[4] = { 99, 130, 83, 99 };
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, sizeof(struct dhcps_msg), PBUF_POOL);
+    struct dhcps_msg *m = p->payload;
+    u8_t *opt;
+
+    memset(m, 0, sizeof(*m));
+    m->op = 1;
+    m->htype = 1;
+    m->hlen = 6;
+    client_mac(client, m->chaddr);
+    if (ciaddr) {
+        memcpy(m->ciaddr, ciaddr, sizeof(m->ciaddr));
+    }
+    memcpy(m->options, magic_cookie, sizeof(magic_cookie));
+    opt = &m->options[4];
+    *opt++ = 53;
+    *opt++ = 1;
+    *opt++ = type;
+    if (requested) {
+        *opt++ = 50;
+        *opt++ = 4;
+        memcpy(opt, requested, 4);
+        opt += 4;
+    }
+    *opt++ = 255;
+
+    acked = 0;
+    dhcp_test_handle_dhcp(NULL, NULL, p, &ip_addr_any, 68);
+}
+
+static bool client_ip(int client, ip4_addr_t *ip)
+{
+    u8_t mac[6];
+    client_mac(client, mac);
+    return dhcp_search_ip_on_mac(mac, ip);
+}
+
+static int leases_num(void)
+{
+    ip4_addr_t ip;
+    int i, n = 0;
+    for (i = 0; i < CLIENTS_NUM; i++) {
+        n += client_ip(i, &ip);
+    }
+    return n;
+}
+
+static double elapsed_us(const struct timespec *start, int count)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec)) / count / 1000;
+}
+
+//
+// Test starts here
+//
+int main(int argc, char** argv)
+{
+    static u8_t leased[CLIENTS_NUM][4];
+    static const u8_t pool_ip[4] = { 192, 168, 4, 2 };
+    struct timespec start;
+    ip4_addr_t ip;
+    int i, round;
+
+    dhcp_test_init_di();
+
+    IP4_ADDR(&server_ip, 192,168,4,1);
+    dhcps_set_new_lease_cb(dhcp_test_dhcps_cb);
+
+    // Without memory for the lease table no address is leased
+    mem_malloc_fails = true;
+    dhcps_start(&mynetif, server_ip);
+    mem_malloc_fails = false;
+    send_msg(0, DHCPDISCOVER, NULL, NULL);
+    CHECK(!client_ip(0, &ip));
+    send_msg(0, DHCPREQUEST, NULL, pool_ip);
+    CHECK(acked == 0 && !client_ip(0, &ip));
+    dhcps_coarse_tmr();
+    dhcps_stop(&mynetif);
+
+    dhcps_start(&mynetif, server_ip);
+
+    // Every client of the pool gets a distinct address
+    for (i = 0; i < CLIENTS_NUM; i++) {
+        send_msg(i, DHCPDISCOVER, NULL, NULL);
+        CHECK(client_ip(i, &ip));
+        memcpy(leased[i], &ip.addr, sizeof(leased[i]));
+        send_msg(i, DHCPREQUEST, NULL, leased[i]);
+        CHECK(acked == 1 && memcmp(acked_ip, leased[i], 4) == 0);
+        CHECK(i == 0 || memcmp(leased[i], leased[i - 1], 4) != 0);
+    }
+    CHECK(leases_num() == CLIENTS_NUM);
+
+    // The pool is exhausted for a new client
+    send_msg(CLIENTS_NUM, DHCPDISCOVER, NULL, NULL);
+    CHECK(!client_ip(CLIENTS_NUM, &ip));
+
+    // Renewals keep the addresses, a released address goes to the next client
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        for (i = 0; i < CLIENTS_NUM; i++) {
+            send_msg(i, DHCPREQUEST, leased[i], NULL);
+            CHECK(acked == 1 && memcmp(acked_ip, leased[i], 4) == 0);
+        }
+    }
+    printf("%d clients: renewal %.2f us per packet", CLIENTS_NUM, elapsed_us(&start, BENCH_ROUNDS * CLIENTS_NUM));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        CHECK(leases_num() == CLIENTS_NUM);
+    }
+    printf(", lookup %.2f us", elapsed_us(&start, BENCH_ROUNDS * CLIENTS_NUM));
+
+    send_msg(CLIENTS_NUM / 2, DHCPRELEASE, leased[CLIENTS_NUM / 2], NULL);
+    CHECK(!client_ip(CLIENTS_NUM / 2, &ip));
+    send_msg(CLIENTS_NUM, DHCPDISCOVER, NULL, NULL);
+    CHECK(client_ip(CLIENTS_NUM, &ip) && memcmp(&ip.addr, leased[CLIENTS_NUM / 2], 4) == 0);
+    send_msg(CLIENTS_NUM, DHCPRELEASE, leased[CLIENTS_NUM / 2], NULL);
+
+    // The lease timer removes the oldest leases above the station limit, one per tick
+    for (i = 0; i < CLIENTS_NUM; i++) {
+        if (i != CLIENTS_NUM / 2) {
+            send_msg(i, DHCPREQUEST, leased[i], NULL);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < CLIENTS_NUM; i++) {
+        dhcps_coarse_tmr();
+    }
+    printf(", lease timer %.2f us per tick\n", elapsed_us(&start, CLIENTS_NUM));
+    CHECK(leases_num() == CONFIG_LWIP_DHCPS_MAX_STATION_NUM);
+    CHECK(client_ip(CLIENTS_NUM - 1, &ip) && !client_ip(0, &ip));
+
+    // The remaining leases expire with the lease time
+    for (i = 0; i < DHCPS_LEASE_TIME_DEF * DHCPS_LEASE_UNIT; i++) {
+        dhcps_coarse_tmr();
+    }
+    CHECK(leases_num() == 0);
+
+    dhcps_stop(&mynetif);
+    printf("DHCP server lease test %s\n", failures ? "failed" : "passed");
+    return failures ? 1 : 0;
+}
@@ -17,6 +17,7 @@
 #include "mdns_networking.h"
 #include "esp_log.h"
 #include <string.h>
+#include <ctype.h>
 
 #ifdef MDNS_ENABLE_DEBUG
 void mdns_debug_packet(const uint8_t * data, size_t len);
@@ -29,15 +30,24 @@ mdns_server_t * _mdns_server = NULL;
 
 static const char *TAG = "MDNS";
 
+static mdns_name_dict_t _mdns_name_dict;
+
 static volatile TaskHandle_t _mdns_service_task_handle = NULL;
 static SemaphoreHandle_t _mdns_service_semaphore = NULL;
 
+static mdns_action_t _mdns_action_pool[MDNS_ACTION_POOL_SIZE];
+static uint32_t _mdns_action_pool_free = (1UL << MDNS_ACTION_POOL_SIZE) - 1;
+static portMUX_TYPE _mdns_action_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
 static void _mdns_search_finish_done(void);
 static mdns_search_once_t * _mdns_search_find_from(mdns_search_once_t * search, mdns_name_t * name, uint16_t type, tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
 static void _mdns_search_result_add_ip(mdns_search_once_t * search, const char * hostname, ip_addr_t * ip, tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
 static void _mdns_search_result_add_srv(mdns_search_once_t * search, const char * hostname, uint16_t port, tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
 static void _mdns_search_result_add_txt(mdns_search_once_t * search, mdns_txt_item_t * txt, size_t txt_count, tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
 static mdns_result_t * _mdns_search_result_add_ptr(mdns_search_once_t * search, const char * instance, tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
+static void _mdns_cache_add_record(const uint8_t * packet, mdns_name_t * name, uint16_t type, bool flush, uint32_t ttl,
+                                   const uint8_t * data, uint16_t data_len, tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
+static void _mdns_cache_flush_pcb(tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
 
 static inline bool _str_null_or_empty(const char * str){
     return (str == NULL || *str == 0);
@@ -119,11 +129,51 @@ static bool _mdns_can_add_more_services(void)
     return true;
 }
 
+/**
+ * @brief  Allocate a zeroed action, from the preallocated ones if any is free
+ *
+ * Actions are created by the API, the event loop and the network stack,
+ * so the pool is protected by a critical section
+ */
+static mdns_action_t * _mdns_alloc_action(void)
+{
+    mdns_action_t * action = NULL;
+    portENTER_CRITICAL(&_mdns_action_pool_lock);
+    if (_mdns_action_pool_free) {
+        uint8_t i = __builtin_ctz(_mdns_action_pool_free);
+        _mdns_action_pool_free &= ~(1UL << i);
+        action = &_mdns_action_pool[i];
+    }
+    portEXIT_CRITICAL(&_mdns_action_pool_lock);
+    if (!action) {
+        action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+        if (!action) {
+            return NULL;
+        }
+    }
+    memset(action, 0, sizeof(mdns_action_t));
+    return action;
+}
+
+/**
+ * @brief  Return an action to the pool, or to the heap if it was allocated there
+ */
+static void _mdns_release_action(mdns_action_t * action)
+{
+    if (action >= _mdns_action_pool && action < _mdns_action_pool + MDNS_ACTION_POOL_SIZE) {
+        portENTER_CRITICAL(&_mdns_action_pool_lock);
+        _mdns_action_pool_free |= 1UL << (action - _mdns_action_pool);
+        portEXIT_CRITICAL(&_mdns_action_pool_lock);
+    } else {
+        free(action);
+    }
+}
+
 esp_err_t _mdns_send_rx_action(mdns_rx_packet_t * packet)
 {
     mdns_action_t * action = NULL;
 
-    action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         return ESP_ERR_NO_MEM;
@@ -132,7 +182,7 @@ esp_err_t _mdns_send_rx_action(mdns_rx_packet_t * packet)
     action->type = ACTION_RX_HANDLE;
     action->data.rx_handle.packet = packet;
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -353,76 +403,213 @@ static inline uint8_t _mdns_append_string(uint8_t * packet, uint16_t * index, co
 }
 
 /**
- * @brief  appends FQDN to a packet, incrementing the index and
- *         compressing the output if previous occurrence of the string (or part of it) has been found
+ * @brief  checks if the FQDN at given location in the packet is the one given by strings
  *
  * @param  packet       MDNS packet
- * @param  index        offset in the packet
+ * @param  location     location of the length byte of the first label
  * @param  strings      string array containing the parts of the FQDN
  * @param  count        number of strings in the array
  *
- * @return length of added data: 0 on error or length on success
+ * @return 1 if the FQDN matches, 0 if it does not or -1 if it is not a readable FQDN
  */
-static uint16_t _mdns_append_fqdn(uint8_t * packet, uint16_t * index, const char * strings[], uint8_t count)
+static int _mdns_fqdn_matches(const uint8_t * packet, const uint8_t * location, const char * strings[], uint8_t count)
 {
-    if (!count) {
-        //empty string so terminate
-        return _mdns_append_u8(packet, index, 0);
-    }
     mdns_name_t name;
     static char buf[MDNS_NAME_BUF_LEN];
+    uint8_t len = strlen(strings[0]);
+    if (location[0] != len || memcmp(location + 1, strings[0], len)) {
+        //not continuing with our string
+        return 0;
+    }
+    //seems that we might have found the string that we are looking for
+    //read the destination into name and compare
+    name.parts = 0;
+    name.sub = 0;
+    name.invalid = false;
+    name.host[0] = 0;
+    name.service[0] = 0;
+    name.proto[0] = 0;
+    name.domain[0] = 0;
+    if (!_mdns_read_fqdn(packet, location, &name, buf)) {
+        return -1;
+    }
+    if (name.parts != count) {
+        return 0;
+    }
+    uint8_t i;
+    for (i=0; i<count; i++) {
+        if (strcasecmp(strings[i], (const char *)&name + (i * (MDNS_NAME_BUF_LEN)))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief  finds FQDN in a packet by scanning it for the length byte of the first label
+ *
+ * @param  packet       MDNS packet
+ * @param  index        length of the packet so far
+ * @param  strings      string array containing the parts of the FQDN
+ * @param  count        number of strings in the array
+ *
+ * @return offset of the first occurrence, 0 if not found or -1 if the packet could not be read
+ */
+static int _mdns_find_fqdn_scan(const uint8_t * packet, uint16_t index, const char * strings[], uint8_t count)
+{
     uint8_t len = strlen(strings[0]);
     //try to find first the string length in the packet (if it exists)
-    uint8_t * len_location = (uint8_t *)memchr(packet, (char)len, *index);
+    const uint8_t * len_location = (const uint8_t *)memchr(packet, (char)len, index);
     while (len_location) {
-        //check if the string after len_location is the string that we are looking for
-        if (memcmp(len_location+1, strings[0], len)) { //not continuing with our string
-search_next:
-            //try and find the length byte further in the packet
-            len_location = (uint8_t *)memchr(len_location+1, (char)len, *index - (len_location+1 - packet));
-            continue;
-        }
-        //seems that we might have found the string that we are looking for
-        //read the destination into name and compare
-        name.parts = 0;
-        name.sub = 0;
-        name.host[0] = 0;
-        name.service[0] = 0;
-        name.proto[0] = 0;
-        name.domain[0] = 0;
-        const uint8_t * content = _mdns_read_fqdn(packet, len_location, &name, buf);
-        if (!content) {
-            //not a readable fqdn?
+        if (len_location + 1 + len > packet + index) {
+            //the label would not fit into the packet written so far
             return 0;
         }
-        if (name.parts == count) {
-            uint8_t i;
-            for (i=0; i<count; i++) {
-                if (strcasecmp(strings[i], (const char *)&name + (i * (MDNS_NAME_BUF_LEN)))) {
-                    //not our string! let's search more
-                    goto search_next;
-                }
+        int match = _mdns_fqdn_matches(packet, len_location, strings, count);
+        if (match) {
+            return (match < 0) ? -1 : (len_location - packet);
+        }
+        //try and find the length byte further in the packet
+        len_location = (const uint8_t *)memchr(len_location+1, (char)len, index - (len_location+1 - packet));
+    }
+    return 0;
+}
+
+/**
+ * @brief  hashes FQDN for the name dictionary, ignoring the case
+ */
+static uint16_t _mdns_name_dict_hash(const char * strings[], uint8_t count)
+{
+    uint32_t hash = 2166136261U;
+    uint8_t i;
+    for (i=0; i<count; i++) {
+        const uint8_t * s = (const uint8_t *)strings[i];
+        while (*s) {
+            hash = (hash ^ tolower(*s++)) * 16777619U;
+        }
+        hash = (hash ^ '.') * 16777619U;
+    }
+    return (hash >> 16) ^ (hash & 0xFFFF);
+}
+
+/**
+ * @brief  starts a new name dictionary for the packet
+ *
+ * Names appended to this packet are then remembered in the dictionary,
+ * so that compression targets are found without scanning the packet.
+ * Names appended to any other packet are compressed by scanning it.
+ *
+ * @param  packet       MDNS packet
+ */
+static void _mdns_name_dict_reset(const uint8_t * packet)
+{
+    _mdns_name_dict.packet = MDNS_NAME_DICT_ENABLED ? packet : NULL;
+    _mdns_name_dict.count = 0;
+    _mdns_name_dict.full = false;
+    memset(_mdns_name_dict.buckets, MDNS_NAME_DICT_NONE, sizeof(_mdns_name_dict.buckets));
+}
+
+/**
+ * @brief  remembers that FQDN starts at the given offset of the packet
+ *
+ * @param  offset       offset of the length byte of the first label
+ * @param  hash         hash of the FQDN
+ */
+static void _mdns_name_dict_add(uint16_t offset, uint16_t hash)
+{
+    if (_mdns_name_dict.count == MDNS_NAME_DICT_SIZE) {
+        //from now on the dictionary might miss names
+        _mdns_name_dict.full = true;
+        return;
+    }
+    uint8_t bucket = hash % MDNS_NAME_DICT_BUCKETS;
+    mdns_name_dict_entry_t * entry = &_mdns_name_dict.entries[_mdns_name_dict.count];
+    entry->hash = hash;
+    entry->offset = offset;
+    entry->next = _mdns_name_dict.buckets[bucket];
+    _mdns_name_dict.buckets[bucket] = _mdns_name_dict.count++;
+}
+
+/**
+ * @brief  finds FQDN in the name dictionary of the packet
+ *
+ * Gives the same result as _mdns_find_fqdn_scan(), as long as all names
+ * in the packet have been appended with _mdns_append_fqdn()
+ *
+ * @param  packet       MDNS packet
+ * @param  strings      string array containing the parts of the FQDN
+ * @param  count        number of strings in the array
+ * @param  hash         hash of the FQDN
+ *
+ * @return offset of the first occurrence, 0 if not found or -1 if the packet could not be read
+ */
+static int _mdns_find_fqdn_dict(const uint8_t * packet, const char * strings[], uint8_t count, uint16_t hash)
+{
+    int found = 0;
+    uint8_t i = _mdns_name_dict.buckets[hash % MDNS_NAME_DICT_BUCKETS];
+    //entries are chained from the last one added, so keep the last match
+    while (i != MDNS_NAME_DICT_NONE) {
+        const mdns_name_dict_entry_t * entry = &_mdns_name_dict.entries[i];
+        if (entry->hash == hash) {
+            int match = _mdns_fqdn_matches(packet, packet + entry->offset, strings, count);
+            if (match < 0) {
+                return -1;
+            }
+            if (match) {
+                found = entry->offset;
             }
-            //we actually have found the string
-            break;
-        } else {
-            goto search_next;
         }
+        i = entry->next;
+    }
+    return found;
+}
+
+/**
+ * @brief  appends FQDN to a packet, incrementing the index and
+ *         compressing the output if previous occurrence of the string (or part of it) has been found
+ *
+ * @param  packet       MDNS packet
+ * @param  index        offset in the packet
+ * @param  strings      string array containing the parts of the FQDN
+ * @param  count        number of strings in the array
+ *
+ * @return length of added data: 0 on error or length on success
+ */
+static uint16_t _mdns_append_fqdn(uint8_t * packet, uint16_t * index, const char * strings[], uint8_t count)
+{
+    if (!count) {
+        //empty string so terminate
+        return _mdns_append_u8(packet, index, 0);
+    }
+    bool use_dict = (_mdns_name_dict.packet == packet);
+    uint16_t hash = 0;
+    int offset;
+    if (use_dict && !_mdns_name_dict.full) {
+        hash = _mdns_name_dict_hash(strings, count);
+        offset = _mdns_find_fqdn_dict(packet, strings, count, hash);
+    } else {
+        offset = _mdns_find_fqdn_scan(packet, *index, strings, count);
+    }
+    if (offset < 0) {
+        //not a readable fqdn?
+        return 0;
     }
     //string is not yet in the packet, so let's add it
-    if (!len_location) {
+    if (!offset) {
+        uint16_t location = *index;
         uint8_t written = _mdns_append_string(packet, index, strings[0]);
         if (!written) {
             return 0;
         }
+        if (use_dict && !_mdns_name_dict.full) {
+            _mdns_name_dict_add(location, hash);
+        }
         //run the same for the other strings in the name
         return written + _mdns_append_fqdn(packet, index, &strings[1], count - 1);
     }
 
     //we have found the string so let's insert a pointer to it instead
-    uint16_t offset = len_location - packet;
-    offset |= MDNS_NAME_REF;
-    return _mdns_append_u16(packet, index, offset);
+    return _mdns_append_u16(packet, index, offset | MDNS_NAME_REF);
 }
 
 /**
@@ -911,6 +1098,7 @@ static void _mdns_dispatch_tx_packet(mdns_tx_packet_t * p)
     static uint8_t packet[MDNS_MAX_PACKET_SIZE];
     uint16_t index = MDNS_HEAD_LEN;
     memset(packet, 0, MDNS_HEAD_LEN);
+    _mdns_name_dict_reset(packet);
     mdns_out_question_t * q;
     mdns_out_answer_t * a;
     uint8_t count;
@@ -2691,6 +2879,7 @@ void mdns_parse_packet(mdns_rx_packet_t * packet)
             uint32_t ttl = _mdns_read_u32(content, MDNS_TTL_OFFSET);
             uint16_t data_len = _mdns_read_u16(content, MDNS_LEN_OFFSET);
             const uint8_t * data_ptr = content + MDNS_DATA_OFFSET;
+            bool flush = !!(clas & 0x8000);
             clas &= 0x7FFF;
 
             content = data_ptr + data_len;
@@ -2727,6 +2916,9 @@ void mdns_parse_packet(mdns_rx_packet_t * packet)
                     //skip this record
                     continue;
                 }
+                if (clas == 0x0001) {
+                    _mdns_cache_add_record(data, name, type, flush, ttl, data_ptr, data_len, packet->tcpip_if, packet->ip_protocol);
+                }
                 search_result = _mdns_search_find_from(_mdns_server->search_once, name, type, packet->tcpip_if, packet->ip_protocol);
             }
 
@@ -3040,6 +3232,7 @@ void _mdns_disable_pcb(tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protoc
             _mdns_enable_pcb(other_if, ip_protocol);
         }
     }
+    _mdns_cache_flush_pcb(tcpip_if, ip_protocol);
     _mdns_server->interfaces[tcpip_if].pcbs[ip_protocol].state = PCB_OFF;
 }
 
@@ -3500,6 +3693,457 @@ static mdns_search_once_t * _mdns_search_find_from(mdns_search_once_t * s, mdns_
     return NULL;
 }
 
+/**
+ * @brief  Check if two optional names are the same
+ */
+static bool _mdns_cache_name_eq(const char * a, const char * b)
+{
+    if (_str_null_or_empty(a) || _str_null_or_empty(b)) {
+        return _str_null_or_empty(a) && _str_null_or_empty(b);
+    }
+    return !strcasecmp(a, b);
+}
+
+/**
+ * @brief  Check if cached record has the given owner name and type
+ */
+static bool _mdns_cache_record_is(const mdns_cache_record_t * r, const mdns_cache_record_t * other)
+{
+    return r->tcpip_if == other->tcpip_if && r->ip_protocol == other->ip_protocol && r->type == other->type
+        && _mdns_cache_name_eq(r->host, other->host)
+        && _mdns_cache_name_eq(r->service, other->service)
+        && _mdns_cache_name_eq(r->proto, other->proto);
+}
+
+/**
+ * @brief  Check if cached record has the same owner name, type and data
+ */
+static bool _mdns_cache_record_equals(const mdns_cache_record_t * r, const mdns_cache_record_t * other)
+{
+    if (!_mdns_cache_record_is(r, other)) {
+        return false;
+    }
+    switch (r->type) {
+    case MDNS_TYPE_PTR:
+        return _mdns_cache_name_eq(r->data.instance, other->data.instance);
+    case MDNS_TYPE_SRV:
+        return r->data.srv.port == other->data.srv.port && _mdns_cache_name_eq(r->data.srv.hostname, other->data.srv.hostname);
+    case MDNS_TYPE_TXT:
+        return r->data.txt.len == other->data.txt.len && !memcmp(r->data.txt.data, other->data.txt.data, r->data.txt.len);
+    default:
+        return r->data.addr.type == other->data.addr.type
+            && !memcmp(&r->data.addr.u_addr, &other->data.addr.u_addr, (r->data.addr.type == IPADDR_TYPE_V6) ? 16 : 4);
+    }
+}
+
+/**
+ * @brief  Swap two entries of the expiry heap
+ */
+static void _mdns_cache_heap_swap(mdns_cache_t * cache, uint8_t i, uint8_t j)
+{
+    uint8_t tmp = cache->heap[i];
+    cache->heap[i] = cache->heap[j];
+    cache->heap[j] = tmp;
+    cache->records[cache->heap[i]].heap_index = i;
+    cache->records[cache->heap[j]].heap_index = j;
+}
+
+/**
+ * @brief  Check if heap entry i expires before entry j
+ */
+static bool _mdns_cache_heap_less(mdns_cache_t * cache, uint8_t i, uint8_t j)
+{
+    return (int32_t)(cache->records[cache->heap[i]].expires_at - cache->records[cache->heap[j]].expires_at) < 0;
+}
+
+/**
+ * @brief  Move heap entry to its place after its expiry time has changed
+ */
+static void _mdns_cache_heap_fix(mdns_cache_t * cache, uint8_t i)
+{
+    while (i && _mdns_cache_heap_less(cache, i, (i - 1) / 2)) {
+        _mdns_cache_heap_swap(cache, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    for (;;) {
+        uint16_t first = i;
+        uint16_t child = 2 * i + 1;
+        if (child < cache->count && _mdns_cache_heap_less(cache, child, first)) {
+            first = child;
+        }
+        if (child + 1 < cache->count && _mdns_cache_heap_less(cache, child + 1, first)) {
+            first = child + 1;
+        }
+        if (first == i) {
+            break;
+        }
+        _mdns_cache_heap_swap(cache, i, first);
+        i = first;
+    }
+}
+
+/**
+ * @brief  Free the data of cached record
+ */
+static void _mdns_cache_record_free(mdns_cache_record_t * r)
+{
+    free(r->host);
+    free(r->service);
+    free(r->proto);
+    if (r->type == MDNS_TYPE_PTR) {
+        free(r->data.instance);
+    } else if (r->type == MDNS_TYPE_SRV) {
+        free(r->data.srv.hostname);
+    } else if (r->type == MDNS_TYPE_TXT) {
+        free(r->data.txt.data);
+    }
+}
+
+/**
+ * @brief  Remove record from the cache
+ *
+ * @param  index        index of the record in the records array
+ */
+static void _mdns_cache_remove(uint8_t index)
+{
+    mdns_cache_t * cache = &_mdns_server->cache;
+    uint8_t h = cache->records[index].heap_index;
+    _mdns_cache_record_free(&cache->records[index]);
+    cache->count--;
+    if (h != cache->count) {
+        cache->heap[h] = cache->heap[cache->count];
+        cache->records[cache->heap[h]].heap_index = h;
+        _mdns_cache_heap_fix(cache, h);
+    }
+    if (index != cache->count) {
+        //keep the records in use at the start of the array
+        cache->records[index] = cache->records[cache->count];
+        cache->heap[cache->records[index].heap_index] = index;
+    }
+}
+
+/**
+ * @brief  Remove the expired records from the cache
+ */
+static void _mdns_cache_expire(uint32_t now)
+{
+    mdns_cache_t * cache = &_mdns_server->cache;
+    while (cache->count && (int32_t)(cache->records[cache->heap[0]].expires_at - now) <= 0) {
+        _mdns_cache_remove(cache->heap[0]);
+    }
+}
+
+/**
+ * @brief  Duplicate optional name for cached record
+ */
+static esp_err_t _mdns_cache_strdup(char ** out, const char * in)
+{
+    *out = NULL;
+    if (_str_null_or_empty(in)) {
+        return ESP_OK;
+    }
+    *out = strdup(in);
+    if (!*out) {
+        HOOK_MALLOC_FAILED;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief  Called from parser to cache record received from another host
+ *
+ * @param  packet       received packet
+ * @param  name         owner name of the record
+ * @param  type         type of the record
+ * @param  flush        cache flush bit of the record
+ * @param  ttl          TTL of the record in seconds
+ * @param  data         record data
+ * @param  data_len     length of the record data
+ */
+static void _mdns_cache_add_record(const uint8_t * packet, mdns_name_t * name, uint16_t type, bool flush, uint32_t ttl,
+                                   const uint8_t * data, uint16_t data_len, tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
+{
+    static mdns_name_t n;
+    mdns_cache_t * cache = &_mdns_server->cache;
+    mdns_cache_record_t rec;
+    const char * target = NULL;
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    uint8_t i;
+
+    if (!cache->records || name->invalid || name->sub || strcasecmp(name->domain, MDNS_DEFAULT_DOMAIN)) {
+        return;
+    }
+
+    memset(&rec, 0, sizeof(mdns_cache_record_t));
+    rec.tcpip_if = tcpip_if;
+    rec.ip_protocol = ip_protocol;
+    rec.type = type;
+    rec.host = name->host;
+    rec.service = name->service;
+    rec.proto = name->proto;
+    if (type == MDNS_TYPE_PTR) {
+        if (!_mdns_parse_fqdn(packet, data, &n) || _str_null_or_empty(n.host)) {
+            return;
+        }
+        target = n.host;
+        rec.data.instance = n.host;
+    } else if (type == MDNS_TYPE_SRV) {
+        if (data_len <= MDNS_SRV_FQDN_OFFSET || !_mdns_parse_fqdn(packet, data + MDNS_SRV_FQDN_OFFSET, &n) || _str_null_or_empty(n.host)) {
+            return;
+        }
+        target = n.host;
+        rec.data.srv.hostname = n.host;
+        rec.data.srv.port = _mdns_read_u16(data, MDNS_SRV_PORT_OFFSET);
+    } else if (type == MDNS_TYPE_TXT && data_len) {
+        rec.data.txt.data = (uint8_t *)data;
+        rec.data.txt.len = data_len;
+    } else if (type == MDNS_TYPE_A && data_len == 4) {
+        rec.data.addr.type = IPADDR_TYPE_V4;
+        memcpy(&rec.data.addr.u_addr.ip4.addr, data, 4);
+    } else if (type == MDNS_TYPE_AAAA && data_len == 16) {
+        rec.data.addr.type = IPADDR_TYPE_V6;
+        memcpy(rec.data.addr.u_addr.ip6.addr, data, 16);
+    } else {
+        return;
+    }
+
+    _mdns_cache_expire(now);
+
+    //the record replaces the ones with the same name and type received earlier (RFC 6762, 10.2)
+    i = 0;
+    while (flush && i < cache->count) {
+        mdns_cache_record_t * r = &cache->records[i];
+        if (_mdns_cache_record_is(r, &rec) && !_mdns_cache_record_equals(r, &rec)
+                && (now - r->received_at) > MDNS_CACHE_FLUSH_DELAY) {
+            _mdns_cache_remove(i);
+            continue;
+        }
+        i++;
+    }
+
+    if (ttl > MDNS_CACHE_MAX_TTL) {
+        ttl = MDNS_CACHE_MAX_TTL;
+    }
+    for (i = 0; i < cache->count; i++) {
+        mdns_cache_record_t * r = &cache->records[i];
+        if (_mdns_cache_record_equals(r, &rec)) {
+            //goodbye records expire after a second (RFC 6762, 10.1)
+            r->expires_at = now + (ttl ? ttl * 1000 : 1000);
+            r->received_at = now;
+            if (ttl) {
+                r->ttl = ttl;
+            }
+            _mdns_cache_heap_fix(cache, r->heap_index);
+            return;
+        }
+    }
+    if (!ttl) {
+        return;
+    }
+
+    if (cache->count == CONFIG_MDNS_CACHE_SIZE) {
+        //make room by dropping the record closest to expiry
+        _mdns_cache_remove(cache->heap[0]);
+    }
+
+    mdns_cache_record_t * r = &cache->records[cache->count];
+    memset(r, 0, sizeof(mdns_cache_record_t));
+    r->tcpip_if = tcpip_if;
+    r->ip_protocol = ip_protocol;
+    r->type = type;
+    if (_mdns_cache_strdup(&r->host, name->host)
+            || _mdns_cache_strdup(&r->service, name->service)
+            || _mdns_cache_strdup(&r->proto, name->proto)
+            || (type == MDNS_TYPE_PTR && _mdns_cache_strdup(&r->data.instance, target))
+            || (type == MDNS_TYPE_SRV && _mdns_cache_strdup(&r->data.srv.hostname, target))) {
+        _mdns_cache_record_free(r);
+        return;
+    }
+    if (type == MDNS_TYPE_SRV) {
+        r->data.srv.port = rec.data.srv.port;
+    } else if (type == MDNS_TYPE_TXT) {
+        r->data.txt.data = (uint8_t *)malloc(data_len);
+        if (!r->data.txt.data) {
+            HOOK_MALLOC_FAILED;
+            _mdns_cache_record_free(r);
+            return;
+        }
+        memcpy(r->data.txt.data, data, data_len);
+        r->data.txt.len = data_len;
+    } else if (type == MDNS_TYPE_A || type == MDNS_TYPE_AAAA) {
+        r->data.addr = rec.data.addr;
+    }
+    r->ttl = ttl;
+    r->received_at = now;
+    r->expires_at = now + ttl * 1000;
+    r->heap_index = cache->count;
+    cache->heap[cache->count] = cache->count;
+    cache->count++;
+    _mdns_cache_heap_fix(cache, r->heap_index);
+}
+
+/**
+ * @brief  Remove the records received on an interface, which is going down
+ */
+static void _mdns_cache_flush_pcb(tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
+{
+    mdns_cache_t * cache = &_mdns_server->cache;
+    uint8_t i = 0;
+    while (i < cache->count) {
+        if (cache->records[i].tcpip_if == tcpip_if && cache->records[i].ip_protocol == ip_protocol) {
+            _mdns_cache_remove(i);
+            continue;
+        }
+        i++;
+    }
+}
+
+/**
+ * @brief  Fill new search with the results found in the cache
+ *
+ * Records are added in the order that the searches need them: instances
+ * first, then their host names and last the addresses of the hosts.
+ */
+static void _mdns_cache_search(mdns_search_once_t * search)
+{
+    static const uint16_t types[] = { MDNS_TYPE_PTR, MDNS_TYPE_SRV, MDNS_TYPE_TXT, MDNS_TYPE_A, MDNS_TYPE_AAAA };
+    static mdns_name_t n;
+    mdns_cache_t * cache = &_mdns_server->cache;
+    mdns_name_t * name = &n;
+    uint8_t t, i;
+
+    if (!cache->records) {
+        return;
+    }
+    _mdns_cache_expire(xTaskGetTickCount() * portTICK_PERIOD_MS);
+
+    for (t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        for (i = 0; i < cache->count; i++) {
+            mdns_cache_record_t * r = &cache->records[i];
+            if (r->type != types[t]) {
+                continue;
+            }
+            memset(name, 0, sizeof(mdns_name_t));
+            strlcpy(name->host, r->host ? r->host : "", sizeof(name->host));
+            strlcpy(name->service, r->service ? r->service : "", sizeof(name->service));
+            strlcpy(name->proto, r->proto ? r->proto : "", sizeof(name->proto));
+            strlcpy(name->domain, MDNS_DEFAULT_DOMAIN, sizeof(name->domain));
+            if (_mdns_search_find_from(search, name, r->type, r->tcpip_if, r->ip_protocol) != search) {
+                continue;
+            }
+
+            mdns_result_t * result = NULL;
+            mdns_txt_item_t * txt = NULL;
+            size_t txt_count = 0;
+            switch (r->type) {
+            case MDNS_TYPE_PTR:
+                _mdns_search_result_add_ptr(search, r->data.instance, r->tcpip_if, r->ip_protocol);
+                break;
+            case MDNS_TYPE_SRV:
+                if (search->type != MDNS_TYPE_PTR) {
+                    _mdns_search_result_add_srv(search, r->data.srv.hostname, r->data.srv.port, r->tcpip_if, r->ip_protocol);
+                    break;
+                }
+                result = _mdns_search_result_add_ptr(search, name->host, r->tcpip_if, r->ip_protocol);
+                if (result && !result->hostname) {
+                    result->port = r->data.srv.port;
+                    result->hostname = strdup(r->data.srv.hostname);
+                }
+                break;
+            case MDNS_TYPE_TXT:
+                if (search->type == MDNS_TYPE_PTR) {
+                    result = _mdns_search_result_add_ptr(search, name->host, r->tcpip_if, r->ip_protocol);
+                    if (!result || result->txt) {
+                        break;
+                    }
+                }
+                _mdns_result_txt_create(r->data.txt.data, r->data.txt.len, &txt, &txt_count);
+                if (!txt_count) {
+                    break;
+                }
+                if (result) {
+                    result->txt = txt;
+                    result->txt_count = txt_count;
+                } else {
+                    _mdns_search_result_add_txt(search, txt, txt_count, r->tcpip_if, r->ip_protocol);
+                }
+                break;
+            default:
+                _mdns_search_result_add_ip(search, name->host, &r->data.addr, r->tcpip_if, r->ip_protocol);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief  Check if the results of the search filled from the cache answer it
+ *
+ * The search must have collected the maximum number of results, and each of them
+ * must hold the data asked for, so that it does not need to be sent
+ */
+static bool _mdns_search_is_answered(mdns_search_once_t * search)
+{
+    if (!search->max_results || search->num_results < search->max_results) {
+        return false;
+    }
+    mdns_result_t * r = search->result;
+    while (r) {
+        if ((search->type == MDNS_TYPE_PTR && (!r->hostname || !r->addr))
+                || (search->type == MDNS_TYPE_SRV && !r->hostname)
+                || (search->type == MDNS_TYPE_TXT && !r->txt)
+                || ((search->type == MDNS_TYPE_A || search->type == MDNS_TYPE_AAAA) && !r->addr)
+                || search->type == MDNS_TYPE_ANY) {
+            return false;
+        }
+        r = r->next;
+    }
+    return true;
+}
+
+/**
+ * @brief  Check if PTR record may be sent as a known answer in a query
+ *
+ * @return true if the cache holds the record with more than half of its TTL remaining
+ *         (RFC 6762, 7.1), or if the cache is disabled
+ */
+static bool _mdns_cache_ptr_is_known(const char * instance, const char * service, const char * proto, tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
+{
+    mdns_cache_t * cache = &_mdns_server->cache;
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    uint8_t i;
+
+    if (!cache->records) {
+        return true;
+    }
+    for (i = 0; i < cache->count; i++) {
+        mdns_cache_record_t * r = &cache->records[i];
+        if (r->type == MDNS_TYPE_PTR && r->tcpip_if == tcpip_if && r->ip_protocol == ip_protocol
+                && _str_null_or_empty(r->host)
+                && _mdns_cache_name_eq(r->service, service) && _mdns_cache_name_eq(r->proto, proto)
+                && _mdns_cache_name_eq(r->data.instance, instance)) {
+            return (int32_t)(r->expires_at - now) > (int32_t)(r->ttl * 500);
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief  Free all cached records
+ */
+static void _mdns_cache_free(void)
+{
+    mdns_cache_t * cache = &_mdns_server->cache;
+    while (cache->count) {
+        _mdns_cache_remove(cache->count - 1);
+    }
+    free(cache->records);
+    free(cache->heap);
+    cache->records = NULL;
+    cache->heap = NULL;
+}
+
 /**
  * @brief  Create search packet for partidular interface
  */
@@ -3530,7 +4174,8 @@ static mdns_tx_packet_t * _mdns_create_search_packet(mdns_search_once_t * search
         r = search->result;
         while (r) {
             //full record on the same interface is available
-            if (r->tcpip_if != tcpip_if || r->ip_protocol != ip_protocol || r->instance_name == NULL || r->hostname == NULL || r->addr == NULL) {
+            if (r->tcpip_if != tcpip_if || r->ip_protocol != ip_protocol || r->instance_name == NULL || r->hostname == NULL || r->addr == NULL
+                    || !_mdns_cache_ptr_is_known(r->instance_name, search->service, search->proto, tcpip_if, ip_protocol)) {
                 r = r->next;
                 continue;
             }
@@ -3688,15 +4333,8 @@ static void _mdns_free_action(mdns_action_t * action)
         free(action->data.srv_txt_del.key);
         break;
     case ACTION_SEARCH_ADD:
-        //fallthrough
-    case ACTION_SEARCH_SEND:
-        //fallthrough
-    case ACTION_SEARCH_END:
         _mdns_search_free(action->data.search_add.search);
         break;
-    case ACTION_TX_HANDLE:
-        _mdns_free_tx_packet(action->data.tx_handle.packet);
-        break;
     case ACTION_RX_HANDLE:
         pbuf_free(action->data.rx_handle.packet->pb);
         free(action->data.rx_handle.packet);
@@ -3704,7 +4342,7 @@ static void _mdns_free_action(mdns_action_t * action)
     default:
         break;
     }
-    free(action);
+    _mdns_release_action(action);
 }
 
 /**
@@ -3866,25 +4504,11 @@ static void _mdns_execute_action(mdns_action_t * action)
 
         break;
     case ACTION_SEARCH_ADD:
+        _mdns_cache_search(action->data.search_add.search);
         _mdns_search_add(action->data.search_add.search);
-        break;
-    case ACTION_SEARCH_SEND:
-        _mdns_search_send(action->data.search_add.search);
-        break;
-    case ACTION_SEARCH_END:
-        _mdns_search_finish(action->data.search_add.search);
-        break;
-    case ACTION_TX_HANDLE:
-        {
-            mdns_tx_packet_t * p = _mdns_server->tx_queue_head;
-            // packet to be handled should be at tx head, but must be consistent with the one pushed to action queue
-            if (p && p==action->data.tx_handle.packet && p->queued) {
-                p->queued = false; // clearing, as the packet might be reused (pushed and transmitted again)
-                _mdns_server->tx_queue_head = p->next;
-                _mdns_tx_handle_packet(p);
-            } else {
-                ESP_LOGD(TAG, "Skipping transmit of an unexpected packet!");
-            }
+        if (_mdns_search_is_answered(action->data.search_add.search)) {
+            //no need to ask the network
+            _mdns_search_finish(action->data.search_add.search);
         }
         break;
     case ACTION_RX_HANDLE:
@@ -3895,7 +4519,7 @@ static void _mdns_execute_action(mdns_action_t * action)
     default:
         break;
     }
-    free(action);
+    _mdns_release_action(action);
 }
 
 /**
@@ -3905,7 +4529,7 @@ static esp_err_t _mdns_send_search_action(mdns_action_type_t type, mdns_search_o
 {
     mdns_action_t * action = NULL;
 
-    action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         return ESP_ERR_NO_MEM;
@@ -3914,92 +4538,103 @@ static esp_err_t _mdns_send_search_action(mdns_action_type_t type, mdns_search_o
     action->type = type;
     action->data.search_add.search = search;
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
 }
 
 /**
- * @brief  Called from timer task to run mDNS responder
+ * @brief  Called from service task to transmit the packets which are due
  *
- * periodically checks first unqueued packet (from tx head).
- * if it is scheduled to be transmitted, then pushes the packet to action queue to be handled.
+ * @param  now          current time in milliseconds
  *
+ * @return number of milliseconds until the first packet left is due, or UINT32_MAX if there is none
  */
-static void _mdns_scheduler_run(void)
+static uint32_t _mdns_scheduler_run(uint32_t now)
 {
-    MDNS_SERVICE_LOCK();
-    mdns_tx_packet_t * p = _mdns_server->tx_queue_head;
-    mdns_action_t * action = NULL;
-
-    // find first unqueued packet
-    while (p && p->queued) {
-        p = p->next;
+    mdns_tx_packet_t * p;
+    // handling may put the packet back to the queue, but always at least 250ms later
+    while ((p = _mdns_server->tx_queue_head) && (int32_t)(p->send_at - now) <= 0) {
+        _mdns_server->tx_queue_head = p->next;
+        _mdns_tx_handle_packet(p);
     }
     if (!p) {
-        MDNS_SERVICE_UNLOCK();
-        return;
+        return UINT32_MAX;
     }
-    if ((int32_t)(p->send_at - (xTaskGetTickCount() * portTICK_PERIOD_MS)) < 0) {
-        action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
-        if (action) {
-            action->type = ACTION_TX_HANDLE;
-            action->data.tx_handle.packet = p;
-            p->queued = true;
-            if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
-                free(action);
-                p->queued = false;
-            }
-        } else {
-            HOOK_MALLOC_FAILED;
-            // continue
-        }
-    }
-    MDNS_SERVICE_UNLOCK();
+    return p->send_at - now;
 }
 
 /**
- * @brief  Called from timer task to run active searches
+ * @brief  Called from service task to send the active searches and finish the timed out ones
+ *
+ * @param  now          current time in milliseconds
+ *
+ * @return number of milliseconds until a search has to be sent or finished, or UINT32_MAX if there is none
  */
-static void _mdns_search_run(void)
+static uint32_t _mdns_search_run(uint32_t now)
 {
-    MDNS_SERVICE_LOCK();
     mdns_search_once_t * s = _mdns_server->search_once;
-    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
-    if (!s) {
-        MDNS_SERVICE_UNLOCK();
-        return;
-    }
+    mdns_search_once_t * next;
+    uint32_t wait = UINT32_MAX;
+    uint32_t left;
     while (s) {
+        next = s->next;
         if (s->state != SEARCH_OFF) {
-            if (now > (s->started_at + s->timeout)) {
-                s->state = SEARCH_OFF;
-                if (_mdns_send_search_action(ACTION_SEARCH_END, s) != ESP_OK) {
-                    s->state = SEARCH_RUNNING;
-                }
-            } else if (s->state == SEARCH_INIT || (now - s->sent_at) > 1000) {
+            if ((int32_t)(now - (s->started_at + s->timeout)) >= 0) {
+                _mdns_search_finish(s);
+                s = next;
+                continue;
+            }
+            if (s->state == SEARCH_INIT || (int32_t)(now - (s->sent_at + 1000)) >= 0) {
                 s->state = SEARCH_RUNNING;
                 s->sent_at = now;
-                if (_mdns_send_search_action(ACTION_SEARCH_SEND, s) != ESP_OK) {
-                    s->sent_at -= 1000;
-                }
+                _mdns_search_send(s);
+            }
+            left = s->started_at + s->timeout - now;
+            if (s->sent_at + 1000 - now < left) {
+                left = s->sent_at + 1000 - now;
+            }
+            if (left < wait) {
+                wait = left;
             }
         }
-        s = s->next;
+        s = next;
     }
-    MDNS_SERVICE_UNLOCK();
+    return wait;
+}
+
+/**
+ * @brief  Called from service task to run the packets and searches which are due
+ *
+ * @return number of ticks to wait for actions before the next packet or search is due
+ */
+static TickType_t _mdns_timed_run(void)
+{
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    uint32_t tx_wait = _mdns_scheduler_run(now);
+    uint32_t search_wait = _mdns_search_run(now);
+    uint32_t wait = (tx_wait < search_wait) ? tx_wait : search_wait;
+    if (wait == UINT32_MAX) {
+        return portMAX_DELAY;
+    }
+    // round up, not to wake before the deadline
+    return (wait + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
 }
 
 /**
  * @brief  the main MDNS service task. Packets are received and parsed here
+ *
+ * Scheduled packets and searches are run from here too, the task waits for
+ * actions only until the next of them is due, so it does not wake up while idle
  */
 static void _mdns_service_task(void *pvParameters)
 {
     mdns_action_t * a = NULL;
+    TickType_t wait = portMAX_DELAY;
     for (;;) {
         if (_mdns_server && _mdns_server->action_queue) {
-            if (xQueueReceive(_mdns_server->action_queue, &a, portMAX_DELAY) == pdTRUE) {
+            if (xQueueReceive(_mdns_server->action_queue, &a, wait) == pdTRUE) {
                 if (a->type == ACTION_TASK_STOP) {
                     break;
                 }
@@ -4007,6 +4642,9 @@ static void _mdns_service_task(void *pvParameters)
                 _mdns_execute_action(a);
                 MDNS_SERVICE_UNLOCK();
             }
+            MDNS_SERVICE_LOCK();
+            wait = _mdns_timed_run();
+            MDNS_SERVICE_UNLOCK();
         } else {
             vTaskDelay(500 * portTICK_PERIOD_MS);
         }
@@ -4015,38 +4653,6 @@ static void _mdns_service_task(void *pvParameters)
     vTaskDelete(NULL);
 }
 
-static void _mdns_timer_cb(void * arg)
-{
-    _mdns_scheduler_run();
-    _mdns_search_run();
-}
-
-static esp_err_t _mdns_start_timer(void){
-    esp_timer_create_args_t timer_conf = {
-        .callback = _mdns_timer_cb,
-        .arg = NULL,
-        .dispatch_method = ESP_TIMER_TASK,
-        .name = "mdns_timer"
-    };
-    esp_err_t err = esp_timer_create(&timer_conf, &(_mdns_server->timer_handle));
-    if (err) {
-        return err;
-    }
-    return esp_timer_start_periodic(_mdns_server->timer_handle, MDNS_TIMER_PERIOD_US);
-}
-
-static esp_err_t _mdns_stop_timer(void){
-    esp_err_t err = ESP_OK;
-    if (_mdns_server->timer_handle) {
-        err = esp_timer_stop(_mdns_server->timer_handle);
-        if (err) {
-            return err;
-        }
-        err = esp_timer_delete(_mdns_server->timer_handle);
-    }
-    return err;
-}
-
 /**
  * @brief  Start the service thread if not running
  *
@@ -4063,14 +4669,9 @@ static esp_err_t _mdns_service_task_start(void)
         }
     }
     MDNS_SERVICE_LOCK();
-    if (_mdns_start_timer()) {
-        MDNS_SERVICE_UNLOCK();
-        return ESP_FAIL;
-    }
     if (!_mdns_service_task_handle) {
         xTaskCreatePinnedToCore(_mdns_service_task, "mdns", MDNS_SERVICE_STACK_DEPTH, NULL, 1, (TaskHandle_t * const)(&_mdns_service_task_handle), 0);
         if (!_mdns_service_task_handle) {
-            _mdns_stop_timer();
             MDNS_SERVICE_UNLOCK();
             vSemaphoreDelete(_mdns_service_semaphore);
             _mdns_service_semaphore = NULL;
@@ -4089,7 +4690,6 @@ static esp_err_t _mdns_service_task_start(void)
  */
 static esp_err_t _mdns_service_task_stop(void)
 {
-    _mdns_stop_timer();
     if (_mdns_service_task_handle) {
         mdns_action_t action;
         mdns_action_t * a = &action;
@@ -4124,7 +4724,7 @@ static void event_handler(void* arg, esp_event_base_t event_base,
         return;
     }
 
-    mdns_action_t * action = (mdns_action_t *)calloc(1, sizeof(mdns_action_t));
+    mdns_action_t * action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         return;
@@ -4138,7 +4738,7 @@ static void event_handler(void* arg, esp_event_base_t event_base,
     }
 
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
-        free(action);
+        _mdns_release_action(action);
     }
 }
 
@@ -4169,6 +4769,16 @@ esp_err_t mdns_init(void)
         goto free_lock;
     }
 
+    if (CONFIG_MDNS_CACHE_SIZE) {
+        _mdns_server->cache.records = (mdns_cache_record_t *)calloc(CONFIG_MDNS_CACHE_SIZE, sizeof(mdns_cache_record_t));
+        _mdns_server->cache.heap = (uint8_t *)malloc(CONFIG_MDNS_CACHE_SIZE);
+        if (!_mdns_server->cache.records || !_mdns_server->cache.heap) {
+            HOOK_MALLOC_FAILED;
+            err = ESP_ERR_NO_MEM;
+            goto free_cache;
+        }
+    }
+
     if ((err = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL)) != ESP_OK) {
         goto free_event_handlers;
     }
@@ -4209,6 +4819,8 @@ free_event_handlers:
     esp_event_handler_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler);
     esp_event_handler_unregister(IP_EVENT, ESP_EVENT_ANY_ID, &event_handler);
     esp_event_handler_unregister(ETH_EVENT, ESP_EVENT_ANY_ID, &event_handler);
+free_cache:
+    _mdns_cache_free();
     vQueueDelete(_mdns_server->action_queue);
 free_lock:
     vSemaphoreDelete(_mdns_server->lock);
@@ -4253,6 +4865,7 @@ void mdns_free(void)
         }
         free(h);
     }
+    _mdns_cache_free();
     vSemaphoreDelete(_mdns_server->lock);
     esp_event_handler_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler);
     esp_event_handler_unregister(IP_EVENT, ESP_EVENT_ANY_ID, &event_handler);
@@ -4274,7 +4887,7 @@ esp_err_t mdns_hostname_set(const char * hostname)
         return ESP_ERR_NO_MEM;
     }
 
-    mdns_action_t * action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    mdns_action_t * action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         free(new_hostname);
@@ -4284,7 +4897,7 @@ esp_err_t mdns_hostname_set(const char * hostname)
     action->data.hostname = new_hostname;
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
         free(new_hostname);
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     return ERR_OK;
@@ -4303,7 +4916,7 @@ esp_err_t mdns_instance_name_set(const char * instance)
         return ESP_ERR_NO_MEM;
     }
 
-    mdns_action_t * action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    mdns_action_t * action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         free(new_instance);
@@ -4313,7 +4926,7 @@ esp_err_t mdns_instance_name_set(const char * instance)
     action->data.instance = new_instance;
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
         free(new_instance);
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     return ERR_OK;
@@ -4353,7 +4966,7 @@ esp_err_t mdns_service_add(const char * instance, const char * service, const ch
     item->service = s;
     item->next = NULL;
 
-    mdns_action_t * action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    mdns_action_t * action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         _mdns_free_service(s);
@@ -4365,7 +4978,7 @@ esp_err_t mdns_service_add(const char * instance, const char * service, const ch
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
         _mdns_free_service(s);
         free(item);
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
 
@@ -4390,7 +5003,7 @@ esp_err_t mdns_service_port_set(const char * service, const char * proto, uint16
         return ESP_ERR_NOT_FOUND;
     }
 
-    mdns_action_t * action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    mdns_action_t * action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         return ESP_ERR_NO_MEM;
@@ -4399,7 +5012,7 @@ esp_err_t mdns_service_port_set(const char * service, const char * proto, uint16
     action->data.srv_port.service = s;
     action->data.srv_port.port = port;
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -4423,7 +5036,7 @@ esp_err_t mdns_service_txt_set(const char * service, const char * proto, mdns_tx
         }
     }
 
-    mdns_action_t * action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    mdns_action_t * action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         _mdns_free_linked_txt(new_txt);
@@ -4435,7 +5048,7 @@ esp_err_t mdns_service_txt_set(const char * service, const char * proto, mdns_tx
 
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
         _mdns_free_linked_txt(new_txt);
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -4451,7 +5064,7 @@ esp_err_t mdns_service_txt_item_set(const char * service, const char * proto, co
     if (!s) {
         return ESP_ERR_NOT_FOUND;
     }
-    mdns_action_t * action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    mdns_action_t * action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         return ESP_ERR_NO_MEM;
@@ -4461,19 +5074,19 @@ esp_err_t mdns_service_txt_item_set(const char * service, const char * proto, co
     action->data.srv_txt_set.service = s;
     action->data.srv_txt_set.key = strdup(key);
     if (!action->data.srv_txt_set.key) {
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     action->data.srv_txt_set.value = strdup(value);
     if (!action->data.srv_txt_set.value) {
         free(action->data.srv_txt_set.key);
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
         free(action->data.srv_txt_set.key);
         free(action->data.srv_txt_set.value);
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -4488,7 +5101,7 @@ esp_err_t mdns_service_txt_item_remove(const char * service, const char * proto,
     if (!s) {
         return ESP_ERR_NOT_FOUND;
     }
-    mdns_action_t * action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    mdns_action_t * action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         return ESP_ERR_NO_MEM;
@@ -4498,12 +5111,12 @@ esp_err_t mdns_service_txt_item_remove(const char * service, const char * proto,
     action->data.srv_txt_del.service = s;
     action->data.srv_txt_del.key = strdup(key);
     if (!action->data.srv_txt_del.key) {
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
         free(action->data.srv_txt_del.key);
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -4526,7 +5139,7 @@ esp_err_t mdns_service_instance_name_set(const char * service, const char * prot
         return ESP_ERR_NO_MEM;
     }
 
-    mdns_action_t * action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    mdns_action_t * action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         free(new_instance);
@@ -4537,7 +5150,7 @@ esp_err_t mdns_service_instance_name_set(const char * service, const char * prot
     action->data.srv_instance.instance = new_instance;
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
         free(new_instance);
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -4553,7 +5166,7 @@ esp_err_t mdns_service_remove(const char * service, const char * proto)
         return ESP_ERR_NOT_FOUND;
     }
 
-    mdns_action_t * action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    mdns_action_t * action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         return ESP_ERR_NO_MEM;
@@ -4561,7 +5174,7 @@ esp_err_t mdns_service_remove(const char * service, const char * proto)
     action->type = ACTION_SERVICE_DEL;
     action->data.srv_del.service = s;
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -4576,14 +5189,14 @@ esp_err_t mdns_service_remove_all(void)
         return ESP_OK;
     }
 
-    mdns_action_t * action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
+    mdns_action_t * action = _mdns_alloc_action();
     if (!action) {
         HOOK_MALLOC_FAILED;
         return ESP_ERR_NO_MEM;
     }
     action->type = ACTION_SERVICES_CLEAR;
     if (xQueueSend(_mdns_server->action_queue, &action, (portTickType)0) != pdPASS) {
-        free(action);
+        _mdns_release_action(action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
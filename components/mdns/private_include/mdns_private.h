@@ -57,10 +57,14 @@
 #define MDNS_SERVICE_STACK_DEPTH    4096                    // Stack size for the service thread
 #define MDNS_PACKET_QUEUE_LEN       16                      // Maximum packets that can be queued for parsing
 #define MDNS_ACTION_QUEUE_LEN       16                      // Maximum actions pending to the server
+#define MDNS_ACTION_POOL_SIZE       (MDNS_ACTION_QUEUE_LEN + 2) // Preallocated actions, more are allocated from heap
 #define MDNS_TXT_MAX_LEN            1024                    // Maximum string length of text data in TXT record
 #define MDNS_NAME_MAX_LEN           64                      // Maximum string length of hostname, instance, service and proto
 #define MDNS_NAME_BUF_LEN           (MDNS_NAME_MAX_LEN+1)   // Maximum char buffer size to hold hostname, instance, service or proto
 #define MDNS_MAX_PACKET_SIZE        1460                    // Maximum size of mDNS  outgoing packet
+#define MDNS_NAME_DICT_SIZE         128                     // Maximum names remembered for compression of outgoing packet
+#define MDNS_NAME_DICT_BUCKETS      32                      // Hash buckets of the name dictionary
+#define MDNS_NAME_DICT_NONE         0xFF
 
 #define MDNS_HEAD_LEN               12
 #define MDNS_HEAD_ID_OFFSET         0
@@ -81,7 +85,8 @@
 #define MDNS_SRV_PORT_OFFSET        4
 #define MDNS_SRV_FQDN_OFFSET        6
 
-#define MDNS_TIMER_PERIOD_US        100000
+#define MDNS_CACHE_MAX_TTL          86400                   // Cached records expire after a day at most
+#define MDNS_CACHE_FLUSH_DELAY      1000                    // Records received this many ms before a cache flush one are kept
 
 #define MDNS_SERVICE_LOCK()     xSemaphoreTake(_mdns_service_semaphore, portMAX_DELAY)
 #define MDNS_SERVICE_UNLOCK()   xSemaphoreGive(_mdns_service_semaphore)
@@ -117,6 +122,10 @@
 #define PCB_STATE_IS_ANNOUNCING(s) (s->state > PCB_PROBE_3 && s->state < PCB_RUNNING)
 #define PCB_STATE_IS_RUNNING(s) (s->state == PCB_RUNNING)
 
+#ifndef MDNS_NAME_DICT_ENABLED
+#define MDNS_NAME_DICT_ENABLED  true
+#endif
+
 #ifndef HOOK_MALLOC_FAILED
 #define HOOK_MALLOC_FAILED  ESP_LOGE(TAG, "Cannot allocate memory (line: %d, free heap: %d bytes)", __LINE__, esp_get_free_heap_size());
 #endif
@@ -145,9 +154,6 @@ typedef enum {
     ACTION_SERVICE_TXT_DEL,
     ACTION_SERVICES_CLEAR,
     ACTION_SEARCH_ADD,
-    ACTION_SEARCH_SEND,
-    ACTION_SEARCH_END,
-    ACTION_TX_HANDLE,
     ACTION_RX_HANDLE,
     ACTION_TASK_STOP,
     ACTION_MAX
@@ -187,6 +193,23 @@ typedef struct {
     bool    invalid;
 } mdns_name_t;
 
+typedef struct {
+    uint16_t hash;      //hash of the FQDN starting at offset
+    uint16_t offset;    //offset of the first label in the packet
+    uint8_t next;       //previous entry in the same bucket
+} mdns_name_dict_entry_t;
+
+/**
+ * @brief  Dictionary of the names written to the outgoing packet
+ */
+typedef struct {
+    const uint8_t * packet;
+    uint8_t count;
+    bool full;
+    uint8_t buckets[MDNS_NAME_DICT_BUCKETS];
+    mdns_name_dict_entry_t entries[MDNS_NAME_DICT_SIZE];
+} mdns_name_dict_t;
+
 typedef struct mdns_parsed_question_s {
     struct mdns_parsed_question_s * next;
     uint16_t type;
@@ -292,7 +315,6 @@ typedef struct mdns_tx_packet_s {
     mdns_out_answer_t * answers;
     mdns_out_answer_t * servers;
     mdns_out_answer_t * additional;
-    bool queued;
 } mdns_tx_packet_t;
 
 typedef struct {
@@ -329,6 +351,43 @@ typedef struct mdns_search_once_s {
     mdns_result_t * result;
 } mdns_search_once_t;
 
+/**
+ * @brief  Record received from another host
+ */
+typedef struct {
+    uint32_t expires_at;        //time in ms when the record expires
+    uint32_t received_at;       //time in ms when the record was last received
+    uint32_t ttl;               //TTL in seconds, as last received
+    tcpip_adapter_if_t tcpip_if;
+    mdns_ip_protocol_t ip_protocol;
+    uint16_t type;
+    uint8_t heap_index;         //position in the expiry heap
+    char * host;                //owner name, NULL if the part is empty
+    char * service;
+    char * proto;
+    union {
+        char * instance;        //PTR
+        struct {
+            char * hostname;
+            uint16_t port;
+        } srv;
+        struct {
+            uint8_t * data;
+            uint16_t len;
+        } txt;
+        ip_addr_t addr;         //A and AAAA
+    } data;
+} mdns_cache_record_t;
+
+/**
+ * @brief  Cache of records received from other hosts
+ */
+typedef struct {
+    mdns_cache_record_t * records;  //records in use are at the start of the array
+    uint8_t * heap;                 //indexes of the records in use, as a min-heap by expiry time
+    uint8_t count;
+} mdns_cache_t;
+
 typedef struct mdns_server_s {
     struct {
         mdns_pcb_t pcbs[MDNS_IP_PROTOCOL_MAX];
@@ -340,7 +399,7 @@ typedef struct mdns_server_s {
     QueueHandle_t action_queue;
     mdns_tx_packet_t * tx_queue_head;
     mdns_search_once_t * search_once;
-    esp_timer_handle_t timer_handle;
+    mdns_cache_t cache;
 } mdns_server_t;
 
 typedef struct {
@@ -383,9 +442,6 @@ typedef struct {
         struct {
             mdns_search_once_t * search;
         } search_add;
-        struct {
-            mdns_tx_packet_t * packet;
-        } tx_handle;
         struct {
             mdns_rx_packet_t * packet;
         } rx_handle;
@@ -34,6 +34,7 @@
 #include <sys/time.h>
 
 #define CONFIG_MDNS_MAX_SERVICES    25
+#define CONFIG_MDNS_CACHE_SIZE      32
 
 #define ERR_OK                      0
 #define ESP_OK                      0
@@ -69,6 +70,9 @@
 #define vSemaphoreDelete(s)         free(s)
 #define xTaskCreatePinnedToCore(a,b,c,d,e,f,g)     *(f) = malloc(1)
 #define vTaskDelay(m)               usleep((m)*0)
+#define portENTER_CRITICAL(m)
+#define portEXIT_CRITICAL(m)
+#define portMUX_INITIALIZER_UNLOCKED 0
 #define pbuf_free(p)                free(p)
 #define esp_random()                (rand()%UINT32_MAX)
 #define tcpip_adapter_get_ip_info(i,d)          true
@@ -103,6 +107,7 @@ typedef void * xQueueHandle;
 typedef void * QueueHandle_t;
 typedef void * TaskHandle_t;
 typedef void * esp_timer_handle_t;
+typedef int portMUX_TYPE;
 typedef uint32_t TickType_t;
 typedef uint32_t portTickType;
 
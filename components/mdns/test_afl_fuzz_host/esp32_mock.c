@@ -8,6 +8,8 @@
 void*     g_queue;
 int       g_queue_send_shall_fail = 0;
 int       g_size = 0;
+uint8_t   g_tx_packet[1460];
+size_t    g_tx_len = 0;
 
 const char * WIFI_EVENT = "wifi_event";
 const char * IP_EVENT = "ip_event";
@@ -57,6 +59,14 @@ uint32_t xTaskGetTickCount(void)
     return 0;
 }
 
+size_t mdns_test_udp_pcb_write(const uint8_t * data, size_t len)
+{
+    // Keep the last packet sent, so that tests could check it
+    g_tx_len = len < sizeof(g_tx_packet) ? len : sizeof(g_tx_packet);
+    memcpy(g_tx_packet, data, g_tx_len);
+    return len;
+}
+
 /// Queue mock
  QueueHandle_t xQueueCreate( uint32_t uxQueueLength, uint32_t uxItemSize )
  {
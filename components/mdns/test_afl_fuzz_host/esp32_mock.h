@@ -44,6 +44,8 @@ esp_err_t esp_event_handler_register(const char * event_base, int32_t event_id,
 
 esp_err_t esp_event_handler_unregister(const char * event_base, int32_t event_id, void* event_handler);
 
-#define _mdns_udp_pcb_write(tcpip_if, ip_protocol, ip, port, data, len) len
+size_t mdns_test_udp_pcb_write(const uint8_t * data, size_t len);
+
+#define _mdns_udp_pcb_write(tcpip_if, ip_protocol, ip, port, data, len) mdns_test_udp_pcb_write(data, len)
 
 #endif /* ESP32_MOCK_H_ */
\ No newline at end of file
@@ -3,6 +3,10 @@
  * 
  */
 
+// Name compression can be switched between the dictionary and scanning the packet
+#define MDNS_NAME_DICT_ENABLED mdns_test_name_dict_enabled
+bool mdns_test_name_dict_enabled = true;
+
 #include "mdns.h"
 #include "mdns_private.h"
 
@@ -11,12 +15,24 @@ mdns_srv_item_t * (*mdns_test_static_mdns_get_service_item)(const char * service
 mdns_search_once_t * (*mdns_test_static_search_init)(const char * name, const char * service, const char * proto, uint16_t type, uint32_t timeout, uint8_t max_results) = NULL;
 esp_err_t         (*mdns_test_static_send_search_action)(mdns_action_type_t type, mdns_search_once_t * search) = NULL;
 void              (*mdns_test_static_search_free)(mdns_search_once_t * search) = NULL;
+mdns_tx_packet_t * (*mdns_test_static_create_probe_packet)(tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol, mdns_srv_item_t * services[], size_t len, bool first, bool include_ip) = NULL;
+mdns_tx_packet_t * (*mdns_test_static_create_announce_packet)(tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol, mdns_srv_item_t * services[], size_t len, bool include_ip) = NULL;
+void              (*mdns_test_static_dispatch_tx_packet)(mdns_tx_packet_t * p) = NULL;
+void              (*mdns_test_static_free_tx_packet)(mdns_tx_packet_t * packet) = NULL;
+void              (*mdns_test_static_schedule_tx_packet)(mdns_tx_packet_t * packet, uint32_t ms_after) = NULL;
+TickType_t        (*mdns_test_static_timed_run)(void) = NULL;
 
 static void _mdns_execute_action(mdns_action_t * action);
 static mdns_srv_item_t * _mdns_get_service_item(const char * service, const char * proto);
 static mdns_search_once_t * _mdns_search_init(const char * name, const char * service, const char * proto, uint16_t type, uint32_t timeout, uint8_t max_results);
 static esp_err_t _mdns_send_search_action(mdns_action_type_t type, mdns_search_once_t * search);
 static void _mdns_search_free(mdns_search_once_t * search);
+static mdns_tx_packet_t * _mdns_create_probe_packet(tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol, mdns_srv_item_t * services[], size_t len, bool first, bool include_ip);
+static mdns_tx_packet_t * _mdns_create_announce_packet(tcpip_adapter_if_t tcpip_if, mdns_ip_protocol_t ip_protocol, mdns_srv_item_t * services[], size_t len, bool include_ip);
+static void _mdns_dispatch_tx_packet(mdns_tx_packet_t * p);
+static void _mdns_free_tx_packet(mdns_tx_packet_t * packet);
+static void _mdns_schedule_tx_packet(mdns_tx_packet_t * packet, uint32_t ms_after);
+static TickType_t _mdns_timed_run(void);
 
 void mdns_test_init_di(void)
 {
@@ -25,6 +41,12 @@ void mdns_test_init_di(void)
     mdns_test_static_search_init = _mdns_search_init;
     mdns_test_static_send_search_action = _mdns_send_search_action;
     mdns_test_static_search_free = _mdns_search_free;
+    mdns_test_static_create_probe_packet = _mdns_create_probe_packet;
+    mdns_test_static_create_announce_packet = _mdns_create_announce_packet;
+    mdns_test_static_dispatch_tx_packet = _mdns_dispatch_tx_packet;
+    mdns_test_static_free_tx_packet = _mdns_free_tx_packet;
+    mdns_test_static_schedule_tx_packet = _mdns_schedule_tx_packet;
+    mdns_test_static_timed_run = _mdns_timed_run;
 }
 
 void mdns_test_execute_action(void * action)
@@ -50,4 +72,34 @@ mdns_search_once_t * mdns_test_search_init(const char * name, const char * servi
 mdns_srv_item_t * mdns_test_mdns_get_service_item(const char * service, const char * proto)
 {
     return mdns_test_static_mdns_get_service_item(service, proto);
-}
\ No newline at end of file
+}
+
+mdns_tx_packet_t * mdns_test_create_probe_packet(mdns_srv_item_t * services[], size_t len, bool first)
+{
+    return mdns_test_static_create_probe_packet(TCPIP_ADAPTER_IF_STA, MDNS_IP_PROTOCOL_V4, services, len, first, false);
+}
+
+mdns_tx_packet_t * mdns_test_create_announce_packet(mdns_srv_item_t * services[], size_t len)
+{
+    return mdns_test_static_create_announce_packet(TCPIP_ADAPTER_IF_STA, MDNS_IP_PROTOCOL_V4, services, len, false);
+}
+
+void mdns_test_dispatch_tx_packet(mdns_tx_packet_t * p)
+{
+    mdns_test_static_dispatch_tx_packet(p);
+}
+
+void mdns_test_free_tx_packet(mdns_tx_packet_t * packet)
+{
+    mdns_test_static_free_tx_packet(packet);
+}
+
+void mdns_test_schedule_tx_packet(mdns_tx_packet_t * packet, uint32_t ms_after)
+{
+    mdns_test_static_schedule_tx_packet(packet, ms_after);
+}
+
+TickType_t mdns_test_timed_run(void)
+{
+    return mdns_test_static_timed_run();
+}
@@ -0,0 +1,286 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Checks that records announced by other hosts are cached, expire with
+// their TTL and answer queries without sending them
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mdns.h"
+#include "mdns_private.h"
+
+#define CHECK(cond) do { if (!(cond)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+extern mdns_server_t * _mdns_server;
+extern size_t g_tx_len;
+
+static int failures = 0;
+
+//
+// Dependency injected test functions
+void mdns_test_execute_action(void * action);
+mdns_search_once_t * mdns_test_search_init(const char * name, const char * service, const char * proto, uint16_t type, uint32_t timeout, uint8_t max_results);
+esp_err_t mdns_test_send_search_action(mdns_action_type_t type, mdns_search_once_t * search);
+void mdns_test_search_free(mdns_search_once_t * search);
+void mdns_test_init_di(void);
+void mdns_parse_packet(mdns_rx_packet_t * packet);
+
+//
+// Builder of response packets, as announced by other hosts
+static uint8_t packet[1460];
+static size_t packet_len;
+static uint16_t packet_answers;
+
+static void packet_start(void)
+{
+    memset(packet, 0, 12);
+    packet[2] = 0x84;           // authoritative response
+    packet_len = 12;
+    packet_answers = 0;
+}
+
+static void packet_u16(uint16_t value)
+{
+    packet[packet_len++] = value >> 8;
+    packet[packet_len++] = value & 0xFF;
+}
+
+static void packet_name(const char * a, const char * b, const char * c)
+{
+    const char * parts[4] = { a, b, c, "local" };
+    int i;
+    for (i = 0; i < 4; i++) {
+        if (parts[i]) {
+            packet[packet_len++] = strlen(parts[i]);
+            memcpy(packet + packet_len, parts[i], strlen(parts[i]));
+            packet_len += strlen(parts[i]);
+        }
+    }
+    packet[packet_len++] = 0;
+}
+
+static size_t packet_record(uint16_t type, bool flush, uint32_t ttl)
+{
+    packet_u16(type);
+    packet_u16(flush ? 0x8001 : 0x0001);
+    packet_u16(ttl >> 16);
+    packet_u16(ttl & 0xFFFF);
+    packet_u16(0);              // data length, set by packet_record_end()
+    packet_answers++;
+    return packet_len;
+}
+
+static void packet_record_end(size_t data_start)
+{
+    packet[data_start - 2] = (packet_len - data_start) >> 8;
+    packet[data_start - 1] = (packet_len - data_start) & 0xFF;
+}
+
+static void add_ptr(const char * instance, const char * service, uint32_t ttl)
+{
+    packet_name(NULL, service, "_tcp");
+    size_t start = packet_record(MDNS_TYPE_PTR, false, ttl);
+    packet_name(instance, service, "_tcp");
+    packet_record_end(start);
+}
+
+static void add_srv(const char * instance, const char * service, const char * host, uint16_t port, uint32_t ttl)
+{
+    packet_name(instance, service, "_tcp");
+    size_t start = packet_record(MDNS_TYPE_SRV, true, ttl);
+    packet_u16(0);
+    packet_u16(0);
+    packet_u16(port);
+    packet_name(host, NULL, NULL);
+    packet_record_end(start);
+}
+
+static void add_txt(const char * instance, const char * service, const char * item, uint32_t ttl)
+{
+    packet_name(instance, service, "_tcp");
+    size_t start = packet_record(MDNS_TYPE_TXT, true, ttl);
+    packet[packet_len++] = strlen(item);
+    memcpy(packet + packet_len, item, strlen(item));
+    packet_len += strlen(item);
+    packet_record_end(start);
+}
+
+static void add_a(const char * host, uint8_t last_byte, bool flush, uint32_t ttl)
+{
+    packet_name(host, NULL, NULL);
+    size_t start = packet_record(MDNS_TYPE_A, flush, ttl);
+    packet[packet_len++] = 192;
+    packet[packet_len++] = 168;
+    packet[packet_len++] = 1;
+    packet[packet_len++] = last_byte;
+    packet_record_end(start);
+}
+
+static void packet_receive(void)
+{
+    static struct pbuf pb;
+    static mdns_rx_packet_t rx;
+    packet[6] = packet_answers >> 8;
+    packet[7] = packet_answers & 0xFF;
+    pb.payload = packet;
+    pb.len = packet_len;
+    memset(&rx, 0, sizeof(rx));
+    rx.tcpip_if = TCPIP_ADAPTER_IF_STA;
+    rx.ip_protocol = MDNS_IP_PROTOCOL_V4;
+    rx.pb = &pb;
+    rx.src_port = MDNS_SERVICE_PORT;
+    rx.multicast = 1;
+    mdns_parse_packet(&rx);
+}
+
+//
+// Runs a query the way mdns_query() does, and returns its results if it was
+// answered without asking the network
+static mdns_result_t * query(const char * name, const char * service, uint16_t type, uint8_t max_results, bool * answered)
+{
+    mdns_search_once_t * search = mdns_test_search_init(name, service, service ? "_tcp" : NULL, type, 3000, max_results);
+    mdns_action_t * a = NULL;
+    if (!search || mdns_test_send_search_action(ACTION_SEARCH_ADD, search)) {
+        abort();
+    }
+    GetLastItem(&a);
+    g_tx_len = 0;
+    mdns_test_execute_action(a);
+    *answered = search->state == SEARCH_OFF;
+    mdns_result_t * results = search->result;
+    if (!*answered) {
+        // still running, remove it as its timeout would
+        search->state = SEARCH_OFF;
+        queueDetach(mdns_search_once_t, _mdns_server->search_once, search);
+    }
+    CHECK(g_tx_len == 0);
+    mdns_test_search_free(search);
+    return results;
+}
+
+static void check_ip(mdns_result_t * r, uint8_t last_byte)
+{
+    CHECK(r && r->addr && r->addr->addr.type == IPADDR_TYPE_V4);
+    if (r && r->addr) {
+        CHECK(((r->addr->addr.u_addr.ip4.addr >> 24) & 0xFF) == last_byte);
+    }
+}
+
+int main(void)
+{
+    mdns_result_t * r;
+    bool answered;
+
+    mdns_test_init_di();
+    if (mdns_init()) {
+        abort();
+    }
+
+    // Nothing is known yet
+    r = query("printer", NULL, MDNS_TYPE_A, 1, &answered);
+    CHECK(!answered && !r);
+
+    // Another host announces its service
+    packet_start();
+    add_ptr("Office Printer", "_ipp", 4500);
+    add_srv("Office Printer", "_ipp", "printer", 631, 120);
+    add_txt("Office Printer", "_ipp", "rp=ipp/print", 4500);
+    add_a("printer", 10, true, 120);
+    packet_receive();
+    CHECK(_mdns_server->cache.count == 4);
+
+    r = query("printer", NULL, MDNS_TYPE_A, 1, &answered);
+    CHECK(answered);
+    check_ip(r, 10);
+    mdns_query_results_free(r);
+
+    r = query("PRINTER", NULL, MDNS_TYPE_AAAA, 1, &answered);
+    CHECK(!answered && !r);
+
+    r = query(NULL, "_ipp", MDNS_TYPE_PTR, 1, &answered);
+    CHECK(answered);
+    CHECK(r && r->instance_name && !strcmp(r->instance_name, "Office Printer"));
+    CHECK(r && r->hostname && !strcmp(r->hostname, "printer") && r->port == 631);
+    CHECK(r && r->txt_count == 1 && !strcmp(r->txt[0].key, "rp") && !strcmp(r->txt[0].value, "ipp/print"));
+    check_ip(r, 10);
+    mdns_query_results_free(r);
+
+    r = query("Office Printer", "_ipp", MDNS_TYPE_SRV, 1, &answered);
+    CHECK(answered && r && r->port == 631);
+    mdns_query_results_free(r);
+
+    // Browsing for all instances still asks the network, with the cached ones as results
+    r = query(NULL, "_ipp", MDNS_TYPE_PTR, 0, &answered);
+    CHECK(!answered && r && !r->next);
+    mdns_query_results_free(r);
+
+    // A refreshed record is not duplicated, a second address is added
+    packet_start();
+    add_a("printer", 10, false, 120);
+    add_a("printer", 11, false, 120);
+    packet_receive();
+    CHECK(_mdns_server->cache.count == 5);
+
+    // A record with the cache flush bit replaces the ones received more than a second ago
+    sleep(2);
+    packet_start();
+    add_a("printer", 12, true, 120);
+    packet_receive();
+    CHECK(_mdns_server->cache.count == 4);
+    r = query("printer", NULL, MDNS_TYPE_A, 1, &answered);
+    CHECK(answered);
+    check_ip(r, 12);
+    CHECK(r && r->addr && !r->addr->next);
+    mdns_query_results_free(r);
+
+    // Goodbye records expire after a second, records expire with their TTL
+    packet_start();
+    add_a("printer", 12, true, 0);
+    add_a("scanner", 20, true, 1);
+    packet_receive();
+    CHECK(_mdns_server->cache.count == 5);
+    sleep(2);
+    r = query("printer", NULL, MDNS_TYPE_A, 1, &answered);
+    CHECK(!answered && !r);
+    r = query("scanner", NULL, MDNS_TYPE_A, 1, &answered);
+    CHECK(!answered && !r);
+    CHECK(_mdns_server->cache.count == 3);
+
+    // The cache is bounded, dropping the records closest to expiry
+    int i;
+    char host[16];
+    for (i = 0; i < 2 * CONFIG_MDNS_CACHE_SIZE; i++) {
+        packet_start();
+        snprintf(host, sizeof(host), "host-%d", i);
+        add_a(host, i, true, 1000 + i);
+        packet_receive();
+    }
+    CHECK(_mdns_server->cache.count == CONFIG_MDNS_CACHE_SIZE);
+    r = query("host-0", NULL, MDNS_TYPE_A, 1, &answered);
+    CHECK(!answered && !r);
+    snprintf(host, sizeof(host), "host-%d", 2 * CONFIG_MDNS_CACHE_SIZE - 1);
+    r = query(host, NULL, MDNS_TYPE_A, 1, &answered);
+    CHECK(answered);
+    check_ip(r, 2 * CONFIG_MDNS_CACHE_SIZE - 1);
+    mdns_query_results_free(r);
+
+    ForceTaskDelete();
+    mdns_free();
+    printf("Record cache test %s\n", failures ? "failed" : "passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,167 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Checks that outgoing packets compressed with the name dictionary are
+// identical to the ones compressed by scanning the packet, and compares
+// the time it takes to build them
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mdns.h"
+#include "mdns_private.h"
+
+#define SERVICES_NUM    24
+#define BENCH_ROUNDS    2000
+
+extern uint8_t g_tx_packet[];
+extern size_t  g_tx_len;
+extern bool    mdns_test_name_dict_enabled;
+
+//
+// Dependency injected test functions
+void mdns_test_execute_action(void * action);
+mdns_srv_item_t * mdns_test_mdns_get_service_item(const char * service, const char * proto);
+mdns_tx_packet_t * mdns_test_create_probe_packet(mdns_srv_item_t * services[], size_t len, bool first);
+mdns_tx_packet_t * mdns_test_create_announce_packet(mdns_srv_item_t * services[], size_t len);
+void mdns_test_dispatch_tx_packet(mdns_tx_packet_t * p);
+void mdns_test_free_tx_packet(mdns_tx_packet_t * packet);
+void mdns_test_init_di(void);
+
+static void execute_last_action(void)
+{
+    mdns_action_t * a = NULL;
+    GetLastItem(&a);
+    mdns_test_execute_action(a);
+}
+
+static mdns_srv_item_t * add_service(const char * instance, const char * service, const char * proto, uint16_t port)
+{
+    mdns_txt_item_t txt[3] = {
+        {"board", "esp32"},
+        {"path", "/"},
+        {"version", service + 1}
+    };
+    // Fails as the service thread is not running, the action is executed below
+    mdns_service_add(instance, service, proto, port, txt, 3);
+    execute_last_action();
+    return mdns_test_mdns_get_service_item(service, proto);
+}
+
+static size_t build_packet(mdns_tx_packet_t * p, bool use_dict, uint8_t * out)
+{
+    mdns_test_name_dict_enabled = use_dict;
+    g_tx_len = 0;
+    mdns_test_dispatch_tx_packet(p);
+    memcpy(out, g_tx_packet, g_tx_len);
+    return g_tx_len;
+}
+
+static int compare_packet(const char * what, mdns_tx_packet_t * p)
+{
+    uint8_t with_dict[MDNS_MAX_PACKET_SIZE];
+    uint8_t with_scan[MDNS_MAX_PACKET_SIZE];
+    if (!p) {
+        printf("%s: cannot create packet\n", what);
+        return 1;
+    }
+    size_t dict_len = build_packet(p, true, with_dict);
+    size_t scan_len = build_packet(p, false, with_scan);
+    mdns_test_free_tx_packet(p);
+    if (!dict_len || dict_len != scan_len || memcmp(with_dict, with_scan, dict_len)) {
+        printf("%s: packets differ (%zu / %zu bytes)\n", what, dict_len, scan_len);
+        return 1;
+    }
+    return 0;
+}
+
+static double bench_packet(mdns_tx_packet_t * p, bool use_dict)
+{
+    uint8_t out[MDNS_MAX_PACKET_SIZE];
+    struct timespec start, end;
+    int i;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        build_packet(p, use_dict, out);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / BENCH_ROUNDS / 1000;
+}
+
+int main(void)
+{
+    const char * names[SERVICES_NUM] = {
+        "_http", "_https", "_workstation", "_arduino", "_afpovertcp", "_rfb", "_smb", "_adisk",
+        "_airport", "_printer", "_airplay", "_raop", "_uscan", "_uscans", "_ippusb", "_scanner",
+        "_ipp", "_ipps", "_pdl-datastream", "_ptp", "_sleep-proxy", "_mqtt", "_coap", "_ssh"
+    };
+    mdns_srv_item_t * services[SERVICES_NUM];
+    char instance[SERVICES_NUM][32];
+    int failures = 0;
+    size_t i, len;
+
+    mdns_test_init_di();
+    if (mdns_init()) {
+        abort();
+    }
+    mdns_hostname_set("esp32-bench");
+    execute_last_action();
+    mdns_instance_name_set("ESP32 Bench");
+    execute_last_action();
+
+    for (i = 0; i < SERVICES_NUM; i++) {
+        // Mix default and own instance names, the latter differing only in case from the host name
+        const char * inst = NULL;
+        if (i % 3 == 1) {
+            snprintf(instance[i], sizeof(instance[i]), "ESP32-Bench");
+            inst = instance[i];
+        } else if (i % 3 == 2) {
+            snprintf(instance[i], sizeof(instance[i]), "Device %zu", i);
+            inst = instance[i];
+        }
+        services[i] = add_service(inst, names[i], (i % 4 == 3) ? "_udp" : "_tcp", 8000 + i);
+        if (!services[i]) {
+            abort();
+        }
+    }
+
+    char what[64];
+    for (len = 1; len <= SERVICES_NUM; len++) {
+        for (i = 0; i + len <= SERVICES_NUM; i++) {
+            snprintf(what, sizeof(what), "announce %zu-%zu", i, i + len - 1);
+            failures += compare_packet(what, mdns_test_create_announce_packet(services + i, len));
+            snprintf(what, sizeof(what), "probe %zu-%zu", i, i + len - 1);
+            failures += compare_packet(what, mdns_test_create_probe_packet(services + i, len, i & 1));
+        }
+    }
+    printf("Compared %d packets with the name dictionary and with scanning: %d differ\n",
+           SERVICES_NUM * (SERVICES_NUM + 1), failures);
+
+    mdns_tx_packet_t * p = mdns_test_create_announce_packet(services, SERVICES_NUM);
+    if (!p) {
+        abort();
+    }
+    double scan_us = bench_packet(p, false);
+    double dict_us = bench_packet(p, true);
+    printf("Announce of %d services (%zu bytes): scanning %.1f us, dictionary %.1f us per packet\n",
+           SERVICES_NUM, g_tx_len, scan_us, dict_us);
+    mdns_test_free_tx_packet(p);
+
+    ForceTaskDelete();
+    mdns_free();
+    return failures ? 1 : 0;
+}
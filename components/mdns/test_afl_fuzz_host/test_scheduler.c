@@ -0,0 +1,149 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Checks that the service task sleeps until the next scheduled packet or
+// search is due, and runs them once they are
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mdns.h"
+#include "mdns_private.h"
+
+#define CHECK(cond) do { if (!(cond)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+extern mdns_server_t * _mdns_server;
+extern size_t g_tx_len;
+
+static int failures = 0;
+
+//
+// Dependency injected test functions
+void mdns_test_execute_action(void * action);
+mdns_srv_item_t * mdns_test_mdns_get_service_item(const char * service, const char * proto);
+mdns_search_once_t * mdns_test_search_init(const char * name, const char * service, const char * proto, uint16_t type, uint32_t timeout, uint8_t max_results);
+esp_err_t mdns_test_send_search_action(mdns_action_type_t type, mdns_search_once_t * search);
+void mdns_test_search_free(mdns_search_once_t * search);
+mdns_tx_packet_t * mdns_test_create_announce_packet(mdns_srv_item_t * services[], size_t len);
+void mdns_test_schedule_tx_packet(mdns_tx_packet_t * packet, uint32_t ms_after);
+TickType_t mdns_test_timed_run(void);
+void mdns_test_init_di(void);
+
+static void execute_last_action(void)
+{
+    mdns_action_t * a = NULL;
+    GetLastItem(&a);
+    mdns_test_execute_action(a);
+}
+
+int main(void)
+{
+    TickType_t wait;
+
+    mdns_test_init_di();
+    if (mdns_init()) {
+        abort();
+    }
+    mdns_hostname_set("esp32-scheduler");
+    execute_last_action();
+    mdns_service_add(NULL, "_http", "_tcp", 80, NULL, 0);
+    execute_last_action();
+    mdns_srv_item_t * service = mdns_test_mdns_get_service_item("_http", "_tcp");
+    if (!service) {
+        abort();
+    }
+    // Packets are written by the mock, the pcb only has to be set
+    static int dummy_pcb;
+    mdns_pcb_t * pcb = &_mdns_server->interfaces[TCPIP_ADAPTER_IF_STA].pcbs[MDNS_IP_PROTOCOL_V4];
+    pcb->pcb = (struct udp_pcb *)&dummy_pcb;
+    pcb->state = PCB_RUNNING;
+
+    // Nothing to wait for
+    CHECK(mdns_test_timed_run() == portMAX_DELAY);
+
+    // Packets are kept until they are due, the task sleeps until then
+    mdns_tx_packet_t * later = mdns_test_create_announce_packet(&service, 1);
+    mdns_tx_packet_t * sooner = mdns_test_create_announce_packet(&service, 1);
+    if (!later || !sooner) {
+        abort();
+    }
+    mdns_test_schedule_tx_packet(later, 400);
+    mdns_test_schedule_tx_packet(sooner, 200);
+    g_tx_len = 0;
+    wait = mdns_test_timed_run();
+    CHECK(wait > 150 / portTICK_PERIOD_MS && wait <= 200 / portTICK_PERIOD_MS);
+    CHECK(g_tx_len == 0 && _mdns_server->tx_queue_head == sooner);
+
+    usleep(250 * 1000);
+    wait = mdns_test_timed_run();
+    CHECK(g_tx_len != 0 && _mdns_server->tx_queue_head == later);
+    CHECK(wait > 100 / portTICK_PERIOD_MS && wait <= 150 / portTICK_PERIOD_MS);
+
+    // Packets scheduled right away are sent on the next run
+    mdns_test_schedule_tx_packet(mdns_test_create_announce_packet(&service, 1), 0);
+    g_tx_len = 0;
+    mdns_test_timed_run();
+    CHECK(g_tx_len != 0 && _mdns_server->tx_queue_head == later);
+
+    usleep(200 * 1000);
+    g_tx_len = 0;
+    CHECK(mdns_test_timed_run() == portMAX_DELAY);
+    CHECK(g_tx_len != 0 && !_mdns_server->tx_queue_head);
+
+    // A new search is sent right away, then every second until it times out
+    mdns_search_once_t * search = mdns_test_search_init(NULL, "_http", "_tcp", MDNS_TYPE_PTR, 1500, 0);
+    if (!search || mdns_test_send_search_action(ACTION_SEARCH_ADD, search)) {
+        abort();
+    }
+    execute_last_action();
+    CHECK(search->state == SEARCH_INIT);
+    g_tx_len = 0;
+    wait = mdns_test_timed_run();
+    CHECK(search->state == SEARCH_RUNNING && g_tx_len != 0);
+    CHECK(wait > 950 / portTICK_PERIOD_MS && wait <= 1000 / portTICK_PERIOD_MS);
+
+    g_tx_len = 0;
+    CHECK(mdns_test_timed_run() > 900 / portTICK_PERIOD_MS && g_tx_len == 0);
+
+    usleep(1050 * 1000);
+    wait = mdns_test_timed_run();
+    CHECK(search->state == SEARCH_RUNNING && g_tx_len != 0);
+    CHECK(wait > 400 / portTICK_PERIOD_MS && wait <= 450 / portTICK_PERIOD_MS);
+
+    usleep(500 * 1000);
+    CHECK(mdns_test_timed_run() == portMAX_DELAY);
+    CHECK(search->state == SEARCH_OFF && !_mdns_server->search_once);
+    mdns_test_search_free(search);
+
+    // Actions are allocated from heap when all the preallocated ones are pending
+    mdns_action_t * actions[MDNS_ACTION_POOL_SIZE + 2];
+    size_t i;
+    for (i = 0; i < sizeof(actions) / sizeof(actions[0]); i++) {
+        CHECK(mdns_instance_name_set("Scheduler") == ESP_OK);
+        GetLastItem(&actions[i]);
+    }
+    for (i = 0; i < sizeof(actions) / sizeof(actions[0]); i++) {
+        mdns_test_execute_action(actions[i]);
+    }
+
+    pcb->pcb = NULL;
+    pcb->state = PCB_OFF;
+    ForceTaskDelete();
+    mdns_free();
+    printf("Scheduler test %s\n", failures ? "failed" : "passed");
+    return failures ? 1 : 0;
+}
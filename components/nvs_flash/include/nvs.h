@@ -110,6 +110,16 @@ typedef struct {
  */
 typedef struct nvs_opaque_iterator_t *nvs_iterator_t;
 
+/**
+ * Opaque pointer type representing a batch of values to be written together
+ */
+typedef struct nvs_opaque_batch_t *nvs_batch_handle_t;
+
+/**
+ * Opaque pointer type representing a blob opened for streaming access
+ */
+typedef struct nvs_opaque_blob_t *nvs_blob_handle_t;
+
 /**
  * @brief      Open non-volatile storage with a given namespace from the default NVS partition
  *
@@ -495,6 +505,245 @@ esp_err_t nvs_get_stats(const char *part_name, nvs_stats_t *nvs_stats);
  */
 esp_err_t nvs_get_used_entry_count(nvs_handle_t handle, size_t* used_entries);
 
+/**
+ * @brief      Start a batch of values to be written together
+ *
+ * Values set with nvs_batch_set_* functions are kept in RAM and written
+ * to flash by nvs_batch_commit. The batch is written to a single page,
+ * and the entry state table is updated once for the whole batch. After
+ * a reset, either all values of the batch are visible, or none of them.
+ *
+ * The whole batch has to fit into one page (126 entries). Primitive values
+ * take one entry; strings and blobs take one entry plus one per 32 bytes of
+ * data, and blobs one more entry for the blob index.
+ *
+ * @param[in]  handle     Handle obtained from nvs_open function.
+ *                        Handles that were opened read only cannot be used.
+ * @param[out] out_batch  If successful (return code is zero), batch handle
+ *                        will be returned in this argument.
+ *
+ * @return
+ *             - ESP_OK if the batch was created successfully
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if storage handle was opened as read only
+ */
+esp_err_t nvs_batch_begin(nvs_handle_t handle, nvs_batch_handle_t *out_batch);
+
+/**@{*/
+/**
+ * @brief      stage value for given key in a batch
+ *
+ * This family of functions add the value to the batch. Flash is not accessed
+ * until nvs_batch_commit is called. If the same key is set more than once,
+ * the last value is kept.
+ *
+ * @param[in]  batch   Batch handle obtained from nvs_batch_begin function.
+ * @param[in]  key     Key name. Maximal length is 15 characters. Shouldn't be empty.
+ * @param[in]  value   The value to set.
+ *                     For strings, the maximum length (including null character) is
+ *                     4000 bytes.
+ *
+ * @return
+ *             - ESP_OK if value was added to the batch
+ *             - ESP_ERR_NVS_INVALID_HANDLE if batch is NULL
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if key name is too long
+ *             - ESP_ERR_NVS_VALUE_TOO_LONG if the string value is too long
+ */
+esp_err_t nvs_batch_set_i8  (nvs_batch_handle_t batch, const char* key, int8_t value);
+esp_err_t nvs_batch_set_u8  (nvs_batch_handle_t batch, const char* key, uint8_t value);
+esp_err_t nvs_batch_set_i16 (nvs_batch_handle_t batch, const char* key, int16_t value);
+esp_err_t nvs_batch_set_u16 (nvs_batch_handle_t batch, const char* key, uint16_t value);
+esp_err_t nvs_batch_set_i32 (nvs_batch_handle_t batch, const char* key, int32_t value);
+esp_err_t nvs_batch_set_u32 (nvs_batch_handle_t batch, const char* key, uint32_t value);
+esp_err_t nvs_batch_set_i64 (nvs_batch_handle_t batch, const char* key, int64_t value);
+esp_err_t nvs_batch_set_u64 (nvs_batch_handle_t batch, const char* key, uint64_t value);
+esp_err_t nvs_batch_set_str (nvs_batch_handle_t batch, const char* key, const char* value);
+/**@}*/
+
+/**
+ * @brief      stage variable length binary value for given key in a batch
+ *
+ * @param[in]  batch   Batch handle obtained from nvs_batch_begin function.
+ * @param[in]  key     Key name. Maximal length is 15 characters. Shouldn't be empty.
+ * @param[in]  value   The value to set.
+ * @param[in]  length  length of binary value to set, in bytes; Maximum length is
+ *                     3968 bytes, since the blob has to fit into one page.
+ *
+ * @return
+ *             - ESP_OK if value was added to the batch
+ *             - ESP_ERR_NVS_INVALID_HANDLE if batch is NULL
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if key name is too long
+ *             - ESP_ERR_NVS_VALUE_TOO_LONG if the value is too long
+ */
+esp_err_t nvs_batch_set_blob(nvs_batch_handle_t batch, const char* key, const void* value, size_t length);
+
+/**
+ * @brief      Write all values of the batch to flash
+ *
+ * Values which are equal to the ones already stored are skipped. The batch
+ * handle is released by this function, whether the commit succeeds or not.
+ *
+ * @param[in]  batch   Batch handle obtained from nvs_batch_begin function.
+ *
+ * @return
+ *             - ESP_OK if all values were written successfully
+ *             - ESP_ERR_NVS_INVALID_HANDLE if batch is NULL, or the handle
+ *               it was created with has been closed
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if the batch doesn't fit into one
+ *               page, or there is not enough space in the underlying storage;
+ *               nothing is written in this case
+ *             - ESP_ERR_NVS_REMOVE_FAILED if old values weren't removed because flash
+ *               write operation has failed. The batch was written however, and
+ *               update will be finished after re-initialization of nvs, provided that
+ *               flash operation doesn't fail again.
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_batch_commit(nvs_batch_handle_t batch);
+
+/**
+ * @brief      Release the batch without writing anything
+ *
+ * @param[in]  batch   Batch handle obtained from nvs_batch_begin function.
+ *                     NULL argument is allowed.
+ */
+void nvs_batch_abort(nvs_batch_handle_t batch);
+
+/**
+ * @brief      Open a blob for reading and appending in parts
+ *
+ * Chunks of the blob are located once, when the blob is opened. Data can then
+ * be read with nvs_blob_read_at and added with nvs_blob_append through a buffer
+ * of any size, so the whole blob never has to be kept in RAM.
+ *
+ * Data passed to nvs_blob_append is written to flash right away, but it becomes
+ * part of the blob only when nvs_blob_close is called. If power goes off before
+ * that, the blob keeps its previous value. To replace the value of a blob, call
+ * nvs_blob_truncate and append the new data.
+ *
+ * @param[in]  handle     Handle obtained from nvs_open function.
+ * @param[in]  key        Key name. Maximal length is determined by the underlying
+ *                        implementation, but is guaranteed to be at least
+ *                        15 characters. Shouldn't be empty.
+ * @param[out] out_blob   If ok, returns the blob handle. It has to be released
+ *                        using nvs_blob_close or nvs_blob_abort.
+ *
+ * @return
+ *             - ESP_OK if blob was opened successfully
+ *             - ESP_ERR_NVS_NOT_FOUND if the blob does not exist and the handle
+ *               was opened read only. For handles opened read-write, an empty
+ *               blob is created instead.
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if key name is too long
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_open(nvs_handle_t handle, const char* key, nvs_blob_handle_t* out_blob);
+
+/**
+ * @brief      Get size of the blob as it was when it was opened
+ *
+ * @param[in]  blob      Blob handle obtained from nvs_blob_open function.
+ * @param[out] length    Size of the blob data in bytes.
+ *
+ * @return
+ *             - ESP_OK if the size was returned
+ *             - ESP_ERR_NVS_INVALID_HANDLE if blob handle is NULL
+ */
+esp_err_t nvs_blob_get_size(nvs_blob_handle_t blob, size_t* length);
+
+/**
+ * @brief      Read part of the blob
+ *
+ * Only data present when the blob was opened can be read. Data read in order
+ * from the start of each chunk is checked against the chunk checksum.
+ *
+ * @param[in]  blob      Blob handle obtained from nvs_blob_open function.
+ * @param[in]  offset    Offset in the blob to read from.
+ * @param[out] out_value Buffer to read data into.
+ * @param[in]  length    Number of bytes to read.
+ *
+ * @return
+ *             - ESP_OK if the data was read successfully
+ *             - ESP_ERR_NVS_INVALID_LENGTH if offset and length are out of the blob
+ *             - ESP_ERR_NVS_NOT_FOUND if the blob was erased or written while
+ *               it was open, or if its data is corrupted
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the blob or the NVS handle used
+ *               to open it has been closed
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_read_at(nvs_blob_handle_t blob, size_t offset, void* out_value, size_t length);
+
+/**
+ * @brief      Append data to the blob
+ *
+ * Data is written in chunks straight to flash, only the last partial 32-byte
+ * entry is kept in RAM. If this function fails, the blob handle is aborted:
+ * further calls to nvs_blob_append return the same error, and nvs_blob_close
+ * discards the appended data and returns that error too.
+ *
+ * @param[in]  blob      Blob handle obtained from nvs_blob_open function.
+ * @param[in]  value     Data to append.
+ * @param[in]  length    Number of bytes to append.
+ *
+ * @return
+ *             - ESP_OK if the data was written successfully
+ *             - ESP_ERR_NVS_READ_ONLY if the NVS handle was opened as read only
+ *             - ESP_ERR_NVS_VALUE_TOO_LONG if the blob would become larger than
+ *               the partition can hold
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the blob or the NVS handle used
+ *               to open it has been closed
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_append(nvs_blob_handle_t blob, const void* value, size_t length);
+
+/**
+ * @brief      Discard the value of the blob, so that appended data replaces it
+ *
+ * Data appended so far is discarded, and data appended afterwards is written
+ * as a new version of the blob, next to the existing one. The existing value
+ * can still be read and is erased only when nvs_blob_close is called, so if
+ * power goes off before that, the blob keeps its previous value. If nothing is
+ * appended after this call, nvs_blob_close makes the blob empty.
+ *
+ * @param[in]  blob      Blob handle obtained from nvs_blob_open function.
+ *
+ * @return
+ *             - ESP_OK if the blob will be replaced when it is closed
+ *             - ESP_ERR_NVS_READ_ONLY if the NVS handle was opened as read only
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the blob or the NVS handle used
+ *               to open it has been closed
+ *             - error returned by a failed nvs_blob_append call
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_truncate(nvs_blob_handle_t blob);
+
+/**
+ * @brief      Make the appended data part of the blob and release the blob handle
+ *
+ * The blob handle is released even if an error is returned, in which case
+ * the blob keeps the value it had when it was opened.
+ *
+ * @param[in]  blob      Blob handle obtained from nvs_blob_open function.
+ *
+ * @return
+ *             - ESP_OK if the blob was updated successfully
+ *             - ESP_ERR_INVALID_STATE if the blob was written or erased by other
+ *               functions while it was open
+ *             - ESP_ERR_NVS_INVALID_HANDLE if blob handle is NULL, or if the NVS
+ *               handle used to open the blob has been closed
+ *             - error returned by a failed nvs_blob_append call
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_close(nvs_blob_handle_t blob);
+
+/**
+ * @brief      Release the blob handle, discarding any appended data
+ *
+ * @param[in]  blob      Blob handle obtained from nvs_blob_open function.
+ *                       NULL argument is allowed.
+ */
+void nvs_blob_abort(nvs_blob_handle_t blob);
+
 /**
  * @brief       Create an iterator to enumerate NVS entries based on one or more parameters
  *
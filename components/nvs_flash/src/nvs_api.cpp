@@ -432,6 +432,263 @@ extern "C" esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const vo
 }
 
 
+extern "C" esp_err_t nvs_batch_begin(nvs_handle_t handle, nvs_batch_handle_t *out_batch)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %d", __func__, handle);
+    HandleEntry entry;
+    auto err = nvs_find_ns_handle(handle, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (entry.mReadOnly) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    nvs_batch_handle_t batch = new nvs_opaque_batch_t;
+    batch->handle = handle;
+    *out_batch = batch;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_batch_add(nvs_batch_handle_t batch, nvs::ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    if (batch == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    if (isVariableLengthType(datatype) && dataSize > Page::CHUNK_MAX_SIZE) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+    // blob data and blob index have to fit into one page together
+    if (datatype == nvs::ItemType::BLOB && dataSize > Page::CHUNK_MAX_SIZE - Page::ENTRY_SIZE) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+
+    auto it = find_if(begin(batch->items), end(batch->items), [=](Storage::BatchItem& e) -> bool {
+        return strncmp(key, e.key, sizeof(e.key) - 1) == 0;
+    });
+    if (it != end(batch->items)) {
+        batch->items.erase(it);
+        delete static_cast<Storage::BatchItem*>(it);
+    }
+
+    Storage::BatchItem* item = new Storage::BatchItem;
+    item->datatype = datatype;
+    strncpy(item->key, key, sizeof(item->key) - 1);
+    item->key[sizeof(item->key) - 1] = 0;
+    item->dataSize = dataSize;
+    item->data = (dataSize <= sizeof(item->value)) ? item->value : new uint8_t[dataSize];
+    memcpy(item->data, data, dataSize);
+    batch->items.push_back(item);
+    return ESP_OK;
+}
+
+template<typename T>
+static esp_err_t nvs_batch_set(nvs_batch_handle_t batch, const char* key, T value)
+{
+    ESP_LOGD(TAG, "%s %s %d %d", __func__, key, sizeof(T), (uint32_t) value);
+    return nvs_batch_add(batch, itemTypeOf(value), key, &value, sizeof(value));
+}
+
+extern "C" esp_err_t nvs_batch_set_i8  (nvs_batch_handle_t batch, const char* key, int8_t value)
+{
+    return nvs_batch_set(batch, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_u8  (nvs_batch_handle_t batch, const char* key, uint8_t value)
+{
+    return nvs_batch_set(batch, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_i16 (nvs_batch_handle_t batch, const char* key, int16_t value)
+{
+    return nvs_batch_set(batch, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_u16 (nvs_batch_handle_t batch, const char* key, uint16_t value)
+{
+    return nvs_batch_set(batch, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_i32 (nvs_batch_handle_t batch, const char* key, int32_t value)
+{
+    return nvs_batch_set(batch, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_u32 (nvs_batch_handle_t batch, const char* key, uint32_t value)
+{
+    return nvs_batch_set(batch, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_i64 (nvs_batch_handle_t batch, const char* key, int64_t value)
+{
+    return nvs_batch_set(batch, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_u64 (nvs_batch_handle_t batch, const char* key, uint64_t value)
+{
+    return nvs_batch_set(batch, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_str(nvs_batch_handle_t batch, const char* key, const char* value)
+{
+    ESP_LOGD(TAG, "%s %s %s", __func__, key, value);
+    return nvs_batch_add(batch, nvs::ItemType::SZ, key, value, strlen(value) + 1);
+}
+
+extern "C" esp_err_t nvs_batch_set_blob(nvs_batch_handle_t batch, const char* key, const void* value, size_t length)
+{
+    ESP_LOGD(TAG, "%s %s %d", __func__, key, length);
+    return nvs_batch_add(batch, nvs::ItemType::BLOB, key, value, length);
+}
+
+extern "C" esp_err_t nvs_batch_commit(nvs_batch_handle_t batch)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    if (batch == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    HandleEntry entry;
+    auto err = nvs_find_ns_handle(batch->handle, entry);
+    if (err == ESP_OK) {
+        err = entry.mStoragePtr->writeBatch(entry.mNsIndex, batch->items);
+    }
+    batch->items.clearAndFreeNodes();
+    delete batch;
+    return err;
+}
+
+extern "C" void nvs_batch_abort(nvs_batch_handle_t batch)
+{
+    if (batch == NULL) {
+        return;
+    }
+    batch->items.clearAndFreeNodes();
+    delete batch;
+}
+
+extern "C" esp_err_t nvs_blob_open(nvs_handle_t handle, const char* key, nvs_blob_handle_t* out_blob)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %d %s", __func__, handle, key);
+    HandleEntry entry;
+    auto err = nvs_find_ns_handle(handle, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    nvs_blob_handle_t blob = new nvs_opaque_blob_t;
+    blob->handle = handle;
+    blob->readOnly = entry.mReadOnly;
+    err = entry.mStoragePtr->openBlob(entry.mNsIndex, key, blob->cursor);
+    if (err == ESP_OK && blob->readOnly && !blob->cursor.found) {
+        entry.mStoragePtr->closeBlob(blob->cursor, false);
+        err = ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (err != ESP_OK) {
+        delete blob;
+        return err;
+    }
+    *out_blob = blob;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_blob_get_size(nvs_blob_handle_t blob, size_t* length)
+{
+    if (blob == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    *length = blob->cursor.dataSize;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_find_blob_handle(nvs_blob_handle_t blob, HandleEntry& entry)
+{
+    if (blob == NULL || blob->cursor.storage == nullptr) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    return nvs_find_ns_handle(blob->handle, entry);
+}
+
+extern "C" esp_err_t nvs_blob_read_at(nvs_blob_handle_t blob, size_t offset, void* out_value, size_t length)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %d %d", __func__, offset, length);
+    HandleEntry entry;
+    auto err = nvs_find_blob_handle(blob, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return entry.mStoragePtr->readBlob(blob->cursor, offset, out_value, length);
+}
+
+extern "C" esp_err_t nvs_blob_append(nvs_blob_handle_t blob, const void* value, size_t length)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %d", __func__, length);
+    HandleEntry entry;
+    auto err = nvs_find_blob_handle(blob, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (blob->readOnly) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    return entry.mStoragePtr->appendBlob(blob->cursor, value, length);
+}
+
+extern "C" esp_err_t nvs_blob_truncate(nvs_blob_handle_t blob)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    HandleEntry entry;
+    auto err = nvs_find_blob_handle(blob, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (blob->readOnly) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    return entry.mStoragePtr->truncateBlob(blob->cursor);
+}
+
+extern "C" esp_err_t nvs_blob_close(nvs_blob_handle_t blob)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    if (blob == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    HandleEntry entry;
+    auto err = nvs_find_blob_handle(blob, entry);
+    if (blob->cursor.storage != nullptr) {
+        // appended data is discarded if the NVS handle was closed in the meantime
+        auto rc = blob->cursor.storage->closeBlob(blob->cursor, err == ESP_OK);
+        if (err == ESP_OK) {
+            err = rc;
+        }
+    }
+    delete blob;
+    return err;
+}
+
+extern "C" void nvs_blob_abort(nvs_blob_handle_t blob)
+{
+    Lock lock;
+    if (blob == NULL) {
+        return;
+    }
+    if (blob->cursor.storage != nullptr) {
+        blob->cursor.storage->closeBlob(blob->cursor, false);
+    }
+    delete blob;
+}
+
 template<typename T>
 static esp_err_t nvs_get(nvs_handle_t handle, const char* key, T* out_value)
 {
@@ -17,101 +17,169 @@
 namespace nvs
 {
 
+const uint8_t HashList::EMPTY;
+const size_t HashList::SLOT_MAP_NODES;
+
 HashList::HashList()
 {
 }
-    
+
+void HashList::setItemIndex(ItemIndex* index, Page* owner)
+{
+    mItemIndex = index;
+    mOwner = owner;
+    // hashes inserted before the index was attached, e.g. while the page was loaded
+    if (mItemIndex) {
+        for (size_t i = 0; i < mCapacity; ++i) {
+            if (mTable[i].mIndex != EMPTY) {
+                mItemIndex->insert(mTable[i].mHash, mOwner);
+            }
+        }
+    }
+}
+
 void HashList::clear()
 {
-    for (auto it = mBlockList.begin(); it != mBlockList.end();) {
-        auto tmp = it;
-        ++it;
-        mBlockList.erase(tmp);
-        delete static_cast<HashListBlock*>(tmp);
+    if (mTable == nullptr) {
+        return;
     }
+    if (mItemIndex) {
+        for (size_t i = 0; i < mCapacity; ++i) {
+            if (mTable[i].mIndex != EMPTY) {
+                mItemIndex->erase(mTable[i].mHash, mOwner);
+            }
+        }
+    }
+    delete[] mTable;
+    mTable = nullptr;
+    mSlots = nullptr;
+    mCapacity = 0;
+    mCount = 0;
 }
-    
+
 HashList::~HashList()
 {
+    // index may already be gone at this point, it is cleared by the owner
+    mItemIndex = nullptr;
     clear();
 }
 
-HashList::HashListBlock::HashListBlock()
+void HashList::placeNode(HashListNode node)
+{
+    size_t slot = homeSlot(node.mHash);
+    while (mTable[slot].mIndex != EMPTY) {
+        slot = nextSlot(slot);
+    }
+    mTable[slot] = node;
+    mSlots[node.mIndex] = slot;
+}
+
+void HashList::resize(size_t capacity)
 {
-    static_assert(sizeof(HashListBlock) == HashListBlock::BYTE_SIZE,
-                  "cache block size calculation incorrect");
+    static_assert(INDEX_COUNT < EMPTY, "entry index should not overlap with empty slot marker");
+    /* one spare step is kept after erase, see below */
+    static_assert(capacityFor(INDEX_COUNT) + STEP_SLOTS <= EMPTY, "slot number should not overlap with empty slot marker");
+    static_assert(INDEX_COUNT % sizeof(HashListNode) == 0, "slot map should fill whole nodes");
+    HashListNode* old = mTable;
+    size_t oldCapacity = mCapacity;
+    mTable = new HashListNode[capacity + SLOT_MAP_NODES];
+    mSlots = reinterpret_cast<uint8_t*>(mTable + capacity);
+    mCapacity = capacity;
+    for (size_t i = 0; i < capacity; ++i) {
+        mTable[i].mIndex = EMPTY;
+        mTable[i].mHash = 0;
+    }
+    for (size_t i = 0; i < INDEX_COUNT; ++i) {
+        mSlots[i] = EMPTY;
+    }
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (old[i].mIndex != EMPTY) {
+            placeNode(old[i]);
+        }
+    }
+    delete[] old;
 }
 
 void HashList::insert(const Item& item, size_t index)
 {
+    assert(index < INDEX_COUNT);
     const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
-    // add entry to the end of last block if possible
-    if (mBlockList.size()) {
-        auto& block = mBlockList.back();
-        if (block.mCount < HashListBlock::ENTRY_COUNT) {
-            block.mNodes[block.mCount++] = HashListNode(hash_24, index);
-            return;
-        }
+    if (mItemIndex) {
+        mItemIndex->insert(hash_24, mOwner);
+    }
+    if (capacityFor(mCount + 1) > mCapacity) {
+        resize(capacityFor(mCount + 1));
     }
-    // if the above failed, create a new block and add entry to it
-    HashListBlock* newBlock = new HashListBlock;
-    mBlockList.push_back(newBlock);
-    newBlock->mNodes[0] = HashListNode(hash_24, index);
-    newBlock->mCount++;
+    HashListNode node;
+    node.mIndex = index;
+    node.mHash = hash_24;
+    placeNode(node);
+    ++mCount;
 }
 
 void HashList::erase(size_t index, bool itemShouldExist)
 {
-    for (auto it = mBlockList.begin(); it != mBlockList.end();) {
-        bool haveEntries = false;
-        bool foundIndex = false;
-        for (size_t i = 0; i < it->mCount; ++i) {
-            if (it->mNodes[i].mIndex == index) {
-                it->mNodes[i].mIndex = 0xff;
-                foundIndex = true;
-                /* found the item and removed it */
-            }
-            if (it->mNodes[i].mIndex != 0xff) {
-                haveEntries = true;
-            }
-            if (haveEntries && foundIndex) {
-                /* item was found, and HashListBlock still has some items */
-                return;
-            }
+    /* the hash of the entry may not be known, e.g. if the item is corrupted,
+     * so its slot is looked up by index */
+    if (mTable == nullptr || index >= INDEX_COUNT || mSlots[index] == EMPTY) {
+        if (itemShouldExist) {
+            assert(false && "item should have been present in cache");
         }
-        /* no items left in HashListBlock, can remove */
-        if (!haveEntries) {
-            auto tmp = it;
-            ++it;
-            mBlockList.erase(tmp);
-            delete static_cast<HashListBlock*>(tmp);
-        } else {
-            ++it;
+        return;
+    }
+    size_t slot = mSlots[index];
+
+    if (mItemIndex) {
+        mItemIndex->erase(mTable[slot].mHash, mOwner);
+    }
+
+    /* backward shift deletion, keeps probe sequences free of tombstones */
+    size_t hole = slot;
+    size_t next = slot;
+    while (true) {
+        next = nextSlot(next);
+        if (mTable[next].mIndex == EMPTY) {
+            break;
         }
-        if (foundIndex) {
-            /* item was found and empty HashListBlock was removed */
-            return;
+        size_t home = homeSlot(mTable[next].mHash);
+        bool inRange = (hole <= next) ? (hole < home && home <= next)
+                                      : (hole < home || home <= next);
+        if (inRange) {
+            continue;
         }
+        mTable[hole] = mTable[next];
+        mSlots[mTable[hole].mIndex] = hole;
+        hole = next;
     }
-    if (itemShouldExist) {
-        assert(false && "item should have been present in cache");
+    mTable[hole].mIndex = EMPTY;
+    mSlots[index] = EMPTY;
+
+    if (--mCount == 0) {
+        /* no items left, can release the table */
+        delete[] mTable;
+        mTable = nullptr;
+        mSlots = nullptr;
+        mCapacity = 0;
+    } else if (mCapacity >= capacityFor(mCount) + 2 * STEP_SLOTS) {
+        /* keep one spare step, so that alternating inserts and erases don't resize every time */
+        resize(capacityFor(mCount) + STEP_SLOTS);
     }
 }
 
 size_t HashList::find(size_t start, const Item& item)
 {
+    if (mTable == nullptr) {
+        return SIZE_MAX;
+    }
     const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
-    for (auto it = mBlockList.begin(); it != mBlockList.end(); ++it) {
-        for (size_t index = 0; index < it->mCount; ++index) {
-            HashListNode& e = it->mNodes[index];
-            if (e.mIndex >= start &&
-                    e.mHash == hash_24 &&
-                    e.mIndex != 0xff) {
-                return e.mIndex;
-            }
+    size_t result = SIZE_MAX;
+    for (size_t i = homeSlot(hash_24); mTable[i].mIndex != EMPTY; i = nextSlot(i)) {
+        const size_t index = mTable[i].mIndex;
+        if (index >= start && index < result && mTable[i].mHash == hash_24) {
+            result = index;
         }
     }
-    return SIZE_MAX;
+    return result;
 }
 
 
@@ -17,7 +17,7 @@
 
 #include "nvs.h"
 #include "nvs_types.hpp"
-#include "intrusive_list.h"
+#include "nvs_item_index.hpp"
 
 namespace nvs
 {
@@ -32,40 +32,66 @@ public:
     void erase(const size_t index, bool itemShouldExist=true);
     size_t find(size_t start, const Item& item);
     void clear();
+
+    /* Mirror all inserted and erased hashes into a partition-wide index.
+     * Hashes already in the list are added to the index as well. */
+    void setItemIndex(ItemIndex* index, Page* owner);
     
 private:
     HashList(const HashList& other);
     const HashList& operator= (const HashList& rhs);
     
+public:
+    /* Entry indices handled by the list are in range [0, INDEX_COUNT) */
+    static const size_t INDEX_COUNT = 128;
+
 protected:
 
+    /* Open-addressed table with linear probing, keyed by 24-bit hash.
+     * Each slot holds an entry index with its hash, as the nodes of the
+     * former block list did. The table grows and shrinks in steps of
+     * STEP_SLOTS slots, and a step holds at most STEP_ENTRIES entries, which
+     * keeps the load at 75% so that probe sequences stay short.
+     * The slot of each entry index is kept in a map of INDEX_COUNT bytes,
+     * allocated together with the table, so that erase doesn't have to
+     * search for an index whose hash isn't known. */
     struct HashListNode {
-        HashListNode() :
-            mIndex(0xff), mHash(0)
-        {
-        }
-
-        HashListNode(uint32_t hash, size_t index) :
-            mIndex((uint32_t) index), mHash(hash)
-        {
-        }
-
         uint32_t mIndex : 8;
         uint32_t mHash  : 24;
     };
 
-    struct HashListBlock : public intrusive_list_node<HashList::HashListBlock> {
-        HashListBlock();
+    static const uint8_t EMPTY = 0xff;
+    static const size_t STEP_SLOTS = 32;
+    static const size_t STEP_ENTRIES = 24;
+    static const size_t SLOT_MAP_NODES = INDEX_COUNT / sizeof(HashListNode);
 
-        static const size_t BYTE_SIZE = 128;
-        static const size_t ENTRY_COUNT = (BYTE_SIZE - sizeof(intrusive_list_node<HashListBlock>) - sizeof(size_t)) / 4;
+    static constexpr size_t capacityFor(size_t count)
+    {
+        return (count + STEP_ENTRIES - 1) / STEP_ENTRIES * STEP_SLOTS;
+    }
 
-        size_t mCount = 0;
-        HashListNode mNodes[ENTRY_COUNT];
-    };
+    size_t homeSlot(uint32_t hash) const
+    {
+        return hash % mCapacity;
+    }
+
+    size_t nextSlot(size_t slot) const
+    {
+        return (slot + 1 == mCapacity) ? 0 : slot + 1;
+    }
+
+    void placeNode(HashListNode node);
+    void resize(size_t capacity);
+
+    /* Allocated on first insert and freed when the last entry is erased */
+    HashListNode* mTable = nullptr;
+    /* Slot of each entry index, or EMPTY; stored right after the table */
+    uint8_t* mSlots = nullptr;
+    size_t mCapacity = 0;
+    size_t mCount = 0;
 
-    typedef intrusive_list<HashListBlock> TBlockList;
-    TBlockList mBlockList;
+    ItemIndex* mItemIndex = nullptr;
+    Page* mOwner = nullptr;
 }; // class HashList
 
 } // namespace nvs
@@ -0,0 +1,157 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nvs_item_index.hpp"
+#include <cassert>
+
+namespace nvs
+{
+
+ItemIndex::ItemIndex()
+{
+}
+
+ItemIndex::~ItemIndex()
+{
+    clear();
+}
+
+void ItemIndex::clear()
+{
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCapacity = 0;
+    mCount = 0;
+}
+
+void ItemIndex::grow()
+{
+    Node* oldNodes = mNodes;
+    size_t oldCapacity = mCapacity;
+
+    mCapacity = (oldCapacity == 0) ? MIN_CAPACITY : oldCapacity * 2;
+    mNodes = new Node[mCapacity];
+    for (size_t i = 0; i < mCapacity; ++i) {
+        mNodes[i].mPage = nullptr;
+    }
+
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (oldNodes[i].mPage == nullptr) {
+            continue;
+        }
+        size_t slot = slotFor(oldNodes[i].mHash);
+        while (mNodes[slot].mPage != nullptr) {
+            slot = (slot + 1) & (mCapacity - 1);
+        }
+        mNodes[slot] = oldNodes[i];
+    }
+    delete[] oldNodes;
+}
+
+void ItemIndex::insert(uint32_t hash, Page* page)
+{
+    assert(page != nullptr);
+    hash &= 0xffffff;
+    // keep load factor below 3/4 so that probe sequences stay short
+    if ((mCount + 1) * 4 > mCapacity * 3) {
+        grow();
+    }
+
+    size_t slot = slotFor(hash);
+    while (mNodes[slot].mPage != nullptr) {
+        Node& node = mNodes[slot];
+        if (node.mHash == hash && node.mPage == page) {
+            assert(node.mRefs < 0xff);
+            ++node.mRefs;
+            return;
+        }
+        slot = (slot + 1) & (mCapacity - 1);
+    }
+    mNodes[slot].mPage = page;
+    mNodes[slot].mHash = hash;
+    mNodes[slot].mRefs = 1;
+    ++mCount;
+}
+
+void ItemIndex::erase(uint32_t hash, Page* page)
+{
+    hash &= 0xffffff;
+    if (mCount == 0) {
+        assert(false && "item should have been present in index");
+        return;
+    }
+
+    const size_t mask = mCapacity - 1;
+    size_t slot = slotFor(hash);
+    while (true) {
+        Node& node = mNodes[slot];
+        if (node.mPage == nullptr) {
+            assert(false && "item should have been present in index");
+            return;
+        }
+        if (node.mHash == hash && node.mPage == page) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (--mNodes[slot].mRefs > 0) {
+        return;
+    }
+
+    // backward shift deletion: move following nodes of the probe sequence
+    // into the hole, so that no tombstones are needed
+    size_t hole = slot;
+    size_t next = slot;
+    while (true) {
+        next = (next + 1) & mask;
+        if (mNodes[next].mPage == nullptr) {
+            break;
+        }
+        size_t home = slotFor(mNodes[next].mHash);
+        bool inRange = (hole <= next) ? (hole < home && home <= next)
+                                      : (hole < home || home <= next);
+        if (inRange) {
+            continue;
+        }
+        mNodes[hole] = mNodes[next];
+        hole = next;
+    }
+    mNodes[hole].mPage = nullptr;
+    --mCount;
+}
+
+Page* ItemIndex::find(uint32_t hash, size_t& pos) const
+{
+    if (mCount == 0) {
+        return nullptr;
+    }
+    hash &= 0xffffff;
+    const size_t mask = mCapacity - 1;
+    const size_t home = slotFor(hash);
+    while (pos < mCapacity) {
+        const Node& node = mNodes[(home + pos) & mask];
+        ++pos;
+        if (node.mPage == nullptr) {
+            pos = mCapacity;
+            break;
+        }
+        if (node.mHash == hash) {
+            return node.mPage;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace nvs
@@ -0,0 +1,91 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef nvs_item_index_hpp
+#define nvs_item_index_hpp
+
+#include <cstdint>
+#include <cstddef>
+
+namespace nvs
+{
+
+class Page;
+
+/**
+ * Partition-wide index of items.
+ *
+ * Maps the 24-bit hash of <namespace, key, chunk index> (the same hash which
+ * is kept in each page's HashList) to the set of pages which contain at least
+ * one entry with this hash. Lookups therefore only need to probe the pages
+ * returned by find() instead of every page of the partition.
+ *
+ * The table uses open addressing with linear probing. Each slot holds a
+ * reference count, since several entries within one page may share a hash.
+ */
+class ItemIndex
+{
+public:
+    ItemIndex();
+    ~ItemIndex();
+
+    void insert(uint32_t hash, Page* page);
+    void erase(uint32_t hash, Page* page);
+    void clear();
+
+    /**
+     * Returns the next page which contains an entry with the given hash,
+     * or nullptr if there are no more such pages. pos should be set to 0
+     * before the first call.
+     */
+    Page* find(uint32_t hash, size_t& pos) const;
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+private:
+    ItemIndex(const ItemIndex& other);
+    const ItemIndex& operator= (const ItemIndex& rhs);
+
+    struct Node {
+        Page* mPage;
+        uint32_t mHash : 24;
+        uint32_t mRefs : 8;
+    };
+
+    static const size_t MIN_CAPACITY = 64;
+
+    size_t slotFor(uint32_t hash) const
+    {
+        // spread the low bits of CRC a bit more, tables are small
+        return ((hash * 2654435761u) >> 8) & (mCapacity - 1);
+    }
+
+    void grow();
+
+    Node* mNodes = nullptr;
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+}; // class ItemIndex
+
+} // namespace nvs
+
+#endif /* nvs_item_index_hpp */
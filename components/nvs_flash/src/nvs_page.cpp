@@ -120,13 +120,8 @@ esp_err_t Page::writeEntry(const Item& item)
     return ESP_OK;
 }
 
-esp_err_t Page::writeEntryData(const uint8_t* data, size_t size)
+esp_err_t Page::writeDataToFlash(size_t entry, const uint8_t* data, size_t size)
 {
-    assert(size % ENTRY_SIZE == 0);
-    assert(mNextFreeEntry != INVALID_ENTRY);
-    assert(mFirstUsedEntry != INVALID_ENTRY);
-    const uint16_t count = size / ENTRY_SIZE;
-
     const uint8_t* buf = data;
 
 #ifdef ESP_PLATFORM
@@ -146,7 +141,7 @@ esp_err_t Page::writeEntryData(const uint8_t* data, size_t size)
     }
 #endif //ESP_PLATFORM
 
-    auto rc = nvs_flash_write(getEntryAddress(mNextFreeEntry), buf, size);
+    auto rc = nvs_flash_write(getEntryAddress(entry), buf, size);
 
 #ifdef ESP_PLATFORM
     if (buf != data) {
@@ -155,6 +150,19 @@ esp_err_t Page::writeEntryData(const uint8_t* data, size_t size)
 #endif //ESP_PLATFORM
     if (rc != ESP_OK) {
         mState = PageState::INVALID;
+    }
+    return rc;
+}
+
+esp_err_t Page::writeEntryData(const uint8_t* data, size_t size)
+{
+    assert(size % ENTRY_SIZE == 0);
+    assert(mNextFreeEntry != INVALID_ENTRY);
+    assert(mFirstUsedEntry != INVALID_ENTRY);
+    const uint16_t count = size / ENTRY_SIZE;
+
+    auto rc = writeDataToFlash(mNextFreeEntry, data, size);
+    if (rc != ESP_OK) {
         return rc;
     }
     auto err = alterEntryRangeState(mNextFreeEntry, mNextFreeEntry + count, EntryState::WRITTEN);
@@ -257,6 +265,213 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
     return ESP_OK;
 }
 
+size_t Page::getItemSpan(ItemType datatype, size_t dataSize)
+{
+    if (!isVariableLengthType(datatype)) {
+        return 1;
+    }
+    return 1 + (dataSize + ENTRY_SIZE - 1) / ENTRY_SIZE;
+}
+
+size_t Page::packItem(Item* entries, uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx)
+{
+    const size_t span = getItemSpan(datatype, dataSize);
+    Item& item = entries[0];
+    item = Item(nsIndex, datatype, span, key, chunkIdx);
+    if (!isVariableLengthType(datatype)) {
+        memcpy(item.data, data, dataSize);
+    } else {
+        item.varLength.dataCrc32 = Item::calculateCrc32(static_cast<const uint8_t*>(data), dataSize);
+        item.varLength.dataSize = dataSize;
+        item.varLength.reserved = 0xffff;
+
+        // same layout as writeEntryData followed by the tail entry: unused bytes are left erased
+        if (span > 1) {
+            uint8_t* dst = entries[1].rawData;
+            std::fill_n(dst, (span - 1) * ENTRY_SIZE, 0xff);
+            memcpy(dst, data, dataSize);
+        }
+    }
+    item.crc32 = item.calculateCrc32();
+    return span;
+}
+
+esp_err_t Page::writeEntries(const Item* entries, size_t count)
+{
+    esp_err_t err;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    if (mState == PageState::UNINITIALIZED) {
+        err = initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mState == PageState::FULL) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    assert(count > 0);
+    if (mNextFreeEntry == INVALID_ENTRY || mNextFreeEntry + count > ENTRY_COUNT) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    // all entries go to flash in one write while their state is still EMPTY.
+    // mLoadEntryTable erases such entries if power goes off before the entry state
+    // table is updated.
+    err = nvs_flash_write(getEntryAddress(mNextFreeEntry), entries, count * ENTRY_SIZE);
+    if (err != ESP_OK) {
+        mState = PageState::INVALID;
+        return err;
+    }
+
+    // alterEntryRangeState writes the state table from the end of the range, so the
+    // word which holds the first entry is written last. Until it is written, the first
+    // entry is EMPTY and the whole range is discarded on load.
+    err = alterEntryRangeState(mNextFreeEntry, mNextFreeEntry + count, EntryState::WRITTEN);
+    if (err != ESP_OK) {
+        mState = PageState::INVALID;
+        return err;
+    }
+
+    for (size_t i = 0; i < count; i += entries[i].span) {
+        assert(entries[i].span > 0);
+        mHashList.insert(entries[i], mNextFreeEntry + i);
+    }
+
+    if (mFirstUsedEntry == INVALID_ENTRY) {
+        mFirstUsedEntry = mNextFreeEntry;
+    }
+
+    mUsedEntryCount += count;
+    mNextFreeEntry += count;
+    return ESP_OK;
+}
+
+esp_err_t Page::writePendingData(size_t offset, const void* data, size_t size)
+{
+    esp_err_t err;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    if (mState == PageState::UNINITIALIZED) {
+        err = initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mState == PageState::FULL) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    assert(offset % ENTRY_SIZE == 0 && size % ENTRY_SIZE == 0);
+    if (mNextFreeEntry == INVALID_ENTRY || offset + size > getVarDataTailroom()) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    // the entry at mNextFreeEntry is left for the header. Data entries stay EMPTY until
+    // writePendingItem is called, so mLoadEntryTable discards them if power goes off.
+    return writeDataToFlash(mNextFreeEntry + 1 + offset / ENTRY_SIZE, static_cast<const uint8_t*>(data), size);
+}
+
+esp_err_t Page::writePendingItem(uint8_t nsIndex, ItemType datatype, const char* key, size_t dataSize, uint32_t dataCrc32, uint8_t chunkIdx)
+{
+    if (mState != PageState::ACTIVE) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    assert(isVariableLengthType(datatype));
+    const size_t span = getItemSpan(datatype, dataSize);
+    if (mNextFreeEntry == INVALID_ENTRY || mNextFreeEntry + span > ENTRY_COUNT) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    Item item(nsIndex, datatype, span, key, chunkIdx);
+    item.varLength.dataCrc32 = dataCrc32;
+    item.varLength.dataSize = dataSize;
+    item.varLength.reserved = 0xffff;
+    item.crc32 = item.calculateCrc32();
+
+    auto err = nvs_flash_write(getEntryAddress(mNextFreeEntry), &item, sizeof(item));
+    if (err != ESP_OK) {
+        mState = PageState::INVALID;
+        return err;
+    }
+
+    // same as in writeEntries, the header entry changes its state last
+    err = alterEntryRangeState(mNextFreeEntry, mNextFreeEntry + span, EntryState::WRITTEN);
+    if (err != ESP_OK) {
+        mState = PageState::INVALID;
+        return err;
+    }
+
+    mHashList.insert(item, mNextFreeEntry);
+
+    if (mFirstUsedEntry == INVALID_ENTRY) {
+        mFirstUsedEntry = mNextFreeEntry;
+    }
+
+    mUsedEntryCount += span;
+    mNextFreeEntry += span;
+    return ESP_OK;
+}
+
+esp_err_t Page::readItemData(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx, Item& item, size_t offset, void* data, size_t size)
+{
+    size_t index = 0;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    esp_err_t rc = findItem(nsIndex, datatype, key, index, item, chunkIdx);
+    if (rc != ESP_OK) {
+        return rc;
+    }
+
+    assert(isVariableLengthType(datatype));
+    if (offset + size > item.varLength.dataSize) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    uint8_t* dst = static_cast<uint8_t*>(data);
+    size_t entry = index + 1 + offset / ENTRY_SIZE;
+    size_t skip = offset % ENTRY_SIZE;
+    while (size > 0) {
+        if (skip == 0 && size >= ENTRY_SIZE) {
+            // whole entries go straight to the destination buffer
+            size_t willCopy = size / ENTRY_SIZE * ENTRY_SIZE;
+            rc = nvs_flash_read(getEntryAddress(entry), dst, willCopy);
+            if (rc != ESP_OK) {
+                return rc;
+            }
+            entry += willCopy / ENTRY_SIZE;
+            dst += willCopy;
+            size -= willCopy;
+            continue;
+        }
+        Item ditem;
+        rc = readEntry(entry, ditem);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        size_t willCopy = std::min(ENTRY_SIZE - skip, size);
+        memcpy(dst, ditem.rawData + skip, willCopy);
+        ++entry;
+        skip = 0;
+        dst += willCopy;
+        size -= willCopy;
+    }
+    return ESP_OK;
+}
+
 esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -542,30 +757,51 @@ esp_err_t Page::mLoadEntryTable()
         // however, if power failed after some data was written into the entry.
         // but before the entry state table was altered, the entry locacted via
         // entry state table may actually be half-written.
-        // this is easy to check by reading EntryHeader (i.e. first word)
-        while (mNextFreeEntry < ENTRY_COUNT) {
-            uint32_t entryAddress = getEntryAddress(mNextFreeEntry);
-            uint32_t header;
-            auto rc = spi_flash_read(entryAddress, &header, sizeof(header));
-            if (rc != ESP_OK) {
-                mState = PageState::INVALID;
-                return rc;
+        // writeEntries also changes the state of its entries starting from the last one,
+        // so written entries may follow the first empty one, and data entries may start
+        // with 0xffffffff. Find the last entry which is not in erased state and discard
+        // everything up to it.
+        if (mNextFreeEntry < ENTRY_COUNT) {
+            size_t lastDirtyEntry = INVALID_ENTRY;
+            const size_t BLOCK_ENTRIES = 16;
+            uint32_t* block = new uint32_t[BLOCK_ENTRIES * ENTRY_SIZE / 4];
+            for (size_t i = mNextFreeEntry; i < ENTRY_COUNT; i += BLOCK_ENTRIES) {
+                size_t count = std::min(BLOCK_ENTRIES, ENTRY_COUNT - i);
+                auto rc = spi_flash_read(getEntryAddress(i), block, count * ENTRY_SIZE);
+                if (rc != ESP_OK) {
+                    mState = PageState::INVALID;
+                    delete[] block;
+                    return rc;
+                }
+                for (size_t j = 0; j < count; ++j) {
+                    const uint32_t* entry = block + j * ENTRY_SIZE / 4;
+                    if (mEntryTable.get(i + j) != EntryState::EMPTY ||
+                            std::any_of(entry, entry + ENTRY_SIZE / 4, [](uint32_t val) -> bool { return val != 0xffffffff; })) {
+                        lastDirtyEntry = i + j;
+                    }
+                }
             }
-            if (header != 0xffffffff) {
-                auto oldState = mEntryTable.get(mNextFreeEntry);
-                auto err = alterEntryState(mNextFreeEntry, EntryState::ERASED);
+            delete[] block;
+
+            if (lastDirtyEntry != INVALID_ENTRY) {
+                for (size_t i = mNextFreeEntry; i <= lastDirtyEntry; ++i) {
+                    auto oldState = mEntryTable.get(i);
+                    if (oldState == EntryState::WRITTEN) {
+                        --mUsedEntryCount;
+                    }
+                    if (oldState != EntryState::ERASED) {
+                        ++mErasedEntryCount;
+                    }
+                }
+                auto err = alterEntryRangeState(mNextFreeEntry, lastDirtyEntry + 1, EntryState::ERASED);
                 if (err != ESP_OK) {
                     mState = PageState::INVALID;
                     return err;
                 }
-                ++mNextFreeEntry;
-                if (oldState == EntryState::WRITTEN) {
-                    --mUsedEntryCount;
+                if (mFirstUsedEntry != INVALID_ENTRY && mFirstUsedEntry >= mNextFreeEntry) {
+                    mFirstUsedEntry = INVALID_ENTRY;
                 }
-                ++mErasedEntryCount;
-            }
-            else {
-                break;
+                mNextFreeEntry = lastDirtyEntry + 1;
             }
         }
 
@@ -947,6 +1183,16 @@ size_t Page::getVarDataTailroom() const
     return ((mNextFreeEntry < (ENTRY_COUNT-1)) ? ((ENTRY_COUNT - mNextFreeEntry - 1) * ENTRY_SIZE): 0);
 }
 
+size_t Page::getEmptyEntryCount() const
+{
+    if (mState == PageState::UNINITIALIZED) {
+        return ENTRY_COUNT;
+    } else if (mState != PageState::ACTIVE || mNextFreeEntry >= ENTRY_COUNT) {
+        return 0;
+    }
+    return ENTRY_COUNT - mNextFreeEntry;
+}
+
 const char* Page::pageStateToName(PageState ps)
 {
     switch (ps) {
@@ -92,6 +92,19 @@ public:
 
     esp_err_t writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY);
 
+    esp_err_t writeEntries(const Item* entries, size_t count);
+
+    /* Writes data of a variable length item before its header. Both offset and
+     * size must be multiples of ENTRY_SIZE. Data only becomes part of the page
+     * once writePendingItem is called, so no other item may be written in between. */
+    esp_err_t writePendingData(size_t offset, const void* data, size_t size);
+
+    esp_err_t writePendingItem(uint8_t nsIndex, ItemType datatype, const char* key, size_t dataSize, uint32_t dataCrc32, uint8_t chunkIdx = CHUNK_ANY);
+
+    /* Reads size bytes starting at offset from the data of a variable length item.
+     * Header of the item is returned in item. Data crc is not checked. */
+    esp_err_t readItemData(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx, Item& item, size_t offset, void* data, size_t size);
+
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
     esp_err_t cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
@@ -137,6 +150,12 @@ public:
     }
     size_t getVarDataTailroom() const ;
 
+    size_t getEmptyEntryCount() const;
+
+    static size_t getItemSpan(ItemType datatype, size_t dataSize);
+
+    static size_t packItem(Item* entries, uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY);
+
     esp_err_t markFull();
 
     esp_err_t markFreeing();
@@ -149,6 +168,11 @@ public:
 
     esp_err_t calcEntries(nvs_stats_t &nvsStats);
 
+    void setItemIndex(ItemIndex* index)
+    {
+        mHashList.setItemIndex(index, this);
+    }
+
 protected:
 
     class Header
@@ -191,6 +215,8 @@ protected:
     
     esp_err_t writeEntryData(const uint8_t* data, size_t size);
 
+    esp_err_t writeDataToFlash(size_t entry, const uint8_t* data, size_t size);
+
     esp_err_t eraseEntryAndSpan(size_t index);
 
     void updateFirstUsedEntry(size_t index, size_t span);
@@ -230,6 +256,7 @@ protected:
     static_assert(sizeof(Header) == 32, "header size must be 32 bytes");
     static_assert(ENTRY_TABLE_OFFSET % 32 == 0, "entry table offset should be aligned");
     static_assert(ENTRY_DATA_OFFSET % 32 == 0, "entry data offset should be aligned");
+    static_assert(ENTRY_COUNT <= HashList::INDEX_COUNT, "hash list should be able to hold all entries");
 
 }; // class Page
 
@@ -12,22 +12,47 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include "nvs_pagemanager.hpp"
+#include "nvs_platform.hpp"
+#ifdef CONFIG_NVS_ENCRYPTION
+#include "nvs_encr.hpp"
+#endif
 
 namespace nvs
 {
+void PageManager::loadPage(void* arg, size_t index)
+{
+    auto job = static_cast<LoadJob*>(arg);
+    job->results[index] = job->pages[index].load(job->baseSector + index);
+}
+
 esp_err_t PageManager::load(uint32_t baseSector, uint32_t sectorCount)
 {
     mBaseSector = baseSector;
     mPageCount = sectorCount;
     mPageList.clear();
     mFreePageList.clear();
+    mItemIndex.clear();
     mPages.reset(new Page[sectorCount]);
 
+    // Pages are independent of each other, so reading the entry tables,
+    // checking CRCs and building hash lists can be done in parallel.
+    // Only the cheap ordering by sequence number below has to be sequential.
+    std::unique_ptr<esp_err_t[]> results(new esp_err_t[sectorCount]);
+    LoadJob job = { mPages.get(), results.get(), baseSector };
+    bool parallel = mParallelLoad;
+#ifdef CONFIG_NVS_ENCRYPTION
+    // keep decryption on the calling task
+    parallel = parallel && !EncrMgr::isEncrActive();
+#endif
+    parallelFor(sectorCount, parallel, loadPage, &job);
+
     for (uint32_t i = 0; i < sectorCount; ++i) {
-        auto err = mPages[i].load(baseSector + i);
-        if (err != ESP_OK) {
-            return err;
+        if (results[i] != ESP_OK) {
+            return results[i];
         }
+#ifdef CONFIG_NVS_ITEM_INDEX
+        mPages[i].setItemIndex(&mItemIndex);
+#endif
         uint32_t seqNumber;
         if (mPages[i].getSeqNumber(seqNumber) != ESP_OK) {
             mFreePageList.push_back(&mPages[i]);
@@ -54,18 +79,14 @@ esp_err_t PageManager::load(uint32_t baseSector, uint32_t sectorCount)
     }
 
     // if power went out after a new item for the given key was written,
-    // but before the old one was erased, we end up with a duplicate item
+    // but before the old one was erased, we end up with a duplicate item.
+    // A batch (see Storage::writeBatch) may leave several such items on the last page.
     Page& lastPage = back();
-    size_t lastItemIndex = SIZE_MAX;
+    auto last = PageManager::TPageListIterator(&lastPage);
     Item item;
     size_t itemIndex = 0;
     while (lastPage.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
         itemIndex += item.span;
-        lastItemIndex = itemIndex;
-    }
-
-    if (lastItemIndex != SIZE_MAX) {
-        auto last = PageManager::TPageListIterator(&lastPage);
         TPageListIterator it;
 
         for (it = begin(); it != last; ++it) {
@@ -16,9 +16,11 @@
 
 #include <memory>
 #include <list>
+#include "sdkconfig.h"
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
 #include "nvs_pagemanager.hpp"
+#include "nvs_item_index.hpp"
 #include "intrusive_list.h"
 
 namespace nvs
@@ -61,17 +63,32 @@ public:
         return mBaseSector;
     }
 
+    const ItemIndex& getItemIndex() const
+    {
+        return mItemIndex;
+    }
+
 protected:
     friend class Iterator;
 
+    struct LoadJob {
+        Page* pages;
+        esp_err_t* results;
+        uint32_t baseSector;
+    };
+
+    static void loadPage(void* arg, size_t index);
+
     esp_err_t activatePage();
 
     TPageList mPageList;
     TPageList mFreePageList;
     std::unique_ptr<Page[]> mPages;
+    ItemIndex mItemIndex;
     uint32_t mBaseSector;
     uint32_t mPageCount;
     uint32_t mSeqNumber;
+    bool mParallelLoad = true;
 }; // class PageManager
 
 
@@ -15,9 +15,13 @@
 #define nvs_platform_h
 
 
+#include <atomic>
+#include "sdkconfig.h"
+
 #ifdef ESP_PLATFORM
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 
 namespace nvs
 {
@@ -61,9 +65,69 @@ public:
 
     static SemaphoreHandle_t mSemaphore;
 };
+
+struct ParallelForJob {
+    void (*func)(void*, size_t);
+    void* arg;
+    size_t count;
+    std::atomic<size_t> next;
+    SemaphoreHandle_t done;
+
+    void run()
+    {
+        for (size_t i = next++; i < count; i = next++) {
+            func(arg, i);
+        }
+    }
+};
+
+inline void parallelForTask(void* arg)
+{
+    auto job = static_cast<ParallelForJob*>(arg);
+    job->run();
+    xSemaphoreGive(job->done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * Calls func(arg, i) for each i in [0, count). If parallel is set, the calling
+ * task shares the work with a helper task pinned to the other CPU core.
+ * Falls back to running everything in the calling task if the helper task
+ * can not be created.
+ */
+inline void parallelFor(size_t count, bool parallel, void (*func)(void*, size_t), void* arg)
+{
+    ParallelForJob job;
+    job.func = func;
+    job.arg = arg;
+    job.count = count;
+    job.next = 0;
+    job.done = nullptr;
+#if defined(CONFIG_NVS_PARALLEL_LOAD) && !defined(CONFIG_FREERTOS_UNICORE)
+    if (parallel && count > 1) {
+        job.done = xSemaphoreCreateBinary();
+    }
+    if (job.done) {
+        BaseType_t otherCore = (xPortGetCoreID() == 0) ? 1 : 0;
+        if (xTaskCreatePinnedToCore(parallelForTask, "nvs_load", 3072, &job,
+                                    uxTaskPriorityGet(NULL), NULL, otherCore) == pdPASS) {
+            job.run();
+            xSemaphoreTake(job.done, portMAX_DELAY);
+            vSemaphoreDelete(job.done);
+            return;
+        }
+        vSemaphoreDelete(job.done);
+    }
+#endif
+    job.run();
+}
 } // namespace nvs
 
 #else // ESP_PLATFORM
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 namespace nvs
 {
 class Lock
@@ -74,6 +138,33 @@ public:
     static void init() {}
     static void uninit() {}
 };
+
+/**
+ * Calls func(arg, i) for each i in [0, count). If parallel is set, the work
+ * is shared between the calling thread and a pool of worker threads.
+ */
+inline void parallelFor(size_t count, bool parallel, void (*func)(void*, size_t), void* arg)
+{
+    std::atomic<size_t> next(0);
+    auto run = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            func(arg, i);
+        }
+    };
+    std::vector<std::thread> workers;
+#ifdef CONFIG_NVS_PARALLEL_LOAD
+    if (parallel) {
+        size_t workerCount = std::min<size_t>(std::thread::hardware_concurrency(), count);
+        for (size_t i = 1; i < workerCount; ++i) {
+            workers.emplace_back(run);
+        }
+    }
+#endif
+    run();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
 } // namespace nvs
 #endif // ESP_PLATFORM
 
@@ -24,6 +24,16 @@ namespace nvs
 Storage::~Storage()
 {
     clearNamespaces();
+    detachBlobCursors();
+}
+
+void Storage::detachBlobCursors()
+{
+    // cursors which are still open can not be used any more
+    for (auto it = mBlobCursors.begin(); it != mBlobCursors.end(); ++it) {
+        it->storage = nullptr;
+    }
+    mBlobCursors.clear();
 }
 
 void Storage::clearNamespaces()
@@ -86,6 +96,9 @@ void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList)
 
 esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
 {
+    // blob cursors refer to pages which are about to be reloaded
+    detachBlobCursors();
+
     auto err = mPageManager.load(baseSector, sectorCount);
     if (err != ESP_OK) {
         mState = StorageState::INVALID;
@@ -135,6 +148,45 @@ bool Storage::isValid() const
 
 esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
+#ifdef CONFIG_NVS_ITEM_INDEX
+    // Page::findItem only uses the hash list for fully specified lookups, same applies to the index
+    if (nsIndex != Page::NS_ANY && datatype != ItemType::ANY && key != nullptr) {
+        Page* candidates[MAX_INDEX_CANDIDATES];
+        size_t candidateCount = 0;
+        size_t pos = 0;
+        const uint32_t hash = Item(nsIndex, datatype, 0, key, chunkIdx).calculateCrc32WithoutValue();
+        const ItemIndex& index = mPageManager.getItemIndex();
+        Page* p;
+        while ((p = index.find(hash, pos)) != nullptr && candidateCount < MAX_INDEX_CANDIDATES) {
+            candidates[candidateCount++] = p;
+        }
+        if (p == nullptr) {
+            // if the item is present in more than one page (e.g. power went off between writing
+            // a new copy and erasing the old one), return the oldest copy, like a full scan would do
+            Page* found = nullptr;
+            uint32_t foundSeqNumber = UINT32_MAX;
+            for (size_t i = 0; i < candidateCount; ++i) {
+                size_t itemIndex = 0;
+                Item candidateItem;
+                uint32_t seqNumber;
+                auto err = candidates[i]->findItem(nsIndex, datatype, key, itemIndex, candidateItem, chunkIdx, chunkStart);
+                if (err == ESP_OK && candidates[i]->getSeqNumber(seqNumber) == ESP_OK
+                        && (found == nullptr || seqNumber < foundSeqNumber)) {
+                    found = candidates[i];
+                    foundSeqNumber = seqNumber;
+                    item = candidateItem;
+                }
+            }
+            if (found == nullptr) {
+                return ESP_ERR_NVS_NOT_FOUND;
+            }
+            page = found;
+            return ESP_OK;
+        }
+        // too many hash collisions, fall back to scanning all pages
+    }
+#endif // CONFIG_NVS_ITEM_INDEX
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         size_t itemIndex = 0;
         auto err = it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
@@ -146,22 +198,26 @@ esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key,
     return ESP_ERR_NVS_NOT_FOUND;
 }
 
-esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const void* data, size_t dataSize, VerOffset chunkStart)
+size_t Storage::getMaxBlobSize()
 {
-    uint8_t chunkCount = 0;
-    TUsedPageList usedPages;
-    size_t remainingSize = dataSize;
-    size_t offset=0;
-    esp_err_t err = ESP_OK;
-
     /* Check how much maximum data can be accommodated**/
     uint32_t max_pages = mPageManager.getPageCount() - 1;
 
     if(max_pages > (Page::CHUNK_ANY-1)/2) {
        max_pages = (Page::CHUNK_ANY-1)/2;
     }
+    return max_pages * Page::CHUNK_MAX_SIZE;
+}
+
+esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const void* data, size_t dataSize, VerOffset chunkStart)
+{
+    uint8_t chunkCount = 0;
+    TUsedPageList usedPages;
+    size_t remainingSize = dataSize;
+    size_t offset=0;
+    esp_err_t err = ESP_OK;
 
-    if (dataSize > max_pages * Page::CHUNK_MAX_SIZE) {
+    if (dataSize > getMaxBlobSize()) {
         return ESP_ERR_NVS_VALUE_TOO_LONG;
     }
 
@@ -251,6 +307,8 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    flushBlobCursors();
+
     Page* findPage = nullptr;
     Item item;
 
@@ -371,6 +429,575 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
     return ESP_OK;
 }
 
+esp_err_t Storage::writeBatch(uint8_t nsIndex, TBatchItemList& items)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    flushBlobCursors();
+
+    // Drop items which would not change anything, and count entries needed for the rest.
+    // A blob is written as a single data chunk followed by its index.
+    size_t entryCount = 0;
+    for (auto it = std::begin(items); it != std::end(items); ) {
+        BatchItem* batchItem = it;
+        ++it;
+
+        Page* findPage = nullptr;
+        Item item;
+        esp_err_t err;
+        bool unchanged;
+        if (batchItem->datatype == ItemType::BLOB) {
+            err = findItem(nsIndex, ItemType::BLOB_IDX, batchItem->key, findPage, item);
+            unchanged = (err == ESP_OK &&
+                    cmpMultiPageBlob(nsIndex, batchItem->key, batchItem->data, batchItem->dataSize) == ESP_OK);
+        } else {
+            err = findItem(nsIndex, batchItem->datatype, batchItem->key, findPage, item);
+            unchanged = (err == ESP_OK &&
+                    findPage->cmpItem(nsIndex, batchItem->datatype, batchItem->key, batchItem->data, batchItem->dataSize) == ESP_OK);
+        }
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+            return err;
+        }
+
+        if (unchanged) {
+            items.erase(batchItem);
+            delete batchItem;
+        } else if (batchItem->datatype == ItemType::BLOB) {
+            entryCount += Page::getItemSpan(ItemType::BLOB_DATA, batchItem->dataSize) + 1;
+        } else {
+            entryCount += Page::getItemSpan(batchItem->datatype, batchItem->dataSize);
+        }
+    }
+
+    if (entryCount == 0) {
+        return ESP_OK;
+    }
+
+    // the whole batch is committed by a single entry state table update,
+    // so it has to fit into the current page
+    if (entryCount > Page::ENTRY_COUNT) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+
+    esp_err_t err;
+    for (size_t attempt = 0; getCurrentPage().getEmptyEntryCount() < entryCount; ++attempt) {
+        if (attempt == mPageManager.getPageCount()) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        Page& page = getCurrentPage();
+        if (page.state() != Page::PageState::FULL) {
+            err = page.markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    // Pages are not reclaimed from this point on, so old locations stay valid until
+    // the old values are erased.
+    for (auto it = std::begin(items); it != std::end(items); ++it) {
+        Item item;
+        it->oldPage = nullptr;
+        it->oldChunkStart = VerOffset::VER_ANY;
+        if (it->datatype == ItemType::BLOB) {
+            err = findItem(nsIndex, ItemType::BLOB_IDX, it->key, it->oldPage, item);
+            if (err == ESP_OK) {
+                it->oldChunkStart = item.blobIndex.chunkStart;
+            } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+                /* Support for earlier versions where BLOBS were stored without index */
+                err = findItem(nsIndex, ItemType::BLOB, it->key, it->oldPage, item);
+            }
+        } else {
+            err = findItem(nsIndex, it->datatype, it->key, it->oldPage, item);
+        }
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+            return err;
+        }
+    }
+
+    Item* entries = new Item[entryCount];
+    size_t entryIndex = 0;
+    for (auto it = std::begin(items); it != std::end(items); ++it) {
+        if (it->datatype == ItemType::BLOB) {
+            VerOffset chunkStart = (it->oldChunkStart == VerOffset::VER_0_OFFSET) ? VerOffset::VER_1_OFFSET : VerOffset::VER_0_OFFSET;
+            entryIndex += Page::packItem(entries + entryIndex, nsIndex, ItemType::BLOB_DATA, it->key,
+                    it->data, it->dataSize, static_cast<uint8_t> (chunkStart));
+
+            Item item;
+            std::fill_n(item.data, sizeof(item.data), 0xff);
+            item.blobIndex.dataSize = it->dataSize;
+            item.blobIndex.chunkCount = 1;
+            item.blobIndex.chunkStart = chunkStart;
+            entryIndex += Page::packItem(entries + entryIndex, nsIndex, ItemType::BLOB_IDX, it->key,
+                    item.data, sizeof(item.data));
+        } else {
+            entryIndex += Page::packItem(entries + entryIndex, nsIndex, it->datatype, it->key,
+                    it->data, it->dataSize);
+        }
+    }
+    assert(entryIndex == entryCount);
+
+    err = getCurrentPage().writeEntries(entries, entryCount);
+    delete[] entries;
+    assert(err != ESP_ERR_NVS_PAGE_FULL);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // New values are visible now. If power goes off before all old values are erased,
+    // PageManager::load and Page::mLoadEntryTable remove the remaining duplicates.
+    for (auto it = std::begin(items); it != std::end(items); ++it) {
+        if (it->oldPage == nullptr) {
+            continue;
+        }
+        if (it->datatype == ItemType::BLOB && it->oldChunkStart != VerOffset::VER_ANY) {
+            err = eraseMultiPageBlob(nsIndex, it->key, it->oldChunkStart);
+        } else {
+            err = it->oldPage->eraseItem(nsIndex, it->datatype, it->key);
+        }
+        if (err == ESP_ERR_FLASH_OP_FAIL) {
+            return ESP_ERR_NVS_REMOVE_FAILED;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+#ifndef ESP_PLATFORM
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
+esp_err_t Storage::openBlob(uint8_t nsIndex, const char* key, BlobCursor& cursor)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    cursor.nsIndex = nsIndex;
+    strncpy(cursor.key, key, sizeof(cursor.key) - 1);
+    cursor.key[sizeof(cursor.key) - 1] = 0;
+
+    Item item;
+    Page* findPage = nullptr;
+    auto err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        cursor.found = false;
+        cursor.chunkStart = VerOffset::VER_0_OFFSET;
+        cursor.chunkCount = 0;
+        cursor.dataSize = 0;
+    } else if (err != ESP_OK) {
+        return err;
+    } else {
+        cursor.found = true;
+        cursor.chunkStart = item.blobIndex.chunkStart;
+        cursor.chunkCount = item.blobIndex.chunkCount;
+        cursor.dataSize = item.blobIndex.dataSize;
+
+        /* Locate all chunks once, reads then go straight to the right page */
+        cursor.chunks = new BlobCursor::Chunk[cursor.chunkCount];
+        size_t offset = 0;
+        for (uint8_t chunkNum = 0; chunkNum < cursor.chunkCount; chunkNum++) {
+            BlobCursor::Chunk& chunk = cursor.chunks[chunkNum];
+            err = findItem(nsIndex, ItemType::BLOB_DATA, key, chunk.page, item, static_cast<uint8_t> (cursor.chunkStart) + chunkNum);
+            if (err != ESP_OK) {
+                return err;
+            }
+            chunk.offset = offset;
+            chunk.dataSize = item.varLength.dataSize;
+            chunk.dataCrc32 = item.varLength.dataCrc32;
+            chunk.checkedSize = 0;
+            chunk.checkedCrc32 = 0xffffffff;
+            offset += chunk.dataSize;
+        }
+        if (offset != cursor.dataSize) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+    }
+
+    cursor.storage = this;
+    mBlobCursors.push_back(&cursor);
+    return ESP_OK;
+}
+
+esp_err_t Storage::readBlob(BlobCursor& cursor, size_t offset, void* data, size_t size)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    if (offset > cursor.dataSize || size > cursor.dataSize - offset) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    if (size == 0) {
+        return ESP_OK;
+    }
+
+    /* Last chunk which starts at or before offset */
+    auto chunk = std::upper_bound(cursor.chunks, cursor.chunks + cursor.chunkCount, offset,
+        [](size_t offset, const BlobCursor::Chunk& chunk) -> bool {
+            return offset < chunk.offset;
+        }) - 1;
+    uint8_t* dst = static_cast<uint8_t*>(data);
+    for (; size > 0; ++chunk) {
+        const uint8_t chunkIdx = static_cast<uint8_t> (cursor.chunkStart) + (chunk - cursor.chunks);
+        const size_t chunkOffset = offset - chunk->offset;
+        const size_t willRead = std::min(chunk->dataSize - chunkOffset, size);
+
+        if (chunk->checkedSize == chunk->dataSize && chunk->checkedCrc32 != chunk->dataCrc32) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+
+        Item item;
+        auto err = chunk->page->readItemData(cursor.nsIndex, ItemType::BLOB_DATA, cursor.key, chunkIdx, item, chunkOffset, dst, willRead);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            // chunk may have been moved to another page by garbage collection
+            err = findItem(cursor.nsIndex, ItemType::BLOB_DATA, cursor.key, chunk->page, item, chunkIdx);
+            if (err == ESP_OK) {
+                err = chunk->page->readItemData(cursor.nsIndex, ItemType::BLOB_DATA, cursor.key, chunkIdx, item, chunkOffset, dst, willRead);
+            }
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (item.varLength.dataSize != chunk->dataSize || item.varLength.dataCrc32 != chunk->dataCrc32) {
+            // blob was written again while the cursor was open
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+
+        // data read in order is checked against the chunk crc
+        if (chunkOffset == chunk->checkedSize) {
+            chunk->checkedCrc32 = Item::calculateCrc32(dst, willRead, chunk->checkedCrc32);
+            chunk->checkedSize += willRead;
+            if (chunk->checkedSize == chunk->dataSize && chunk->checkedCrc32 != chunk->dataCrc32) {
+                return ESP_ERR_NVS_NOT_FOUND;
+            }
+        }
+
+        offset += willRead;
+        dst += willRead;
+        size -= willRead;
+    }
+    return ESP_OK;
+}
+
+/* Chunks which are kept when the cursor is closed, appended chunks follow them */
+static uint8_t keptChunkCount(const Storage::BlobCursor& cursor)
+{
+    return cursor.replace ? 0 : cursor.chunkCount;
+}
+
+static size_t keptDataSize(const Storage::BlobCursor& cursor)
+{
+    return cursor.replace ? 0 : cursor.dataSize;
+}
+
+/* A blob which is replaced is written with the other version, like in writeItem */
+static VerOffset appendedChunkStart(const Storage::BlobCursor& cursor)
+{
+    if (!cursor.replace) {
+        return cursor.chunkStart;
+    }
+    return (cursor.chunkStart == VerOffset::VER_1_OFFSET) ? VerOffset::VER_0_OFFSET : VerOffset::VER_1_OFFSET;
+}
+
+static uint8_t appendedChunkIndex(const Storage::BlobCursor& cursor, uint8_t chunkNum)
+{
+    return static_cast<uint8_t> (appendedChunkStart(cursor)) + keptChunkCount(cursor) + chunkNum;
+}
+
+esp_err_t Storage::startBlobChunk(BlobCursor& cursor)
+{
+    if (keptChunkCount(cursor) + cursor.appendedChunkCount >= (Page::CHUNK_ANY - 1) / 2) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+
+    /* Same as in writeMultiPageBlob, don't start a chunk if tailroom is too small */
+    size_t tailroom = getCurrentPage().getVarDataTailroom();
+    while (tailroom < Page::CHUNK_MAX_SIZE / 10) {
+        Page& page = getCurrentPage();
+        if (page.state() != Page::PageState::FULL) {
+            auto err = page.markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        auto err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (getCurrentPage().getVarDataTailroom() == tailroom) {
+            /* We got the same page or we are not improving.*/
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        tailroom = getCurrentPage().getVarDataTailroom();
+    }
+
+    cursor.pendingPage = &getCurrentPage();
+    cursor.pendingCapacity = tailroom;
+    cursor.pendingSize = 0;
+    cursor.pendingCrc32 = 0xffffffff;
+    cursor.tailSize = 0;
+    return ESP_OK;
+}
+
+esp_err_t Storage::finishBlobChunk(BlobCursor& cursor)
+{
+    Page* page = cursor.pendingPage;
+
+    if (cursor.tailSize > 0) {
+        std::fill_n(cursor.tail + cursor.tailSize, Page::ENTRY_SIZE - cursor.tailSize, 0xff);
+        auto err = page->writePendingData(cursor.pendingSize, cursor.tail, Page::ENTRY_SIZE);
+        if (err != ESP_OK) {
+            abortBlobChunk(cursor);
+            return err;
+        }
+        cursor.pendingCrc32 = Item::calculateCrc32(cursor.tail, cursor.tailSize, cursor.pendingCrc32);
+        cursor.pendingSize += cursor.tailSize;
+        cursor.tailSize = 0;
+    }
+    if (cursor.pendingSize == 0) {
+        cursor.pendingPage = nullptr;
+        return ESP_OK;
+    }
+
+    const uint8_t chunkIdx = appendedChunkIndex(cursor, cursor.appendedChunkCount);
+    auto err = page->writePendingItem(cursor.nsIndex, ItemType::BLOB_DATA, cursor.key, cursor.pendingSize, cursor.pendingCrc32, chunkIdx);
+    if (err != ESP_OK) {
+        abortBlobChunk(cursor);
+        return err;
+    }
+    cursor.pendingPage = nullptr;
+    cursor.appendedChunkCount++;
+    cursor.appendedSize += cursor.pendingSize;
+    return ESP_OK;
+}
+
+void Storage::abortBlobChunk(BlobCursor& cursor)
+{
+    // data of the chunk may be partly written after the last item of the page,
+    // so nothing else may be written to that page. The chunk header is never written.
+    Page* page = cursor.pendingPage;
+    cursor.pendingPage = nullptr;
+    cursor.tailSize = 0;
+    if (page->state() == Page::PageState::ACTIVE) {
+        page->markFull();
+    }
+}
+
+void Storage::eraseAppendedChunks(BlobCursor& cursor)
+{
+    for (uint8_t chunkNum = 0; chunkNum < cursor.appendedChunkCount; chunkNum++) {
+        Item item;
+        Page* findPage = nullptr;
+        const uint8_t chunkIdx = appendedChunkIndex(cursor, chunkNum);
+        if (findItem(cursor.nsIndex, ItemType::BLOB_DATA, cursor.key, findPage, item, chunkIdx) == ESP_OK) {
+            findPage->eraseItem(cursor.nsIndex, ItemType::BLOB_DATA, cursor.key, chunkIdx);
+        }
+    }
+    cursor.appendedChunkCount = 0;
+    cursor.appendedSize = 0;
+}
+
+void Storage::flushBlobCursors(BlobCursor* except)
+{
+    // data of a pending chunk follows the last item of the current page,
+    // so the chunk has to be completed before anything else is written
+    for (auto it = mBlobCursors.begin(); it != mBlobCursors.end(); ++it) {
+        if (static_cast<BlobCursor*>(it) != except && it->pendingPage != nullptr) {
+            auto err = finishBlobChunk(*it);
+            if (err != ESP_OK && it->appendError == ESP_OK) {
+                it->appendError = err;
+            }
+        }
+    }
+}
+
+esp_err_t Storage::appendBlob(BlobCursor& cursor, const void* data, size_t size)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (cursor.appendError != ESP_OK) {
+        return cursor.appendError;
+    }
+
+    size_t totalSize = keptDataSize(cursor) + cursor.appendedSize;
+    if (cursor.pendingPage != nullptr) {
+        totalSize += cursor.pendingSize + cursor.tailSize;
+    }
+    if (size > getMaxBlobSize() - std::min(totalSize, getMaxBlobSize())) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+
+    flushBlobCursors(&cursor);
+
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    esp_err_t err = ESP_OK;
+    while (size > 0) {
+        if (cursor.pendingPage == nullptr) {
+            err = startBlobChunk(cursor);
+            if (err != ESP_OK) {
+                break;
+            }
+        }
+
+        const size_t room = cursor.pendingCapacity - cursor.pendingSize - cursor.tailSize;
+        if (cursor.tailSize > 0 || size < Page::ENTRY_SIZE) {
+            /* Partial entries are collected in the tail buffer */
+            size_t willCopy = std::min(std::min(Page::ENTRY_SIZE - cursor.tailSize, size), room);
+            memcpy(cursor.tail + cursor.tailSize, src, willCopy);
+            cursor.tailSize += willCopy;
+            src += willCopy;
+            size -= willCopy;
+            if (cursor.tailSize == Page::ENTRY_SIZE) {
+                err = cursor.pendingPage->writePendingData(cursor.pendingSize, cursor.tail, Page::ENTRY_SIZE);
+                if (err != ESP_OK) {
+                    break;
+                }
+                cursor.pendingCrc32 = Item::calculateCrc32(cursor.tail, Page::ENTRY_SIZE, cursor.pendingCrc32);
+                cursor.pendingSize += Page::ENTRY_SIZE;
+                cursor.tailSize = 0;
+            }
+        } else {
+            /* Whole entries are written directly from the caller's buffer */
+            size_t willCopy = std::min(size, room) / Page::ENTRY_SIZE * Page::ENTRY_SIZE;
+            err = cursor.pendingPage->writePendingData(cursor.pendingSize, src, willCopy);
+            if (err != ESP_OK) {
+                break;
+            }
+            cursor.pendingCrc32 = Item::calculateCrc32(src, willCopy, cursor.pendingCrc32);
+            cursor.pendingSize += willCopy;
+            src += willCopy;
+            size -= willCopy;
+        }
+
+        if (cursor.pendingSize + cursor.tailSize == cursor.pendingCapacity) {
+            err = finishBlobChunk(cursor);
+            if (err != ESP_OK) {
+                break;
+            }
+        }
+    }
+
+    if (err != ESP_OK) {
+        // the handle is aborted, closeBlob discards everything appended so far
+        if (cursor.pendingPage != nullptr) {
+            abortBlobChunk(cursor);
+        }
+        cursor.appendError = err;
+    }
+    return err;
+}
+
+esp_err_t Storage::truncateBlob(BlobCursor& cursor)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (cursor.appendError != ESP_OK) {
+        return cursor.appendError;
+    }
+
+    if (cursor.pendingPage != nullptr) {
+        auto err = finishBlobChunk(cursor);
+        if (err != ESP_OK) {
+            cursor.appendError = err;
+            return err;
+        }
+    }
+    eraseAppendedChunks(cursor);
+    cursor.replace = true;
+    return ESP_OK;
+}
+
+esp_err_t Storage::closeBlob(BlobCursor& cursor, bool commit)
+{
+    flushBlobCursors();
+    esp_err_t err = cursor.appendError;
+
+    if ((cursor.appendedChunkCount > 0 || cursor.replace) && commit && err == ESP_OK) {
+        /* Make sure that the blob was not written or erased since the cursor was opened */
+        Item item;
+        Page* findPage = nullptr;
+        err = findItem(cursor.nsIndex, ItemType::BLOB_IDX, cursor.key, findPage, item);
+        if (err == ESP_OK) {
+            if (!cursor.found || item.blobIndex.chunkStart != cursor.chunkStart ||
+                    item.blobIndex.chunkCount != cursor.chunkCount || item.blobIndex.dataSize != cursor.dataSize) {
+                err = ESP_ERR_INVALID_STATE;
+            }
+        } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = cursor.found ? ESP_ERR_INVALID_STATE : ESP_OK;
+        }
+
+        if (err == ESP_OK) {
+            std::fill_n(item.data, sizeof(item.data), 0xff);
+            item.blobIndex.dataSize = keptDataSize(cursor) + cursor.appendedSize;
+            item.blobIndex.chunkCount = keptChunkCount(cursor) + cursor.appendedChunkCount;
+            item.blobIndex.chunkStart = appendedChunkStart(cursor);
+
+            err = getCurrentPage().writeItem(cursor.nsIndex, ItemType::BLOB_IDX, cursor.key, item.data, sizeof(item.data));
+            if (err == ESP_ERR_NVS_PAGE_FULL) {
+                Page& page = getCurrentPage();
+                err = ESP_OK;
+                if (page.state() != Page::PageState::FULL) {
+                    err = page.markFull();
+                }
+                if (err == ESP_OK) {
+                    err = mPageManager.requestNewPage();
+                }
+                if (err == ESP_OK) {
+                    err = getCurrentPage().writeItem(cursor.nsIndex, ItemType::BLOB_IDX, cursor.key, item.data, sizeof(item.data));
+                    if (err == ESP_ERR_NVS_PAGE_FULL) {
+                        err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+                    }
+                }
+            }
+        }
+
+        if (err == ESP_OK) {
+            /* Erase the previous index, or a blob stored in the format without index.
+             * A replaced blob has its own chunks, which are erased with the old index. */
+            esp_err_t rc;
+            if (cursor.found && cursor.replace) {
+                rc = eraseMultiPageBlob(cursor.nsIndex, cursor.key, cursor.chunkStart);
+            } else {
+                ItemType oldType = cursor.found ? ItemType::BLOB_IDX : ItemType::BLOB;
+                rc = findItem(cursor.nsIndex, oldType, cursor.key, findPage, item);
+                if (rc == ESP_OK) {
+                    rc = findPage->eraseItem(cursor.nsIndex, oldType, cursor.key);
+                }
+            }
+            if (rc == ESP_ERR_FLASH_OP_FAIL) {
+                rc = ESP_ERR_NVS_REMOVE_FAILED;
+            }
+            if (rc != ESP_ERR_NVS_NOT_FOUND) {
+                err = rc;
+            }
+            cursor.appendedChunkCount = 0;
+        }
+    }
+
+    /* Anything failed or the cursor was aborted, erase the appended chunks */
+    eraseAppendedChunks(cursor);
+
+    mBlobCursors.erase(&cursor);
+    cursor.storage = nullptr;
+#ifndef ESP_PLATFORM
+    if (err == ESP_OK) {
+        debugCheck();
+    }
+#endif
+    return err;
+}
+
 esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uint8_t& nsIndex)
 {
     if (mState != StorageState::ACTIVE) {
@@ -663,6 +1290,18 @@ void Storage::debugCheck()
                 assert(0);
             }
             keys.insert(std::make_pair(keystr, static_cast<Page*>(p)));
+#ifdef CONFIG_NVS_ITEM_INDEX
+            size_t pos = 0;
+            Page* indexed;
+            while ((indexed = mPageManager.getItemIndex().find(item.calculateCrc32WithoutValue(), pos)) != nullptr
+                    && indexed != static_cast<Page*>(p)) {
+            }
+            if (indexed == nullptr) {
+                printf("Key missing from index: %s\n", keystr.c_str());
+                debugDump();
+                assert(0);
+            }
+#endif // CONFIG_NVS_ITEM_INDEX
             itemIndex += item.span;
             usedCount += item.span;
         }
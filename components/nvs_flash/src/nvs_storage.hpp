@@ -58,7 +58,74 @@ class Storage : public intrusive_list_node<Storage>
 
     typedef intrusive_list<BlobIndexNode> TBlobIndexList;
 
+    /* Number of pages probed via ItemIndex before falling back to a full scan */
+    static const size_t MAX_INDEX_CANDIDATES = 8;
+
 public:
+    /* Item staged by nvs_batch_set_* functions until the batch is committed */
+    struct BatchItem : public intrusive_list_node<BatchItem> {
+        public:
+            ~BatchItem()
+            {
+                if (data != value) {
+                    delete[] data;
+                }
+            }
+
+            ItemType datatype;
+            char key[Item::MAX_KEY_LENGTH + 1];
+            uint8_t* data;
+            size_t dataSize;
+            uint8_t value[8];
+
+            /* location of the previous value, filled in by writeBatch */
+            Page* oldPage;
+            VerOffset oldChunkStart;
+    };
+
+    typedef intrusive_list<BatchItem> TBatchItemList;
+
+    /* Multi-page blob opened by nvs_blob_open */
+    struct BlobCursor : public intrusive_list_node<BlobCursor> {
+        public:
+            struct Chunk {
+                Page* page;
+                size_t offset;          // offset of chunk data within the blob
+                size_t dataSize;
+                uint32_t dataCrc32;
+                size_t checkedSize;     // chunk data read in order so far
+                uint32_t checkedCrc32;  // crc of that data, compared to dataCrc32 once complete
+            };
+
+            ~BlobCursor()
+            {
+                delete[] chunks;
+            }
+
+            Storage* storage = nullptr;
+            uint8_t nsIndex;
+            char key[Item::MAX_KEY_LENGTH + 1];
+            bool found;                 // blob index existed when the cursor was opened
+            VerOffset chunkStart;
+            uint8_t chunkCount;
+            size_t dataSize;
+            Chunk* chunks = nullptr;
+
+            /* data written by appendBlob, the index is updated by closeBlob */
+            bool replace = false;       // appended data replaces the chunks above, see truncateBlob
+            uint8_t appendedChunkCount = 0;
+            size_t appendedSize = 0;
+            esp_err_t appendError = ESP_OK;
+
+            /* chunk which is being written, its header is not written yet */
+            Page* pendingPage = nullptr;
+            size_t pendingCapacity;
+            size_t pendingSize;
+            uint32_t pendingCrc32;
+            uint8_t tail[Page::ENTRY_SIZE];
+            size_t tailSize;
+    };
+
     ~Storage();
 
     Storage(const char *pName = NVS_DEFAULT_PART_NAME) : mPartitionName(pName) { };
@@ -77,6 +144,18 @@ public:
 
     esp_err_t eraseItem(uint8_t nsIndex, ItemType datatype, const char* key);
 
+    esp_err_t writeBatch(uint8_t nsIndex, TBatchItemList& items);
+
+    esp_err_t openBlob(uint8_t nsIndex, const char* key, BlobCursor& cursor);
+
+    esp_err_t readBlob(BlobCursor& cursor, size_t offset, void* data, size_t size);
+
+    esp_err_t appendBlob(BlobCursor& cursor, const void* data, size_t size);
+
+    esp_err_t truncateBlob(BlobCursor& cursor);
+
+    esp_err_t closeBlob(BlobCursor& cursor, bool commit);
+
     template<typename T>
     esp_err_t writeItem(uint8_t nsIndex, const char* key, const T& value)
     {
@@ -142,6 +221,20 @@ protected:
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    esp_err_t startBlobChunk(BlobCursor& cursor);
+
+    esp_err_t finishBlobChunk(BlobCursor& cursor);
+
+    void abortBlobChunk(BlobCursor& cursor);
+
+    void eraseAppendedChunks(BlobCursor& cursor);
+
+    void flushBlobCursors(BlobCursor* except = nullptr);
+
+    void detachBlobCursors();
+
+    size_t getMaxBlobSize();
+
 protected:
     const char *mPartitionName;
     size_t mPageCount;
@@ -149,6 +242,7 @@ protected:
     TNamespaces mNamespaces;
     CompressedEnumTable<bool, 1, 256> mNamespaceUsage;
     StorageState mState = StorageState::INVALID;
+    intrusive_list<BlobCursor> mBlobCursors;
 };
 
 } // namespace nvs
@@ -163,4 +257,17 @@ struct nvs_opaque_iterator_t
     nvs_entry_info_t entry_info;
 };
 
+struct nvs_opaque_batch_t
+{
+    nvs_handle_t handle;
+    nvs::Storage::TBatchItemList items;
+};
+
+struct nvs_opaque_blob_t
+{
+    nvs_handle_t handle;
+    bool readOnly;
+    nvs::Storage::BlobCursor cursor;
+};
+
 #endif /* nvs_storage_hpp */
@@ -43,11 +43,10 @@ uint32_t Item::calculateCrc32WithoutValue() const
     return result;
 }
 
-uint32_t Item::calculateCrc32(const uint8_t* data, size_t size)
+uint32_t Item::calculateCrc32(const uint8_t* data, size_t size, uint32_t crc)
 {
-    uint32_t result = 0xffffffff;
-    result = crc32_le(result, data, size);
-    return result;
+    // crc of data received in several parts can be computed by passing the previous result
+    return crc32_le(crc, data, size);
 }
 
 } // namespace nvs
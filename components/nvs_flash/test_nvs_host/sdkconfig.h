@@ -1,3 +1,5 @@
 #define CONFIG_NVS_ENCRYPTION 1
+#define CONFIG_NVS_ITEM_INDEX 1
+#define CONFIG_NVS_PARALLEL_LOAD 1
 //currently use the legacy implementation, since the stubs for new HAL are not done yet
 #define CONFIG_SPI_FLASH_USE_LEGACY_IMPL 1
@@ -18,6 +18,8 @@
 #include <cassert>
 #include <algorithm>
 #include <random>
+#include <atomic>
+#include <mutex>
 #include "esp_spi_flash.h"
 #include "catch.hpp"
 
@@ -71,6 +73,7 @@ public:
 
     bool write(size_t dstAddr, const uint32_t* src, size_t size)
     {
+        std::lock_guard<std::mutex> lock(mMutex);
         uint32_t sectorNumber = dstAddr/SPI_FLASH_SEC_SIZE;
         if (sectorNumber < mLowerSectorBound || sectorNumber >= mUpperSectorBound) {
             WARN("invalid flash operation detected: erase sector=" << sectorNumber);
@@ -107,6 +110,7 @@ public:
 
     bool erase(size_t sectorNumber)
     {
+        std::lock_guard<std::mutex> lock(mMutex);
         size_t offset = sectorNumber * SPI_FLASH_SEC_SIZE / 4;
         if (offset > mData.size()) {
             return false;
@@ -225,12 +229,14 @@ protected:
 
     std::vector<uint32_t> mData;
 
-    mutable size_t mReadOps = 0;
-    mutable size_t mWriteOps = 0;
-    mutable size_t mReadBytes = 0;
-    mutable size_t mWriteBytes = 0;
-    mutable size_t mEraseOps = 0;
-    mutable size_t mTotalTime = 0;
+    // pages may be loaded by several threads at once
+    mutable std::atomic<size_t> mReadOps{0};
+    mutable std::atomic<size_t> mWriteOps{0};
+    mutable std::atomic<size_t> mReadBytes{0};
+    mutable std::atomic<size_t> mWriteBytes{0};
+    mutable std::atomic<size_t> mEraseOps{0};
+    mutable std::atomic<size_t> mTotalTime{0};
+    std::mutex mMutex;
     size_t mLowerSectorBound = 0;
     size_t mUpperSectorBound = 0;
     
@@ -27,6 +27,8 @@
 #include <sys/wait.h>
 #include <string.h>
 #include <string>
+#include <chrono>
+#include <vector>
 
 #define TEST_ESP_ERR(rc, res) CHECK((rc) == (res))
 #define TEST_ESP_OK(rc) CHECK((rc) == ESP_OK)
@@ -291,9 +293,14 @@ TEST_CASE("Page handles invalid CRC of variable length items", "[nvs][cur]")
 class HashListTestHelper : public HashList
 {
     public:
-        size_t getBlockCount()
+        size_t getTableCount()
         {
-            return mBlockList.size();
+            return (mTable != nullptr) ? 1 : 0;
+        }
+
+        size_t getCapacity()
+        {
+            return mCapacity;
         }
 };
 
@@ -308,12 +315,12 @@ TEST_CASE("HashList is cleaned up as soon as items are erased", "[nvs]")
         Item item(1, ItemType::U32, 1, key);
         hashlist.insert(item, i);
     }
-    INFO("Added " << count << " items, " << hashlist.getBlockCount() << " blocks");
+    INFO("Added " << count << " items, " << hashlist.getTableCount() << " tables");
     // Remove them in reverse order
     for (size_t i = count; i > 0; --i) {
         hashlist.erase(i - 1, true);
     }
-    CHECK(hashlist.getBlockCount() == 0);
+    CHECK(hashlist.getTableCount() == 0);
     // Add again
     for (size_t i = 0; i < count; ++i) {
         char key[16];
@@ -321,12 +328,130 @@ TEST_CASE("HashList is cleaned up as soon as items are erased", "[nvs]")
         Item item(1, ItemType::U32, 1, key);
         hashlist.insert(item, i);
     }
-    INFO("Added " << count << " items, " << hashlist.getBlockCount() << " blocks");
+    INFO("Added " << count << " items, " << hashlist.getTableCount() << " tables");
     // Remove them in the same order
     for (size_t i = 0; i < count; ++i) {
         hashlist.erase(i, true);
     }
-    CHECK(hashlist.getBlockCount() == 0);
+    CHECK(hashlist.getTableCount() == 0);
+}
+
+TEST_CASE("HashList table grows and shrinks with the number of entries", "[nvs]")
+{
+    HashListTestHelper hashlist;
+    // one 32 slot step per 24 entries, the table is kept at most 75% full
+    for (size_t i = 0; i < 126; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "i%ld", (long int)i);
+        Item item(1, ItemType::U32, 1, key);
+        hashlist.insert(item, i);
+        CHECK(hashlist.getCapacity() == (i / 24 + 1) * 32);
+        CHECK(hashlist.find(0, item) == i);
+    }
+    for (size_t i = 0; i < 126; ++i) {
+        hashlist.erase(i, true);
+        size_t count = 125 - i;
+        INFO("count " << count << " capacity " << hashlist.getCapacity());
+        CHECK(hashlist.getCapacity() <= ((count + 23) / 24 + 1) * 32);
+    }
+    CHECK(hashlist.getTableCount() == 0);
+}
+
+TEST_CASE("HashList finds lowest matching index at or after start", "[nvs]")
+{
+    HashListTestHelper hashlist;
+    Item item(1, ItemType::U32, 1, "dup");
+    Item other(1, ItemType::U32, 1, "other");
+    hashlist.insert(item, 40);
+    hashlist.insert(other, 5);
+    hashlist.insert(item, 10);
+    hashlist.insert(item, 20);
+    CHECK(hashlist.find(0, item) == 10);
+    CHECK(hashlist.find(11, item) == 20);
+    CHECK(hashlist.find(21, item) == 40);
+    CHECK(hashlist.find(41, item) == SIZE_MAX);
+    CHECK(hashlist.find(0, other) == 5);
+    hashlist.erase(20);
+    CHECK(hashlist.find(11, item) == 40);
+    hashlist.erase(7, false);
+    hashlist.erase(10);
+    hashlist.erase(40);
+    CHECK(hashlist.find(0, item) == SIZE_MAX);
+    CHECK(hashlist.find(0, other) == 5);
+    hashlist.erase(5);
+    CHECK(hashlist.getTableCount() == 0);
+}
+
+TEST_CASE("benchmark HashList insert, find and erase", "[nvs]")
+{
+    const size_t iterations = 1000;
+    HashListTestHelper hashlist;
+    std::vector<Item> items;
+    for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+        items.push_back(Item(1, ItemType::U32, 1, key));
+    }
+
+    // count lookup misses instead of checking each one, so that the assertions
+    // don't dominate the measured time
+    size_t misses = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < iterations; ++n) {
+        for (size_t i = 0; i < items.size(); ++i) {
+            hashlist.insert(items[i], i);
+        }
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (hashlist.find(0, items[i]) != i) {
+                ++misses;
+            }
+        }
+        // erase in an order different from insertion
+        for (size_t i = 0; i < items.size(); ++i) {
+            hashlist.erase((i * 5) % items.size());
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    CHECK(misses == 0);
+    CHECK(hashlist.getTableCount() == 0);
+    s_perf << "Time to insert, find and erase " << Page::ENTRY_COUNT << " HashList entries " << iterations << " times: "
+           << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << " us" << std::endl;
+}
+
+TEST_CASE("ItemIndex keeps reference count for each page", "[nvs]")
+{
+    ItemIndex index;
+    Page pages[3];
+    const size_t count = 300;
+    for (size_t i = 0; i < count; ++i) {
+        index.insert(i, &pages[i % 3]);
+        index.insert(i, &pages[(i + 1) % 3]);
+        index.insert(i, &pages[(i + 1) % 3]);
+    }
+    CHECK(index.size() == count * 2);
+    CHECK(index.capacity() * 3 >= index.size() * 4);
+
+    for (size_t i = 0; i < count; ++i) {
+        index.erase(i, &pages[(i + 1) % 3]);
+    }
+    // pages which had the hash twice still have to be returned
+    for (size_t i = 0; i < count; ++i) {
+        size_t pos = 0;
+        size_t found = 0;
+        while (Page* p = index.find(i, pos)) {
+            CHECK((p == &pages[i % 3] || p == &pages[(i + 1) % 3]));
+            ++found;
+        }
+        CHECK(found == 2);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        index.erase(i, &pages[i % 3]);
+        index.erase(i, &pages[(i + 1) % 3]);
+        size_t pos = 0;
+        CHECK(index.find(i, pos) == nullptr);
+    }
+    CHECK(index.size() == 0);
 }
 
 TEST_CASE("can init PageManager in empty flash", "[nvs]")
@@ -399,6 +524,178 @@ TEST_CASE("can write one item a thousand times", "[nvs]")
     s_perf << "Time to write one item a thousand times: " << emu.getTotalTime() << " us (" << emu.getEraseOps() << " " << emu.getWriteOps() << " " << emu.getReadOps() << " " << emu.getWriteBytes() << " " << emu.getReadBytes() << ")" << std::endl;
 }
 
+class StorageScanHelper : public Storage
+{
+public:
+    // lookup by probing each page in turn, as done without the item index
+    esp_err_t scanItem(uint8_t nsIndex, ItemType datatype, const char* key)
+    {
+        for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
+            size_t itemIndex = 0;
+            Item item;
+            if (it->findItem(nsIndex, datatype, key, itemIndex, item) == ESP_OK) {
+                return ESP_OK;
+            }
+        }
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+};
+
+TEST_CASE("benchmark item lookup versus page count", "[nvs]")
+{
+    const size_t lookupCount = 1000;
+    const size_t pageCounts[] = {4, 16, 64};
+    char filler[Page::CHUNK_MAX_SIZE - 4 * Page::ENTRY_SIZE];
+    fill_n(filler, sizeof(filler), 'x');
+    filler[sizeof(filler) - 1] = 0;
+
+    for (size_t pageCount : pageCounts) {
+        SpiFlashEmulator emu(pageCount);
+        StorageScanHelper storage;
+        REQUIRE(storage.init(0, pageCount) == ESP_OK);
+        // fill every page but the last two with one big string each
+        for (size_t i = 0; i < pageCount - 2; ++i) {
+            char key[16];
+            snprintf(key, sizeof(key), "fill%d", static_cast<int>(i));
+            REQUIRE(storage.writeItem(1, ItemType::SZ, key, filler, sizeof(filler)) == ESP_OK);
+        }
+        REQUIRE(storage.writeItem(1, "target", static_cast<uint32_t>(pageCount)) == ESP_OK);
+
+        emu.clearStats();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < lookupCount; ++i) {
+            uint32_t value;
+            REQUIRE(storage.readItem(1, "target", value) == ESP_OK);
+            REQUIRE(value == pageCount);
+            REQUIRE(storage.readItem(1, "missing", value) == ESP_ERR_NVS_NOT_FOUND);
+        }
+        auto indexedTime = std::chrono::steady_clock::now() - start;
+        size_t indexedReads = emu.getReadOps();
+
+        emu.clearStats();
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < lookupCount; ++i) {
+            REQUIRE(storage.scanItem(1, itemTypeOf<uint32_t>(), "target") == ESP_OK);
+            REQUIRE(storage.scanItem(1, itemTypeOf<uint32_t>(), "missing") == ESP_ERR_NVS_NOT_FOUND);
+        }
+        auto scanTime = std::chrono::steady_clock::now() - start;
+
+        s_perf << "Time to look up one present and one missing item " << lookupCount << " times (" << pageCount << " pages): "
+               << std::chrono::duration_cast<std::chrono::microseconds>(indexedTime).count() << " us ("
+               << indexedReads << "R), page scan: "
+               << std::chrono::duration_cast<std::chrono::microseconds>(scanTime).count() << " us ("
+               << emu.getReadOps() << "R)" << std::endl;
+    }
+}
+
+TEST_CASE("benchmark batch commit versus individual writes", "[nvs]")
+{
+    const size_t itemCount = 32;
+    size_t writeOps[2][2];
+
+    for (int useBatch = 0; useBatch < 2; ++useBatch) {
+        SpiFlashEmulator emu(10);
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 10));
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("bench", NVS_READWRITE, &handle));
+
+        // first round creates the keys, second one updates all of them
+        for (int round = 0; round < 2; ++round) {
+            emu.clearStats();
+            nvs_batch_handle_t batch;
+            if (useBatch) {
+                TEST_ESP_OK(nvs_batch_begin(handle, &batch));
+            }
+            for (size_t i = 0; i < itemCount; ++i) {
+                char key[16];
+                snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+                uint32_t value = static_cast<uint32_t>(i + round * itemCount);
+                if (useBatch) {
+                    TEST_ESP_OK(nvs_batch_set_u32(batch, key, value));
+                } else {
+                    TEST_ESP_OK(nvs_set_u32(handle, key, value));
+                }
+            }
+            if (useBatch) {
+                TEST_ESP_OK(nvs_batch_commit(batch));
+            }
+            writeOps[useBatch][round] = emu.getWriteOps();
+
+            s_perf << "Time to " << ((round == 0) ? "write " : "update ") << itemCount << " integers "
+                   << (useBatch ? "in one batch: " : "one by one: ") << emu.getTotalTime() << " us ("
+                   << emu.getEraseOps() << "E " << emu.getWriteOps() << "W " << emu.getReadOps() << "R "
+                   << emu.getWriteBytes() << "Wb " << emu.getReadBytes() << "Rb)" << std::endl;
+
+            for (size_t i = 0; i < itemCount; ++i) {
+                char key[16];
+                snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+                uint32_t value;
+                TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+                CHECK(value == i + round * itemCount);
+            }
+        }
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit());
+    }
+
+    CHECK(writeOps[1][0] < writeOps[0][0]);
+    CHECK(writeOps[1][1] < writeOps[0][1]);
+}
+
+class PageManagerTestHelper : public PageManager
+{
+    public:
+        void setParallelLoad(bool parallel)
+        {
+            mParallelLoad = parallel;
+        }
+};
+
+TEST_CASE("benchmark nvs_flash_init versus partition size", "[nvs]")
+{
+    const size_t pageCounts[] = {8, 32, 128, 512};
+
+    for (size_t pageCount : pageCounts) {
+        SpiFlashEmulator emu(pageCount);
+        // fill all pages but the last two with integers
+        for (size_t p = 0; p < pageCount - 2; ++p) {
+            Page page;
+            REQUIRE(page.load(p) == ESP_OK);
+            REQUIRE(page.setSeqNumber(p) == ESP_OK);
+            for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+                char key[16];
+                snprintf(key, sizeof(key), "k%d", static_cast<int>(p * Page::ENTRY_COUNT + i));
+                REQUIRE(page.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+            }
+            REQUIRE(page.markFull() == ESP_OK);
+        }
+
+        size_t indexSize[2];
+        std::chrono::steady_clock::duration loadTime[2];
+        for (int parallel = 0; parallel < 2; ++parallel) {
+            PageManagerTestHelper pm;
+            pm.setParallelLoad(parallel);
+            auto start = std::chrono::steady_clock::now();
+            REQUIRE(pm.load(0, pageCount) == ESP_OK);
+            loadTime[parallel] = std::chrono::steady_clock::now() - start;
+            indexSize[parallel] = pm.getItemIndex().size();
+        }
+        CHECK(indexSize[0] == indexSize[1]);
+
+        emu.clearStats();
+        auto start = std::chrono::steady_clock::now();
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, pageCount));
+        auto initTime = std::chrono::steady_clock::now() - start;
+        TEST_ESP_OK(nvs_flash_deinit());
+
+        s_perf << "Time to init storage (" << pageCount << " pages): "
+               << std::chrono::duration_cast<std::chrono::microseconds>(initTime).count() << " us ("
+               << emu.getReadOps() << "R), page load: "
+               << std::chrono::duration_cast<std::chrono::microseconds>(loadTime[0]).count() << " us sequential, "
+               << std::chrono::duration_cast<std::chrono::microseconds>(loadTime[1]).count() << " us parallel" << std::endl;
+    }
+}
+
 TEST_CASE("storage doesn't add duplicates within multiple pages", "[nvs]")
 {
     SpiFlashEmulator emu(8);
@@ -612,6 +909,303 @@ TEST_CASE("nvs api tests", "[nvs]")
 }
 
 
+TEST_CASE("nvs batch api tests", "[nvs]")
+{
+    SpiFlashEmulator emu(3);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 3));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_u8(handle, "u8", 1));
+    TEST_ESP_OK(nvs_set_str(handle, "str", "old value"));
+
+    nvs_batch_handle_t batch;
+    TEST_ESP_OK(nvs_batch_begin(handle, &batch));
+    TEST_ESP_OK(nvs_batch_set_i8(batch, "i8", -8));
+    TEST_ESP_OK(nvs_batch_set_u8(batch, "u8", 2));
+    TEST_ESP_OK(nvs_batch_set_i16(batch, "i16", -16));
+    TEST_ESP_OK(nvs_batch_set_u16(batch, "u16", 16));
+    TEST_ESP_OK(nvs_batch_set_i32(batch, "i32", -32));
+    TEST_ESP_OK(nvs_batch_set_u32(batch, "u32", 0));
+    TEST_ESP_OK(nvs_batch_set_u32(batch, "u32", 32));
+    TEST_ESP_OK(nvs_batch_set_i64(batch, "i64", -64));
+    TEST_ESP_OK(nvs_batch_set_u64(batch, "u64", 64));
+    TEST_ESP_OK(nvs_batch_set_str(batch, "str", "new value 0123456789abcdef0123456789abcdef"));
+    const uint8_t blob[] = {0xff, 0xff, 0xff, 0xff, 0x01, 0x02, 0x03};
+    TEST_ESP_OK(nvs_batch_set_blob(batch, "blob", blob, sizeof(blob)));
+    TEST_ESP_ERR(nvs_batch_set_u8(batch, "this key is too long", 1), ESP_ERR_NVS_KEY_TOO_LONG);
+
+    // nothing is written before commit
+    uint8_t u8;
+    uint32_t u32;
+    TEST_ESP_ERR(nvs_get_u32(handle, "u32", &u32), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(nvs_get_u8(handle, "u8", &u8));
+    CHECK(u8 == 1);
+
+    TEST_ESP_OK(nvs_batch_commit(batch));
+
+    int8_t i8;
+    int16_t i16;
+    uint16_t u16;
+    int32_t i32;
+    int64_t i64;
+    uint64_t u64;
+    TEST_ESP_OK(nvs_get_i8(handle, "i8", &i8));
+    CHECK(i8 == -8);
+    TEST_ESP_OK(nvs_get_u8(handle, "u8", &u8));
+    CHECK(u8 == 2);
+    TEST_ESP_OK(nvs_get_i16(handle, "i16", &i16));
+    CHECK(i16 == -16);
+    TEST_ESP_OK(nvs_get_u16(handle, "u16", &u16));
+    CHECK(u16 == 16);
+    TEST_ESP_OK(nvs_get_i32(handle, "i32", &i32));
+    CHECK(i32 == -32);
+    TEST_ESP_OK(nvs_get_u32(handle, "u32", &u32));
+    CHECK(u32 == 32);
+    TEST_ESP_OK(nvs_get_i64(handle, "i64", &i64));
+    CHECK(i64 == -64);
+    TEST_ESP_OK(nvs_get_u64(handle, "u64", &u64));
+    CHECK(u64 == 64);
+    char buf[64];
+    size_t buf_len = sizeof(buf);
+    TEST_ESP_OK(nvs_get_str(handle, "str", buf, &buf_len));
+    CHECK(strcmp(buf, "new value 0123456789abcdef0123456789abcdef") == 0);
+    uint8_t blob_read[sizeof(blob)];
+    size_t blob_len = sizeof(blob_read);
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", blob_read, &blob_len));
+    CHECK(memcmp(blob, blob_read, sizeof(blob)) == 0);
+
+    // old copies were erased, values survive re-initialization
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 3));
+    TEST_ESP_OK(nvs_get_u8(handle, "u8", &u8));
+    CHECK(u8 == 2);
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", blob_read, &blob_len));
+    CHECK(memcmp(blob, blob_read, sizeof(blob)) == 0);
+
+    // unchanged values are not written again
+    TEST_ESP_OK(nvs_batch_begin(handle, &batch));
+    TEST_ESP_OK(nvs_batch_set_u8(batch, "u8", 2));
+    TEST_ESP_OK(nvs_batch_set_blob(batch, "blob", blob, sizeof(blob)));
+    emu.clearStats();
+    TEST_ESP_OK(nvs_batch_commit(batch));
+    CHECK(emu.getWriteOps() == 0);
+
+    // batch which doesn't fit into one page is rejected
+    uint8_t big[Page::CHUNK_MAX_SIZE / 2] = {0};
+    TEST_ESP_OK(nvs_batch_begin(handle, &batch));
+    TEST_ESP_OK(nvs_batch_set_blob(batch, "big1", big, sizeof(big)));
+    TEST_ESP_OK(nvs_batch_set_blob(batch, "big2", big, sizeof(big)));
+    TEST_ESP_ERR(nvs_batch_commit(batch), ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    blob_len = sizeof(big);
+    TEST_ESP_ERR(nvs_get_blob(handle, "big1", big, &blob_len), ESP_ERR_NVS_NOT_FOUND);
+
+    TEST_ESP_OK(nvs_batch_begin(handle, &batch));
+    TEST_ESP_OK(nvs_batch_set_u8(batch, "aborted", 1));
+    nvs_batch_abort(batch);
+    TEST_ESP_ERR(nvs_get_u8(handle, "aborted", &u8), ESP_ERR_NVS_NOT_FOUND);
+
+    nvs_handle_t handle_ro;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle_ro));
+    TEST_ESP_ERR(nvs_batch_begin(handle_ro, &batch), ESP_ERR_NVS_READ_ONLY);
+    nvs_close(handle_ro);
+
+    // commit after the handle was closed
+    TEST_ESP_OK(nvs_batch_begin(handle, &batch));
+    TEST_ESP_OK(nvs_batch_set_u8(batch, "closed", 1));
+    nvs_close(handle);
+    TEST_ESP_ERR(nvs_batch_commit(batch), ESP_ERR_NVS_INVALID_HANDLE);
+}
+
+static void fill_pattern(uint8_t* data, size_t offset, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<uint8_t>((offset + i) * 7 + (offset + i) / 251);
+    }
+}
+
+TEST_CASE("nvs blob cursor api tests", "[nvs]")
+{
+    SpiFlashEmulator emu(20);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 20));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+
+    // blob written at once is read in parts
+    const size_t blobSize = 10000;
+    uint8_t* expected = new uint8_t[3 * blobSize];
+    fill_pattern(expected, 0, 3 * blobSize);
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", expected, blobSize));
+
+    nvs_blob_handle_t blob;
+    TEST_ESP_OK(nvs_blob_open(handle, "blob", &blob));
+    size_t size;
+    TEST_ESP_OK(nvs_blob_get_size(blob, &size));
+    CHECK(size == blobSize);
+    uint8_t buf[100];
+    for (size_t offset = 0; offset < blobSize; offset += sizeof(buf)) {
+        TEST_ESP_OK(nvs_blob_read_at(blob, offset, buf, sizeof(buf)));
+        CHECK(memcmp(buf, expected + offset, sizeof(buf)) == 0);
+    }
+    const size_t offsets[] = {1, 31, 4000, 4001, blobSize - 77};
+    for (size_t offset : offsets) {
+        TEST_ESP_OK(nvs_blob_read_at(blob, offset, buf, 77));
+        CHECK(memcmp(buf, expected + offset, 77) == 0);
+    }
+    TEST_ESP_ERR(nvs_blob_read_at(blob, blobSize - 10, buf, 11), ESP_ERR_NVS_INVALID_LENGTH);
+    TEST_ESP_OK(nvs_blob_close(blob));
+
+    // blob written in parts is read at once
+    TEST_ESP_OK(nvs_blob_open(handle, "stream", &blob));
+    TEST_ESP_OK(nvs_blob_get_size(blob, &size));
+    CHECK(size == 0);
+    for (size_t offset = 0; offset < 2 * blobSize; offset += 77) {
+        TEST_ESP_OK(nvs_blob_append(blob, expected + offset, std::min<size_t>(77, 2 * blobSize - offset)));
+    }
+    uint8_t* actual = new uint8_t[3 * blobSize];
+    size = 3 * blobSize;
+    TEST_ESP_ERR(nvs_get_blob(handle, "stream", actual, &size), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(nvs_blob_close(blob));
+    size = 3 * blobSize;
+    TEST_ESP_OK(nvs_get_blob(handle, "stream", actual, &size));
+    CHECK(size == 2 * blobSize);
+    CHECK(memcmp(actual, expected, size) == 0);
+
+    // appending keeps existing data, other writes may happen in between
+    TEST_ESP_OK(nvs_blob_open(handle, "stream", &blob));
+    TEST_ESP_OK(nvs_blob_append(blob, expected + 2 * blobSize, 1000));
+    TEST_ESP_OK(nvs_set_u32(handle, "u32", 1));
+    TEST_ESP_OK(nvs_blob_read_at(blob, 1000, buf, sizeof(buf)));
+    CHECK(memcmp(buf, expected + 1000, sizeof(buf)) == 0);
+    TEST_ESP_OK(nvs_blob_append(blob, expected + 2 * blobSize + 1000, blobSize - 1000));
+    TEST_ESP_OK(nvs_blob_close(blob));
+
+    // data survives reinitialization
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 20));
+    size = 3 * blobSize;
+    TEST_ESP_OK(nvs_get_blob(handle, "stream", actual, &size));
+    CHECK(size == 3 * blobSize);
+    CHECK(memcmp(actual, expected, size) == 0);
+    uint32_t u32;
+    TEST_ESP_OK(nvs_get_u32(handle, "u32", &u32));
+    CHECK(u32 == 1);
+
+    // truncated blob keeps its value until it is closed
+    TEST_ESP_OK(nvs_blob_open(handle, "stream", &blob));
+    TEST_ESP_OK(nvs_blob_append(blob, expected, 3000));
+    TEST_ESP_OK(nvs_blob_truncate(blob));
+    TEST_ESP_OK(nvs_blob_append(blob, expected + blobSize, 5000));
+    TEST_ESP_OK(nvs_blob_read_at(blob, 2 * blobSize, buf, sizeof(buf)));
+    CHECK(memcmp(buf, expected + 2 * blobSize, sizeof(buf)) == 0);
+    size = 3 * blobSize;
+    TEST_ESP_OK(nvs_get_blob(handle, "stream", actual, &size));
+    CHECK(size == 3 * blobSize);
+    TEST_ESP_OK(nvs_blob_close(blob));
+    size = 3 * blobSize;
+    TEST_ESP_OK(nvs_get_blob(handle, "stream", actual, &size));
+    CHECK(size == 5000);
+    CHECK(memcmp(actual, expected + blobSize, size) == 0);
+
+    // replaced blob can be appended to, and replaced again with nothing
+    TEST_ESP_OK(nvs_blob_open(handle, "stream", &blob));
+    TEST_ESP_OK(nvs_blob_append(blob, expected + blobSize + 5000, 1000));
+    TEST_ESP_OK(nvs_blob_close(blob));
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 20));
+    size = 3 * blobSize;
+    TEST_ESP_OK(nvs_get_blob(handle, "stream", actual, &size));
+    CHECK(size == 6000);
+    CHECK(memcmp(actual, expected + blobSize, size) == 0);
+    TEST_ESP_OK(nvs_blob_open(handle, "stream", &blob));
+    TEST_ESP_OK(nvs_blob_truncate(blob));
+    TEST_ESP_OK(nvs_blob_close(blob));
+    size = 3 * blobSize;
+    TEST_ESP_OK(nvs_get_blob(handle, "stream", actual, &size));
+    CHECK(size == 0);
+
+    // aborted data is discarded
+    TEST_ESP_OK(nvs_blob_open(handle, "blob", &blob));
+    TEST_ESP_OK(nvs_blob_append(blob, expected, 5000));
+    nvs_blob_abort(blob);
+    size = 3 * blobSize;
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", actual, &size));
+    CHECK(size == blobSize);
+
+    // blob which was erased while it was open
+    TEST_ESP_OK(nvs_blob_open(handle, "blob", &blob));
+    TEST_ESP_OK(nvs_blob_append(blob, expected, 100));
+    TEST_ESP_OK(nvs_erase_key(handle, "blob"));
+    TEST_ESP_ERR(nvs_blob_read_at(blob, 0, buf, sizeof(buf)), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_ERR(nvs_blob_close(blob), ESP_ERR_INVALID_STATE);
+    size = 3 * blobSize;
+    TEST_ESP_ERR(nvs_get_blob(handle, "blob", actual, &size), ESP_ERR_NVS_NOT_FOUND);
+
+    nvs_handle_t handle_ro;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle_ro));
+    TEST_ESP_ERR(nvs_blob_open(handle_ro, "missing", &blob), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(nvs_blob_open(handle_ro, "stream", &blob));
+    TEST_ESP_ERR(nvs_blob_append(blob, expected, 1), ESP_ERR_NVS_READ_ONLY);
+    TEST_ESP_ERR(nvs_blob_truncate(blob), ESP_ERR_NVS_READ_ONLY);
+    TEST_ESP_OK(nvs_blob_close(blob));
+    nvs_close(handle_ro);
+
+    // blob cursors can't be used after the handle is closed
+    TEST_ESP_OK(nvs_blob_open(handle, "stream", &blob));
+    nvs_close(handle);
+    TEST_ESP_ERR(nvs_blob_read_at(blob, 0, buf, sizeof(buf)), ESP_ERR_NVS_INVALID_HANDLE);
+    TEST_ESP_ERR(nvs_blob_close(blob), ESP_ERR_NVS_INVALID_HANDLE);
+
+    delete[] expected;
+    delete[] actual;
+    TEST_ESP_OK(nvs_flash_deinit());
+}
+
+TEST_CASE("benchmark blob cursor versus nvs_get_blob", "[nvs]")
+{
+    const size_t blobSize = 100 * 1024;
+    const size_t pageCount = 40;
+    SpiFlashEmulator emu(pageCount);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, pageCount));
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("bench", NVS_READWRITE, &handle));
+
+    uint8_t buf[256];
+    emu.clearStats();
+    nvs_blob_handle_t blob;
+    TEST_ESP_OK(nvs_blob_open(handle, "blob", &blob));
+    for (size_t offset = 0; offset < blobSize; offset += sizeof(buf)) {
+        fill_pattern(buf, offset, sizeof(buf));
+        TEST_ESP_OK(nvs_blob_append(blob, buf, sizeof(buf)));
+    }
+    TEST_ESP_OK(nvs_blob_close(blob));
+    s_perf << "Time to append 100 KB blob in 256 byte parts: " << emu.getTotalTime() << " us ("
+           << emu.getEraseOps() << "E " << emu.getWriteOps() << "W " << emu.getReadOps() << "R "
+           << emu.getWriteBytes() << "Wb " << emu.getReadBytes() << "Rb)" << std::endl;
+
+    emu.clearStats();
+    TEST_ESP_OK(nvs_blob_open(handle, "blob", &blob));
+    for (size_t offset = 0; offset < blobSize; offset += sizeof(buf)) {
+        uint8_t expected[sizeof(buf)];
+        fill_pattern(expected, offset, sizeof(buf));
+        TEST_ESP_OK(nvs_blob_read_at(blob, offset, buf, sizeof(buf)));
+        REQUIRE(memcmp(buf, expected, sizeof(buf)) == 0);
+    }
+    TEST_ESP_OK(nvs_blob_close(blob));
+    s_perf << "Time to read 100 KB blob in 256 byte parts: " << emu.getTotalTime() << " us ("
+           << emu.getReadOps() << "R " << emu.getReadBytes() << "Rb)" << std::endl;
+
+    uint8_t* data = new uint8_t[blobSize];
+    size_t size = blobSize;
+    emu.clearStats();
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", data, &size));
+    CHECK(size == blobSize);
+    s_perf << "Time to read 100 KB blob at once: " << emu.getTotalTime() << " us ("
+           << emu.getReadOps() << "R " << emu.getReadBytes() << "Rb)" << std::endl;
+
+    delete[] data;
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit());
+}
+
 TEST_CASE("nvs iterators tests", "[nvs]")
 {
     SpiFlashEmulator emu(5);
@@ -1833,6 +2427,230 @@ TEST_CASE("Recovery from power-off when page is being freed.", "[nvs]")
     nvs_close(handle);
 }
 
+TEST_CASE("Recovery from power-off during batch commit", "[nvs][recovery]")
+{
+    const size_t intCount = 6;
+    const char* oldStr = "old value";
+    const char* newStr = "new value 0123456789abcdef0123456789abcdef";
+    uint8_t oldBlob[100];
+    uint8_t newBlob[100];
+    fill_n(oldBlob, sizeof(oldBlob), 0x11);
+    fill_n(newBlob, sizeof(newBlob), 0xff);
+    newBlob[sizeof(newBlob) - 1] = 0x22;
+
+    // without padding, the batch goes to the page which holds the old values;
+    // with padding, that page is full and the batch goes to the next one
+    const size_t paddings[] = {0, 100};
+    for (size_t padding : paddings) {
+        for (uint32_t errDelay = 0; ; ++errDelay) {
+            INFO(padding << " " << errDelay);
+            SpiFlashEmulator emu(5);
+            TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 5));
+            nvs_handle_t handle;
+            TEST_ESP_OK(nvs_open("test", NVS_READWRITE, &handle));
+
+            char key[16];
+            for (size_t i = 0; i < intCount; ++i) {
+                snprintf(key, sizeof(key), "int%d", static_cast<int>(i));
+                TEST_ESP_OK(nvs_set_i32(handle, key, i));
+            }
+            TEST_ESP_OK(nvs_set_str(handle, "str", oldStr));
+            TEST_ESP_OK(nvs_set_blob(handle, "blob", oldBlob, sizeof(oldBlob)));
+            for (size_t i = 0; i < padding; ++i) {
+                snprintf(key, sizeof(key), "pad%d", static_cast<int>(i));
+                TEST_ESP_OK(nvs_set_u8(handle, key, i));
+            }
+
+            nvs_batch_handle_t batch;
+            TEST_ESP_OK(nvs_batch_begin(handle, &batch));
+            for (size_t i = 0; i < intCount; ++i) {
+                snprintf(key, sizeof(key), "int%d", static_cast<int>(i));
+                TEST_ESP_OK(nvs_batch_set_i32(batch, key, i + 100));
+            }
+            TEST_ESP_OK(nvs_batch_set_str(batch, "str", newStr));
+            TEST_ESP_OK(nvs_batch_set_blob(batch, "blob", newBlob, sizeof(newBlob)));
+
+            emu.failAfter(errDelay);
+            esp_err_t err = nvs_batch_commit(batch);
+            emu.failAfter(UINT32_MAX);
+
+            TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 5));
+
+            size_t newCount = 0;
+            for (size_t i = 0; i < intCount; ++i) {
+                int32_t value;
+                snprintf(key, sizeof(key), "int%d", static_cast<int>(i));
+                TEST_ESP_OK(nvs_get_i32(handle, key, &value));
+                CHECK((value == static_cast<int32_t>(i) || value == static_cast<int32_t>(i + 100)));
+                newCount += (value == static_cast<int32_t>(i + 100)) ? 1 : 0;
+            }
+            char buf[64];
+            size_t bufLen = sizeof(buf);
+            TEST_ESP_OK(nvs_get_str(handle, "str", buf, &bufLen));
+            CHECK((strcmp(buf, oldStr) == 0 || strcmp(buf, newStr) == 0));
+            newCount += (strcmp(buf, newStr) == 0) ? 1 : 0;
+            uint8_t blob[sizeof(newBlob)];
+            size_t blobLen = sizeof(blob);
+            TEST_ESP_OK(nvs_get_blob(handle, "blob", blob, &blobLen));
+            CHECK((memcmp(blob, oldBlob, sizeof(blob)) == 0 || memcmp(blob, newBlob, sizeof(blob)) == 0));
+            newCount += (memcmp(blob, newBlob, sizeof(blob)) == 0) ? 1 : 0;
+
+            // either the whole batch is visible, or nothing of it
+            CHECK((newCount == 0 || newCount == intCount + 2));
+            nvs_close(handle);
+            if (err == ESP_OK) {
+                CHECK(newCount == intCount + 2);
+                break;
+            }
+        }
+    }
+}
+
+TEST_CASE("Recovery from power-off during blob append", "[nvs][recovery]")
+{
+    const size_t oldSize = 3000;
+    const size_t newSize = 6000;
+    uint8_t expected[oldSize + newSize];
+    fill_pattern(expected, 0, sizeof(expected));
+
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        SpiFlashEmulator emu(5);
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 5));
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("test", NVS_READWRITE, &handle));
+        TEST_ESP_OK(nvs_set_blob(handle, "blob", expected, oldSize));
+
+        emu.failAfter(errDelay);
+        nvs_blob_handle_t blob;
+        esp_err_t err = nvs_blob_open(handle, "blob", &blob);
+        if (err == ESP_OK) {
+            for (size_t offset = oldSize; offset < sizeof(expected) && err == ESP_OK; offset += 1000) {
+                err = nvs_blob_append(blob, expected + offset, 1000);
+                if (err == ESP_OK && offset == oldSize + 2000) {
+                    err = nvs_set_u8(handle, "u8", 1);
+                }
+            }
+            esp_err_t closeErr = nvs_blob_close(blob);
+            if (err == ESP_OK) {
+                err = closeErr;
+            }
+        }
+        emu.failAfter(UINT32_MAX);
+
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 5));
+
+        // blob has either the old value or the whole appended data
+        uint8_t actual[sizeof(expected)];
+        size_t size = sizeof(actual);
+        TEST_ESP_OK(nvs_get_blob(handle, "blob", actual, &size));
+        CHECK((size == oldSize || size == sizeof(expected)));
+        CHECK(memcmp(actual, expected, size) == 0);
+        nvs_close(handle);
+        if (err == ESP_OK) {
+            CHECK(size == sizeof(expected));
+            break;
+        }
+    }
+}
+
+TEST_CASE("Recovery from power-off during blob replace", "[nvs][recovery]")
+{
+    const size_t oldSize = 3000;
+    const size_t newSize = 6000;
+    uint8_t expected[oldSize + newSize];
+    fill_pattern(expected, 0, sizeof(expected));
+
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        SpiFlashEmulator emu(5);
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 5));
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("test", NVS_READWRITE, &handle));
+        TEST_ESP_OK(nvs_set_blob(handle, "blob", expected, oldSize));
+
+        emu.failAfter(errDelay);
+        nvs_blob_handle_t blob;
+        esp_err_t err = nvs_blob_open(handle, "blob", &blob);
+        if (err == ESP_OK) {
+            err = nvs_blob_truncate(blob);
+            for (size_t offset = oldSize; offset < sizeof(expected) && err == ESP_OK; offset += 1000) {
+                err = nvs_blob_append(blob, expected + offset, 1000);
+            }
+            esp_err_t closeErr = nvs_blob_close(blob);
+            if (err == ESP_OK) {
+                err = closeErr;
+            }
+        }
+        emu.failAfter(UINT32_MAX);
+
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 5));
+
+        // blob has either the old or the new value, never neither of them
+        uint8_t actual[sizeof(expected)];
+        size_t size = sizeof(actual);
+        TEST_ESP_OK(nvs_get_blob(handle, "blob", actual, &size));
+        if (size == oldSize) {
+            CHECK(memcmp(actual, expected, size) == 0);
+        } else {
+            CHECK(size == newSize);
+            CHECK(memcmp(actual, expected + oldSize, size) == 0);
+        }
+        nvs_close(handle);
+        if (err == ESP_OK) {
+            CHECK(size == newSize);
+            break;
+        }
+    }
+}
+
+TEST_CASE("Failed blob append leaves the blob handle aborted", "[nvs]")
+{
+    const size_t oldSize = 3000;
+    uint8_t expected[oldSize + 6000];
+    fill_pattern(expected, 0, sizeof(expected));
+
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        SpiFlashEmulator emu(5);
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 5));
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("test", NVS_READWRITE, &handle));
+        TEST_ESP_OK(nvs_set_blob(handle, "blob", expected, oldSize));
+        nvs_blob_handle_t blob;
+        TEST_ESP_OK(nvs_blob_open(handle, "blob", &blob));
+
+        // the partly written chunk must not be completed once flash works again
+        emu.failAfter(errDelay);
+        esp_err_t err = ESP_OK;
+        for (size_t offset = oldSize; offset < sizeof(expected) && err == ESP_OK; offset += 1000) {
+            err = nvs_blob_append(blob, expected + offset, 1000);
+        }
+        emu.failAfter(UINT32_MAX);
+
+        if (err == ESP_OK) {
+            TEST_ESP_OK(nvs_blob_close(blob));
+            nvs_close(handle);
+            break;
+        }
+        CHECK(nvs_blob_append(blob, expected, 100) == err);
+        CHECK(nvs_blob_truncate(blob) == err);
+        CHECK(nvs_blob_close(blob) == err);
+
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 5));
+        uint8_t actual[sizeof(expected)];
+        size_t size = sizeof(actual);
+        TEST_ESP_OK(nvs_get_blob(handle, "blob", actual, &size));
+        CHECK(size == oldSize);
+        CHECK(memcmp(actual, expected, size) == 0);
+        TEST_ESP_OK(nvs_set_blob(handle, "other", expected, 1000));
+        size = sizeof(actual);
+        TEST_ESP_OK(nvs_get_blob(handle, "other", actual, &size));
+        CHECK(size == 1000);
+        nvs_close(handle);
+    }
+}
+
 TEST_CASE("Multi-page blobs are supported", "[nvs]")
 {
     const size_t blob_size = Page::CHUNK_MAX_SIZE *2;
@@ -439,8 +439,17 @@ uint32_t emac_hal_get_tx_desc_owner(emac_hal_context_t *hal)
 }
 
 void emac_hal_transmit_frame(emac_hal_context_t *hal, uint8_t *buf, uint32_t length)
+{
+    emac_hal_transmit_multiple_buf_frame(hal, &buf, &length, 1);
+}
+
+void emac_hal_transmit_multiple_buf_frame(emac_hal_context_t *hal, uint8_t **buffs, uint32_t *lengths, uint32_t buffs_cnt)
 {
     /* Get the number of Tx buffers to use for the frame */
+    uint32_t length = 0;
+    for (uint32_t i = 0; i < buffs_cnt; i++) {
+        length += lengths[i];
+    }
     uint32_t bufcount = 0;
     uint32_t lastlen = length;
     while (lastlen > CONFIG_ETH_DMA_BUFFER_SIZE) {
@@ -450,8 +459,12 @@ void emac_hal_transmit_frame(emac_hal_context_t *hal, uint8_t *buf, uint32_t len
     if (lastlen) {
         bufcount++;
     }
+    /* Position in the input buffers */
+    uint32_t buff = 0;
+    uint32_t offset = 0;
     /* A frame is transmitted in multiple descriptor */
     for (uint32_t i = 0; i < bufcount; i++) {
+        uint32_t size = CONFIG_ETH_DMA_BUFFER_SIZE;
         /* Clear FIRST and LAST segment bits */
         hal->tx_desc->TDES0.FirstSegment = 0;
         hal->tx_desc->TDES0.LastSegment = 0;
@@ -464,15 +477,25 @@ void emac_hal_transmit_frame(emac_hal_context_t *hal, uint8_t *buf, uint32_t len
             hal->tx_desc->TDES0.LastSegment = 1;
             /* Enable transmit interrupt */
             hal->tx_desc->TDES0.InterruptOnComplete = 1;
-            /* Program size */
-            hal->tx_desc->TDES1.TransmitBuffer1Size = lastlen;
-            /* copy data from uplayer stack buffer */
-            memcpy((void *)(hal->tx_desc->Buffer1Addr), buf + i * CONFIG_ETH_DMA_BUFFER_SIZE, lastlen);
-        } else {
-            /* Program size */
-            hal->tx_desc->TDES1.TransmitBuffer1Size = CONFIG_ETH_DMA_BUFFER_SIZE;
-            /* copy data from uplayer stack buffer */
-            memcpy((void *)(hal->tx_desc->Buffer1Addr), buf + i * CONFIG_ETH_DMA_BUFFER_SIZE, CONFIG_ETH_DMA_BUFFER_SIZE);
+            size = lastlen;
+        }
+        /* Program size */
+        hal->tx_desc->TDES1.TransmitBuffer1Size = size;
+        /* copy data from uplayer stack buffers, a DMA buffer may span several of them */
+        uint8_t *dest = (uint8_t *)(hal->tx_desc->Buffer1Addr);
+        while (size) {
+            uint32_t copy_len = lengths[buff] - offset;
+            if (copy_len > size) {
+                copy_len = size;
+            }
+            memcpy(dest, buffs[buff] + offset, copy_len);
+            dest += copy_len;
+            size -= copy_len;
+            offset += copy_len;
+            if (offset == lengths[buff]) {
+                buff++;
+                offset = 0;
+            }
         }
         /* Set Own bit of the Tx descriptor Status: gives the buffer back to ETHERNET DMA */
         hal->tx_desc->TDES0.Own = EMAC_DMADESC_OWNER_DMA;
@@ -380,6 +380,8 @@ uint32_t emac_hal_get_tx_desc_owner(emac_hal_context_t *hal);
 
 void emac_hal_transmit_frame(emac_hal_context_t *hal, uint8_t *buf, uint32_t length);
 
+void emac_hal_transmit_multiple_buf_frame(emac_hal_context_t *hal, uint8_t **buffs, uint32_t *lengths, uint32_t buffs_cnt);
+
 uint32_t emac_hal_receive_frame(emac_hal_context_t *hal, uint8_t *buf, uint32_t *frames_remain);
 
 void emac_hal_isr(void *arg);
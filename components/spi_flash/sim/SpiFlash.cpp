@@ -31,7 +31,8 @@ using namespace std;
 
 SpiFlash::SpiFlash()
 {
-    return;
+    memset(&this->stats, 0, sizeof(this->stats));
+    memset(&this->timing, 0, sizeof(this->timing));
 }
 
 SpiFlash::~SpiFlash()
@@ -63,6 +64,8 @@ void SpiFlash::init(uint32_t chip_size, uint32_t block_size, uint32_t sector_siz
 
     this->total_erase_cycles = 0;
 
+    this->reset_stats();
+
     // Load partitions table bin
     this->memory = (uint8_t *) malloc(this->chip_size);
     memset(this->memory, 0xFF, this->chip_size);
@@ -115,13 +118,26 @@ esp_rom_spiflash_result_t SpiFlash::erase_block(uint32_t block)
     uint32_t start_sector = block * sectors_per_block;
 
     for (int i = start_sector; i < start_sector + sectors_per_block; i++) {
-        this->erase_sector(i);
+        this->erase_sector_internal(i);
     }
 
+    this->count_op(&this->stats.erase, block * this->block_size, this->block_size, this->timing.block_erase_ns);
+
     return ESP_ROM_SPIFLASH_RESULT_OK;
 }
 
 esp_rom_spiflash_result_t SpiFlash::erase_sector(uint32_t sector)
+{
+    esp_rom_spiflash_result_t result = this->erase_sector_internal(sector);
+
+    if (result == ESP_ROM_SPIFLASH_RESULT_OK) {
+        this->count_op(&this->stats.erase, sector * this->sector_size, this->sector_size, this->timing.sector_erase_ns);
+    }
+
+    return result;
+}
+
+esp_rom_spiflash_result_t SpiFlash::erase_sector_internal(uint32_t sector)
 {
     if (this->total_erase_cycles_limit != 0 && 
         this->total_erase_cycles >= this->total_erase_cycles_limit) {
@@ -133,16 +149,11 @@ esp_rom_spiflash_result_t SpiFlash::erase_sector(uint32_t sector)
         return ESP_ROM_SPIFLASH_RESULT_ERR;
     }
 
-    uint32_t pages_per_sector = (this->sector_size / this->page_size);
-    uint32_t start_page = sector * pages_per_sector;
-
     if (this->erase_states[sector]) {
         goto out;
     }
 
-    for (int i = start_page; i < start_page + pages_per_sector; i++) {
-        this->erase_page(i);
-    }
+    memset(&this->memory[sector * this->sector_size], 0xFF, this->sector_size);
 
     this->erase_cycles[sector]++;
     this->total_erase_cycles++;
@@ -156,6 +167,7 @@ out:
 esp_rom_spiflash_result_t SpiFlash::erase_page(uint32_t page)
 {
     memset(&this->memory[page * this->page_size], 0xFF, this->page_size);
+    this->count_op(&this->stats.erase, page * this->page_size, this->page_size, this->timing.page_erase_ns);
     return ESP_ROM_SPIFLASH_RESULT_OK;
 }
 
@@ -194,6 +206,9 @@ esp_rom_spiflash_result_t SpiFlash::write(uint32_t dest_addr, const void *src, u
         this->memory[dest_addr + ctr] = data;
     }
 
+    uint32_t pages = size > 0 ? (dest_addr + size - 1) / this->page_size - dest_addr / this->page_size + 1 : 0;
+    this->count_op(&this->stats.write, dest_addr, size, (uint64_t) pages * this->timing.page_program_ns);
+
     return ESP_ROM_SPIFLASH_RESULT_OK;
 }
 
@@ -220,6 +235,7 @@ esp_rom_spiflash_result_t SpiFlash::read(uint32_t src_addr, void *dest, uint32_t
 
     // Do the read
     memcpy(dest, &this->memory[src_addr], size);
+    this->count_op(&this->stats.read, src_addr, size, this->timing.read_op_ns + (uint64_t) size * this->timing.read_byte_ns);
     return ESP_ROM_SPIFLASH_RESULT_OK;
 }
 
@@ -256,4 +272,68 @@ void SpiFlash::reset_erase_cycles()
 void SpiFlash::reset_total_erase_cycles()
 {
     this->total_erase_cycles = 0;
-}
\ No newline at end of file
+}
+
+void SpiFlash::count_op(spiflash_op_stats_t* op, uint32_t addr, uint32_t size, uint64_t time_ns)
+{
+    op->ops++;
+    op->bytes += size;
+    op->time_ns += time_ns;
+    this->stats.elapsed_ns += time_ns;
+
+    int bucket = size > 1 ? 32 - __builtin_clz(size - 1) : 0;
+    if (bucket >= SPIFLASH_SIZE_HIST_COUNT) {
+        bucket = SPIFLASH_SIZE_HIST_COUNT - 1;
+    }
+    op->size_hist[bucket]++;
+
+    if (addr % this->sector_size == 0) {
+        op->align_hist[SPIFLASH_ALIGN_SECTOR]++;
+    } else if (addr % this->page_size == 0) {
+        op->align_hist[SPIFLASH_ALIGN_PAGE]++;
+    } else if (addr % 4 == 0) {
+        op->align_hist[SPIFLASH_ALIGN_WORD]++;
+    } else {
+        op->align_hist[SPIFLASH_ALIGN_BYTE]++;
+    }
+}
+
+void SpiFlash::set_timing(const spiflash_timing_t* timing)
+{
+    if (timing) {
+        this->timing = *timing;
+    } else {
+        memset(&this->timing, 0, sizeof(this->timing));
+    }
+}
+
+const spiflash_stats_t& SpiFlash::get_stats()
+{
+    return this->stats;
+}
+
+void SpiFlash::reset_stats()
+{
+    memset(&this->stats, 0, sizeof(this->stats));
+}
+
+void SpiFlash::print_stats(FILE* stream)
+{
+    const char* names[] = { "read", "write", "erase" };
+    const spiflash_op_stats_t* ops[] = { &this->stats.read, &this->stats.write, &this->stats.erase };
+
+    for (int i = 0; i < 3; i++) {
+        const spiflash_op_stats_t* op = ops[i];
+        fprintf(stream, "%-6s %8u ops %10llu bytes %10llu us, align byte/word/page/sector: %u/%u/%u/%u, size:",
+                names[i], op->ops, (unsigned long long) op->bytes, (unsigned long long) (op->time_ns / 1000),
+                op->align_hist[SPIFLASH_ALIGN_BYTE], op->align_hist[SPIFLASH_ALIGN_WORD],
+                op->align_hist[SPIFLASH_ALIGN_PAGE], op->align_hist[SPIFLASH_ALIGN_SECTOR]);
+        for (int n = 0; n < SPIFLASH_SIZE_HIST_COUNT; n++) {
+            if (op->size_hist[n] != 0) {
+                fprintf(stream, " <=%u:%u", 1u << n, op->size_hist[n]);
+            }
+        }
+        fprintf(stream, "\n");
+    }
+    fprintf(stream, "elapsed %llu us\n", (unsigned long long) (this->stats.elapsed_ns / 1000));
+}
@@ -16,10 +16,70 @@
 #define _SpiFlash_H_
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #include "esp_err.h"
 #include "esp32/rom/spi_flash.h"
 
+#define SPIFLASH_SIZE_HIST_COUNT    17  /*!< Number of size histogram buckets, the last one counts operations of 64KB and more */
+
+/**
+* @brief Alignment of the address of a flash operation, used as index into spiflash_op_stats_t::align_hist
+*/
+typedef enum {
+    SPIFLASH_ALIGN_BYTE,        /*!< Address is not 4-byte aligned */
+    SPIFLASH_ALIGN_WORD,        /*!< Address is 4-byte aligned, but not page aligned */
+    SPIFLASH_ALIGN_PAGE,        /*!< Address is page aligned, but not sector aligned */
+    SPIFLASH_ALIGN_SECTOR,      /*!< Address is sector aligned */
+    SPIFLASH_ALIGN_COUNT
+} spiflash_align_t;
+
+/**
+* @brief Counters for one type of flash operation
+*/
+typedef struct {
+    uint32_t ops;                                   /*!< Number of operations */
+    uint64_t bytes;                                 /*!< Number of bytes read, written or erased */
+    uint64_t time_ns;                               /*!< Simulated time spent in these operations */
+    uint32_t size_hist[SPIFLASH_SIZE_HIST_COUNT];   /*!< Bucket n counts operations of more than 2^(n-1) and at most 2^n bytes */
+    uint32_t align_hist[SPIFLASH_ALIGN_COUNT];      /*!< Operations by alignment of the address */
+} spiflash_op_stats_t;
+
+/**
+* @brief Flash operation counters, see SpiFlash::get_stats()
+*/
+typedef struct {
+    spiflash_op_stats_t read;
+    spiflash_op_stats_t write;
+    spiflash_op_stats_t erase;      /*!< Sector, block and page erase commands */
+    uint64_t elapsed_ns;            /*!< Simulated time of all operations, 0 unless a timing model is set */
+} spiflash_stats_t;
+
+/**
+* @brief Timing model of the flash chip. Writes take page_program_ns for every page they touch.
+*/
+typedef struct {
+    uint32_t read_op_ns;            /*!< Command and address phase of a read */
+    uint32_t read_byte_ns;          /*!< Transfer of one byte of read data */
+    uint32_t page_program_ns;       /*!< Page program time (tPP) */
+    uint32_t page_erase_ns;         /*!< Page erase time (tPE) */
+    uint32_t sector_erase_ns;       /*!< Sector erase time (tSE) */
+    uint32_t block_erase_ns;        /*!< Block erase time (tBE) */
+} spiflash_timing_t;
+
+/**
+* @brief Typical datasheet timing of a 32Mbit flash chip, read in DIO mode at 40MHz
+*/
+#define SPIFLASH_TIMING_DEFAULT() { \
+    1000,           /* read_op_ns */ \
+    100,            /* read_byte_ns */ \
+    700000,         /* page_program_ns */ \
+    20000000,       /* page_erase_ns */ \
+    45000000,       /* sector_erase_ns */ \
+    150000000,      /* block_erase_ns */ \
+}
+
 /**
 * @brief This class is used to emulate flash devices.
 *
@@ -56,6 +116,26 @@ public:
 
     uint8_t* get_memory_ptr(uint32_t src_address);
 
+    /**
+    * @brief Set the timing model used to calculate the simulated time of operations
+    *
+    * @param timing  timing model, or NULL to stop counting time
+    */
+    void set_timing(const spiflash_timing_t* timing);
+
+    /**
+    * @brief Get operation counters since init() or the last reset_stats()
+    *
+    * Memory accessed through get_memory_ptr() (spi_flash_mmap) is not counted.
+    */
+    const spiflash_stats_t& get_stats();
+    void reset_stats();
+
+    /**
+    * @brief Print operation counters in human readable form
+    */
+    void print_stats(FILE* stream);
+
 private:
     uint32_t chip_size;
     uint32_t block_size;
@@ -75,6 +155,11 @@ private:
     uint32_t total_erase_cycles;
     uint32_t total_erase_cycles_limit;
 
+    spiflash_stats_t stats;
+    spiflash_timing_t timing;
+
+    void count_op(spiflash_op_stats_t* op, uint32_t addr, uint32_t size, uint64_t time_ns);
+    esp_rom_spiflash_result_t erase_sector_internal(uint32_t sector);
     void deinit();
 };
 
@@ -0,0 +1,11 @@
+#pragma once
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef void* QueueHandle_t;
+
+#if defined(__cplusplus)
+}
+#endif
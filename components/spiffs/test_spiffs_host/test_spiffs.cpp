@@ -9,10 +9,12 @@
 #include "spiffs.h"
 #include "spiffs_nucleus.h"
 #include "spiffs_api.h"
+#include "SpiFlash.h"
 
 #include "catch.hpp"
 
 extern "C" void _spi_flash_init(const char* chip_size, size_t block_size, size_t sector_size, size_t page_size, const char* partition_bin);
+extern SpiFlash spiflash;
 
 static void init_spiffs(spiffs *fs, uint32_t max_files)
 {
@@ -177,10 +179,16 @@ TEST_CASE("format disk, open file, write and read file", "[spiffs]")
     }
 
     // Write data to file
+    spiflash.reset_stats();
     spiffs_res = SPIFFS_write(&fs, file, (void*)data, data_size);
     REQUIRE(spiffs_res >= SPIFFS_OK);
     REQUIRE(spiffs_res == data_size);
 
+    // Data and metadata pages go to flash
+    printf("spiffs, write %d bytes:\n", (int) data_size);
+    spiflash.print_stats(stdout);
+    CHECK(spiflash.get_stats().write.bytes >= data_size);
+
     // Set the file object pointer to the beginning
     spiffs_res = SPIFFS_lseek(&fs, file, 0, SPIFFS_SEEK_SET);
     REQUIRE(spiffs_res >= SPIFFS_OK);
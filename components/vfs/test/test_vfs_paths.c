@@ -20,6 +20,9 @@
 #include <sys/fcntl.h>
 #include <sys/dirent.h>
 #include "esp_vfs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "unity.h"
 #include "esp_log.h"
 
@@ -246,6 +249,63 @@ TEST_CASE("vfs unregisters correct nested mount point", "[vfs]")
     TEST_ESP_OK( esp_vfs_unregister("/foo/bar") );
 }
 
+TEST_CASE("vfs selects longest mount point after register and unregister", "[vfs]")
+{
+    dummy_vfs_t inst_a = {
+        .match_path = "/b/file",
+        .called = false
+    };
+    esp_vfs_t desc_a = DUMMY_VFS();
+    dummy_vfs_t inst_ab = {
+        .match_path = "/file",
+        .called = false
+    };
+    esp_vfs_t desc_ab = DUMMY_VFS();
+    dummy_vfs_t inst_abc = {
+        .match_path = "/file",
+        .called = false
+    };
+    esp_vfs_t desc_abc = DUMMY_VFS();
+    dummy_vfs_t inst_other = {
+        .match_path = "/file",
+        .called = false
+    };
+    esp_vfs_t desc_other = DUMMY_VFS();
+
+    /* mount points are registered neither shortest nor longest first */
+    TEST_ESP_OK( esp_vfs_register("/a/b", &desc_ab, &inst_ab) );
+    TEST_ESP_OK( esp_vfs_register("/other", &desc_other, &inst_other) );
+    TEST_ESP_OK( esp_vfs_register("/a", &desc_a, &inst_a) );
+    TEST_ESP_OK( esp_vfs_register("/a/b/c", &desc_abc, &inst_abc) );
+
+    test_opened(&inst_abc, "/a/b/c/file");
+    test_not_called(&inst_ab, "/a/b/c/file");
+    test_not_called(&inst_a, "/a/b/c/file");
+    test_opened(&inst_ab, "/a/b/file");
+    test_not_called(&inst_a, "/a/b/file");
+    test_not_opened(&inst_a, "/a/bc/file");
+    test_not_called(&inst_ab, "/a/bc/file");
+    test_opened(&inst_other, "/other/file");
+
+    /* the remaining mount points are still ordered after removing one in the middle */
+    TEST_ESP_OK( esp_vfs_unregister("/a/b") );
+    test_opened(&inst_abc, "/a/b/c/file");
+    test_opened(&inst_a, "/a/b/file");
+    test_not_called(&inst_ab, "/a/b/file");
+    test_opened(&inst_other, "/other/file");
+
+    /* and a mount point registered again takes its place */
+    TEST_ESP_OK( esp_vfs_register("/a/b", &desc_ab, &inst_ab) );
+    test_opened(&inst_ab, "/a/b/file");
+    test_not_called(&inst_a, "/a/b/file");
+    test_opened(&inst_abc, "/a/b/c/file");
+
+    TEST_ESP_OK( esp_vfs_unregister("/a/b/c") );
+    TEST_ESP_OK( esp_vfs_unregister("/a/b") );
+    TEST_ESP_OK( esp_vfs_unregister("/a") );
+    TEST_ESP_OK( esp_vfs_unregister("/other") );
+}
+
 
 void test_vfs_register(const char* prefix, bool expect_success, int line)
 {
@@ -281,3 +341,67 @@ TEST_CASE("vfs checks mount point path", "[vfs]")
     test_register_ok("/23456789012345");
     test_register_fail("/234567890123456");
 }
+
+typedef struct {
+    volatile bool stop;
+    SemaphoreHandle_t done;
+} churn_task_args_t;
+
+static void mount_point_churn_task(void* arg)
+{
+    churn_task_args_t* args = (churn_task_args_t*) arg;
+    dummy_vfs_t inst = {
+        .match_path = "",
+        .called = false
+    };
+    esp_vfs_t desc = DUMMY_VFS();
+    while (!args->stop) {
+        /* the longest prefix moves the other entries of the search table */
+        TEST_ESP_OK( esp_vfs_register("/churn/long/prefix", &desc, &inst) );
+        TEST_ESP_OK( esp_vfs_register("/c", &desc, &inst) );
+        TEST_ESP_OK( esp_vfs_unregister("/churn/long/prefix") );
+        TEST_ESP_OK( esp_vfs_unregister("/c") );
+    }
+    xSemaphoreGive(args->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("vfs resolves paths while other mount points change", "[vfs]")
+{
+    dummy_vfs_t inst_a = {
+        .match_path = "/file",
+        .called = false
+    };
+    esp_vfs_t desc_a = DUMMY_VFS();
+    dummy_vfs_t inst_abc = {
+        .match_path = "/file",
+        .called = false
+    };
+    esp_vfs_t desc_abc = DUMMY_VFS();
+    TEST_ESP_OK( esp_vfs_register("/a", &desc_a, &inst_a) );
+    TEST_ESP_OK( esp_vfs_register("/a/b/c", &desc_abc, &inst_abc) );
+
+    churn_task_args_t args = {
+        .stop = false,
+        .done = xSemaphoreCreateBinary()
+    };
+    TEST_ASSERT_NOT_NULL(args.done);
+    xTaskCreatePinnedToCore(mount_point_churn_task, "churn", 2048, &args, 3, NULL, portNUM_PROCESSORS - 1);
+
+    /* a lookup that misses its mount point fails to open the file */
+    const int flags = O_CREAT | O_TRUNC | O_RDWR;
+    for (int i = 0; i < 10000; ++i) {
+        int fd = esp_vfs_open(__getreent(), "/a/b/c/file", flags, 0);
+        TEST_ASSERT_TRUE(fd >= 0);
+        esp_vfs_close(__getreent(), fd);
+        fd = esp_vfs_open(__getreent(), "/a/file", flags, 0);
+        TEST_ASSERT_TRUE(fd >= 0);
+        esp_vfs_close(__getreent(), fd);
+    }
+
+    args.stop = true;
+    xSemaphoreTake(args.done, portMAX_DELAY);
+    vSemaphoreDelete(args.done);
+    TEST_ESP_OK( esp_vfs_unregister("/a/b/c") );
+    TEST_ESP_OK( esp_vfs_unregister("/a") );
+}
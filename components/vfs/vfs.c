@@ -69,9 +69,44 @@ typedef struct {
 static vfs_entry_t* s_vfs[VFS_MAX_COUNT] = { 0 };
 static size_t s_vfs_count = 0;
 
+// VFS entries which have a path prefix, sorted by decreasing prefix length
+typedef struct {
+    size_t count;
+    const vfs_entry_t* vfs[VFS_MAX_COUNT];
+} vfs_prefix_table_t;
+
+// Path lookups don't take a lock. They read the table published in
+// s_vfs_by_prefix, while register / unregister fill the other table and
+// then publish it with a single pointer store.
+static vfs_prefix_table_t s_vfs_prefix_tables[2] = { 0 };
+static const vfs_prefix_table_t* volatile s_vfs_by_prefix = &s_vfs_prefix_tables[0];
+
 static fd_table_t s_fd_table[MAX_FDS] = { [0 ... MAX_FDS-1] = FD_TABLE_ENTRY_UNUSED };
 static _lock_t s_fd_table_lock;
 
+// Rebuilds the path search order after s_vfs was changed. Entries with equal
+// prefix length keep their order in s_vfs.
+static void update_vfs_by_prefix(void)
+{
+    vfs_prefix_table_t* table = &s_vfs_prefix_tables[s_vfs_by_prefix == &s_vfs_prefix_tables[0] ? 1 : 0];
+    const vfs_entry_t** sorted = table->vfs;
+    size_t count = 0;
+    for (size_t i = 0; i < s_vfs_count; ++i) {
+        const vfs_entry_t* vfs = s_vfs[i];
+        if (!vfs || vfs->path_prefix_len == LEN_PATH_PREFIX_IGNORED) {
+            continue;
+        }
+        size_t j = count++;
+        while (j > 0 && sorted[j - 1]->path_prefix_len < vfs->path_prefix_len) {
+            sorted[j] = sorted[j - 1];
+            --j;
+        }
+        sorted[j] = vfs;
+    }
+    table->count = count;
+    s_vfs_by_prefix = table;
+}
+
 static esp_err_t esp_vfs_register_common(const char* base_path, size_t len, const esp_vfs_t* vfs, void* ctx, int *vfs_index)
 {
     if (len != LEN_PATH_PREFIX_IGNORED) {
@@ -109,6 +144,7 @@ static esp_err_t esp_vfs_register_common(const char* base_path, size_t len, cons
     entry->path_prefix_len = len;
     entry->ctx = ctx;
     entry->offset = index;
+    update_vfs_by_prefix();
 
     if (vfs_index) {
         *vfs_index = index;
@@ -136,8 +172,8 @@ esp_err_t esp_vfs_register_fd_range(const esp_vfs_t *vfs, void *ctx, int min_fd,
         _lock_acquire(&s_fd_table_lock);
         for (int i = min_fd; i < max_fd; ++i) {
             if (s_fd_table[i].vfs_index != -1) {
-                free(s_vfs[i]);
-                s_vfs[i] = NULL;
+                free(s_vfs[index]);
+                s_vfs[index] = NULL;
                 for (int j = min_fd; j < i; ++j) {
                     if (s_fd_table[j].vfs_index == index) {
                         s_fd_table[j] = FD_TABLE_ENTRY_UNUSED;
@@ -179,8 +215,9 @@ esp_err_t esp_vfs_unregister(const char* base_path)
         }
         if (base_path_len == vfs->path_prefix_len &&
                 memcmp(base_path, vfs->path_prefix, vfs->path_prefix_len) == 0) {
-            free(vfs);
             s_vfs[i] = NULL;
+            update_vfs_by_prefix();
+            free(vfs);
 
             _lock_acquire(&s_fd_table_lock);
             // Delete all references from the FD lookup-table
@@ -259,25 +296,16 @@ static inline bool fd_valid(int fd)
     return (fd < MAX_FDS) && (fd >= 0);
 }
 
-static const vfs_entry_t *get_vfs_for_fd(int fd)
-{
-    const vfs_entry_t *vfs = NULL;
-    if (fd_valid(fd)) {
-        const int index = s_fd_table[fd].vfs_index; // single read -> no locking is required
-        vfs = get_vfs_for_index(index);
-    }
-    return vfs;
-}
-
-static inline int get_local_fd(const vfs_entry_t *vfs, int fd)
+// Resolves fd to its VFS and the FD within that VFS with one lookup in the FD table.
+// The table entry is read once (no locking is required), so both are consistent.
+static inline const vfs_entry_t *get_vfs_for_fd(int fd, int *local_fd)
 {
-    int local_fd = -1;
-
-    if (vfs && fd_valid(fd)) {
-        local_fd = s_fd_table[fd].local_fd; // single read -> no locking is required
+    if (!fd_valid(fd)) {
+        return NULL;
     }
-
-    return local_fd;
+    const fd_table_t item = s_fd_table[fd];
+    *local_fd = item.local_fd;
+    return get_vfs_for_index(item.vfs_index);
 }
 
 static const char* translate_path(const vfs_entry_t* vfs, const char* src_path)
@@ -292,42 +320,28 @@ static const char* translate_path(const vfs_entry_t* vfs, const char* src_path)
 
 static const vfs_entry_t* get_vfs_for_path(const char* path)
 {
-    const vfs_entry_t* best_match = NULL;
-    ssize_t best_match_prefix_len = -1;
     size_t len = strlen(path);
-    for (size_t i = 0; i < s_vfs_count; ++i) {
-        const vfs_entry_t* vfs = s_vfs[i];
-        if (!vfs || vfs->path_prefix_len == LEN_PATH_PREFIX_IGNORED) {
-            continue;
-        }
+    const vfs_prefix_table_t* table = s_vfs_by_prefix;
+    for (size_t i = 0; i < table->count; ++i) {
+        const vfs_entry_t* vfs = table->vfs[i];
         // match path prefix
         if (len < vfs->path_prefix_len ||
             memcmp(path, vfs->path_prefix, vfs->path_prefix_len) != 0) {
             continue;
         }
-        // this is the default VFS and we don't have a better match yet.
-        if (vfs->path_prefix_len == 0 && !best_match) {
-            best_match = vfs;
-            continue;
-        }
         // if path is not equal to the prefix, expect to see a path separator
-        // i.e. don't match "/data" prefix for "/data1/foo.txt" path
-        if (len > vfs->path_prefix_len &&
+        // i.e. don't match "/data" prefix for "/data1/foo.txt" path.
+        // The default VFS (empty prefix) matches any path.
+        if (len > vfs->path_prefix_len && vfs->path_prefix_len > 0 &&
                 path[vfs->path_prefix_len] != '/') {
             continue;
         }
-        // Out of all matching path prefixes, select the longest one;
-        // i.e. if "/dev" and "/dev/uart" both match, for "/dev/uart/1" path,
-        // choose "/dev/uart",
-        // This causes all s_vfs_count VFS entries to be scanned when opening
-        // a file by name. This can be optimized by introducing a table for
-        // FS search order, sorted so that longer prefixes are checked first.
-        if (best_match_prefix_len < (ssize_t) vfs->path_prefix_len) {
-            best_match_prefix_len = (ssize_t) vfs->path_prefix_len;
-            best_match = vfs;
-        }
+        // Longer path prefixes are checked first, so this is the longest
+        // matching one; i.e. if "/dev" and "/dev/uart" both match, for
+        // "/dev/uart/1" path, "/dev/uart" is chosen.
+        return vfs;
     }
-    return best_match;
+    return NULL;
 }
 
 /*
@@ -410,9 +424,9 @@ int esp_vfs_open(struct _reent *r, const char * path, int flags, int mode)
 
 ssize_t esp_vfs_write(struct _reent *r, int fd, const void * data, size_t size)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -423,9 +437,9 @@ ssize_t esp_vfs_write(struct _reent *r, int fd, const void * data, size_t size)
 
 off_t esp_vfs_lseek(struct _reent *r, int fd, off_t size, int mode)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -436,9 +450,9 @@ off_t esp_vfs_lseek(struct _reent *r, int fd, off_t size, int mode)
 
 ssize_t esp_vfs_read(struct _reent *r, int fd, void * dst, size_t size)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -450,9 +464,9 @@ ssize_t esp_vfs_read(struct _reent *r, int fd, void * dst, size_t size)
 ssize_t esp_vfs_pread(int fd, void *dst, size_t size, off_t offset)
 {
     struct _reent *r = __getreent();
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -464,9 +478,9 @@ ssize_t esp_vfs_pread(int fd, void *dst, size_t size, off_t offset)
 ssize_t esp_vfs_pwrite(int fd, const void *src, size_t size, off_t offset)
 {
     struct _reent *r = __getreent();
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -477,9 +491,9 @@ ssize_t esp_vfs_pwrite(int fd, const void *src, size_t size, off_t offset)
 
 int esp_vfs_close(struct _reent *r, int fd)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -496,9 +510,9 @@ int esp_vfs_close(struct _reent *r, int fd)
 
 int esp_vfs_fstat(struct _reent *r, int fd, struct stat * st)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -714,9 +728,9 @@ int rmdir(const char* name)
 
 int _fcntl_r(struct _reent *r, int fd, int cmd, int arg)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -737,10 +751,10 @@ int __attribute__((weak)) fcntl(int fd, int cmd, ...)
 
 int ioctl(int fd, int cmd, ...)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
     struct _reent* r = __getreent();
-    if (vfs == NULL || local_fd < 0) {
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -754,10 +768,10 @@ int ioctl(int fd, int cmd, ...)
 
 int fsync(int fd)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
     struct _reent* r = __getreent();
-    if (vfs == NULL || local_fd < 0) {
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -1079,10 +1093,10 @@ void esp_vfs_select_triggered_isr(esp_vfs_select_sem_t sem, BaseType_t *woken)
 #ifdef CONFIG_VFS_SUPPORT_TERMIOS
 int tcgetattr(int fd, struct termios *p)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
     struct _reent* r = __getreent();
-    if (vfs == NULL || local_fd < 0) {
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -1093,10 +1107,10 @@ int tcgetattr(int fd, struct termios *p)
 
 int tcsetattr(int fd, int optional_actions, const struct termios *p)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
     struct _reent* r = __getreent();
-    if (vfs == NULL || local_fd < 0) {
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -1107,10 +1121,10 @@ int tcsetattr(int fd, int optional_actions, const struct termios *p)
 
 int tcdrain(int fd)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
     struct _reent* r = __getreent();
-    if (vfs == NULL || local_fd < 0) {
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -1121,10 +1135,10 @@ int tcdrain(int fd)
 
 int tcflush(int fd, int select)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
     struct _reent* r = __getreent();
-    if (vfs == NULL || local_fd < 0) {
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -1135,10 +1149,10 @@ int tcflush(int fd, int select)
 
 int tcflow(int fd, int action)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
     struct _reent* r = __getreent();
-    if (vfs == NULL || local_fd < 0) {
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -1149,10 +1163,10 @@ int tcflow(int fd, int action)
 
 pid_t tcgetsid(int fd)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
     struct _reent* r = __getreent();
-    if (vfs == NULL || local_fd < 0) {
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -1163,10 +1177,10 @@ pid_t tcgetsid(int fd)
 
 int tcsendbreak(int fd, int duration)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
+    int local_fd;
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd, &local_fd);
     struct _reent* r = __getreent();
-    if (vfs == NULL || local_fd < 0) {
+    if (vfs == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
@@ -116,6 +116,11 @@ esp_err_t WL_Flash::config(wl_config_t *cfg, Flash_Access *flash_drv)
     return ESP_OK;
 }
 
+void WL_Flash::config_skip_erased(bool skip_erased)
+{
+    this->skip_erased = skip_erased;
+}
+
 esp_err_t WL_Flash::init()
 {
     esp_err_t result = ESP_OK;
@@ -550,6 +555,16 @@ esp_err_t WL_Flash::erase_sector(size_t sector)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - sector= 0x%08x", __func__, (uint32_t) sector);
+    if (this->skip_erased) {
+        // The sector is not touched, so the flash contents are never in an intermediate state
+        bool erased = false;
+        result = this->isErased(this->calcAddr(sector * this->cfg.sector_size), &erased);
+        WL_RESULT_CHECK(result);
+        if (erased) {
+            ESP_LOGV(TAG, "%s - sector= 0x%08x is already erased", __func__, (uint32_t) sector);
+            return result;
+        }
+    }
     result = this->updateWL();
     WL_RESULT_CHECK(result);
     size_t virt_addr = this->calcAddr(sector * this->cfg.sector_size);
@@ -557,6 +572,25 @@ esp_err_t WL_Flash::erase_sector(size_t sector)
     WL_RESULT_CHECK(result);
     return result;
 }
+
+esp_err_t WL_Flash::isErased(size_t virt_addr, bool *erased)
+{
+    esp_err_t result = ESP_OK;
+    uint32_t buff[32];
+    *erased = false;
+    for (size_t offset = 0; offset < this->cfg.sector_size; offset += sizeof(buff)) {
+        result = this->flash_drv->read(this->cfg.start_addr + virt_addr + offset, buff, sizeof(buff));
+        WL_RESULT_CHECK(result);
+        for (size_t i = 0; i < sizeof(buff) / sizeof(buff[0]); i++) {
+            if (buff[i] != 0xffffffff) {
+                return result;
+            }
+        }
+    }
+    *erased = true;
+    return result;
+}
+
 esp_err_t WL_Flash::erase_range(size_t start_address, size_t size)
 {
     esp_err_t result = ESP_OK;
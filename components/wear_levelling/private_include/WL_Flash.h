@@ -31,6 +31,7 @@ public :
 
     virtual esp_err_t config(wl_config_t *cfg, Flash_Access *flash_drv);
     virtual esp_err_t init();
+    void config_skip_erased(bool skip_erased);
 
     size_t chip_size() override;
     size_t sector_size() override;
@@ -66,11 +67,13 @@ protected:
     uint8_t *temp_buff = NULL;
     size_t dummy_addr;
     uint32_t pos_data[4];
+    bool skip_erased = false;   /*!< do not erase sectors which are already erased, see config_skip_erased()*/
 
     esp_err_t initSections();
     esp_err_t updateWL();
     esp_err_t recoverPos();
     size_t calcAddr(size_t addr);
+    esp_err_t isErased(size_t virt_addr, bool *erased);
 
     esp_err_t updateVersion();
     esp_err_t updateV1_V2();
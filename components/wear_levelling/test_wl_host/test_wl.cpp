@@ -6,6 +6,7 @@
 #include "esp_partition.h"
 #include "wear_levelling.h"
 #include "WL_Flash.h"
+#include "Partition.h"
 #include "SpiFlash.h"
 
 #include "catch.hpp"
@@ -197,7 +198,8 @@ TEST_CASE("power down test", "[wear_levelling]")
             result |= wl_write(wl_handle, err_sector * sector_size, sector_data, sector_size);
         }
 
-        spiflash.reset_total_erase_cycles();
+        // the simulator doesn't count erase cycles of erased sectors, so count the erase operations
+    spiflash.reset_stats();
 
         printf("[%3.f%%] err_sector=%i\n", (float)k / ((float)max_check_count) * 100.0f, err_sector);
     }
@@ -207,4 +209,161 @@ TEST_CASE("power down test", "[wear_levelling]")
     // Unmount
     result = wl_unmount(wl_handle);
     REQUIRE(result == ESP_OK);
-}
\ No newline at end of file
+}
+
+static void fill_sector(uint32_t *sector_data, size_t sector_size, uint32_t value)
+{
+    for (uint32_t m = 0; m < sector_size / sizeof(uint32_t); m++) {
+        sector_data[m] = value + m;
+    }
+}
+
+// Imitates FAT filesystem writing a new file: each data sector, not used before,
+// is followed by an update of the FAT and the directory sectors
+static uint32_t fat_like_workload_erase_ops(bool skip_erased)
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+
+    wl_config_t cfg;
+    cfg.full_mem_size = partition->size;
+    cfg.start_addr = 0;
+    cfg.version = 2;
+    cfg.sector_size = SPI_FLASH_SEC_SIZE;
+    cfg.page_size = SPI_FLASH_SEC_SIZE;
+    cfg.updaterate = 16;
+    cfg.temp_buff_size = 32;
+    cfg.wr_size = 16;
+
+    Partition part(partition);
+    WL_Flash *wl_flash = new WL_Flash();
+    REQUIRE(wl_flash->config(&cfg, &part) == ESP_OK);
+    wl_flash->config_skip_erased(skip_erased);
+    REQUIRE(wl_flash->init() == ESP_OK);
+
+    const size_t sector_size = wl_flash->sector_size();
+    const uint32_t data_sectors = 64;
+    const uint32_t fat_sector = 0;
+    const uint32_t dir_sector = 1;
+    uint32_t *sector_data = new uint32_t[sector_size / sizeof(uint32_t)];
+
+    // FAT and directory sectors are not empty
+    fill_sector(sector_data, sector_size, 0);
+    for (uint32_t i = 0; i < 2; i++) {
+        REQUIRE(wl_flash->erase_range(i * sector_size, sector_size) == ESP_OK);
+        REQUIRE(wl_flash->write(i * sector_size, sector_data, sector_size) == ESP_OK);
+    }
+
+    // the simulator doesn't count erase cycles of erased sectors, so count the erase operations
+    spiflash.reset_stats();
+    for (uint32_t i = 0; i < data_sectors; i++) {
+        uint32_t sector = 2 + i;
+        fill_sector(sector_data, sector_size, sector * sector_size);
+        REQUIRE(wl_flash->erase_range(sector * sector_size, sector_size) == ESP_OK);
+        REQUIRE(wl_flash->write(sector * sector_size, sector_data, sector_size) == ESP_OK);
+
+        fill_sector(sector_data, sector_size, i);
+        REQUIRE(wl_flash->erase_range(fat_sector * sector_size, sector_size) == ESP_OK);
+        REQUIRE(wl_flash->write(fat_sector * sector_size, sector_data, sector_size) == ESP_OK);
+        REQUIRE(wl_flash->erase_range(dir_sector * sector_size, sector_size) == ESP_OK);
+        REQUIRE(wl_flash->write(dir_sector * sector_size, sector_data, sector_size / 2) == ESP_OK);
+    }
+    uint32_t erase_ops = spiflash.get_stats().erase.ops;
+
+    // A sector which differs from an erased one only in its last word has to be erased
+    size_t last_word_addr = (2 + data_sectors + 1) * sector_size - sizeof(uint32_t);
+    uint32_t last_word = 0;
+    REQUIRE(wl_flash->write(last_word_addr, &last_word, sizeof(last_word)) == ESP_OK);
+    REQUIRE(wl_flash->erase_range(last_word_addr - last_word_addr % sector_size, sector_size) == ESP_OK);
+    REQUIRE(wl_flash->read(last_word_addr, &last_word, sizeof(last_word)) == ESP_OK);
+    CHECK(last_word == 0xffffffff);
+    delete wl_flash;
+
+    // Flash contents are the same as with every sector erased
+    wl_flash = new WL_Flash();
+    REQUIRE(wl_flash->config(&cfg, &part) == ESP_OK);
+    REQUIRE(wl_flash->init() == ESP_OK);
+    uint32_t *read_data = new uint32_t[sector_size / sizeof(uint32_t)];
+    for (uint32_t i = 0; i < data_sectors; i++) {
+        uint32_t sector = 2 + i;
+        fill_sector(sector_data, sector_size, sector * sector_size);
+        REQUIRE(wl_flash->read(sector * sector_size, read_data, sector_size) == ESP_OK);
+        REQUIRE(memcmp(sector_data, read_data, sector_size) == 0);
+    }
+    fill_sector(sector_data, sector_size, data_sectors - 1);
+    REQUIRE(wl_flash->read(fat_sector * sector_size, read_data, sector_size) == ESP_OK);
+    REQUIRE(memcmp(sector_data, read_data, sector_size) == 0);
+    memset(&sector_data[sector_size / 2 / sizeof(uint32_t)], 0xff, sector_size / 2);
+    REQUIRE(wl_flash->read(dir_sector * sector_size, read_data, sector_size) == ESP_OK);
+    REQUIRE(memcmp(sector_data, read_data, sector_size) == 0);
+
+    delete wl_flash;
+    delete[] read_data;
+    delete[] sector_data;
+    return erase_ops;
+}
+
+TEST_CASE("erased sectors are not erased again", "[wear_levelling]")
+{
+    // other tests run with CONFIG_WL_SKIP_ERASED_SECTORS disabled, it is only enabled here
+    uint32_t erase_ops_direct = fat_like_workload_erase_ops(false);
+    uint32_t erase_ops_skipped = fat_like_workload_erase_ops(true);
+    INFO("erase operations: erasing every sector " << erase_ops_direct << ", skipping erased sectors " << erase_ops_skipped);
+    CHECK(erase_ops_skipped > 0);
+    CHECK(erase_ops_skipped * 3 <= erase_ops_direct * 2);
+}
+
+TEST_CASE("flash simulator counts operations and time", "[wear_levelling]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+    spiflash_timing_t timing = SPIFLASH_TIMING_DEFAULT();
+    spiflash.set_timing(&timing);
+
+    const uint32_t sector_size = CONFIG_WL_SECTOR_SIZE;
+    const uint32_t base = 0x100000;
+    uint8_t buf[64] = {0};
+    REQUIRE(spiflash.erase_sector(base / sector_size) == ESP_ROM_SPIFLASH_RESULT_OK);
+    REQUIRE(spiflash.write(base + 1, buf, 3) == ESP_ROM_SPIFLASH_RESULT_OK);
+    // crosses a page boundary, so two pages are programmed
+    REQUIRE(spiflash.write(base + sector_size - 4, buf, 8) == ESP_ROM_SPIFLASH_RESULT_OK);
+    REQUIRE(spiflash.read(base, buf, sizeof(buf)) == ESP_ROM_SPIFLASH_RESULT_OK);
+    REQUIRE(spiflash.erase_block(base / (sector_size * 16)) == ESP_ROM_SPIFLASH_RESULT_OK);
+
+    const spiflash_stats_t& stats = spiflash.get_stats();
+    CHECK(stats.write.ops == 2);
+    CHECK(stats.write.bytes == 11);
+    CHECK(stats.write.size_hist[2] == 1);
+    CHECK(stats.write.size_hist[3] == 1);
+    CHECK(stats.write.align_hist[SPIFLASH_ALIGN_BYTE] == 1);
+    CHECK(stats.write.align_hist[SPIFLASH_ALIGN_WORD] == 1);
+    CHECK(stats.write.time_ns == 3ULL * timing.page_program_ns);
+    CHECK(stats.read.ops == 1);
+    CHECK(stats.read.bytes == sizeof(buf));
+    CHECK(stats.read.size_hist[6] == 1);
+    CHECK(stats.read.align_hist[SPIFLASH_ALIGN_SECTOR] == 1);
+    CHECK(stats.read.time_ns == timing.read_op_ns + sizeof(buf) * timing.read_byte_ns);
+    CHECK(stats.erase.ops == 2);
+    CHECK(stats.erase.bytes == sector_size * 17);
+    CHECK(stats.erase.align_hist[SPIFLASH_ALIGN_SECTOR] == 2);
+    CHECK(stats.erase.time_ns == (uint64_t) timing.sector_erase_ns + timing.block_erase_ns);
+    CHECK(stats.elapsed_ns == stats.read.time_ns + stats.write.time_ns + stats.erase.time_ns);
+
+    // I/O done by wear levelling to write one sector
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    wl_handle_t wl_handle;
+    REQUIRE(wl_mount(partition, &wl_handle) == ESP_OK);
+    uint8_t *data = new uint8_t[sector_size];
+    memset(data, 0x55, sector_size);
+    spiflash.reset_stats();
+    REQUIRE(wl_erase_range(wl_handle, 0, sector_size) == ESP_OK);
+    REQUIRE(wl_write(wl_handle, 0, data, sector_size) == ESP_OK);
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+    printf("wear levelling, write one sector:\n");
+    spiflash.print_stats(stdout);
+    CHECK(stats.write.bytes >= sector_size);
+    CHECK(stats.erase.ops >= 1);
+    CHECK(stats.elapsed_ns >= timing.sector_erase_ns + timing.page_program_ns);
+    delete[] data;
+
+    spiflash.set_timing(NULL);
+}
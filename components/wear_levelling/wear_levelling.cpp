@@ -144,6 +144,9 @@ esp_err_t wl_mount(const esp_partition_t *partition, wl_handle_t *out_handle)
         ESP_LOGE(TAG, "%s: config instance=0x%08x, result=0x%x", __func__, *out_handle, result);
         goto out;
     }
+#if CONFIG_WL_SKIP_ERASED_SECTORS
+    wl_flash->config_skip_erased(true);
+#endif // CONFIG_WL_SKIP_ERASED_SECTORS
     result = wl_flash->init();
     if (ESP_OK != result) {
         ESP_LOGE(TAG, "%s: init instance=0x%08x, result=0x%x", __func__, *out_handle, result);
@@ -0,0 +1,139 @@
+/* HTTP Server Worker Pool Example
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <esp_wifi.h>
+#include <esp_event.h>
+#include <esp_log.h>
+#include <esp_system.h>
+#include <nvs_flash.h>
+#include "tcpip_adapter.h"
+#include "esp_eth.h"
+#include "protocol_examples_common.h"
+
+#include <esp_http_server.h>
+
+/* An example of a server which processes requests in a pool of worker tasks,
+ * so that requests to a slow URI don't delay the requests of other clients.
+ */
+
+static const char *TAG = "example";
+
+/* Responds immediately */
+static esp_err_t fast_get_handler(httpd_req_t *req)
+{
+    return httpd_resp_sendstr(req, "fast");
+}
+
+static const httpd_uri_t fast = {
+    .uri       = "/fast",
+    .method    = HTTP_GET,
+    .handler   = fast_get_handler,
+    .user_ctx  = NULL
+};
+
+/* Responds after a delay, like a handler streaming a file from a slow storage */
+static esp_err_t slow_get_handler(httpd_req_t *req)
+{
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_EXAMPLE_SLOW_HANDLER_DELAY_MS));
+    return httpd_resp_sendstr(req, "slow");
+}
+
+static const httpd_uri_t slow = {
+    .uri       = "/slow",
+    .method    = HTTP_GET,
+    .handler   = slow_get_handler,
+    .user_ctx  = NULL
+};
+
+static httpd_handle_t start_webserver(void)
+{
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.worker_count = CONFIG_EXAMPLE_WORKER_COUNT;
+#ifdef CONFIG_EXAMPLE_WORKER_SPREAD_CORES
+    config.worker_spread_cores = true;
+#endif
+    /* Leave room for a few more clients than workers, and close idle
+     * sessions when the load test opens new connections */
+    config.max_open_sockets = 10;
+    config.lru_purge_enable = true;
+    /* Each worker task has a stack of this size */
+    config.stack_size = 4096;
+
+    // Start the httpd server
+    ESP_LOGI(TAG, "Starting server on port: '%d' with %d workers", config.server_port, config.worker_count);
+    httpd_handle_t server;
+
+    if (httpd_start(&server, &config) == ESP_OK) {
+        // Set URI handlers
+        ESP_LOGI(TAG, "Registering URI handlers");
+        httpd_register_uri_handler(server, &fast);
+        httpd_register_uri_handler(server, &slow);
+        return server;
+    }
+
+    ESP_LOGI(TAG, "Error starting server!");
+    return NULL;
+}
+
+static void stop_webserver(httpd_handle_t server)
+{
+    // Stop the httpd server
+    httpd_stop(server);
+}
+
+static void disconnect_handler(void* arg, esp_event_base_t event_base,
+                               int32_t event_id, void* event_data)
+{
+    httpd_handle_t* server = (httpd_handle_t*) arg;
+    if (*server) {
+        ESP_LOGI(TAG, "Stopping webserver");
+        stop_webserver(*server);
+        *server = NULL;
+    }
+}
+
+static void connect_handler(void* arg, esp_event_base_t event_base,
+                            int32_t event_id, void* event_data)
+{
+    httpd_handle_t* server = (httpd_handle_t*) arg;
+    if (*server == NULL) {
+        ESP_LOGI(TAG, "Starting webserver");
+        *server = start_webserver();
+    }
+}
+
+void app_main(void)
+{
+    static httpd_handle_t server = NULL;
+
+    ESP_ERROR_CHECK(nvs_flash_init());
+    tcpip_adapter_init();
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    /* This helper function configures Wi-Fi or Ethernet, as selected in menuconfig.
+     * Read "Establishing Wi-Fi or Ethernet Connection" section in
+     * examples/protocols/README.md for more information about this function.
+     */
+    ESP_ERROR_CHECK(example_connect());
+
+    /* Register event handlers to stop the server when Wi-Fi or Ethernet is disconnected,
+     * and re-start it upon connection.
+     */
+#ifdef CONFIG_EXAMPLE_CONNECT_WIFI
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &connect_handler, &server));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &disconnect_handler, &server));
+#endif // CONFIG_EXAMPLE_CONNECT_WIFI
+#ifdef CONFIG_EXAMPLE_CONNECT_ETHERNET
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_ETH_GOT_IP, &connect_handler, &server));
+    ESP_ERROR_CHECK(esp_event_handler_register(ETH_EVENT, ETHERNET_EVENT_DISCONNECTED, &disconnect_handler, &server));
+#endif // CONFIG_EXAMPLE_CONNECT_ETHERNET
+
+    /* Start the server for the first time */
+    server = start_webserver();
+}
@@ -0,0 +1,92 @@
+#!/usr/bin/env python
+#
+# Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Load test for the worker pool example: a number of clients request /fast in a
+# loop over persistent connections, while other clients keep requesting /slow.
+# Prints the number of /fast requests per second and their latency percentiles.
+
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+import argparse
+import http.client
+import threading
+import time
+
+
+def client_loop(ip, port, uri, deadline, latencies, errors):
+    conn = None
+    while time.time() < deadline:
+        try:
+            if conn is None:
+                conn = http.client.HTTPConnection(ip, int(port), timeout=15)
+            start = time.time()
+            conn.request("GET", uri)
+            resp = conn.getresponse()
+            resp.read()
+            if resp.status != 200:
+                raise http.client.HTTPException("status %d" % resp.status)
+            latencies.append(time.time() - start)
+        except Exception:
+            # The server may close the connection, e.g. to make room for other clients
+            errors.append(uri)
+            if conn is not None:
+                conn.close()
+            conn = None
+    if conn is not None:
+        conn.close()
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def run_load(ip, port, clients, slow_clients, duration):
+    deadline = time.time() + duration
+    fast_latencies = []
+    slow_latencies = []
+    errors = []
+    threads = []
+    for _ in range(clients):
+        threads.append(threading.Thread(target=client_loop, args=(ip, port, "/fast", deadline, fast_latencies, errors)))
+    for _ in range(slow_clients):
+        threads.append(threading.Thread(target=client_loop, args=(ip, port, "/slow", deadline, slow_latencies, errors)))
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    return fast_latencies, slow_latencies, errors
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Load test for the HTTP server worker pool example')
+    parser.add_argument('IP', metavar='IP', type=str, help='Server IP')
+    parser.add_argument('port', metavar='port', type=str, help='Server port')
+    parser.add_argument('--clients', type=int, default=4, help='Number of clients requesting /fast')
+    parser.add_argument('--slow-clients', type=int, default=2, help='Number of clients requesting /slow')
+    parser.add_argument('--duration', type=float, default=10, help='Test duration in seconds')
+    args = vars(parser.parse_args())
+
+    fast, slow, errors = run_load(args['IP'], args['port'], args['clients'], args['slow_clients'], args['duration'])
+
+    print("/fast: {} requests, {:.1f} requests/s".format(len(fast), len(fast) / args['duration']))
+    print("/fast latency: p50 {:.1f} ms, p99 {:.1f} ms, max {:.1f} ms".format(
+        percentile(fast, 50) * 1000, percentile(fast, 99) * 1000, percentile(fast, 100) * 1000))
+    print("/slow: {} requests, p99 latency {:.1f} ms".format(len(slow), percentile(slow, 99) * 1000))
+    print("errors: {}".format(len(errors)))
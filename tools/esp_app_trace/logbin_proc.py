@@ -0,0 +1,202 @@
+#!/usr/bin/env python
+#
+# Decodes the records stored by the binary log backend (esp_log_binary.h)
+# and prints them using the format strings from the application ELF file.
+#
+
+from __future__ import print_function
+import argparse
+import re
+import struct
+import sys
+import elftools.elf.elffile as elffile
+import espytrace.apptrace as apptrace
+
+
+ESP_LOG_BINARY_SYNC = 0xEB
+ESP_LOG_BINARY_INLINE_STRING = 0x80000000
+
+# flags, width, precision, length modifiers, conversion
+CONV_RE = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?([hlLqjzt]*)([a-zA-Z%])')
+
+
+class ESPLogBinParserError(RuntimeError):
+    def __init__(self, message):
+        RuntimeError.__init__(self, message)
+
+
+class ESPLogBinRecord(object):
+    def __init__(self, core, dropped, timestamp, fmt_addr, words):
+        super(ESPLogBinRecord, self).__init__()
+        self.core = core
+        self.dropped = dropped
+        self.timestamp = timestamp
+        self.fmt_addr = fmt_addr
+        self.words = words
+
+    def __repr__(self):
+        return "core = %d, ts = %d, fmt_addr = 0x%x, words = %d/%s" % (self.core, self.timestamp, self.fmt_addr,
+                                                                        len(self.words), self.words)
+
+
+def logbin_parse(fname):
+    ESP32_LOGBIN_HDR_FMT = '<LLL'
+    ESP32_LOGBIN_HDR_SZ = struct.calcsize(ESP32_LOGBIN_HDR_FMT)
+
+    try:
+        with open(fname, 'rb') as ftrc:
+            data = ftrc.read()
+    except (OSError, IOError) as e:
+        raise ESPLogBinParserError("Failed to open trace file (%s)!" % e)
+
+    recs = []
+    skipped = 0
+    pos = 0
+    while len(data) - pos >= ESP32_LOGBIN_HDR_SZ:
+        hdr, fmt_addr, timestamp = struct.unpack_from(ESP32_LOGBIN_HDR_FMT, data, pos)
+        if (hdr >> 24) != ESP_LOG_BINARY_SYNC:
+            # lost sync, look for the next record header
+            pos += 4
+            skipped += 4
+            continue
+        nwords = hdr & 0xFF
+        args_sz = 4 * nwords
+        if len(data) - pos - ESP32_LOGBIN_HDR_SZ < args_sz:
+            break
+        words = struct.unpack_from('<%dL' % nwords, data, pos + ESP32_LOGBIN_HDR_SZ)
+        recs.append(ESPLogBinRecord((hdr >> 8) & 0xFF, (hdr >> 16) & 0xFF, timestamp, fmt_addr, list(words)))
+        pos += ESP32_LOGBIN_HDR_SZ + args_sz
+    if skipped > 0:
+        print("Skipped %d bytes of invalid log record data!" % skipped)
+    if pos < len(data):
+        print("Unprocessed %d bytes of log record data!" % (len(data) - pos))
+    return recs
+
+
+def to_signed(val, bits):
+    if val & (1 << (bits - 1)):
+        return val - (1 << bits)
+    return val
+
+
+def logbin_format(felf, fmt_str, words):
+    """
+        Formats one record, consuming the argument words in the same order
+        as the conversions of the format string were encoded on the target.
+    """
+    out = []
+    wi = 0
+    last = 0
+    for m in CONV_RE.finditer(fmt_str):
+        out.append(fmt_str[last:m.start()])
+        last = m.end()
+        flags, width, prec, length, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        spec = '%' + flags
+        if width == '*':
+            width = str(to_signed(words[wi], 32))
+            wi += 1
+        spec += width or ''
+        if prec == '*':
+            prec = str(to_signed(words[wi], 32))
+            wi += 1
+        if prec is not None:
+            spec += '.' + prec
+        if conv == 's':
+            word = words[wi]
+            wi += 1
+            if word == 0:
+                arg = '(null)'
+            elif word & ESP_LOG_BINARY_INLINE_STRING:
+                slen = word & ~ESP_LOG_BINARY_INLINE_STRING
+                raw = struct.pack('<%dL' % ((slen + 3) // 4), *words[wi:wi + (slen + 3) // 4])
+                wi += (slen + 3) // 4
+                arg = raw[:slen].decode('utf-8', 'replace')
+            else:
+                arg = apptrace.get_str_from_elf(felf, word)
+                if arg is None:
+                    arg = '<0x%x>' % word
+            out.append((spec + 's') % arg)
+        elif conv in 'fFeEgGaA':
+            arg = struct.unpack('<d', struct.pack('<LL', words[wi], words[wi + 1]))[0]
+            wi += 2
+            out.append((spec + (conv if conv not in 'aA' else 'g')) % arg)
+        else:
+            if length.count('l') >= 2 or 'q' in length or 'j' in length:
+                arg = words[wi] | (words[wi + 1] << 32)
+                bits = 64
+                wi += 2
+            else:
+                arg = words[wi]
+                bits = 32
+                wi += 1
+            if conv in 'di':
+                out.append((spec + 'd') % to_signed(arg, bits))
+            elif conv == 'p':
+                out.append('0x' + (spec + 'x') % arg)
+            elif conv == 'n':
+                pass
+            else:
+                out.append((spec + conv) % arg)
+    out.append(fmt_str[last:])
+    return ''.join(out)
+
+
+def logbin_formated_print(recs, elfname, no_err, details):
+    try:
+        felf = elffile.ELFFile(open(elfname, 'rb'))
+    except (OSError, IOError) as e:
+        raise ESPLogBinParserError("Failed to open ELF file (%s)!" % e)
+
+    for lrec in recs:
+        if lrec.dropped and not no_err:
+            print("[%d records dropped on core %d]" % (lrec.dropped, lrec.core))
+        fmt_str = apptrace.get_str_from_elf(felf, lrec.fmt_addr)
+        if fmt_str is None:
+            if not no_err:
+                print("Format string at 0x%x not found!" % lrec.fmt_addr)
+            continue
+        if details:
+            print("[%d] %d: " % (lrec.core, lrec.timestamp), end='')
+        try:
+            print(logbin_format(felf, fmt_str, lrec.words), end='')
+        except Exception as e:
+            if not no_err:
+                print("Print error (%s)" % e)
+                print("\nFmt = {%s}, args = %d/%s" % (fmt_str, len(lrec.words), lrec.words))
+    felf.stream.close()
+
+
+def main():
+
+    parser = argparse.ArgumentParser(description='ESP32 Binary Log Parsing Tool')
+
+    parser.add_argument('trace_file', help='Path to binary log file', type=str)
+    parser.add_argument('elf_file', help='Path to program ELF file', type=str)
+    parser.add_argument('--print-details', '-d', help='Print CPU core and timestamp of every record', action='store_true')
+    parser.add_argument('--no-errors', '-n', help='Do not print errors', action='store_true')
+    args = parser.parse_args()
+
+    try:
+        print("Parse trace file '%s'..." % args.trace_file)
+        lrecs = logbin_parse(args.trace_file)
+        print("Parsing completed.")
+    except ESPLogBinParserError as e:
+        print("Failed to parse binary log (%s)!" % e)
+        sys.exit(2)
+    print("====================================================================")
+    try:
+        logbin_formated_print(lrecs, args.elf_file, args.no_errors, args.print_details)
+    except ESPLogBinParserError as e:
+        print("Failed to print binary log (%s)!" % e)
+        sys.exit(2)
+    print("\n====================================================================\n")
+
+    print("Log records count: %d" % len(lrecs))
+    print("Dropped records count: %d" % sum(r.dropped for r in lrecs))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,9 @@
+#! /bin/bash
+
+{ coverage debug sys \
+    && coverage erase &> output \
+    && coverage run -a $IDF_PATH/tools/esp_app_trace/logbin_proc.py log.bin ../logtrace/test.elf &>> output \
+    && coverage run -a $IDF_PATH/tools/esp_app_trace/logbin_proc.py -d -n log.bin ../logtrace/test.elf &>> output \
+    && diff output expected_output \
+    && coverage report \
+; } || { echo 'The test for logbin_proc has failed. Please examine the artifacts.' ; exit 1; }